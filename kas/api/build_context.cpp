@@ -0,0 +1,162 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "api/build_context.hpp"
+#include "kdl/lexer_cache.hpp"
+#include "kdl/sema.hpp"
+
+// MARK: - Constructor
+
+kdk::build_context::build_context(std::shared_ptr<const kdk::build_context> parent)
+    : m_parent(parent),
+      m_assemblers(std::make_shared<kdk::assembler_pool>(parent ? parent->m_assemblers : nullptr))
+{
+    // The target of the context only collects resources. A new target is constructed for
+    // each write.
+    m_target = std::make_shared<kdk::target>("", m_assemblers);
+}
+
+// MARK: - Configuration
+
+void kdk::build_context::set_sink(log::sink sink)
+{
+    m_sink = sink;
+}
+
+void kdk::build_context::set_job_count(std::size_t jobs)
+{
+    m_jobs = jobs;
+}
+
+void kdk::build_context::set_cache(std::shared_ptr<kdk::assembly_cache> cache)
+{
+    m_cache = cache;
+}
+
+void kdk::build_context::set_compression(bool compresses)
+{
+    m_compresses = compresses;
+}
+
+// MARK: - Operations
+
+bool kdk::build_context::perform(const std::function<void()>& operation)
+{
+    log::scope scope { m_sink };
+    try {
+        operation();
+        m_last_error.clear();
+        return true;
+    }
+    catch (const std::exception& e) {
+        m_last_error = e.what();
+        return false;
+    }
+}
+
+bool kdk::build_context::lex(const std::string& path, std::vector<kdl::lexer::token>& tokens)
+{
+    return perform([&] {
+        tokens = kdl::lexer_cache::shared().analyze(path);
+    });
+}
+
+bool kdk::build_context::lex(const std::string& name, const std::string& source, std::vector<kdl::lexer::token>& tokens)
+{
+    return perform([&] {
+        tokens = kdl::lexer(name, source).analyze();
+    });
+}
+
+bool kdk::build_context::parse(const std::vector<kdl::lexer::token>& tokens)
+{
+    return perform([&] {
+        kdl::sema(m_target, tokens).run();
+    });
+}
+
+bool kdk::build_context::add_file(const std::string& path)
+{
+    std::vector<kdl::lexer::token> tokens;
+    if (!lex(path, tokens)) {
+        return false;
+    }
+    m_target->add_dependency(path);
+    return parse(tokens);
+}
+
+bool kdk::build_context::add_source(const std::string& name, const std::string& source)
+{
+    std::vector<kdl::lexer::token> tokens;
+    return lex(name, source, tokens) && parse(tokens);
+}
+
+bool kdk::build_context::write(const std::string& path, kdk::output_format format)
+{
+    return perform([&] {
+        std::vector<kdk::resource> resources;
+        collect_resources(resources);
+        
+        kdk::target target { path, m_assemblers };
+        target.set_job_count(m_jobs);
+        target.set_cache(m_cache);
+        target.set_compression(m_compresses);
+        target.add_resources(std::move(resources));
+        target.build(format);
+    });
+}
+
+// MARK: - Accessors
+
+void kdk::build_context::collect_resources(std::vector<kdk::resource>& resources) const
+{
+    if (m_parent) {
+        m_parent->collect_resources(resources);
+    }
+    const auto& own = m_target->resources();
+    resources.insert(resources.end(), own.begin(), own.end());
+}
+
+std::size_t kdk::build_context::resource_count() const
+{
+    return m_target->resources().size() + (m_parent ? m_parent->resource_count() : 0);
+}
+
+std::vector<std::string> kdk::build_context::type_names() const
+{
+    return m_assemblers->type_names();
+}
+
+uint64_t kdk::build_context::type_generation() const
+{
+    return m_assemblers->generation();
+}
+
+const std::vector<std::string>& kdk::build_context::dependencies() const
+{
+    return m_target->dependencies();
+}
+
+const std::string& kdk::build_context::last_error() const
+{
+    return m_last_error;
+}
@@ -0,0 +1,174 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <memory>
+#include "kdl/lexer.hpp"
+#include "structures/target.hpp"
+#include "assemblers/pool.hpp"
+#include "cache/assembly_cache.hpp"
+#include "diagnostic/log.hpp"
+#include "output/resource_writer.hpp"
+
+#if !defined(KDK_BUILD_CONTEXT)
+#define KDK_BUILD_CONTEXT
+
+namespace kdk
+{
+
+/**
+ * A build context holds the types and resources produced by parsing KDL sources, and
+ * assembles them into resource files. It is the means by which other programs compile
+ * KDL in-process, rather than by running `kas`.
+ *
+ * Contexts do not share any state, other than the cached tokens of source files, so
+ * separate contexts may be used from separate threads at once. Diagnostics are delivered
+ * to the sink of the context rather than printed, and errors are reported by returning
+ * false rather than by terminating the process.
+ *
+ * A context may have a parent, whose types are visible to it and whose resources are
+ * included in everything that it writes. Parsing a scenario into a parent context once
+ * allows many builds to be performed against it without parsing it again. A parent must
+ * not be modified whilst its children are in use.
+ */
+class build_context
+{
+public:
+    build_context(const build_context&) = delete;
+    build_context& operator=(const build_context &) = delete;
+    
+    /**
+     * Construct a new build context, with an optional parent context.
+     */
+    build_context(std::shared_ptr<const kdk::build_context> parent = nullptr);
+    
+    /**
+     * Set the function that receives the diagnostics of the context. It may be called
+     * from several threads at once whilst resources are being assembled.
+     */
+    void set_sink(log::sink sink);
+    
+    /**
+     * Set the number of threads that are used to assemble resources. If zero is
+     * specified then the number of hardware threads is used.
+     */
+    void set_job_count(std::size_t jobs);
+    
+    /**
+     * Set the assembly cache that is used to reuse the assembled data of resources that
+     * have not changed since a previous write.
+     */
+    void set_cache(std::shared_ptr<kdk::assembly_cache> cache);
+    
+    /**
+     * Set whether written resource data is compressed, in formats that support it.
+     */
+    void set_compression(bool compresses);
+    
+    /**
+     * Analyse the specified source file, producing its tokens.
+     */
+    bool lex(const std::string& path, std::vector<kdl::lexer::token>& tokens);
+    
+    /**
+     * Analyse the specified source text, producing its tokens. The name is used to
+     * identify the source in diagnostics.
+     */
+    bool lex(const std::string& name, const std::string& source, std::vector<kdl::lexer::token>& tokens);
+    
+    /**
+     * Perform semantic analysis of the tokens, registering the types that they define and
+     * adding the resources that they declare to the context.
+     *
+     * If this fails then the context may hold some of the types and resources of the
+     * tokens, and should be discarded.
+     */
+    bool parse(const std::vector<kdl::lexer::token>& tokens);
+    
+    /**
+     * Lex and parse the specified source file.
+     */
+    bool add_file(const std::string& path);
+    
+    /**
+     * Lex and parse the specified source text.
+     */
+    bool add_source(const std::string& name, const std::string& source);
+    
+    /**
+     * Assemble every resource of the context and its ancestors, and write them to the
+     * specified path in the specified format. The context is unchanged, so it may be
+     * written any number of times.
+     */
+    bool write(const std::string& path, kdk::output_format format = kdk::output_format::classic);
+    
+    /**
+     * Returns the number of resources held by the context and its ancestors.
+     */
+    std::size_t resource_count() const;
+    
+    /**
+     * Returns the names of the types visible to the context.
+     */
+    std::vector<std::string> type_names() const;
+    
+    /**
+     * Returns a number that changes whenever the types visible to the context change.
+     */
+    uint64_t type_generation() const;
+    
+    /**
+     * Returns the files that the context has read, excluding those of its ancestors.
+     */
+    const std::vector<std::string>& dependencies() const;
+    
+    /**
+     * Returns the message of the error that caused the most recent call to fail.
+     */
+    const std::string& last_error() const;
+    
+private:
+    std::shared_ptr<const kdk::build_context> m_parent;
+    std::shared_ptr<kdk::assembler_pool> m_assemblers;
+    std::shared_ptr<kdk::target> m_target;
+    std::size_t m_jobs { 1 };
+    bool m_compresses { false };
+    std::shared_ptr<kdk::assembly_cache> m_cache;
+    log::sink m_sink;
+    std::string m_last_error;
+    
+    /**
+     * Perform an operation within the diagnostic scope of the context, recording the
+     * error that causes it to fail.
+     */
+    bool perform(const std::function<void()>& operation);
+    
+    /**
+     * Append the resources of the context and its ancestors to the list, ancestors first.
+     */
+    void collect_resources(std::vector<kdk::resource>& resources) const;
+};
+
+};
+
+#endif
@@ -0,0 +1,207 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include "api/kdl.h"
+#include "api/build_context.hpp"
+
+// MARK: - Context
+
+struct kdl_context
+{
+    std::shared_ptr<kdk::build_context> context;
+    std::mutex diagnostic_lock;
+    kdl_diagnostic_callback callback { nullptr };
+    void *user_data { nullptr };
+    std::vector<std::string> type_names;
+    bool has_type_names { false };
+    uint64_t type_generation { 0 };
+    std::string error;
+};
+
+static inline kdk::output_format format_for(kdl_format format)
+{
+    switch (format) {
+        case KDL_FORMAT_EXTENDED: return kdk::output_format::extended;
+        case KDL_FORMAT_REZ: return kdk::output_format::rez;
+        case KDL_FORMAT_KESTREL: return kdk::output_format::kestrel;
+        default: return kdk::output_format::classic;
+    }
+}
+
+static inline kdl_status status_for(bool success)
+{
+    return success ? KDL_OK : KDL_ERROR;
+}
+
+/**
+ * Perform an operation on a context on behalf of the caller. Exceptions must not cross
+ * the C interface, so any that escape the operation are recorded as the error of the
+ * context, and the failure value is returned instead.
+ */
+template<typename Result, typename Operation>
+static inline Result guarded(kdl_context *context, Result failure, Operation operation)
+{
+    context->error.clear();
+    try {
+        return operation();
+    }
+    catch (const std::exception& e) {
+        context->error = e.what();
+    }
+    catch (...) {
+        context->error = "An unknown error occurred.";
+    }
+    return failure;
+}
+
+// MARK: - Interface
+
+int kdl_api_version(void)
+{
+    return KDL_API_VERSION;
+}
+
+kdl_context *kdl_context_create(kdl_context *parent)
+{
+    auto context = new (std::nothrow) kdl_context();
+    if (!context) {
+        return nullptr;
+    }
+    try {
+        context->context = std::make_shared<kdk::build_context>(parent ? parent->context : nullptr);
+    }
+    catch (...) {
+        delete context;
+        return nullptr;
+    }
+    return context;
+}
+
+void kdl_context_destroy(kdl_context *context)
+{
+    delete context;
+}
+
+void kdl_context_set_diagnostic_callback(kdl_context *context, kdl_diagnostic_callback callback, void *user_data)
+{
+    guarded(context, false, [&] {
+        context->callback = callback;
+        context->user_data = user_data;
+        if (!callback) {
+            context->context->set_sink(nullptr);
+            return true;
+        }
+        
+        // The callback is never invoked by more than one thread at a time.
+        context->context->set_sink([context] (bool error, const std::string& file, int line, const std::string& message) {
+            std::lock_guard<std::mutex> lock(context->diagnostic_lock);
+            context->callback(context->user_data, error ? 1 : 0, file.c_str(), line, message.c_str());
+        });
+        return true;
+    });
+}
+
+void kdl_context_set_job_count(kdl_context *context, size_t jobs)
+{
+    context->context->set_job_count(jobs);
+}
+
+void kdl_context_set_compression(kdl_context *context, int enabled)
+{
+    context->context->set_compression(enabled != 0);
+}
+
+kdl_status kdl_context_add_file(kdl_context *context, const char *path)
+{
+    return guarded(context, KDL_ERROR, [&] {
+        if (!path) {
+            throw std::invalid_argument("No path was given.");
+        }
+        return status_for(context->context->add_file(path));
+    });
+}
+
+kdl_status kdl_context_add_source(kdl_context *context, const char *name, const char *source, size_t length)
+{
+    return guarded(context, KDL_ERROR, [&] {
+        if (!name || (!source && length > 0)) {
+            throw std::invalid_argument("No name or source was given.");
+        }
+        return status_for(context->context->add_source(name, std::string(source ? source : "", length)));
+    });
+}
+
+kdl_status kdl_context_write(kdl_context *context, const char *path, kdl_format format)
+{
+    return guarded(context, KDL_ERROR, [&] {
+        if (!path) {
+            throw std::invalid_argument("No path was given.");
+        }
+        return status_for(context->context->write(path, format_for(format)));
+    });
+}
+
+size_t kdl_context_resource_count(const kdl_context *context)
+{
+    try {
+        return context->context->resource_count();
+    }
+    catch (...) {
+        return 0;
+    }
+}
+
+size_t kdl_context_type_count(const kdl_context *context)
+{
+    try {
+        return context->context->type_names().size();
+    }
+    catch (...) {
+        return 0;
+    }
+}
+
+const char *kdl_context_type_name(kdl_context *context, size_t index)
+{
+    return guarded(context, static_cast<const char *>(nullptr), [&] () -> const char * {
+        // The names are only refreshed when the types of the context have changed, so that
+        // the names that were returned earlier remain valid until then.
+        auto generation = context->context->type_generation();
+        if (!context->has_type_names || context->type_generation != generation) {
+            context->type_names = context->context->type_names();
+            context->has_type_names = true;
+            context->type_generation = generation;
+        }
+        return index < context->type_names.size() ? context->type_names[index].c_str() : nullptr;
+    });
+}
+
+const char *kdl_context_last_error(const kdl_context *context)
+{
+    if (!context->error.empty()) {
+        return context->error.c_str();
+    }
+    return context->context->last_error().c_str();
+}
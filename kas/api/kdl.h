@@ -0,0 +1,154 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <stddef.h>
+
+#if !defined(KDL_API)
+#define KDL_API
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/**
+ * The C interface to the KDL compiler, for embedding it in other programs.
+ *
+ * Sources are compiled into a context, which holds the types that they define and the
+ * resources that they declare, and which can then be written as a resource file. A
+ * context may be created with a parent, typically holding the definitions of a
+ * scenario, whose types and resources are visible to it. The parent is retained by its
+ * children, so it may be destroyed by the caller at any time, but it must not have
+ * further sources added whilst its children are in use.
+ *
+ * Separate contexts may be used from separate threads at once. A single context must
+ * only be used by one thread at a time.
+ *
+ * Functions that can fail return `KDL_OK` on success. On failure, including a failure to
+ * allocate memory or a missing argument, the message of the error is available from
+ * `kdl_context_last_error`.
+ */
+
+/**
+ * The version of this interface. It changes only when the interface changes
+ * incompatibly.
+ */
+#define KDL_API_VERSION 1
+
+typedef struct kdl_context kdl_context;
+
+typedef enum kdl_status
+{
+    KDL_OK = 0,
+    KDL_ERROR = 1,
+} kdl_status;
+
+typedef enum kdl_format
+{
+    KDL_FORMAT_CLASSIC = 0,
+    KDL_FORMAT_EXTENDED = 1,
+    KDL_FORMAT_REZ = 2,
+    KDL_FORMAT_KESTREL = 3,
+} kdl_format;
+
+/**
+ * Receives a diagnostic. The file and message are only valid for the duration of the
+ * call. Whilst resources are written, this may be called from several threads at once.
+ */
+typedef void (*kdl_diagnostic_callback)(void *user_data, int is_error, const char *file, int line, const char *message);
+
+/**
+ * Returns the version of the interface implemented by the library.
+ */
+int kdl_api_version(void);
+
+/**
+ * Create a new context, with an optional parent context.
+ */
+kdl_context *kdl_context_create(kdl_context *parent);
+
+/**
+ * Destroy a context.
+ */
+void kdl_context_destroy(kdl_context *context);
+
+/**
+ * Set the function that receives the diagnostics of the context. Diagnostics are
+ * discarded if no function is set.
+ */
+void kdl_context_set_diagnostic_callback(kdl_context *context, kdl_diagnostic_callback callback, void *user_data);
+
+/**
+ * Set the number of threads used to assemble resources. Zero uses every hardware thread.
+ */
+void kdl_context_set_job_count(kdl_context *context, size_t jobs);
+
+/**
+ * Set whether resource data is compressed when written in a format that supports it,
+ * which are KDL_FORMAT_EXTENDED and KDL_FORMAT_KESTREL. Compression is disabled by
+ * default.
+ */
+void kdl_context_set_compression(kdl_context *context, int enabled);
+
+/**
+ * Compile the specified source file into the context.
+ */
+kdl_status kdl_context_add_file(kdl_context *context, const char *path);
+
+/**
+ * Compile source text into the context. The name identifies the source in diagnostics.
+ */
+kdl_status kdl_context_add_source(kdl_context *context, const char *name, const char *source, size_t length);
+
+/**
+ * Assemble the resources of the context and its ancestors, and write them to the
+ * specified path.
+ */
+kdl_status kdl_context_write(kdl_context *context, const char *path, kdl_format format);
+
+/**
+ * Returns the number of resources held by the context and its ancestors.
+ */
+size_t kdl_context_resource_count(const kdl_context *context);
+
+/**
+ * Returns the number of types visible to the context.
+ */
+size_t kdl_context_type_count(const kdl_context *context);
+
+/**
+ * Returns the name of the type at the specified index, or NULL if there is none. The
+ * name remains valid until the types visible to the context change, or the context is
+ * destroyed.
+ */
+const char *kdl_context_type_name(kdl_context *context, size_t index);
+
+/**
+ * Returns the message of the error that caused the most recent call on the context to
+ * fail, or an empty string.
+ */
+const char *kdl_context_last_error(const kdl_context *context);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
@@ -20,158 +20,515 @@
 * SOFTWARE.
 */
 
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
 #include "assemblers/assembler.hpp"
 #include "diagnostic/log.hpp"
+#include "cache/hasher.hpp"
+#include "image/image_cache.hpp"
 
+// MARK: - Helpers
 
-// MARK: - Assembly
+static inline uint64_t referenced_file_size(const std::string& path)
+{
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) {
+        log::error(path, 0, "Unable to read referenced file: " + std::string(strerror(errno)));
+    }
+    if (!S_ISREG(info.st_mode)) {
+        log::error(path, 0, "The referenced file is not a regular file.");
+    }
+    return static_cast<uint64_t>(info.st_size);
+}
 
-std::shared_ptr<graphite::data::data> kdk::assembler::assemble_resource(const kdk::resource resource)
+static inline uint64_t p_string_length(const kdk::assembler::instruction& instruction, const std::string& value)
 {
-    auto writer = std::make_shared<graphite::data::writer>();
+    // Pascal Strings are limited to 255 characters, and to the fixed width of their value
+    // if one was specified, less the length byte.
+    auto limit = instruction.width ? std::min<uint64_t>(instruction.width - 1, 255) : 255;
+    return std::min<uint64_t>(value.size(), limit);
+}
+
+// MARK: - Compilation
+
+void kdk::assembler::compile()
+{
+    m_program.clear();
+    m_symbol_tables.clear();
+    m_field_slots.clear();
+    m_fixed_size = true;
+    m_data_size = 0;
+    
+    // The set of resource value types accepted by each encoding slot is resolved now
+    // so that assembly only needs to test a bit.
+    const kdk::resource::field::value_type all_types[] = {
+        kdk::resource::field::value_type::identifier,
+        kdk::resource::field::value_type::resource_id,
+        kdk::resource::field::value_type::integer,
+        kdk::resource::field::value_type::string,
+        kdk::resource::field::value_type::percentage,
+        kdk::resource::field::value_type::file_reference,
+        kdk::resource::field::value_type::color,
+        kdk::resource::field::value_type::image_reference,
+    };
+    
+    std::vector<std::tuple<std::size_t, std::string>> defaults;
+    
+    for (auto n = 0; n < m_fields.size(); ++n) {
+        auto& field = m_fields[n];
+        m_field_slots[field.name()] = n;
+        m_data_size = std::max(m_data_size, field.required_data_size());
+        
+        // Select the field. The jump target for a missing field is patched once the
+        // encoding instructions have been emitted.
+        auto select = m_program.size();
+        kdk::assembler::instruction select_instruction;
+        select_instruction.op = kdk::assembler::instruction::opcode::select_field;
+        select_instruction.field = n;
+        m_program.push_back(select_instruction);
+        
+        for (auto v = 0; v < field.expected_values().size(); ++v) {
+            auto& value = field.expected_values()[v];
+            
+            kdk::assembler::instruction encode_instruction;
+            encode_instruction.field = n;
+            encode_instruction.value = v;
+            encode_instruction.offset = value.offset();
+            encode_instruction.width = value.size();
+            
+            for (auto type : all_types) {
+                if (value.type_allowed(type)) {
+                    encode_instruction.accepted_types |= (1 << type);
+                }
+            }
+            
+            // Only values declared as p_string are Pascal Strings. Every other string is
+            // written as a C String, as it always has been.
+            if (value.type_mask() == kdk::assembler::field::value::type::p_string) {
+                encode_instruction.op = kdk::assembler::instruction::opcode::encode_p_string;
+            }
+            else if (value.type_mask() & kdk::assembler::field::value::type::string) {
+                encode_instruction.op = kdk::assembler::instruction::opcode::encode_c_string;
+            }
+            else if (value.type_mask() == kdk::assembler::field::value::type::color) {
+                encode_instruction.op = kdk::assembler::instruction::opcode::encode_color;
+            }
+            else if (value.type_mask() == kdk::assembler::field::value::type::bitmask) {
+                encode_instruction.op = kdk::assembler::instruction::opcode::encode_bitmask;
+            }
+            else if (value.type_mask() == kdk::assembler::field::value::type::data) {
+                encode_instruction.op = kdk::assembler::instruction::opcode::encode_file;
+            }
+            else {
+                encode_instruction.op = kdk::assembler::instruction::opcode::encode_integer;
+            }
+            
+            // Symbols are stored as their textual values in the definition. Convert them
+            // to integers once, here, and build a perfect hash of them.
+            std::vector<std::tuple<std::string, int64_t>> symbols;
+            for (auto symbol : value.symbols()) {
+                symbols.push_back(std::make_tuple(std::get<0>(symbol), std::stoll(std::get<1>(symbol))));
+            }
+            encode_instruction.symbols = m_symbol_tables.size();
+            m_symbol_tables.push_back(kdk::symbol_table(symbols));
+            
+            if (value.has_default_value()) {
+                defaults.push_back(std::make_tuple(m_program.size(), field.name()));
+            }
+            
+            // Strings may extend beyond their nominal width, bitmasks may consume a variable
+            // number of values, and files must be checked, so resources of the type need
+            // measuring.
+            if (encode_instruction.op == kdk::assembler::instruction::opcode::encode_c_string ||
+                encode_instruction.op == kdk::assembler::instruction::opcode::encode_p_string ||
+                encode_instruction.op == kdk::assembler::instruction::opcode::encode_bitmask ||
+                encode_instruction.op == kdk::assembler::instruction::opcode::encode_file) {
+                m_fixed_size = false;
+            }
+            
+            m_program.push_back(encode_instruction);
+        }
+        
+        m_program[select].target = m_program.size();
+    }
+    
+    // Build the template record for the type. Every resource starts as a copy of this,
+    // with all of the default values already encoded into it.
+    uint64_t template_size = m_data_size;
+    for (auto d : defaults) {
+        const auto& instruction = m_program[std::get<0>(d)];
+        auto default_value = m_fields[instruction.field].expected_values()[instruction.value].default_value();
+        template_size = std::max(template_size, extent(instruction, std::get<0>(default_value), std::get<1>(default_value)));
+    }
     
-    for (auto field : m_fields) {
-        assemble(resource, field, writer);
+    m_template = std::vector<char>(template_size, 0);
+    for (auto d : defaults) {
+        const auto& instruction = m_program[std::get<0>(d)];
+        auto default_value = m_fields[instruction.field].expected_values()[instruction.value].default_value();
+        encode(m_template.data(), m_template.size(), instruction, std::get<1>(d), std::get<0>(default_value), std::get<1>(default_value));
     }
     
-    return writer->data();
+    // Fingerprint the definition. Anything that can affect the assembled bytes of a
+    // resource must contribute to it. The version must change whenever the encoding
+    // of a definition changes.
+    kdk::hasher fingerprint;
+    fingerprint.update(std::string("kas-assembler-1"));
+    for (auto& field : m_fields) {
+        fingerprint.update(field.name()).update(field.deprecation_note()).update(field.is_required() ? 1 : 0);
+        fingerprint.update(field.expected_values().size());
+        for (auto& value : field.expected_values()) {
+            fingerprint.update(value.type_mask()).update(value.offset()).update(value.size());
+            fingerprint.update(value.symbols().size());
+            for (const auto& symbol : value.symbols()) {
+                fingerprint.update(std::get<0>(symbol)).update(std::get<1>(symbol));
+            }
+        }
+    }
+    fingerprint.update(m_template.size()).update(m_template.data(), m_template.size());
+    m_fingerprint = fingerprint.digest();
 }
 
-void kdk::assembler::add_reference(const kdk::assembler::reference reference)
+// MARK: - Assembly
+
+std::vector<const kdk::resource::field *> kdk::assembler::slot_fields(const kdk::resource& resource) const
 {
-    m_refs.push_back(reference);
+    // Unknown fields are ignored, as they have always been.
+    std::vector<const kdk::resource::field *> slots(m_fields.size(), nullptr);
+    for (auto& resource_field : resource.fields()) {
+        auto it = m_field_slots.find(resource_field.name());
+        if (it != m_field_slots.end()) {
+            slots[it->second] = &resource_field;
+        }
+    }
+    return slots;
 }
 
-void kdk::assembler::add_field(const kdk::assembler::field field)
+uint64_t kdk::assembler::measure_resource(const kdk::resource& resource) const
 {
-    m_fields.push_back(field);
+    // Only strings and bitmasks can change the layout of a record, so types without them
+    // are always the size of the template.
+    if (m_fixed_size) {
+        return m_template.size();
+    }
+    return execute(slot_fields(resource), nullptr, 0);
 }
 
-void kdk::assembler::assemble(const kdk::resource resource, kdk::assembler::field field, std::shared_ptr<graphite::data::writer> writer)
+std::shared_ptr<graphite::data::data> kdk::assembler::assemble_resource(const kdk::resource& resource) const
 {
-    // Find the field with in the resource
-    auto resource_field = find_field(field.name(), resource, field.is_required());
-    
-    // Ensure the data object is large enough for this field.
-    writer->set_position(writer->size());
-    writer->pad_to_size(field.required_data_size());
-    writer->set_position(field.offset());
-    
-    // Is the field deprecated? If show show a warning.
-    if (field.is_deprecated()) {
-        log::warning("<missing>", 0, field.deprecation_note());
+    auto size = measure_resource(resource);
+    auto buffer = std::make_shared<std::vector<char>>(size, 0);
+    return assemble_resource(resource, buffer, 0, size);
+}
+
+std::shared_ptr<graphite::data::data> kdk::assembler::assemble_resource(const kdk::resource& resource, std::shared_ptr<std::vector<char>> buffer, std::size_t start, uint64_t size) const
+{
+    auto record = buffer->data() + start;
+    std::copy(m_template.begin(), m_template.end(), record);
+    if (execute(slot_fields(resource), record, size) != size) {
+        log::error("<missing>", 0, "The size of resource #" + std::to_string(resource.id()) + " changed whilst it was being assembled.");
     }
+    return std::make_shared<graphite::data::data>(buffer, size, start);
+}
+
+std::string kdk::assembler::cache_key(const kdk::resource& resource) const
+{
+    // The fields are hashed in the order of the definition, exactly as they will be
+    // seen by the encoding program, so the order in the source does not matter.
+    kdk::hasher key;
+    key.update(m_fingerprint);
+    for (auto field : slot_fields(resource)) {
+        if (!field) {
+            key.update(0);
+            continue;
+        }
+        key.update(1).update(field->values().size());
+        for (const auto& value : field->values()) {
+            key.update(std::get<1>(value)).update(std::get<0>(value));
+            
+            // Files and images are identified by their contents. A file that can not be
+            // read is left out, as it fails to assemble and so is never cached.
+            std::string digest;
+            if (std::get<1>(value) == kdk::resource::field::value_type::file_reference && kdk::hasher::digest_file(std::get<0>(value), digest)) {
+                key.update(digest);
+            }
+            else if (std::get<1>(value) == kdk::resource::field::value_type::image_reference) {
+                for (const auto& path : kdk::image_cache::reference_paths(std::get<0>(value))) {
+                    if (kdk::hasher::digest_file(path, digest)) {
+                        key.update(digest);
+                    }
+                }
+            }
+        }
+    }
+    return key.digest();
+}
+
+uint64_t kdk::assembler::execute(const std::vector<const kdk::resource::field *>& slots, char *record, uint64_t capacity) const
+{
+    const kdk::resource::field *current_field = nullptr;
+    std::size_t cursor = 0;
+    std::size_t remaining = 0;
+    uint64_t size = m_template.size();
     
-    // If the field was provided in the script, then handle it, otherwise try to fill it in with
-    // default values.
-    if (resource_field) {
-        // Check the number of values matches what we actually have.
-        if (resource_field->values().size() != field.expected_values().size()) {
-            log::error("<missing>", 0, "Incorrect number of values passed to field '" + field.name() + "'.");
+    auto pc = 0;
+    while (pc <= m_program.size()) {
+        // Every value provided for the previous field must have been consumed.
+        if (current_field && remaining == 0 && cursor != current_field->values().size()) {
+            log::error("<missing>", 0, "Incorrect number of values passed to field '" + current_field->name() + "'.");
         }
         
-        // Prepare to encode and validate each of the values.
-        for (auto n = 0; n < field.expected_values().size(); ++n) {
-            auto value = resource_field->values()[n];
-            auto expected_value = field.expected_values()[n];
+        if (pc == m_program.size()) {
+            break;
+        }
+        const auto& instruction = m_program[pc++];
+        
+        if (instruction.op == kdk::assembler::instruction::opcode::select_field) {
+            const auto& field = m_fields[instruction.field];
+            current_field = slots[instruction.field];
+            cursor = 0;
+            remaining = field.expected_values().size();
             
-            if (!expected_value.type_allowed(std::get<1>(value))) {
-                // The value type is incorrect
-                log::error("<missing>", 0, "Incorrect value type provided on field '" + field.name() + "' value " + std::to_string(n) + ".");
+            // Is the field deprecated? If show show a warning.
+            if (record && field.is_deprecated()) {
+                log::warning("<missing>", 0, field.deprecation_note());
             }
             
-            // Seek to the appropriate location in the data for encoding.
-            writer->set_position(expected_value.offset());
-            
-            // Handle the value appropriately and encode it into the data.
-            switch (std::get<1>(value)) {
-                case kdk::resource::field::value_type::integer:
-                case kdk::resource::field::value_type::percentage: {
-                    encode(writer, std::get<0>(value), expected_value.size());
-                    break;
-                }
-                    
-                case kdk::resource::field::value_type::resource_id: {
-                    writer->write_signed_short(static_cast<int16_t>(std::stoi(std::get<0>(value))));
-                    break;
-                }
-                    
-                case kdk::resource::field::value_type::string: {
-                    if (expected_value.type_mask() & kdk::assembler::field::value::type::p_string) {
-                        // C String
-                        writer->write_cstr(std::get<0>(value), expected_value.size());
-                    }
-                    else {
-                        // Pascal String
-                        writer->write_pstr(std::get<0>(value));
-                    }
-                    break;
+            if (!current_field) {
+                if (field.is_required()) {
+                    log::error("<missing>", 0, "Missing field '" + field.name() + "' in resource.");
                 }
-                    
-                case kdk::resource::field::value_type::identifier: {
-                    for (auto symbol : expected_value.symbols()) {
-                        if (std::get<0>(value) == std::get<0>(symbol)) {
-                            encode(writer, std::get<1>(symbol), expected_value.size());
-                            goto SYMBOL_FOUND;
-                        }
+                pc = instruction.target;
+            }
+            else if (current_field->values().size() < field.expected_values().size()) {
+                log::error("<missing>", 0, "Incorrect number of values passed to field '" + field.name() + "'.");
+            }
+            continue;
+        }
+        
+        --remaining;
+        const auto& values = current_field->values();
+        
+        if (instruction.op == kdk::assembler::instruction::opcode::encode_bitmask) {
+            // A bitmask combines a run of flags into a single value.
+            auto count = bitmask_span(instruction, values, cursor, remaining);
+            if (record) {
+                int64_t flags = 0;
+                for (auto n = cursor; n < cursor + count; ++n) {
+                    if (!(instruction.accepted_types & (1 << std::get<1>(values[n])))) {
+                        log::error("<missing>", 0, "Incorrect value type provided on field '" + current_field->name() + "' value " + std::to_string(n) + ".");
                     }
-                    
-                    log::error("<missing>", 0, "The symbol '" + std::get<0>(value) + "' was not recognised.");
-                SYMBOL_FOUND:
-                    break;
-                }
-                    
-                case kdk::resource::field::value_type::file_reference: {
-                    // TODO
-                    break;
-                }
-                    
-                case kdk::resource::field::value_type::color: {
-                    auto rgb = static_cast<uint32_t>(std::stoi(std::get<0>(value)));
-                    writer->write_long(rgb);
-                    break;
+                    flags |= resolve_integer(instruction, std::get<0>(values[n]), std::get<1>(values[n]));
                 }
+                encode_integer(record, instruction.offset, flags, instruction.width);
             }
+            cursor += count;
+            continue;
         }
+        
+        const auto& value = values[cursor++];
+        if (record) {
+            encode(record, capacity, instruction, current_field->name(), std::get<0>(value), std::get<1>(value));
+        }
+        else if (!(instruction.accepted_types & (1 << std::get<1>(value)))) {
+            log::error("<missing>", 0, "Incorrect value type provided on field '" + current_field->name() + "' value " + std::to_string(instruction.value) + ".");
+        }
+        size = std::max(size, extent(instruction, std::get<0>(value), std::get<1>(value)));
     }
-    else {
-        // No field was specified in the resource, so write the default values.
-        for (auto expected : field.expected_values()) {
-            expected.write_default_value(writer);
+    
+    return size;
+}
+
+std::size_t kdk::assembler::bitmask_span(const kdk::assembler::instruction& instruction, const std::vector<std::tuple<std::string, kdk::resource::field::value_type>>& values, std::size_t first, std::size_t reserved) const
+{
+    // The bitmask always takes at least one value. It then keeps taking values whilst
+    // they are flags of the bitmask, and enough values remain for the rest of the field.
+    const auto& symbols = m_symbol_tables[instruction.symbols];
+    std::size_t count = 1;
+    
+    while (first + count + reserved < values.size()) {
+        const auto& value = values[first + count];
+        int64_t flag = 0;
+        if (std::get<1>(value) == kdk::resource::field::value_type::identifier && !symbols.find(std::get<0>(value), flag)) {
+            break;
+        }
+        else if (std::get<1>(value) != kdk::resource::field::value_type::identifier && std::get<1>(value) != kdk::resource::field::value_type::integer) {
+            break;
         }
+        ++count;
     }
     
+    return count;
 }
 
-void kdk::assembler::encode(std::shared_ptr<graphite::data::writer> writer, const std::string value, uint64_t width, bool is_signed)
+int64_t kdk::assembler::resolve_integer(const kdk::assembler::instruction& instruction, const std::string& value, kdk::resource::field::value_type type) const
 {
-    if (width == 1 && is_signed) {
-        writer->write_signed_byte(static_cast<int8_t>(std::stol(value)));
+    if (type == kdk::resource::field::value_type::identifier) {
+        int64_t symbol_value = 0;
+        if (!m_symbol_tables[instruction.symbols].find(value, symbol_value)) {
+            log::error("<missing>", 0, "The symbol '" + value + "' was not recognised.");
+        }
+        return symbol_value;
     }
-    else if (width == 1) {
-        writer->write_byte(static_cast<uint8_t>(std::stoul(value)));
+    return std::stoll(value);
+}
+
+void kdk::assembler::add_reference(const kdk::assembler::reference reference)
+{
+    m_refs.push_back(reference);
+}
+
+void kdk::assembler::add_field(const kdk::assembler::field field)
+{
+    m_fields.push_back(field);
+}
+
+const std::vector<kdk::assembler::field>& kdk::assembler::fields() const
+{
+    return m_fields;
+}
+
+// MARK: - Encoding
+
+uint64_t kdk::assembler::extent(const kdk::assembler::instruction& instruction, const std::string& value, kdk::resource::field::value_type type)
+{
+    switch (instruction.op) {
+        case kdk::assembler::instruction::opcode::encode_c_string: {
+            // C Strings occupy a fixed width if one was specified, otherwise they are terminated.
+            return instruction.offset + (instruction.width ? instruction.width : value.size() + 1);
+        }
+        case kdk::assembler::instruction::opcode::encode_p_string: {
+            // Pascal Strings are prefixed by a length byte, and occupy a fixed width if one
+            // was specified.
+            return instruction.offset + (instruction.width ? instruction.width : p_string_length(instruction, value) + 1);
+        }
+        case kdk::assembler::instruction::opcode::encode_color: {
+            return instruction.offset + 4;
+        }
+        case kdk::assembler::instruction::opcode::encode_file: {
+            // Files occupy a fixed width if one was specified, which they must fit within.
+            // Otherwise they occupy their own size. Files are checked as resources are
+            // measured, before anything is assembled.
+            auto is_image = type == kdk::resource::field::value_type::image_reference;
+            auto size = is_image ? kdk::image_cache::shared().data(value)->size() : referenced_file_size(value);
+            if (instruction.width && size > instruction.width) {
+                auto path = is_image ? kdk::image_cache::reference_paths(value).front() : value;
+                log::error(path, 0, "The referenced file is " + std::to_string(size) + " bytes long, but the value only has room for " + std::to_string(instruction.width) + " bytes.");
+            }
+            return instruction.offset + (instruction.width ? instruction.width : size);
+        }
+        default: {
+            return instruction.offset + instruction.width;
+        }
     }
-    else if (width == 2 && is_signed) {
-        writer->write_signed_short(static_cast<int16_t>(std::stol(value)));
+}
+
+void kdk::assembler::encode(char *record, uint64_t capacity, const kdk::assembler::instruction& instruction, const std::string& field_name, const std::string& value, kdk::resource::field::value_type type) const
+{
+    if (!(instruction.accepted_types & (1 << type))) {
+        log::error("<missing>", 0, "Incorrect value type provided on field '" + field_name + "' value " + std::to_string(instruction.value) + ".");
     }
-    else if (width == 2) {
-        writer->write_short(static_cast<uint16_t>(std::stoul(value)));
+    
+    switch (instruction.op) {
+        case kdk::assembler::instruction::opcode::encode_c_string: {
+            auto width = extent(instruction, value, type) - instruction.offset;
+            auto length = std::min<uint64_t>(value.size(), width - 1);
+            std::copy(value.begin(), value.begin() + length, record + instruction.offset);
+            std::fill(record + instruction.offset + length, record + instruction.offset + width, 0);
+            break;
+        }
+            
+        case kdk::assembler::instruction::opcode::encode_p_string: {
+            auto length = p_string_length(instruction, value);
+            record[instruction.offset] = static_cast<char>(length);
+            std::copy(value.begin(), value.begin() + length, record + instruction.offset + 1);
+            
+            // Clear the remainder of the value, which may hold a longer default.
+            auto end = std::max<uint64_t>(instruction.width, length + 1);
+            std::fill(record + instruction.offset + 1 + length, record + instruction.offset + end, 0);
+            break;
+        }
+            
+        case kdk::assembler::instruction::opcode::encode_color: {
+            encode_integer(record, instruction.offset, std::stoll(value), 4);
+            break;
+        }
+            
+        case kdk::assembler::instruction::opcode::encode_integer:
+        case kdk::assembler::instruction::opcode::encode_bitmask: {
+            encode_integer(record, instruction.offset, resolve_integer(instruction, value, type), instruction.width);
+            break;
+        }
+            
+        case kdk::assembler::instruction::opcode::encode_file: {
+            if (type == kdk::resource::field::value_type::image_reference) {
+                auto data = kdk::image_cache::shared().data(value);
+                if (instruction.offset + data->size() > capacity) {
+                    log::error(kdk::image_cache::reference_paths(value).front(), 0, "The imported image changed whilst the resource was being assembled.");
+                }
+                std::copy(data->begin(), data->end(), record + instruction.offset);
+                std::fill(record + instruction.offset + data->size(), record + instruction.offset + std::max<uint64_t>(instruction.width, data->size()), 0);
+            }
+            else {
+                encode_file(record, capacity, instruction, value);
+            }
+            break;
+        }
+            
+        default: {
+            break;
+        }
     }
-    else if (width == 4 && is_signed) {
-        writer->write_signed_long(static_cast<int32_t>(std::stol(value)));
+}
+
+void kdk::assembler::encode_file(char *record, uint64_t capacity, const kdk::assembler::instruction& instruction, const std::string& path)
+{
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        log::error(path, 0, "Unable to read referenced file: " + std::string(strerror(errno)));
     }
-    else if (width == 4) {
-        writer->write_long(static_cast<uint32_t>(std::stoul(value)));
+    
+    // The file is read straight into its place in the record. The record was sized when
+    // the resource was measured, so the file must not have grown since.
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || instruction.offset + static_cast<uint64_t>(info.st_size) > capacity) {
+        ::close(fd);
+        log::error(path, 0, "The referenced file changed whilst the resource was being assembled.");
     }
-    else if (width == 8 && is_signed) {
-        writer->write_signed_quad(static_cast<int64_t>(std::stoll(value)));
+    
+    uint64_t size = static_cast<uint64_t>(info.st_size);
+    uint64_t offset = 0;
+    while (offset < size) {
+        auto count = ::pread(fd, record + instruction.offset + offset, size - offset, static_cast<off_t>(offset));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            ::close(fd);
+            log::error(path, 0, "Unable to read referenced file.");
+        }
+        offset += count;
     }
-    else if (width == 8) {
-        writer->write_quad(static_cast<uint64_t>(std::stoull(value)));
+    ::close(fd);
+    
+    if (instruction.width > size) {
+        std::fill(record + instruction.offset + size, record + instruction.offset + instruction.width, 0);
     }
-    else {
+}
+
+void kdk::assembler::encode_integer(char *record, uint64_t offset, int64_t value, uint64_t width)
+{
+    if (width != 1 && width != 2 && width != 4 && width != 8) {
         throw std::runtime_error("Illegal integer width");
     }
+    
+    auto bits = static_cast<uint64_t>(value);
+    for (auto n = 0; n < width; ++n) {
+        record[offset + n] = static_cast<char>(bits >> ((width - n - 1) * 8));
+    }
 }
 
 // MARK: - References
@@ -291,11 +648,21 @@ std::string& kdk::assembler::field::name()
     return m_name;
 }
 
+const std::string& kdk::assembler::field::name() const
+{
+    return m_name;
+}
+
 std::vector<kdk::assembler::field::value>& kdk::assembler::field::expected_values()
 {
     return m_expected_values;
 }
 
+const std::vector<kdk::assembler::field::value>& kdk::assembler::field::expected_values() const
+{
+    return m_expected_values;
+}
+
 // MARK: - Values
 
 kdk::assembler::field::value::value(std::string name, kdk::assembler::field::value::type type, uint64_t offset, uint64_t size)
@@ -315,9 +682,10 @@ kdk::assembler::field::value kdk::assembler::field::value::set_symbols(const std
     return *this;
 }
 
-kdk::assembler::field::value kdk::assembler::field::value::set_default_value(const std::function<void(std::shared_ptr<graphite::data::writer>)> default_value)
+kdk::assembler::field::value kdk::assembler::field::value::set_default_value(const std::string value, kdk::resource::field::value_type type)
 {
-    m_default_value = default_value;
+    m_has_default_value = true;
+    m_default_value = std::make_tuple(value, type);
     return *this;
 }
 
@@ -336,10 +704,18 @@ std::vector<std::tuple<std::string, std::string>>& kdk::assembler::field::value:
     return m_symbols;
 }
 
+const std::vector<std::tuple<std::string, std::string>>& kdk::assembler::field::value::symbols() const
+{
+    return m_symbols;
+}
+
 bool kdk::assembler::field::value::type_allowed(kdk::resource::field::value_type type) const
 {
     switch (type) {
         case kdk::resource::field::value_type::file_reference:
+        case kdk::resource::field::value_type::image_reference: {
+            return m_type_mask & kdk::assembler::field::value::type::data;
+        }
         case kdk::resource::field::value_type::resource_id: {
             return m_type_mask & kdk::assembler::field::value::type::resource_reference;
         }
@@ -369,12 +745,14 @@ kdk::assembler::field::value::type kdk::assembler::field::value::type_mask() con
     return m_type_mask;
 }
 
-void kdk::assembler::field::value::write_default_value(std::shared_ptr<graphite::data::writer> writer) const
+bool kdk::assembler::field::value::has_default_value() const
 {
-    if (m_default_value) {
-        writer->set_position(m_offset);
-        m_default_value(writer);
-    }
+    return m_has_default_value;
+}
+
+std::tuple<std::string, kdk::resource::field::value_type> kdk::assembler::field::value::default_value() const
+{
+    return m_default_value;
 }
 
 // MARK: - Field Functions
@@ -23,8 +23,11 @@
 #include <type_traits>
 #include <memory>
 #include <tuple>
-#include "libGraphite/data/writer.hpp"
+#include <unordered_map>
+#include <string>
+#include "libGraphite/data/data.hpp"
 #include "structures/resource.hpp"
+#include "assemblers/symbol_table.hpp"
 
 #if !defined(KDK_ASSEMBLER)
 #define KDK_ASSEMBLER
@@ -126,6 +129,7 @@ public:
                 bitmask = (1 << 2),
                 string = (1 << 3),
                 color = (1 << 4),
+                data = (1 << 5),
                 c_string = (1 << 3) | (1 << 10),
                 p_string = (1 << 3) | (1 << 11),
             };
@@ -148,10 +152,10 @@ public:
             kdk::assembler::field::value set_symbols(const std::vector<std::tuple<std::string, std::string>> symbols);
             
             /**
-             * Specify a lambda that can be called so a default value can be written into the
-             * data object.
+             * Specify the default value that should be encoded when the field is not provided
+             * by a resource. Identifiers are resolved against the symbols of the value.
              */
-            kdk::assembler::field::value set_default_value(const std::function<void(std::shared_ptr<graphite::data::writer>)> default_value);
+            kdk::assembler::field::value set_default_value(const std::string value, kdk::resource::field::value_type type);
             
             /**
              * Returns the size of the value when encoded
@@ -174,14 +178,20 @@ public:
             kdk::assembler::field::value::type type_mask() const;
             
             /**
-             * Write the default value into the data.
+             * Returns whether or not the value has a default value.
              */
-            void write_default_value(std::shared_ptr<graphite::data::writer> writer) const;
+            bool has_default_value() const;
+            
+            /**
+             * Returns the default value of the value, and its type.
+             */
+            std::tuple<std::string, kdk::resource::field::value_type> default_value() const;
             
             /**
              * Returns a vector of symbol tuples for the value.
              */
             std::vector<std::tuple<std::string, std::string>>& symbols();
+            const std::vector<std::tuple<std::string, std::string>>& symbols() const;
             
         private:
             std::string m_name;
@@ -189,7 +199,8 @@ public:
             std::vector<std::tuple<std::string, std::string>> m_symbols;
             uint64_t m_size;
             uint64_t m_offset;
-            std::function<void(std::shared_ptr<graphite::data::writer>)> m_default_value;
+            bool m_has_default_value { false };
+            std::tuple<std::string, kdk::resource::field::value_type> m_default_value;
         };
         
     public:
@@ -254,11 +265,13 @@ public:
          * Returns the name of the field.
          */
         std::string& name();
+        const std::string& name() const;
         
         /**
          * Returns the expected values vector.
          */
         std::vector<kdk::assembler::field::value>& expected_values();
+        const std::vector<kdk::assembler::field::value>& expected_values() const;
         
     private:
         bool m_virtual { false };
@@ -268,14 +281,88 @@ public:
         std::vector<kdk::assembler::field::value> m_expected_values;
     };
     
+    /**
+     * The Instruction structure represents a single operation in the compiled
+     * encoding program of the assembler. The program is produced once, when the
+     * type is defined, and is then executed for every resource of that type.
+     */
+    struct instruction
+    {
+    public:
+        
+        /**
+         * Denotes the operation that the instruction performs.
+         *
+         *  - select_field: Locate the resource field in slot `field`. If the field was
+         *    not provided, execution continues at instruction `target`, leaving the
+         *    default values of the template in place.
+         *  - encode_integer: Encode the value as an integer of `width` bytes at `offset`,
+         *    substituting symbols from the symbol table at index `symbols`.
+         *  - encode_c_string / encode_p_string: Encode the value as a string at `offset`.
+         *  - encode_color: Encode the value as a 32-bit color at `offset`.
+         *  - encode_bitmask: Combine one or more flags from the symbol table at index
+         *    `symbols` and encode them as an integer of `width` bytes at `offset`.
+         *  - encode_file: Place the contents of the referenced file, or the data of the
+         *    imported image, into the record at `offset`, padded to `width` bytes if a
+         *    width was given.
+         */
+        enum opcode
+        {
+            select_field, encode_integer, encode_c_string, encode_p_string, encode_color, encode_bitmask, encode_file
+        };
+        
+    public:
+        opcode op;
+        std::size_t field { 0 };
+        std::size_t value { 0 };
+        std::size_t target { 0 };
+        std::size_t symbols { 0 };
+        uint64_t offset { 0 };
+        uint64_t width { 0 };
+        uint32_t accepted_types { 0 };
+    };
+    
 public:
     
+    /**
+     * Compile the field definitions of the assembler into an encoding program.
+     *
+     * This must be called once all fields have been added, and before any resources
+     * are assembled.
+     */
+    void compile();
+    
+    /**
+     * Returns the exact number of bytes that the specified resource will occupy once
+     * it has been assembled.
+     */
+    uint64_t measure_resource(const kdk::resource& resource) const;
+    
     /**
      * Performs assembly of the specified resource.
      *
-     * This method should be implemented by the subclass.
+     * This executes the compiled encoding program against the fields of the resource.
+     * The resource is assembled into a buffer of exactly the required size.
      */
-    std::shared_ptr<graphite::data::data> assemble_resource(const kdk::resource resource);
+    std::shared_ptr<graphite::data::data> assemble_resource(const kdk::resource& resource) const;
+    
+    /**
+     * Performs assembly of the specified resource into a slice of the provided buffer.
+     *
+     * The slice begins at `start` and is `size` bytes long, which must be the size given
+     * by `measure_resource()`. It is an error if the resource no longer assembles to that
+     * size, as happens if a file that it references changes in between. The returned
+     * data object refers to the slice, rather than to a copy of it.
+     */
+    std::shared_ptr<graphite::data::data> assemble_resource(const kdk::resource& resource, std::shared_ptr<std::vector<char>> buffer, std::size_t start, uint64_t size) const;
+    
+    /**
+     * Returns a key that identifies the assembled bytes of the specified resource. The
+     * key is derived from the typed values of the fields of the resource that are used
+     * by the type, from the contents of the files that they reference, and from the
+     * compiled type definition.
+     */
+    std::string cache_key(const kdk::resource& resource) const;
     
     /**
      * Add reference definition to the assembler.
@@ -287,6 +374,11 @@ public:
      */
     void add_field(const kdk::assembler::field field);
     
+    /**
+     * Returns the field definitions of the assembler.
+     */
+    const std::vector<kdk::assembler::field>& fields() const;
+    
     /**
      * Find the specified field in the source resource.
      */
@@ -300,17 +392,65 @@ public:
 private:
     std::vector<kdk::assembler::field> m_fields;
     std::vector<kdk::assembler::reference> m_refs;
+    std::vector<kdk::assembler::instruction> m_program;
+    std::vector<kdk::symbol_table> m_symbol_tables;
+    std::unordered_map<std::string, std::size_t> m_field_slots;
+    bool m_fixed_size { true };
+    std::vector<char> m_template;
+    uint64_t m_data_size { 0 };
+    std::string m_fingerprint;
+    
+    /**
+     * Place each of the fields provided by the resource into the slot of the field
+     * definition it corresponds to.
+     */
+    std::vector<const kdk::resource::field *> slot_fields(const kdk::resource& resource) const;
+    
+    /**
+     * Execute the encoding program against the slotted fields of a resource, encoding
+     * the values into the record, which is `capacity` bytes long. If no record is
+     * provided then the values are only measured.
+     *
+     * \return The size of the assembled record.
+     */
+    uint64_t execute(const std::vector<const kdk::resource::field *>& slots, char *record, uint64_t capacity) const;
+    
+    /**
+     * Returns the number of values, starting at `first`, that are combined into the
+     * bitmask encoded by the instruction. `reserved` values must be left for the values
+     * that follow it in the field.
+     */
+    std::size_t bitmask_span(const kdk::assembler::instruction& instruction, const std::vector<std::tuple<std::string, kdk::resource::field::value_type>>& values, std::size_t first, std::size_t reserved) const;
+    
+    /**
+     * Resolve a symbol or integer value of the instruction into an integer.
+     */
+    int64_t resolve_integer(const kdk::assembler::instruction& instruction, const std::string& value, kdk::resource::field::value_type type) const;
+    
+    /**
+     * Returns the offset of the end of the specified value once it has been encoded
+     * by the instruction.
+     */
+    static uint64_t extent(const kdk::assembler::instruction& instruction, const std::string& value, kdk::resource::field::value_type type);
+    
+    /**
+     * Encode the specified value into the record, using the location and encoding
+     * described by the instruction. The record is `capacity` bytes long, and must be
+     * large enough for the value.
+     */
+    void encode(char *record, uint64_t capacity, const kdk::assembler::instruction& instruction, const std::string& field_name, const std::string& value, kdk::resource::field::value_type type) const;
     
     /**
-     * Assemble the specified field in to the provided resource object.
+     * Read the contents of the file at the specified path directly into the record,
+     * using the location described by the instruction.
      */
-    void assemble(const kdk::resource resource, kdk::assembler::field field, std::shared_ptr<graphite::data::writer> writer);
+    static void encode_file(char *record, uint64_t capacity, const kdk::assembler::instruction& instruction, const std::string& path);
     
     /**
-     * Write the specified value as an integer to the data at the current
-     * offset.
+     * Write the specified value as a big endian integer of the given width into the
+     * record at the specified offset.
      */
-    void encode(std::shared_ptr<graphite::data::writer> writer, const std::string value, uint64_t width, bool is_signed = true);
+    static void encode_integer(char *record, uint64_t offset, int64_t value, uint64_t width);
 };
 
 };
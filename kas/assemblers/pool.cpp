@@ -25,7 +25,8 @@
 
 // MARK: - Singleton
 
-kdk::assembler_pool::assembler_pool()
+kdk::assembler_pool::assembler_pool(std::shared_ptr<const kdk::assembler_pool> parent)
+    : m_parent(parent)
 {
     
 }
@@ -40,12 +41,20 @@ kdk::assembler_pool& kdk::assembler_pool::shared()
 
 std::tuple<std::string, std::shared_ptr<kdk::assembler>> kdk::assembler_pool::assembler_named(const std::string type_name, bool no_error) const
 {
-    for (auto t : m_assemblers) {
-        if (std::get<0>(t) == type_name) {
+    std::lock_guard<std::recursive_mutex> lock(m_lock);
+    for (const auto& t : m_assemblers) {
+        if (std::get<4>(t) == m_build && std::get<0>(t) == type_name) {
             return std::make_tuple(std::get<1>(t), std::get<2>(t));
         }
     }
     
+    if (m_parent) {
+        auto inherited = m_parent->assembler_named(type_name, true);
+        if (std::get<1>(inherited)) {
+            return inherited;
+        }
+    }
+    
     if (!no_error) {
         log::error("<missing>", 0, "Fatal error whilst resolving type name '" + type_name + "'. The type doesn't exist.");
     }
@@ -54,20 +63,92 @@ std::tuple<std::string, std::shared_ptr<kdk::assembler>> kdk::assembler_pool::as
 }
 
 
+std::vector<std::string> kdk::assembler_pool::type_names() const
+{
+    std::lock_guard<std::recursive_mutex> lock(m_lock);
+    std::vector<std::string> names;
+    if (m_parent) {
+        names = m_parent->type_names();
+    }
+    for (const auto& t : m_assemblers) {
+        if (std::get<4>(t) == m_build) {
+            names.push_back(std::get<0>(t));
+        }
+    }
+    return names;
+}
+
+uint64_t kdk::assembler_pool::generation() const
+{
+    // Generations only ever increase, so their sum changes whenever any of them does.
+    std::lock_guard<std::recursive_mutex> lock(m_lock);
+    return m_generation + (m_parent ? m_parent->generation() : 0);
+}
+
+bool kdk::assembler_pool::defines_code(const std::string& type_code) const
+{
+    std::lock_guard<std::recursive_mutex> lock(m_lock);
+    for (const auto& t : m_assemblers) {
+        if (std::get<4>(t) == m_build && std::get<1>(t) == type_code) {
+            return true;
+        }
+    }
+    return m_parent && m_parent->defines_code(type_code);
+}
+
 // MARK: - Assembler Registration
 
-void kdk::assembler_pool::register_assembler(const std::string type_name, const std::string type_code, std::shared_ptr<kdk::assembler> assembler)
+void kdk::assembler_pool::register_assembler(const std::string type_name, const std::string type_code, std::shared_ptr<kdk::assembler> assembler, const std::string digest)
 {
-    // Ensure this is a unique/novel assembler.
-    for (auto t : m_assemblers) {
-        if (std::get<0>(t) == type_name) {
+    std::lock_guard<std::recursive_mutex> lock(m_lock);
+    // Ensure this is a unique/novel assembler within the current build. Assemblers of
+    // earlier builds are replaced.
+    for (auto it = m_assemblers.begin(); it != m_assemblers.end();) {
+        if (std::get<4>(*it) != m_build) {
+            if (std::get<0>(*it) == type_name || std::get<1>(*it) == type_code) {
+                it = m_assemblers.erase(it);
+                continue;
+            }
+        }
+        else if (std::get<0>(*it) == type_name) {
             log::error("<missing>", 0, "Duplicated declaration type '" + type_name + "'");
         }
-        
-        if (std::get<1>(t) == type_code) {
+        else if (std::get<1>(*it) == type_code) {
             log::error("<missing>", 0, "Duplicated resource type '" + type_code + "'");
         }
+        ++it;
+    }
+    
+    // A type may not replace one that is visible through the parent pool.
+    if (m_parent && std::get<1>(m_parent->assembler_named(type_name, true))) {
+        log::error("<missing>", 0, "Duplicated declaration type '" + type_name + "'");
+    }
+    else if (m_parent && m_parent->defines_code(type_code)) {
+        log::error("<missing>", 0, "Duplicated resource type '" + type_code + "'");
     }
     
-    m_assemblers.push_back(std::make_tuple(type_name, type_code, assembler));
+    m_assemblers.push_back(std::make_tuple(type_name, type_code, assembler, digest, m_build));
+    m_generation++;
+}
+
+// MARK: - Builds
+
+void kdk::assembler_pool::begin_build()
+{
+    std::lock_guard<std::recursive_mutex> lock(m_lock);
+    m_build++;
+    m_generation++;
+}
+
+bool kdk::assembler_pool::reuse_assembler(const std::string digest)
+{
+    std::lock_guard<std::recursive_mutex> lock(m_lock);
+    for (const auto& t : m_assemblers) {
+        if (std::get<4>(t) != m_build && std::get<3>(t) == digest) {
+            auto reused = t;
+            register_assembler(std::get<0>(reused), std::get<1>(reused), std::get<2>(reused), digest);
+            return true;
+        }
+    }
+    return false;
 }
@@ -21,6 +21,7 @@
 */
 
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <tuple>
 #include "assemblers/assembler.hpp"
@@ -37,6 +38,14 @@ namespace kdk
  *
  * When an assembler is requested that a pointer to the assembler will be
  * returned for use.
+ *
+ * A pool may have a parent, whose assemblers are visible through it. This allows the
+ * types of a scenario to be compiled once and shared by many builds, each of which
+ * registers its own types in a pool of its own. A parent must not be modified whilst it
+ * has children in use.
+ *
+ * A pool may be used from several threads at once: a pipelined target resolves the
+ * assemblers of queued resources whilst the semantic analyser is still registering types.
  */
 class assembler_pool
 {
@@ -46,15 +55,61 @@ public:
     assembler_pool(assembler_pool &&) = delete;
     assembler_pool & operator=(assembler_pool &&) = delete;
     
+    /**
+     * Construct a new assembler pool, through which the assemblers of the parent pool
+     * are also visible.
+     */
+    assembler_pool(std::shared_ptr<const kdk::assembler_pool> parent = nullptr);
+    
+    /**
+     * The pool used by builds that do not provide a pool of their own.
+     */
     static assembler_pool& shared();
     
     std::tuple<std::string, std::shared_ptr<kdk::assembler>> assembler_named(const std::string type_name, bool no_error = false) const;
-    void register_assembler(const std::string type_name, const std::string type_code, std::shared_ptr<kdk::assembler> assembler);
+    
+    /**
+     * Register an assembler for the current build. The digest identifies the source of
+     * the definition, allowing later builds to reuse the compiled assembler.
+     */
+    void register_assembler(const std::string type_name, const std::string type_code, std::shared_ptr<kdk::assembler> assembler, const std::string digest = "");
+    
+    /**
+     * Begin a new build. Assemblers registered by earlier builds are retained, but are
+     * not visible to the new build until they are registered again.
+     */
+    void begin_build();
+    
+    /**
+     * Register the assembler that an earlier build compiled from a definition with the
+     * specified digest into the current build. Returns false if there is no such assembler.
+     */
+    bool reuse_assembler(const std::string digest);
+    
+    /**
+     * Returns the names of the types registered for the current build, including those of
+     * the parent pool.
+     */
+    std::vector<std::string> type_names() const;
+    
+    /**
+     * Returns a number that changes whenever the types visible through the pool, including
+     * those of the parent pool, change.
+     */
+    uint64_t generation() const;
     
 private:
-    std::vector<std::tuple<std::string, std::string, std::shared_ptr<kdk::assembler>>> m_assemblers;
-    assembler_pool();
+    std::shared_ptr<const kdk::assembler_pool> m_parent;
+    std::vector<std::tuple<std::string, std::string, std::shared_ptr<kdk::assembler>, std::string, uint64_t>> m_assemblers;
+    uint64_t m_build { 0 };
+    uint64_t m_generation { 0 };
+    mutable std::recursive_mutex m_lock;
     
+    /**
+     * Returns true if the current build of this pool or one of its ancestors has registered
+     * a type with the specified resource type code.
+     */
+    bool defines_code(const std::string& type_code) const;
 };
 
 };
@@ -0,0 +1,161 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <algorithm>
+#include "assemblers/symbol_table.hpp"
+
+// MARK: - Constructors
+
+kdk::symbol_table::symbol_table()
+{
+    
+}
+
+kdk::symbol_table::symbol_table(const std::vector<std::tuple<std::string, int64_t>>& symbols)
+{
+    // Remove duplicated symbol names, keeping the first definition.
+    std::vector<std::tuple<std::string, int64_t, uint64_t>> keys;
+    for (auto symbol : symbols) {
+        auto name = std::get<0>(symbol);
+        auto duplicate = std::find_if(keys.begin(), keys.end(), [&name] (const std::tuple<std::string, int64_t, uint64_t>& key) {
+            return std::get<0>(key) == name;
+        });
+        if (duplicate == keys.end()) {
+            keys.push_back(std::make_tuple(name, std::get<1>(symbol), hash(name)));
+        }
+    }
+    
+    if (keys.empty()) {
+        return;
+    }
+    
+    // Build the table using "hash and displace". Keys are first distributed into buckets
+    // by their primary hash. Buckets are then placed largest first, searching for a
+    // displacement that moves every key of the bucket into a free slot.
+    auto bucket_count = keys.size();
+    auto slot_count = keys.size() + (keys.size() / 4) + 1;
+    
+    while (true) {
+        std::vector<std::vector<std::size_t>> buckets(bucket_count);
+        for (auto n = 0; n < keys.size(); ++n) {
+            buckets[std::get<2>(keys[n]) % bucket_count].push_back(n);
+        }
+        
+        std::vector<std::size_t> order(bucket_count);
+        for (auto n = 0; n < bucket_count; ++n) {
+            order[n] = n;
+        }
+        std::stable_sort(order.begin(), order.end(), [&buckets] (std::size_t lhs, std::size_t rhs) {
+            return buckets[lhs].size() > buckets[rhs].size();
+        });
+        
+        m_displacements = std::vector<uint32_t>(bucket_count, 0);
+        m_slots = std::vector<std::tuple<std::string, int64_t>>(slot_count);
+        m_occupied = std::vector<bool>(slot_count, false);
+        
+        auto placed_all = true;
+        for (auto b : order) {
+            const auto& bucket = buckets[b];
+            if (bucket.empty()) {
+                break;
+            }
+            
+            auto placed = false;
+            std::vector<uint64_t> slots(bucket.size());
+            for (uint32_t displacement = 0; displacement < (1 << 16) && !placed; ++displacement) {
+                placed = true;
+                for (auto n = 0; n < bucket.size() && placed; ++n) {
+                    slots[n] = slot(std::get<2>(keys[bucket[n]]), displacement, slot_count);
+                    placed = !m_occupied[slots[n]] && std::find(slots.begin(), slots.begin() + n, slots[n]) == slots.begin() + n;
+                }
+                
+                if (placed) {
+                    m_displacements[b] = displacement;
+                    for (auto n = 0; n < bucket.size(); ++n) {
+                        m_occupied[slots[n]] = true;
+                        m_slots[slots[n]] = std::make_tuple(std::get<0>(keys[bucket[n]]), std::get<1>(keys[bucket[n]]));
+                    }
+                }
+            }
+            
+            if (!placed) {
+                placed_all = false;
+                break;
+            }
+        }
+        
+        if (placed_all) {
+            return;
+        }
+        
+        // Give the keys more room and try again. This is rare, and only happens for
+        // unlucky key sets.
+        slot_count += (slot_count / 2) + 1;
+    }
+}
+
+// MARK: - Hashing
+
+uint64_t kdk::symbol_table::hash(const std::string& name)
+{
+    // 64-bit FNV-1a
+    uint64_t hash = 0xcbf29ce484222325;
+    for (auto c : name) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+uint64_t kdk::symbol_table::slot(uint64_t hash, uint32_t displacement, uint64_t slot_count)
+{
+    // Derive a secondary hash for the displacement by mixing the primary hash, rather
+    // than rehashing the name.
+    auto h = hash ^ (static_cast<uint64_t>(displacement) * 0x9e3779b97f4a7c15);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccd;
+    h ^= h >> 33;
+    return h % slot_count;
+}
+
+// MARK: - Look up
+
+bool kdk::symbol_table::find(const std::string& name, int64_t& value) const
+{
+    if (m_displacements.empty()) {
+        return false;
+    }
+    
+    auto h = hash(name);
+    auto s = slot(h, m_displacements[h % m_displacements.size()], m_slots.size());
+    if (!m_occupied[s] || std::get<0>(m_slots[s]) != name) {
+        return false;
+    }
+    
+    value = std::get<1>(m_slots[s]);
+    return true;
+}
+
+bool kdk::symbol_table::empty() const
+{
+    return m_displacements.empty();
+}
@@ -0,0 +1,84 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <cstdint>
+
+#if !defined(KDK_SYMBOL_TABLE)
+#define KDK_SYMBOL_TABLE
+
+namespace kdk
+{
+
+/**
+ * The symbol table maps the symbol names of a type definition value onto their
+ * integer values. The table is constructed once, when the type is compiled, as a
+ * perfect hash so that resolving a symbol costs a single hash and a single string
+ * comparison, regardless of how many symbols the value has.
+ */
+class symbol_table
+{
+public:
+    /**
+     * Construct an empty symbol table.
+     */
+    symbol_table();
+    
+    /**
+     * Construct a new symbol table from the specified symbols. If a symbol name is
+     * repeated, the first occurrence takes precedence.
+     */
+    symbol_table(const std::vector<std::tuple<std::string, int64_t>>& symbols);
+    
+    /**
+     * Look up the specified symbol name, storing its value in `value` if it was found.
+     *
+     * \return Whether or not the symbol exists in the table.
+     */
+    bool find(const std::string& name, int64_t& value) const;
+    
+    /**
+     * Returns whether or not the symbol table contains any symbols.
+     */
+    bool empty() const;
+    
+private:
+    std::vector<uint32_t> m_displacements;
+    std::vector<std::tuple<std::string, int64_t>> m_slots;
+    std::vector<bool> m_occupied;
+    
+    /**
+     * Returns the primary hash of a symbol name.
+     */
+    static uint64_t hash(const std::string& name);
+    
+    /**
+     * Returns the slot for a primary hash using the specified displacement.
+     */
+    static uint64_t slot(uint64_t hash, uint32_t displacement, uint64_t slot_count);
+};
+
+};
+
+#endif
@@ -0,0 +1,214 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include "cache/assembly_cache.hpp"
+#include "diagnostic/log.hpp"
+
+// MARK: - Helpers
+
+static inline bool make_directory(const std::string& path)
+{
+    return ::mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+// MARK: - Constructor
+
+kdk::assembly_cache::assembly_cache(const std::string& directory)
+    : m_directory(directory)
+{
+    if (m_directory.empty()) {
+        return;
+    }
+    
+    // Create each missing component of the directory path.
+    for (auto n = directory.find('/', 1); n != std::string::npos; n = directory.find('/', n + 1)) {
+        make_directory(directory.substr(0, n));
+    }
+    if (!make_directory(directory)) {
+        log::error(directory, 0, "Unable to create the assembly cache directory: " + std::string(strerror(errno)));
+    }
+}
+
+// MARK: - Blobs
+
+std::string kdk::assembly_cache::path_for(const std::string& key) const
+{
+    return m_directory + "/" + key.substr(0, 2) + "/" + key;
+}
+
+std::shared_ptr<std::vector<char>> kdk::assembly_cache::memory_blob(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(m_memory_lock);
+    auto it = m_memory.find(key);
+    if (it == m_memory.end()) {
+        return nullptr;
+    }
+    std::get<1>(it->second) = m_build;
+    return std::get<0>(it->second);
+}
+
+void kdk::assembly_cache::retain_blob(const std::string& key, const char *bytes, uint64_t size)
+{
+    std::lock_guard<std::mutex> lock(m_memory_lock);
+    auto it = m_memory.find(key);
+    if (it != m_memory.end()) {
+        std::get<1>(it->second) = m_build;
+        return;
+    }
+    
+    m_memory[key] = std::make_tuple(std::make_shared<std::vector<char>>(bytes, bytes + size), m_build);
+    m_memory_size += size;
+}
+
+bool kdk::assembly_cache::find(const std::string& key, uint64_t& size)
+{
+    if (auto blob = memory_blob(key)) {
+        size = blob->size();
+        m_hits++;
+        return true;
+    }
+    
+    struct stat info;
+    if (m_directory.empty() || ::stat(path_for(key).c_str(), &info) != 0) {
+        m_misses++;
+        return false;
+    }
+    size = static_cast<uint64_t>(info.st_size);
+    m_hits++;
+    return true;
+}
+
+void kdk::assembly_cache::load(const std::string& key, char *destination, uint64_t size)
+{
+    if (auto blob = memory_blob(key)) {
+        std::copy(blob->begin(), blob->begin() + std::min<uint64_t>(size, blob->size()), destination);
+        return;
+    }
+    
+    auto path = path_for(key);
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        log::error(path, 0, "Unable to read cached resource data: " + std::string(strerror(errno)));
+    }
+    
+    uint64_t offset = 0;
+    while (offset < size) {
+        auto count = ::pread(fd, destination + offset, size - offset, static_cast<off_t>(offset));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            log::error(path, 0, "Unable to read cached resource data.");
+        }
+        offset += count;
+    }
+    ::close(fd);
+    
+    if (m_memory_capacity > 0) {
+        retain_blob(key, destination, size);
+    }
+}
+
+void kdk::assembly_cache::store(const std::string& key, const char *bytes, uint64_t size)
+{
+    if (m_memory_capacity > 0) {
+        retain_blob(key, bytes, size);
+    }
+    if (m_directory.empty()) {
+        return;
+    }
+    
+    // Blobs are written to a temporary file and then renamed into place, so that a blob
+    // is never observed partially written, even by another build sharing the cache.
+    auto path = path_for(key);
+    make_directory(m_directory + "/" + key.substr(0, 2));
+    auto temporary = path + "." + std::to_string(::getpid()) + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    
+    auto fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    
+    uint64_t offset = 0;
+    while (offset < size) {
+        auto count = ::write(fd, bytes + offset, size - offset);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            break;
+        }
+        offset += count;
+    }
+    ::close(fd);
+    
+    if (offset != size || ::rename(temporary.c_str(), path.c_str()) != 0) {
+        ::unlink(temporary.c_str());
+    }
+}
+
+// MARK: - Configuration
+
+void kdk::assembly_cache::set_memory_capacity(uint64_t bytes)
+{
+    std::lock_guard<std::mutex> lock(m_memory_lock);
+    m_memory_capacity = bytes;
+}
+
+void kdk::assembly_cache::begin_build()
+{
+    m_hits = 0;
+    m_misses = 0;
+    
+    std::lock_guard<std::mutex> lock(m_memory_lock);
+    for (auto stale : { true, false }) {
+        for (auto it = m_memory.begin(); it != m_memory.end() && m_memory_size > m_memory_capacity;) {
+            if (stale && std::get<1>(it->second) == m_build) {
+                ++it;
+                continue;
+            }
+            m_memory_size -= std::get<0>(it->second)->size();
+            it = m_memory.erase(it);
+        }
+    }
+    m_build++;
+}
+
+// MARK: - Statistics
+
+uint64_t kdk::assembly_cache::hits() const
+{
+    return m_hits;
+}
+
+uint64_t kdk::assembly_cache::misses() const
+{
+    return m_misses;
+}
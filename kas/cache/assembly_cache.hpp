@@ -0,0 +1,132 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <cstdint>
+
+#if !defined(KDK_ASSEMBLY_CACHE)
+#define KDK_ASSEMBLY_CACHE
+
+namespace kdk
+{
+
+/**
+ * The assembly cache is a content-addressed store of assembled resource data. Each
+ * blob is stored under a key that identifies everything that the assembled bytes
+ * depend upon, so a blob never needs to be invalidated: a change to a resource or to
+ * its type definition simply produces a different key.
+ *
+ * Blobs are stored on disk as `<directory>/<first two digits of key>/<key>`. Recently
+ * used blobs may also be kept in memory, for processes that perform many builds, and a
+ * cache without a directory keeps blobs only in memory. The cache may be used from
+ * several threads at once.
+ */
+class assembly_cache
+{
+public:
+    assembly_cache(const assembly_cache&) = delete;
+    assembly_cache& operator=(const assembly_cache &) = delete;
+    
+    /**
+     * Construct a new assembly cache in the specified directory, creating the directory
+     * if it does not exist. If no directory is specified, blobs are only kept in memory.
+     */
+    assembly_cache(const std::string& directory = "");
+    
+    /**
+     * Look up the blob with the specified key, returning its size if it exists. Each
+     * lookup is counted as either a hit or a miss.
+     */
+    bool find(const std::string& key, uint64_t& size);
+    
+    /**
+     * Read the blob with the specified key into the destination, which must be at least
+     * `size` bytes long.
+     */
+    void load(const std::string& key, char *destination, uint64_t size);
+    
+    /**
+     * Store a blob under the specified key. Failure to store a blob is not an error, as
+     * the cache is only an optimisation.
+     */
+    void store(const std::string& key, const char *bytes, uint64_t size);
+    
+    /**
+     * Set the number of bytes of recently used blobs that are kept in memory. Zero, the
+     * default, keeps nothing in memory.
+     */
+    void set_memory_capacity(uint64_t bytes);
+    
+    /**
+     * Begin a new build, resetting the hit and miss counts.
+     *
+     * In-memory blobs are only evicted here, never during a build, so a blob that has
+     * been found can always be loaded. Blobs that the previous build did not use are
+     * evicted first.
+     */
+    void begin_build();
+    
+    /**
+     * Returns the number of lookups that found a blob.
+     */
+    uint64_t hits() const;
+    
+    /**
+     * Returns the number of lookups that did not find a blob.
+     */
+    uint64_t misses() const;
+    
+private:
+    std::string m_directory;
+    std::atomic<uint64_t> m_hits { 0 };
+    std::atomic<uint64_t> m_misses { 0 };
+    std::mutex m_memory_lock;
+    std::unordered_map<std::string, std::tuple<std::shared_ptr<std::vector<char>>, uint64_t>> m_memory;
+    uint64_t m_memory_size { 0 };
+    uint64_t m_memory_capacity { 0 };
+    uint64_t m_build { 0 };
+    
+    /**
+     * Returns the path of the blob with the specified key.
+     */
+    std::string path_for(const std::string& key) const;
+    
+    /**
+     * Returns the in-memory copy of the blob with the specified key, if there is one.
+     */
+    std::shared_ptr<std::vector<char>> memory_blob(const std::string& key);
+    
+    /**
+     * Keep a copy of the blob in memory.
+     */
+    void retain_blob(const std::string& key, const char *bytes, uint64_t size);
+};
+
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <fstream>
+#include "cache/build_stamp.hpp"
+#include "cache/hasher.hpp"
+#include "diagnostic/log.hpp"
+
+// The first line of every stamp. This must change whenever the format of the stamp,
+// or the way in which its digests are computed, changes.
+static const std::string stamp_version = "kas-stamp-1";
+
+// MARK: - Constructor
+
+kdk::build_stamp::build_stamp(const std::string& path)
+    : m_path(path)
+{
+    
+}
+
+// MARK: - Stamp
+
+bool kdk::build_stamp::up_to_date(const std::string& options) const
+{
+    std::ifstream f(m_path);
+    if (!f.is_open()) {
+        return false;
+    }
+    
+    std::string line;
+    if (!std::getline(f, line) || line != stamp_version) {
+        return false;
+    }
+    if (!std::getline(f, line) || line != kdk::hasher().update(options).digest()) {
+        return false;
+    }
+    
+    // Each remaining line is the digest of a dependency, followed by its path.
+    while (std::getline(f, line)) {
+        if (line.size() < 34 || line[32] != ' ') {
+            return false;
+        }
+        
+        std::string digest;
+        if (!kdk::hasher::digest_file(line.substr(33), digest) || digest != line.substr(0, 32)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+void kdk::build_stamp::write(const std::string& options, const std::vector<std::string>& dependencies) const
+{
+    std::ofstream f(m_path, std::ios::trunc);
+    if (!f.is_open()) {
+        log::error(m_path, 0, "Unable to write the build stamp.");
+    }
+    
+    f << stamp_version << std::endl;
+    f << kdk::hasher().update(options).digest() << std::endl;
+    for (const auto& dependency : dependencies) {
+        std::string digest;
+        if (!kdk::hasher::digest_file(dependency, digest)) {
+            // A dependency that can not be read is recorded so that it never matches.
+            digest = std::string(32, '-');
+        }
+        f << digest << " " << dependency << std::endl;
+    }
+}
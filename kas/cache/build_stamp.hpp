@@ -0,0 +1,63 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+
+#if !defined(KDK_BUILD_STAMP)
+#define KDK_BUILD_STAMP
+
+namespace kdk
+{
+
+/**
+ * The build stamp records the digest of the contents of every file that an output
+ * depended upon when it was built, along with the options that it was built with. It
+ * allows a build to be skipped entirely when nothing that could affect the output
+ * has changed.
+ */
+class build_stamp
+{
+public:
+    /**
+     * Construct a build stamp that is stored at the specified path.
+     */
+    build_stamp(const std::string& path);
+    
+    /**
+     * Returns whether the stamp was recorded with the same options, and whether every
+     * dependency it recorded still has the same contents.
+     */
+    bool up_to_date(const std::string& options) const;
+    
+    /**
+     * Record the options and the current contents of each of the dependencies.
+     */
+    void write(const std::string& options, const std::vector<std::string>& dependencies) const;
+    
+private:
+    std::string m_path;
+};
+
+};
+
+#endif
@@ -0,0 +1,159 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <cerrno>
+#include <vector>
+#include <algorithm>
+#include "cache/hasher.hpp"
+
+// MARK: - Constructor
+
+kdk::hasher::hasher()
+    : m_lo(0xcbf29ce484222325ULL), m_hi(0x9e3779b97f4a7c15ULL)
+{
+    
+}
+
+// MARK: - Hashing
+
+kdk::hasher& kdk::hasher::update(const void *bytes, std::size_t size)
+{
+    // Two independent lanes are maintained: FNV-1a, and a multiply/xor-shift lane.
+    auto p = static_cast<const uint8_t *>(bytes);
+    for (std::size_t n = 0; n < size; ++n) {
+        m_lo = (m_lo ^ p[n]) * 0x100000001b3ULL;
+        m_hi = (m_hi ^ p[n]) * 0xff51afd7ed558ccdULL;
+        m_hi ^= m_hi >> 29;
+    }
+    return *this;
+}
+
+kdk::hasher& kdk::hasher::update(const std::string& str)
+{
+    update(static_cast<uint64_t>(str.size()));
+    return update(str.data(), str.size());
+}
+
+kdk::hasher& kdk::hasher::update(uint64_t value)
+{
+    uint8_t bytes[8];
+    for (auto n = 0; n < 8; ++n) {
+        bytes[n] = static_cast<uint8_t>(value >> (n * 8));
+    }
+    return update(bytes, sizeof(bytes));
+}
+
+std::string kdk::hasher::digest() const
+{
+    // Finalise each lane so that every input bit affects every output bit.
+    auto mix = [] (uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    };
+    
+    const char *digits = "0123456789abcdef";
+    std::string result(32, '0');
+    uint64_t lanes[2] = { mix(m_lo), mix(m_hi) };
+    for (auto lane = 0; lane < 2; ++lane) {
+        for (auto n = 0; n < 16; ++n) {
+            result[lane * 16 + n] = digits[(lanes[lane] >> ((15 - n) * 4)) & 0xF];
+        }
+    }
+    return result;
+}
+
+bool kdk::hasher::digest_file(const std::string& path, std::string& digest)
+{
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    
+    // A directory is identified by the names of its entries, so that adding or removing
+    // a file changes its digest.
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && S_ISDIR(info.st_mode)) {
+        ::close(fd);
+        auto directory = ::opendir(path.c_str());
+        if (!directory) {
+            return false;
+        }
+        std::vector<std::string> names;
+        while (auto entry = ::readdir(directory)) {
+            names.push_back(entry->d_name);
+        }
+        ::closedir(directory);
+        
+        std::sort(names.begin(), names.end());
+        kdk::hasher hasher;
+        for (const auto& name : names) {
+            hasher.update(name);
+        }
+        digest = hasher.digest();
+        return true;
+    }
+    
+    kdk::hasher hasher;
+    std::vector<char> buffer(1 << 16);
+    while (true) {
+        auto count = ::read(fd, buffer.data(), buffer.size());
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0) {
+            ::close(fd);
+            return false;
+        }
+        if (count == 0) {
+            break;
+        }
+        hasher.update(buffer.data(), count);
+    }
+    ::close(fd);
+    
+    digest = hasher.digest();
+    return true;
+}
+
+std::string kdk::hasher::file_identity(const std::string& path)
+{
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) {
+        return "";
+    }
+#if defined(__APPLE__)
+    const auto& modified = info.st_mtimespec;
+#else
+    const auto& modified = info.st_mtim;
+#endif
+    return std::to_string(info.st_dev) + ":" + std::to_string(info.st_ino) + ":"
+         + std::to_string(info.st_size) + ":" + std::to_string(modified.tv_sec) + "."
+         + std::to_string(modified.tv_nsec);
+}
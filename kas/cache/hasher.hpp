@@ -0,0 +1,89 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <cstdint>
+
+#if !defined(KDK_HASHER)
+#define KDK_HASHER
+
+namespace kdk
+{
+
+/**
+ * The hasher produces a fast, non-cryptographic 128-bit digest of a sequence of
+ * values. It is used to derive the keys of content-addressed stores, where the
+ * digest identifies the content that was hashed.
+ *
+ * Values are hashed along with their length, so that the sequences ("ab", "c")
+ * and ("a", "bc") produce different digests.
+ */
+class hasher
+{
+public:
+    /**
+     * Construct a new hasher.
+     */
+    hasher();
+    
+    /**
+     * Add raw bytes to the digest.
+     */
+    kdk::hasher& update(const void *bytes, std::size_t size);
+    
+    /**
+     * Add a string, and its length, to the digest.
+     */
+    kdk::hasher& update(const std::string& str);
+    
+    /**
+     * Add an integer to the digest.
+     */
+    kdk::hasher& update(uint64_t value);
+    
+    /**
+     * Returns the digest as a string of 32 hexadecimal digits.
+     */
+    std::string digest() const;
+    
+    /**
+     * Compute the digest of the contents of the specified file, or of the names of the
+     * entries of the specified directory. Returns false if it could not be read.
+     */
+    static bool digest_file(const std::string& path, std::string& digest);
+    
+    /**
+     * Returns the identity of the specified file, made of its device, inode, size and
+     * modification time, or an empty string if it does not exist. The identity changes
+     * whenever the file is modified, replaced or removed, and is cheap to check before
+     * computing a digest.
+     */
+    static std::string file_identity(const std::string& path);
+    
+private:
+    uint64_t m_lo;
+    uint64_t m_hi;
+};
+
+};
+
+#endif
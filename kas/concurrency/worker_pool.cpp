@@ -0,0 +1,148 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <algorithm>
+#include "concurrency/worker_pool.hpp"
+
+// MARK: - Constructor
+
+kdk::worker_pool::worker_pool(std::size_t thread_count)
+{
+    if (thread_count == 0) {
+        thread_count = std::max(1U, std::thread::hardware_concurrency());
+    }
+    
+    // The calling thread is always one of the threads performing work.
+    for (auto n = 1; n < thread_count; ++n) {
+        m_threads.emplace_back(&kdk::worker_pool::worker_main, this);
+    }
+}
+
+kdk::worker_pool::~worker_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_stopping = true;
+    }
+    m_work_available.notify_all();
+    
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+// MARK: - Accessors
+
+std::size_t kdk::worker_pool::thread_count() const
+{
+    return m_threads.size() + 1;
+}
+
+// MARK: - Work
+
+void kdk::worker_pool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& task)
+{
+    if (count == 0) {
+        return;
+    }
+    
+    // There is no benefit to waking the pool for a single invocation.
+    if (m_threads.empty() || count == 1) {
+        for (auto n = 0; n < count; ++n) {
+            task(n);
+        }
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_task = &task;
+        m_count = count;
+        m_next = 0;
+        m_exception = nullptr;
+        m_scoped = log::scope::active();
+        m_sink = m_scoped ? log::scope::current() : nullptr;
+        m_active = m_threads.size();
+        ++m_generation;
+    }
+    m_work_available.notify_all();
+    
+    drain();
+    
+    std::unique_lock<std::mutex> lock(m_lock);
+    m_work_finished.wait(lock, [this] { return m_active == 0; });
+    m_task = nullptr;
+    
+    if (m_exception) {
+        std::rethrow_exception(m_exception);
+    }
+}
+
+void kdk::worker_pool::drain()
+{
+    std::size_t index;
+    while ((index = m_next.fetch_add(1)) < m_count) {
+        try {
+            (*m_task)(index);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (!m_exception) {
+                m_exception = std::current_exception();
+            }
+        }
+    }
+}
+
+void kdk::worker_pool::worker_main()
+{
+    std::size_t generation = 0;
+    
+    while (true) {
+        auto scoped = false;
+        log::sink sink;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_work_available.wait(lock, [this, generation] { return m_stopping || m_generation != generation; });
+            if (m_stopping) {
+                return;
+            }
+            generation = m_generation;
+            scoped = m_scoped;
+            sink = m_sink;
+        }
+        
+        if (scoped) {
+            log::scope scope { sink };
+            drain();
+        }
+        else {
+            drain();
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            --m_active;
+        }
+        m_work_finished.notify_all();
+    }
+}
@@ -0,0 +1,105 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <exception>
+#include "diagnostic/log.hpp"
+
+#if !defined(KDK_WORKER_POOL)
+#define KDK_WORKER_POOL
+
+namespace kdk
+{
+
+/**
+ * The worker pool owns a fixed set of threads that are used to perform
+ * independent units of work in parallel. The thread that submits the work
+ * always takes part in performing it, so a pool of one thread performs all
+ * work serially on the calling thread.
+ */
+class worker_pool
+{
+public:
+    worker_pool(const worker_pool&) = delete;
+    worker_pool& operator=(const worker_pool &) = delete;
+    
+    /**
+     * Construct a new worker pool with the specified number of threads. If zero
+     * is specified, then the number of hardware threads is used.
+     */
+    worker_pool(std::size_t thread_count = 0);
+    
+    /**
+     * Stop and join all of the threads of the pool.
+     */
+    ~worker_pool();
+    
+    /**
+     * Returns the number of threads that perform work, including the calling thread.
+     */
+    std::size_t thread_count() const;
+    
+    /**
+     * Invoke the task once for each index in the range [0, count), distributing the
+     * indices across the threads of the pool. This does not return until every
+     * invocation has finished. If any invocation throws, the first exception is
+     * rethrown once all of them have finished.
+     *
+     * If the calling thread has a diagnostic scope, then the invocations performed by
+     * the other threads of the pool report their diagnostics to its sink.
+     */
+    void parallel_for(std::size_t count, const std::function<void(std::size_t)>& task);
+    
+private:
+    std::vector<std::thread> m_threads;
+    std::mutex m_lock;
+    std::condition_variable m_work_available;
+    std::condition_variable m_work_finished;
+    const std::function<void(std::size_t)> *m_task { nullptr };
+    std::size_t m_count { 0 };
+    std::atomic<std::size_t> m_next { 0 };
+    std::size_t m_generation { 0 };
+    std::size_t m_active { 0 };
+    std::exception_ptr m_exception;
+    bool m_stopping { false };
+    bool m_scoped { false };
+    log::sink m_sink;
+    
+    /**
+     * The main loop of each of the threads of the pool.
+     */
+    void worker_main();
+    
+    /**
+     * Perform invocations of the current task until none remain.
+     */
+    void drain();
+};
+
+};
+
+#endif
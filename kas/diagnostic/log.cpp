@@ -21,15 +21,90 @@
 */
 
 #include <iostream>
+#include <mutex>
+#include <atomic>
 #include "diagnostic/log.hpp"
 
+// Diagnostics may be emitted from any of the threads assembling resources.
+static std::mutex log_lock;
+static std::atomic<bool> errors_recoverable { false };
+static log::sink diagnostic_sink;
+
+// The scope of each thread takes precedence over the process wide configuration.
+static thread_local log::sink scope_sink;
+static thread_local bool scope_active { false };
+
 void log::warning(const std::string file, const int line, const std::string message)
 {
+    if (scope_active) {
+        if (scope_sink) {
+            scope_sink(false, file, line, message);
+        }
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(log_lock);
+    if (diagnostic_sink) {
+        diagnostic_sink(false, file, line, message);
+        return;
+    }
     std::cout << "\x1b[33m" << "Warning: " << file << ":L" << std::to_string(line) << std::endl << "\x1b[0m  " << message << std::endl;
 }
 
 void log::error(const std::string file, const int line, const std::string message)
 {
-    std::cout << "\x1b[31m" << "Error: " << file << ":L" << std::to_string(line) << std::endl << "\x1b[0m  " << message << std::endl;
+    if (scope_active) {
+        if (scope_sink) {
+            scope_sink(true, file, line, message);
+        }
+        throw log::fatal_error(file + ":L" + std::to_string(line) + ": " + message);
+    }
+    
+    std::lock_guard<std::mutex> lock(log_lock);
+    if (diagnostic_sink) {
+        diagnostic_sink(true, file, line, message);
+    }
+    else {
+        std::cout << "\x1b[31m" << "Error: " << file << ":L" << std::to_string(line) << std::endl << "\x1b[0m  " << message << std::endl;
+    }
+    if (errors_recoverable) {
+        throw log::fatal_error(file + ":L" + std::to_string(line) + ": " + message);
+    }
     exit(1);
 }
+
+void log::set_sink(log::sink sink)
+{
+    std::lock_guard<std::mutex> lock(log_lock);
+    diagnostic_sink = sink;
+}
+
+void log::set_recoverable(bool recoverable)
+{
+    errors_recoverable = recoverable;
+}
+
+// MARK: - Scopes
+
+log::scope::scope(log::sink sink)
+    : m_previous_sink(scope_sink), m_previous_active(scope_active)
+{
+    scope_sink = sink;
+    scope_active = true;
+}
+
+log::scope::~scope()
+{
+    scope_sink = m_previous_sink;
+    scope_active = m_previous_active;
+}
+
+log::sink log::scope::current()
+{
+    return scope_sink;
+}
+
+bool log::scope::active()
+{
+    return scope_active;
+}
@@ -21,6 +21,8 @@
 */
 
 #include <string>
+#include <stdexcept>
+#include <functional>
 
 #if !defined(KDK_DIAGNOSTIC_LOG)
 #define KDK_DIAGNOSTIC_LOG
@@ -35,9 +37,79 @@ void warning(const std::string file, const int line, const std::string message);
 
 /**
  * Prints an error message to the standard output, and then terminates the program.
+ * If errors have been made recoverable, then a `log::fatal_error` is thrown instead.
  */
 void error(const std::string file, const int line, const std::string message);
 
+/**
+ * The exception thrown by `log::error` when errors are recoverable.
+ */
+class fatal_error : public std::runtime_error
+{
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * Set whether errors should throw a `log::fatal_error` rather than terminate the
+ * program. This is used by long running processes that perform many builds.
+ */
+void set_recoverable(bool recoverable);
+
+/**
+ * A function that receives each diagnostic, indicating whether it is an error.
+ */
+typedef std::function<void(bool, const std::string&, int, const std::string&)> sink;
+
+/**
+ * Set a function to receive warnings and errors in place of the standard output. The
+ * program is still terminated by an error, unless errors have been made recoverable.
+ * Passing `nullptr` restores the standard output.
+ */
+void set_sink(log::sink sink);
+
+/**
+ * Whilst a scope exists, diagnostics emitted by the thread that created it are delivered
+ * to its sink rather than to the standard output or the sink set by `log::set_sink`, and
+ * errors throw a `log::fatal_error`. This allows several builds to be performed at once,
+ * each receiving its own diagnostics. Scopes may be nested.
+ *
+ * Threads that perform work on behalf of a scope should create a scope of their own with
+ * its sink, which must then be safe to call from several threads at once.
+ */
+class scope
+{
+public:
+    scope(const scope&) = delete;
+    scope& operator=(const scope &) = delete;
+    
+    /**
+     * Begin a scope delivering diagnostics to the specified sink. If the sink is
+     * `nullptr`, diagnostics are discarded.
+     */
+    scope(log::sink sink);
+    
+    /**
+     * Restore the scope that was current when this scope was created.
+     */
+    ~scope();
+    
+    /**
+     * Returns the sink of the current scope of the calling thread, so that work performed
+     * on behalf of the thread by others may report diagnostics to it.
+     */
+    static log::sink current();
+    
+    /**
+     * Returns true if the calling thread has a current scope.
+     */
+    static bool active();
+    
+private:
+    log::sink m_previous_sink;
+    bool m_previous_active;
+};
+
 };
 
 #endif
@@ -0,0 +1,197 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <mutex>
+#include <chrono>
+#include "driver/batch.hpp"
+#include "driver/driver.hpp"
+#include "api/build_context.hpp"
+#include "concurrency/worker_pool.hpp"
+
+// MARK: - Helpers
+
+static inline std::string format_diagnostic(bool error, const std::string& file, int line, const std::string& message)
+{
+    // Diagnostics are presented exactly as `log` presents them.
+    return std::string(error ? "\x1b[31mError: " : "\x1b[33mWarning: ") + file + ":L" + std::to_string(line) + "\n\x1b[0m  " + message + "\n";
+}
+
+// MARK: - Constructor
+
+kdk::batch::batch(const std::string& manifest_path)
+    : m_manifest_path(manifest_path)
+{
+    
+}
+
+// MARK: - Manifest
+
+bool kdk::batch::read_manifest(std::vector<kdk::batch::entry>& entries) const
+{
+    std::ifstream f(m_manifest_path);
+    if (!f.is_open()) {
+        std::cout << "kas: \x1b[31merror: \x1b[0munable to read the batch manifest: " << m_manifest_path << std::endl;
+        return false;
+    }
+    
+    auto slash = m_manifest_path.rfind('/');
+    auto directory = slash == std::string::npos ? "" : m_manifest_path.substr(0, slash + 1);
+    auto resolve = [&] (const std::string& path) {
+        return path[0] == '/' ? path : directory + path;
+    };
+    
+    std::string line;
+    for (auto line_number = 1; std::getline(f, line); ++line_number) {
+        std::istringstream words(line);
+        std::string output;
+        if (!(words >> output) || output[0] == '#') {
+            continue;
+        }
+        
+        kdk::batch::entry entry;
+        std::string format_name;
+        if (!(words >> format_name) || !kdk::driver::format_named(format_name, entry.format)) {
+            std::cout << "kas: \x1b[31merror: \x1b[0m" << m_manifest_path << ":L" << line_number
+                      << ": expected an output format, found '" << format_name << "'" << std::endl;
+            return false;
+        }
+        
+        entry.output = resolve(output);
+        for (std::string input; words >> input;) {
+            entry.inputs.push_back(resolve(input));
+        }
+        if (entry.inputs.empty()) {
+            std::cout << "kas: \x1b[31merror: \x1b[0m" << m_manifest_path << ":L" << line_number
+                      << ": no input files for " << output << std::endl;
+            return false;
+        }
+        entries.push_back(std::move(entry));
+    }
+    return true;
+}
+
+// MARK: - Build
+
+int kdk::batch::run(const std::vector<std::string>& arguments)
+{
+    std::string scenario_path { "" };
+    std::string cache_dir { "" };
+    std::size_t jobs { 0 };
+    bool compress { false };
+    
+    for (auto i = 0; i < arguments.size(); ++i) {
+        const auto& option = arguments[i];
+        auto has_value = i < arguments.size() - 1;
+        if (option == "--scenario" && has_value) {
+            scenario_path = arguments[++i];
+        }
+        else if (option == "-j" && has_value) {
+            const auto& job_count = arguments[++i];
+            if (job_count.empty() || job_count.find_first_not_of("0123456789") != std::string::npos) {
+                std::cout << "kas: \x1b[31merror: \x1b[0minvalid job count: " << job_count << std::endl;
+                return 3;
+            }
+            jobs = std::stoul(job_count);
+        }
+        else if (option == "--cache-dir" && has_value) {
+            cache_dir = arguments[++i];
+        }
+        else if (option == "--compress") {
+            compress = true;
+        }
+        else {
+            std::cout << "kas: \x1b[31merror: \x1b[0mbad argument supplied: " << option << std::endl;
+            return 2;
+        }
+    }
+    
+    std::vector<kdk::batch::entry> entries;
+    if (!read_manifest(entries)) {
+        return 3;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    std::mutex output_lock;
+    
+    // The scenario is parsed once, into the context that every target shares.
+    auto scenario = std::make_shared<kdk::build_context>();
+    scenario->set_sink([&] (bool error, const std::string& file, int line, const std::string& message) {
+        std::lock_guard<std::mutex> lock(output_lock);
+        std::cout << format_diagnostic(error, file, line, message);
+    });
+    if (!scenario_path.empty()) {
+        for (const auto& file : kdk::driver::scenario_files(scenario_path)) {
+            if (!scenario->add_file(file)) {
+                std::cout << "kas: \x1b[31merror: \x1b[0munable to load the scenario: " << scenario->last_error() << std::endl;
+                return 1;
+            }
+        }
+    }
+    
+    std::shared_ptr<kdk::assembly_cache> cache;
+    if (!cache_dir.empty()) {
+        cache = std::make_shared<kdk::assembly_cache>(cache_dir);
+    }
+    
+    // Each target is built by a single thread, so that targets are built in parallel
+    // without contending with each other. The diagnostics of a target are printed
+    // together once it has finished.
+    std::size_t built = 0;
+    kdk::worker_pool pool { jobs };
+    pool.parallel_for(entries.size(), [&] (std::size_t n) {
+        const auto& entry = entries[n];
+        std::string report;
+        auto reported = false;
+        
+        kdk::build_context context { scenario };
+        context.set_cache(cache);
+        context.set_compression(compress);
+        context.set_sink([&] (bool error, const std::string& file, int line, const std::string& message) {
+            report += format_diagnostic(error, file, line, message);
+            reported |= error;
+        });
+        
+        auto success = true;
+        for (auto it = entry.inputs.begin(); success && it != entry.inputs.end(); ++it) {
+            success = context.add_file(*it);
+        }
+        success = success && context.write(entry.output, entry.format);
+        
+        std::lock_guard<std::mutex> lock(output_lock);
+        std::cout << report;
+        if (success) {
+            std::cout << "kas: built " << entry.output << " (" << context.resource_count() << " resources)" << std::endl;
+            built++;
+        }
+        else {
+            std::cout << "kas: \x1b[31merror: \x1b[0mfailed to build " << entry.output;
+            std::cout << (reported ? "" : ": " + context.last_error()) << std::endl;
+        }
+    });
+    
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "kas: built " << built << " of " << entries.size() << " targets in " << (elapsed.count() / 1000.0) << "ms" << std::endl;
+    return built == entries.size() ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include "output/resource_writer.hpp"
+
+#if !defined(KDK_BATCH)
+#define KDK_BATCH
+
+namespace kdk
+{
+
+/**
+ * A batch builds many targets in a single process. The scenario is parsed once and its
+ * definitions are shared, read-only, by every target, and the targets are built in
+ * parallel, each by a build context of its own.
+ *
+ * The manifest lists one target per line, as the output file, its format and then its
+ * input files, separated by whitespace:
+ *
+ *     plugins/ships.kdat extended ships.kdl weapons.kdl
+ *
+ * Blank lines and lines starting with '#' are ignored. Relative paths are relative to
+ * the directory of the manifest.
+ */
+class batch
+{
+public:
+    /**
+     * Construct a batch from the targets listed in the specified manifest.
+     */
+    batch(const std::string& manifest_path);
+    
+    /**
+     * Build every target of the batch. The remaining command line arguments may specify
+     * the scenario, the number of targets to build at once and an assembly cache.
+     *
+     * \return Zero if every target was built.
+     */
+    int run(const std::vector<std::string>& arguments);
+    
+private:
+    /**
+     * A single target of the batch.
+     */
+    struct entry
+    {
+        std::string output;
+        kdk::output_format format;
+        std::vector<std::string> inputs;
+    };
+    
+    std::string m_manifest_path;
+    
+    /**
+     * Read the targets of the manifest. Returns false if the manifest is invalid.
+     */
+    bool read_manifest(std::vector<kdk::batch::entry>& entries) const;
+};
+
+};
+
+#endif
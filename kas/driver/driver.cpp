@@ -0,0 +1,347 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <sys/stat.h>
+#include <dirent.h>
+#include "driver/driver.hpp"
+#include "kdl/lexer_cache.hpp"
+#include "kdl/sema.hpp"
+#include "assemblers/pool.hpp"
+#include "image/image_cache.hpp"
+#include "cache/build_stamp.hpp"
+#include "output/depfile.hpp"
+#include "driver/file_watcher.hpp"
+#include "diagnostic/log.hpp"
+
+// The number of bytes of recently used blobs that are kept in memory for each assembly
+// cache, when caches are retained between builds.
+static const uint64_t retained_cache_capacity = 256 << 20;
+
+// MARK: - Scenario
+
+std::vector<std::string> kdk::driver::scenario_files(const std::string& path)
+{
+    // A scenario is either a single definition file, or a directory of them. The files of
+    // a directory are assembled in name order, so that builds are reproducible.
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+        return { path };
+    }
+    
+    std::vector<std::string> files;
+    if (auto dir = ::opendir(path.c_str())) {
+        while (auto entry = ::readdir(dir)) {
+            std::string name { entry->d_name };
+            if (name.size() > 4 && name.substr(name.size() - 4) == ".kdl") {
+                files.push_back(path + "/" + name);
+            }
+        }
+        ::closedir(dir);
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+// MARK: - Formats
+
+bool kdk::driver::format_named(const std::string& name, kdk::output_format& format)
+{
+    if (name == "classic") {
+        format = kdk::output_format::classic;
+    }
+    else if (name == "extended") {
+        format = kdk::output_format::extended;
+    }
+    else if (name == "rez") {
+        format = kdk::output_format::rez;
+    }
+    else if (name == "kestrel") {
+        format = kdk::output_format::kestrel;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+// MARK: - Constructor
+
+kdk::driver::driver()
+{
+    
+}
+
+// MARK: - Configuration
+
+void kdk::driver::set_retains_caches(bool retains)
+{
+    m_retains_caches = retains;
+    if (!m_retains_caches) {
+        m_caches.clear();
+    }
+}
+
+std::shared_ptr<kdk::assembly_cache> kdk::driver::cache_for(const std::string& directory)
+{
+    if (!m_retains_caches) {
+        return std::make_shared<kdk::assembly_cache>(directory);
+    }
+    
+    auto& cache = m_caches[directory];
+    if (!cache) {
+        cache = std::make_shared<kdk::assembly_cache>(directory);
+        cache->set_memory_capacity(retained_cache_capacity);
+    }
+    cache->begin_build();
+    return cache;
+}
+
+// MARK: - Build
+
+int kdk::driver::run(const std::vector<std::string>& arguments)
+{
+    // Step through all of the arguments and determine where the _first_ input file is located.
+    std::string scenario_path { "" };
+    std::string output_file { "plugin.kdat" };
+    kdk::output_format format { kdk::output_format::classic };
+    std::vector<std::tuple<std::string, kdk::output_format>> outputs;
+    std::size_t jobs { 1 };
+    bool pipeline { false };
+    bool compress { false };
+    uint64_t max_memory { 0 };
+    std::string cache_dir { "" };
+    std::string depfile { "" };
+    std::vector<std::string> input_files;
+
+    for (auto i = 0; i < arguments.size(); ++i) {
+        // If the argument starts with a '-' then skip it. If the argument depends on additional arguments, then
+        // skip those as well.
+        if (arguments[i].empty() || arguments[i][0] != '-') {
+            input_files.push_back(arguments[i]);
+            continue;
+        }
+
+        const auto& option = arguments[i];
+        auto has_value = i < arguments.size() - 1;
+        if (option == "--scenario" && has_value) {
+            scenario_path = arguments[++i];
+        }
+        else if (option == "--format" && has_value) {
+            const auto& format_name = arguments[++i];
+            if (!format_named(format_name, format)) {
+                std::cout << "kas: \x1b[31merror: \x1b[0minvalid output format: " << format_name << std::endl;
+                return 3;
+            }
+        }
+        else if (option == "--emit" && has_value) {
+            // Each output is given as `format:path`.
+            const auto& emit = arguments[++i];
+            auto separator = emit.find(':');
+            kdk::output_format emit_format;
+            if (separator == std::string::npos || separator + 1 == emit.size() || !format_named(emit.substr(0, separator), emit_format)) {
+                std::cout << "kas: \x1b[31merror: \x1b[0minvalid output, expected format:path: " << emit << std::endl;
+                return 3;
+            }
+            outputs.emplace_back(emit.substr(separator + 1), emit_format);
+        }
+        else if (option == "-o" && has_value) {
+            output_file = arguments[++i];
+        }
+        else if (option == "-j" && has_value) {
+            const auto& job_count = arguments[++i];
+            if (job_count.empty() || job_count.find_first_not_of("0123456789") != std::string::npos) {
+                std::cout << "kas: \x1b[31merror: \x1b[0minvalid job count: " << job_count << std::endl;
+                return 3;
+            }
+            jobs = std::stoul(job_count);
+        }
+        else if (option == "--cache-dir" && has_value) {
+            cache_dir = arguments[++i];
+        }
+        else if (option == "--depfile" && has_value) {
+            depfile = arguments[++i];
+        }
+        else if (option == "--pipeline") {
+            pipeline = true;
+        }
+        else if (option == "--compress") {
+            compress = true;
+        }
+        else if (option == "--max-memory" && has_value) {
+            std::string budget { arguments[++i] };
+            uint64_t multiplier = 1;
+            switch (budget.empty() ? 0 : budget.back()) {
+                case 'K': case 'k': multiplier = 1ULL << 10; budget.pop_back(); break;
+                case 'M': case 'm': multiplier = 1ULL << 20; budget.pop_back(); break;
+                case 'G': case 'g': multiplier = 1ULL << 30; budget.pop_back(); break;
+                default: break;
+            }
+            if (budget.empty() || budget.find_first_not_of("0123456789") != std::string::npos) {
+                std::cout << "kas: \x1b[31merror: \x1b[0minvalid memory budget: " << arguments[i] << std::endl;
+                return 3;
+            }
+            max_memory = std::stoull(budget) * multiplier;
+            pipeline = true;
+        }
+        else {
+            std::cout << "kas: \x1b[31merror: \x1b[0mbad argument supplied: " << option << std::endl;
+            return 2;
+        }
+    }
+
+    // Without any `--emit` options, the single output is given by `-o` and `--format`.
+    if (outputs.empty()) {
+        outputs.emplace_back(output_file, format);
+    }
+    std::vector<std::string> output_files;
+    for (const auto& output : outputs) {
+        output_files.push_back(std::get<0>(output));
+    }
+    
+    std::string options { "kas-0.2" };
+    for (const auto& argument : arguments) {
+        options += std::string(1, '\0') + argument;
+    }
+    
+    // When producing a depfile, a stamp of the contents of every dependency is kept beside
+    // it. If the output exists and none of the dependencies or options have changed, then
+    // there is nothing to do.
+    kdk::build_stamp stamp { depfile + ".stamp" };
+    if (!depfile.empty() && !m_watching) {
+        struct stat info;
+        auto outputs_exist = std::all_of(output_files.begin(), output_files.end(), [&] (const std::string& path) {
+            return ::stat(path.c_str(), &info) == 0;
+        });
+        if (outputs_exist && stamp.up_to_date(options)) {
+            std::cout << "kas: " << output_files.front() << (output_files.size() > 1 ? " and the other outputs are" : " is") << " up to date" << std::endl;
+            return 0;
+        }
+    }
+    
+    // Types defined by an earlier build performed by this process are only used again
+    // if this build defines them identically. The target begins a build of the image
+    // cache itself, which releases the images that the last build did not use.
+    kdk::assembler_pool::shared().begin_build();
+
+    // Setup a new target.
+    auto target = std::make_shared<kdk::target>(output_files.front());
+    target->set_outputs(outputs);
+    target->set_job_count(jobs);
+    target->set_memory_limit(max_memory);
+    target->set_compression(compress);
+    
+    m_target = target;
+    
+    // When caches are retained, assembled data is always cached in memory, even if there
+    // is no cache directory.
+    std::shared_ptr<kdk::assembly_cache> cache;
+    if (!cache_dir.empty() || m_retains_caches) {
+        cache = cache_for(cache_dir);
+        target->set_cache(cache);
+    }
+    
+    if (pipeline) {
+        target->begin(format);
+    }
+
+    // The scenario definitions are assembled ahead of the input files, so that the types
+    // they define are available to them.
+    // The scenario itself is a dependency, so that adding or removing a definition file
+    // from a scenario directory causes a rebuild.
+    std::vector<std::string> source_files;
+    if (!scenario_path.empty()) {
+        target->add_dependency(scenario_path);
+        source_files = scenario_files(scenario_path);
+    }
+    source_files.insert(source_files.end(), input_files.begin(), input_files.end());
+
+    // Iterate through each of the input files.
+    for (auto file : source_files) {
+        target->add_dependency(file);
+        auto sema = kdl::sema(target, kdl::lexer_cache::shared().analyze(file));
+        sema.run();
+    }
+
+    target->build(format);
+    
+    if (!depfile.empty()) {
+        kdk::depfile::write(depfile, output_files, target->dependencies());
+        stamp.write(options, target->dependencies());
+    }
+    
+    if (cache) {
+        std::cout << "kas: assembly cache: " << cache->hits() << " hits, " << cache->misses() << " misses" << std::endl;
+    }
+    
+    auto shared = target->shared_data();
+    if (std::get<0>(shared) > 0) {
+        std::cout << "kas: deduplicated " << std::get<0>(shared) << " resources, saving " << std::get<1>(shared) << " bytes" << std::endl;
+    }
+
+    return 0;
+}
+
+// MARK: - Watch
+
+int kdk::driver::watch(const std::vector<std::string>& arguments)
+{
+    // Errors are reported, and the build is attempted again once a file changes.
+    log::set_recoverable(true);
+    kdl::lexer_cache::shared().set_retains_tokens(true);
+    kdk::image_cache::shared().set_retains_images(true);
+    set_retains_caches(true);
+    m_watching = true;
+    
+    kdk::file_watcher watcher;
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        auto status = 0;
+        m_target = nullptr;
+        try {
+            status = run(arguments);
+        }
+        catch (const log::fatal_error&) {
+            status = 1;
+        }
+        catch (const std::exception& e) {
+            std::cout << "\x1b[31m" << "Error: " << e.what() << "\x1b[0m" << std::endl;
+            status = 1;
+        }
+        
+        // If the build could not be started then there is nothing to watch.
+        if (!m_target) {
+            return status;
+        }
+        
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        std::cout << "kas: build finished with status " << status << " in " << (elapsed.count() / 1000.0) << "ms, "
+                  << "watching " << m_target->dependencies().size() << " files" << std::endl;
+        
+        watcher.watch(m_target->dependencies());
+        for (const auto& path : watcher.wait()) {
+            std::cout << "kas: " << path << " changed" << std::endl;
+        }
+    }
+}
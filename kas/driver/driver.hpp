@@ -0,0 +1,102 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include "cache/assembly_cache.hpp"
+#include "structures/target.hpp"
+#include "output/resource_writer.hpp"
+
+#if !defined(KDK_DRIVER)
+#define KDK_DRIVER
+
+namespace kdk
+{
+
+/**
+ * The driver performs a complete build from a set of command line arguments: it parses
+ * the options, analyses each of the input files and builds the target.
+ *
+ * A single driver may perform many builds. State that is worth keeping between builds,
+ * such as assembly caches, is owned by the driver.
+ */
+class driver
+{
+public:
+    /**
+     * Construct a new driver.
+     */
+    driver();
+    
+    /**
+     * Set whether the driver should keep its assembly caches, and recently used blobs
+     * from them, in memory between builds.
+     */
+    void set_retains_caches(bool retains);
+    
+    /**
+     * Perform a build using the specified command line arguments, excluding the name of
+     * the program.
+     *
+     * \return The exit status of the build.
+     */
+    int run(const std::vector<std::string>& arguments);
+    
+    /**
+     * Perform a build using the specified command line arguments, and then rebuild
+     * whenever any of the files that the build depended upon change. Only files that
+     * have changed are analysed again, and only resources whose assembled data is not
+     * already known are assembled again.
+     *
+     * \return The exit status of the first build, if it could not be started.
+     */
+    int watch(const std::vector<std::string>& arguments);
+    
+    /**
+     * Returns the definition files of a scenario. A scenario is either a single file, or
+     * a directory of files which are returned in name order.
+     */
+    static std::vector<std::string> scenario_files(const std::string& path);
+    
+    /**
+     * Look up the output format with the specified name, which is one of 'classic',
+     * 'extended', 'rez' or 'kestrel'. Returns false if there is no such format.
+     */
+    static bool format_named(const std::string& name, kdk::output_format& format);
+    
+private:
+    bool m_retains_caches { false };
+    bool m_watching { false };
+    std::shared_ptr<kdk::target> m_target;
+    std::map<std::string, std::shared_ptr<kdk::assembly_cache>> m_caches;
+    
+    /**
+     * Returns the assembly cache for the specified directory.
+     */
+    std::shared_ptr<kdk::assembly_cache> cache_for(const std::string& directory);
+};
+
+};
+
+#endif
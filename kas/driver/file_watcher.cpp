@@ -0,0 +1,155 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <poll.h>
+#include <thread>
+#include <chrono>
+#include "driver/file_watcher.hpp"
+#include "cache/hasher.hpp"
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+// Changes that arrive within this many milliseconds of each other are combined.
+static const int settle_interval = 30;
+
+// The interval between checks of the watched files, when they must be polled.
+static const int poll_interval = 250;
+
+// MARK: - Helpers
+
+static std::string directory_of(const std::string& path)
+{
+    auto n = path.find_last_of('/');
+    if (n == std::string::npos) {
+        return ".";
+    }
+    return n == 0 ? "/" : path.substr(0, n);
+}
+
+// MARK: - Constructor
+
+kdk::file_watcher::file_watcher()
+{
+#if defined(__linux__)
+    m_fd = ::inotify_init1(IN_CLOEXEC);
+#endif
+}
+
+kdk::file_watcher::~file_watcher()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+// MARK: - Watching
+
+void kdk::file_watcher::watch(const std::vector<std::string>& paths)
+{
+    m_paths = std::set<std::string>(paths.begin(), paths.end());
+    
+    m_identities.clear();
+    for (const auto& path : m_paths) {
+        m_identities[path] = kdk::hasher::file_identity(path);
+    }
+    
+#if defined(__linux__)
+    if (m_fd >= 0) {
+        for (const auto& directory : m_directories) {
+            ::inotify_rm_watch(m_fd, directory.first);
+        }
+        m_directories.clear();
+        
+        // A watched directory is also watched itself, so that files being added to or
+        // removed from it are noticed.
+        std::set<std::string> directories;
+        for (const auto& path : m_paths) {
+            directories.insert(directory_of(path));
+            
+            struct stat info;
+            if (::stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+                directories.insert(path);
+            }
+        }
+        for (const auto& directory : directories) {
+            auto wd = ::inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE | IN_ATTRIB);
+            if (wd >= 0) {
+                m_directories[wd] = directory;
+            }
+        }
+    }
+#endif
+}
+
+std::vector<std::string> kdk::file_watcher::changed_paths()
+{
+    std::vector<std::string> changed;
+    for (auto& identity : m_identities) {
+        auto current = kdk::hasher::file_identity(identity.first);
+        if (current != identity.second) {
+            identity.second = current;
+            changed.push_back(identity.first);
+        }
+    }
+    return changed;
+}
+
+std::vector<std::string> kdk::file_watcher::wait()
+{
+    while (true) {
+#if defined(__linux__)
+        if (m_fd >= 0 && !m_directories.empty()) {
+            // Block until something happens in one of the watched directories, and then
+            // keep draining events until they settle.
+            struct pollfd pfd { m_fd, POLLIN, 0 };
+            auto timeout = -1;
+            while (::poll(&pfd, 1, timeout) > 0) {
+                char buffer[4096];
+                if (::read(m_fd, buffer, sizeof(buffer)) <= 0) {
+                    break;
+                }
+                timeout = settle_interval;
+            }
+            
+            // Events are reported for every file in the directories, so only report the
+            // watched files that have actually changed.
+            auto changed = changed_paths();
+            if (!changed.empty()) {
+                return changed;
+            }
+            continue;
+        }
+#endif
+        std::this_thread::sleep_for(std::chrono::milliseconds(poll_interval));
+        auto changed = changed_paths();
+        if (!changed.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(settle_interval));
+            auto settled = changed_paths();
+            changed.insert(changed.end(), settled.begin(), settled.end());
+            return changed;
+        }
+    }
+}
@@ -0,0 +1,84 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+
+#if !defined(KDK_FILE_WATCHER)
+#define KDK_FILE_WATCHER
+
+namespace kdk
+{
+
+/**
+ * The file watcher waits for any of a set of files to change. On Linux the watcher
+ * uses inotify, watching the directory of each file so that files replaced by editors
+ * (written to a temporary file and renamed) are still noticed. On other platforms
+ * the files are polled.
+ *
+ * A directory may be watched like a file, in which case it changes whenever an entry is
+ * added to or removed from it.
+ */
+class file_watcher
+{
+public:
+    file_watcher(const file_watcher&) = delete;
+    file_watcher& operator=(const file_watcher &) = delete;
+    
+    /**
+     * Construct a new file watcher, that is not watching any files.
+     */
+    file_watcher();
+    
+    /**
+     * Stop watching all files.
+     */
+    ~file_watcher();
+    
+    /**
+     * Replace the set of files being watched.
+     */
+    void watch(const std::vector<std::string>& paths);
+    
+    /**
+     * Wait until at least one of the watched files has changed, and return the files
+     * that changed. Changes that arrive in quick succession are combined.
+     */
+    std::vector<std::string> wait();
+    
+private:
+    int m_fd { -1 };
+    std::set<std::string> m_paths;
+    std::map<int, std::string> m_directories;
+    std::map<std::string, std::string> m_identities;
+    
+    /**
+     * Returns the files whose identity has changed since they were last checked.
+     */
+    std::vector<std::string> changed_paths();
+};
+
+};
+
+#endif
@@ -0,0 +1,262 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <signal.h>
+#include <cerrno>
+#include <cstring>
+#include <climits>
+#include <chrono>
+#include <sstream>
+#include <iostream>
+#include "driver/server.hpp"
+#include "kdl/lexer_cache.hpp"
+#include "image/image_cache.hpp"
+#include "diagnostic/log.hpp"
+
+// MARK: - Helpers
+
+static bool write_all(int fd, const char *bytes, std::size_t size)
+{
+    while (size > 0) {
+        auto count = ::write(fd, bytes, size);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        bytes += count;
+        size -= count;
+    }
+    return true;
+}
+
+static bool read_all(int fd, char *bytes, std::size_t size)
+{
+    while (size > 0) {
+        auto count = ::read(fd, bytes, size);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        bytes += count;
+        size -= count;
+    }
+    return true;
+}
+
+static bool write_u32(int fd, uint32_t value)
+{
+    char bytes[4] = {
+        static_cast<char>(value >> 24), static_cast<char>(value >> 16),
+        static_cast<char>(value >> 8), static_cast<char>(value)
+    };
+    return write_all(fd, bytes, sizeof(bytes));
+}
+
+static bool read_u32(int fd, uint32_t& value)
+{
+    unsigned char bytes[4];
+    if (!read_all(fd, reinterpret_cast<char *>(bytes), sizeof(bytes))) {
+        return false;
+    }
+    value = (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | uint32_t(bytes[3]);
+    return true;
+}
+
+static bool write_string(int fd, const std::string& str)
+{
+    return write_u32(fd, static_cast<uint32_t>(str.size())) && write_all(fd, str.data(), str.size());
+}
+
+// The largest request that is accepted, which bounds the memory that a client can make
+// the server allocate.
+static const std::size_t max_request_size = 64 << 20;
+
+static bool read_string(int fd, std::string& str)
+{
+    uint32_t size = 0;
+    if (!read_u32(fd, size) || size > max_request_size) {
+        return false;
+    }
+    str.resize(size);
+    return read_all(fd, &str[0], size);
+}
+
+static bool socket_address(const std::string& path, struct sockaddr_un& address)
+{
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return true;
+}
+
+// MARK: - Constructor
+
+kdk::server::server(const std::string& socket_path)
+    : m_socket_path(socket_path)
+{
+    
+}
+
+// MARK: - Server
+
+int kdk::server::run()
+{
+    struct sockaddr_un address;
+    if (!socket_address(m_socket_path, address)) {
+        std::cout << "kas: \x1b[31merror: \x1b[0msocket path is too long: " << m_socket_path << std::endl;
+        return 4;
+    }
+    
+    auto listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(m_socket_path.c_str());
+    if (listener < 0 || ::bind(listener, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) != 0 || ::listen(listener, 16) != 0) {
+        std::cout << "kas: \x1b[31merror: \x1b[0munable to listen on " << m_socket_path << ": " << strerror(errno) << std::endl;
+        return 4;
+    }
+    
+    // A client that disconnects early must not terminate the server. Errors in a build
+    // are reported to its client, rather than terminating the server.
+    ::signal(SIGPIPE, SIG_IGN);
+    log::set_recoverable(true);
+    kdl::lexer_cache::shared().set_retains_tokens(true);
+    kdk::image_cache::shared().set_retains_images(true);
+    m_driver.set_retains_caches(true);
+    
+    std::cout << "kas: listening on " << m_socket_path << std::endl;
+    while (true) {
+        auto connection = ::accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cout << "kas: \x1b[31merror: \x1b[0munable to accept connection: " << strerror(errno) << std::endl;
+            return 4;
+        }
+        serve(connection);
+        ::close(connection);
+    }
+}
+
+void kdk::server::serve(int connection)
+{
+    std::string directory;
+    uint32_t count = 0;
+    if (!read_string(connection, directory) || !read_u32(connection, count)) {
+        return;
+    }
+    
+    // Arguments are read one at a time, and together must fit within the size of a
+    // request, so that the count alone cannot make the server allocate memory.
+    std::vector<std::string> arguments;
+    auto request_size = directory.size();
+    for (uint32_t n = 0; n < count; ++n) {
+        std::string argument;
+        if (!read_string(connection, argument)) {
+            return;
+        }
+        request_size += sizeof(uint32_t) + argument.size();
+        if (request_size > max_request_size) {
+            return;
+        }
+        arguments.push_back(std::move(argument));
+    }
+    
+    // Builds are performed relative to the working directory of the client, and capture
+    // everything that they print so that it can be returned to the client.
+    char server_directory[PATH_MAX];
+    if (!::getcwd(server_directory, sizeof(server_directory)) || ::chdir(directory.c_str()) != 0) {
+        write_u32(connection, 4);
+        write_string(connection, "kas: error: unable to enter directory " + directory + "\n");
+        return;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    std::ostringstream output;
+    auto stdout_buffer = std::cout.rdbuf(output.rdbuf());
+    
+    int status = 0;
+    try {
+        status = m_driver.run(arguments);
+    }
+    catch (const log::fatal_error&) {
+        status = 1;
+    }
+    catch (const std::exception& e) {
+        std::cout << "\x1b[31m" << "Error: " << e.what() << "\x1b[0m" << std::endl;
+        status = 1;
+    }
+    
+    std::cout.rdbuf(stdout_buffer);
+    ::chdir(server_directory);
+    
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "kas: build in " << directory << " finished with status " << status
+              << " in " << (elapsed.count() / 1000.0) << "ms" << std::endl;
+    
+    write_u32(connection, static_cast<uint32_t>(status));
+    write_string(connection, output.str());
+}
+
+// MARK: - Client
+
+int kdk::server::request(const std::string& socket_path, const std::vector<std::string>& arguments)
+{
+    struct sockaddr_un address;
+    auto connection = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (!socket_address(socket_path, address) || connection < 0 || ::connect(connection, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) != 0) {
+        std::cout << "kas: \x1b[31merror: \x1b[0munable to connect to " << socket_path << ": " << strerror(errno) << std::endl;
+        return 4;
+    }
+    
+    char directory[PATH_MAX];
+    if (!::getcwd(directory, sizeof(directory))) {
+        std::cout << "kas: \x1b[31merror: \x1b[0munable to determine the working directory" << std::endl;
+        return 4;
+    }
+    
+    auto sent = write_string(connection, directory) && write_u32(connection, static_cast<uint32_t>(arguments.size()));
+    for (auto n = 0; sent && n < arguments.size(); ++n) {
+        sent = write_string(connection, arguments[n]);
+    }
+    
+    uint32_t status = 0;
+    std::string output;
+    if (!sent || !read_u32(connection, status) || !read_string(connection, output)) {
+        std::cout << "kas: \x1b[31merror: \x1b[0mthe compile server did not respond" << std::endl;
+        ::close(connection);
+        return 4;
+    }
+    ::close(connection);
+    
+    std::cout << output << std::flush;
+    return static_cast<int>(status);
+}
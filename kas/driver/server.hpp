@@ -0,0 +1,79 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include "driver/driver.hpp"
+
+#if !defined(KDK_SERVER)
+#define KDK_SERVER
+
+namespace kdk
+{
+
+/**
+ * The compile server accepts build requests on a Unix domain socket and performs them
+ * with a single, long lived driver. Type definitions, the tokens of source files and
+ * assembly caches are kept warm between requests, and are only discarded when their
+ * source changes.
+ *
+ * A request consists of the working directory of the client followed by its command
+ * line arguments. The response is the exit status of the build, followed by everything
+ * that the build printed. Every value is sent as a big endian 32-bit length or integer,
+ * with strings followed by their bytes.
+ */
+class server
+{
+public:
+    /**
+     * Construct a new compile server that will listen on the specified socket path.
+     */
+    server(const std::string& socket_path);
+    
+    /**
+     * Accept and perform build requests until the process is terminated.
+     *
+     * \return The exit status of the server, if it could not be started.
+     */
+    int run();
+    
+    /**
+     * Send a build request to the compile server listening on the specified socket,
+     * printing its output.
+     *
+     * \return The exit status of the build.
+     */
+    static int request(const std::string& socket_path, const std::vector<std::string>& arguments);
+    
+private:
+    std::string m_socket_path;
+    kdk::driver m_driver;
+    
+    /**
+     * Perform a single build request received on the connection.
+     */
+    void serve(int connection);
+};
+
+};
+
+#endif
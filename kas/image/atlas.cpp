@@ -0,0 +1,286 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include "image/atlas.hpp"
+#include "image/png.hpp"
+
+// MARK: - Constants
+
+// Frames are separated by a transparent gap, so that filtering a frame never samples its
+// neighbours.
+static const uint32_t padding = 1;
+static const uint32_t max_dimension = 0xFFFF;
+
+// The widths of sheet that are tried, relative to the square root of the packed area.
+static const double sheet_widths[] = { 1.0, 1.1, 1.25, 1.5, 2.0 };
+
+// MARK: - Helpers
+
+/**
+ * The visible bounds of a frame, and the place that they are packed in the sheet.
+ */
+struct packed_frame
+{
+    uint32_t left { 0 };
+    uint32_t top { 0 };
+    uint32_t width { 0 };
+    uint32_t height { 0 };
+    uint32_t x { 0 };
+    uint32_t y { 0 };
+};
+
+/**
+ * A horizontal segment of the skyline, which is the top edge of everything packed so far.
+ */
+struct skyline_segment
+{
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+};
+
+static inline void put_u16(std::vector<char>& data, uint32_t value)
+{
+    data.push_back(static_cast<char>(value >> 8));
+    data.push_back(static_cast<char>(value));
+}
+
+/**
+ * Find the bounds of the pixels of the frame that are not entirely transparent. A frame
+ * with no such pixels is empty. Each row is scanned from the left until a visible pixel
+ * is found, and from the right only until the known bounds are reached.
+ */
+static packed_frame trim(const kdk::image& frame)
+{
+    packed_frame bounds;
+    const std::size_t width = frame.width;
+    auto alpha = [&] (std::size_t x, std::size_t y) {
+        return frame.pixels[(y * width + x) * 4 + 3];
+    };
+    
+    std::size_t left = width;
+    std::size_t right = 0;
+    std::size_t top = frame.height;
+    std::size_t bottom = 0;
+    for (std::size_t y = 0; y < frame.height; ++y) {
+        std::size_t x = 0;
+        while (x < width && !alpha(x, y)) {
+            x++;
+        }
+        if (x == width) {
+            continue;
+        }
+        left = std::min(left, x);
+        
+        auto end = width;
+        while (end > std::max(x, right) + 1 && !alpha(end - 1, y)) {
+            end--;
+        }
+        right = std::max(right, end - 1);
+        top = std::min(top, y);
+        bottom = y;
+    }
+    
+    if (top < frame.height) {
+        bounds.left = static_cast<uint32_t>(left);
+        bounds.top = static_cast<uint32_t>(top);
+        bounds.width = static_cast<uint32_t>(right - left + 1);
+        bounds.height = static_cast<uint32_t>(bottom - top + 1);
+    }
+    return bounds;
+}
+
+/**
+ * Pack the frames into a sheet of the specified width using a skyline packer. Frames are
+ * placed from the tallest to the shortest, each at the lowest point of the skyline that it
+ * fits, and then the leftmost. Returns the height of the sheet.
+ */
+static uint32_t pack_skyline(std::vector<packed_frame>& frames, const std::vector<std::size_t>& order, uint32_t sheet_width)
+{
+    std::vector<skyline_segment> skyline { { 0, 0, sheet_width } };
+    uint32_t sheet_height = 0;
+    
+    for (auto index : order) {
+        auto& frame = frames[index];
+        if (frame.width == 0) {
+            continue;
+        }
+        auto width = std::min(frame.width + padding, sheet_width);
+        auto height = frame.height + padding;
+        
+        std::size_t best = skyline.size();
+        uint32_t best_y = UINT32_MAX;
+        for (std::size_t n = 0; n < skyline.size() && skyline[n].x + width <= sheet_width; ++n) {
+            uint32_t y = 0;
+            uint32_t covered = 0;
+            for (auto k = n; covered < width; ++k) {
+                y = std::max(y, skyline[k].y);
+                covered += skyline[k].width;
+            }
+            if (y < best_y) {
+                best = n;
+                best_y = y;
+            }
+        }
+        
+        frame.x = skyline[best].x;
+        frame.y = best_y;
+        sheet_height = std::max(sheet_height, frame.y + frame.height);
+        
+        // The frame becomes a new segment of the skyline, and covers the segments that it
+        // spans, in whole or in part.
+        skyline_segment placed { frame.x, best_y + height, width };
+        auto end = frame.x + width;
+        auto k = best;
+        while (k < skyline.size() && skyline[k].x + skyline[k].width <= end) {
+            k++;
+        }
+        if (k < skyline.size() && skyline[k].x < end) {
+            skyline[k].width -= end - skyline[k].x;
+            skyline[k].x = end;
+        }
+        skyline.erase(skyline.begin() + best, skyline.begin() + k);
+        skyline.insert(skyline.begin() + best, placed);
+        
+        // Neighbouring segments at the same height are merged.
+        for (std::size_t n = 0; n + 1 < skyline.size();) {
+            if (skyline[n].y == skyline[n + 1].y) {
+                skyline[n].width += skyline[n + 1].width;
+                skyline.erase(skyline.begin() + n + 1);
+            }
+            else {
+                n++;
+            }
+        }
+    }
+    return sheet_height;
+}
+
+// MARK: - Packing
+
+bool kdk::atlas::validate(const std::vector<std::shared_ptr<const kdk::image>>& frames, std::string& error)
+{
+    if (frames.empty() || frames.size() > max_dimension) {
+        error = "An atlas must have between 1 and 65535 frames.";
+        return false;
+    }
+    for (const auto& frame : frames) {
+        if (frame->width != frames.front()->width || frame->height != frames.front()->height) {
+            error = "The frames of an atlas must all be the same size.";
+            return false;
+        }
+    }
+    if (frames.front()->width > max_dimension || frames.front()->height > max_dimension) {
+        error = "The frames are too large to be packed into an atlas.";
+        return false;
+    }
+    return true;
+}
+
+bool kdk::atlas::pack(const std::vector<std::shared_ptr<const kdk::image>>& frames, std::vector<char>& data, std::string& error)
+{
+    std::vector<packed_frame> packed;
+    uint64_t area = 0;
+    uint32_t widest = 1;
+    for (const auto& frame : frames) {
+        packed.push_back(trim(*frame));
+        area += static_cast<uint64_t>(packed.back().width + padding) * (packed.back().height + padding);
+        widest = std::max(widest, packed.back().width);
+    }
+    
+    std::vector<std::size_t> order(packed.size());
+    for (std::size_t n = 0; n < order.size(); ++n) {
+        order[n] = n;
+    }
+    std::stable_sort(order.begin(), order.end(), [&] (std::size_t a, std::size_t b) {
+        return std::make_tuple(packed[a].height, packed[a].width) > std::make_tuple(packed[b].height, packed[b].width);
+    });
+    
+    // Several widths of sheet are tried, and the one with the least area is kept. Ties
+    // favour the sheet that is closest to square.
+    std::vector<packed_frame> best;
+    uint32_t best_width = 0;
+    uint32_t best_height = 0;
+    auto side = std::sqrt(static_cast<double>(area));
+    for (auto scale : sheet_widths) {
+        auto width = std::max(widest, static_cast<uint32_t>(std::ceil(side * scale)));
+        auto candidate = packed;
+        auto height = std::max<uint32_t>(pack_skyline(candidate, order, width), 1);
+        
+        auto candidate_area = static_cast<uint64_t>(width) * height;
+        auto best_area = static_cast<uint64_t>(best_width) * best_height;
+        if (best.empty() || candidate_area < best_area || (candidate_area == best_area && std::max(width, height) < std::max(best_width, best_height))) {
+            best = std::move(candidate);
+            best_width = width;
+            best_height = height;
+        }
+    }
+    
+    // The sheet is only as wide as the frames that were placed in it.
+    uint32_t used_width = 1;
+    for (const auto& frame : best) {
+        used_width = std::max(used_width, frame.x + frame.width);
+    }
+    if (used_width > max_dimension || best_height > max_dimension) {
+        error = "The frames are too large to be packed into a single sheet.";
+        return false;
+    }
+    
+    kdk::image sheet;
+    sheet.width = used_width;
+    sheet.height = best_height;
+    sheet.pixels.assign(static_cast<std::size_t>(sheet.width) * sheet.height * 4, 0);
+    for (std::size_t n = 0; n < best.size(); ++n) {
+        const auto& frame = best[n];
+        const auto& source = *frames[n];
+        for (std::size_t row = 0; row < frame.height; ++row) {
+            auto from = source.pixels.begin() + ((frame.top + row) * source.width + frame.left) * 4;
+            std::copy(from, from + frame.width * 4, sheet.pixels.begin() + ((frame.y + row) * sheet.width + frame.x) * 4);
+        }
+    }
+    
+    // The header holds the size of the frames, the number of frames and a reserved word.
+    // Each frame then has its place and size in the sheet, and the offset of its visible
+    // bounds within the frame.
+    data.clear();
+    put_u16(data, frames.front()->width);
+    put_u16(data, frames.front()->height);
+    put_u16(data, static_cast<uint32_t>(frames.size()));
+    put_u16(data, 0);
+    for (const auto& frame : best) {
+        put_u16(data, frame.x);
+        put_u16(data, frame.y);
+        put_u16(data, frame.width);
+        put_u16(data, frame.height);
+        put_u16(data, frame.left);
+        put_u16(data, frame.top);
+    }
+    
+    std::vector<char> encoded;
+    if (!kdk::png::encode(sheet, encoded, error)) {
+        return false;
+    }
+    data.insert(data.end(), encoded.begin(), encoded.end());
+    return true;
+}
@@ -0,0 +1,62 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "image/image.hpp"
+
+#if !defined(KDK_IMAGE_ATLAS)
+#define KDK_IMAGE_ATLAS
+
+namespace kdk
+{
+
+/**
+ * An atlas holds the frames of an animation packed into a single sheet. Each frame is
+ * trimmed to the bounds of its visible pixels, and the trimmed frames are packed as
+ * tightly as possible, so that the sheet is far smaller than a grid of whole frames.
+ *
+ * The atlas begins with the size of the frames and a table that locates each trimmed
+ * frame in the sheet, and is followed by the sheet as a PNG image.
+ */
+namespace atlas
+{
+
+/**
+ * Check that the frames can be packed into an atlas. Returns false, and describes the
+ * problem in `error`, if they are not all the same size.
+ */
+bool validate(const std::vector<std::shared_ptr<const kdk::image>>& frames, std::string& error);
+
+/**
+ * Trim and pack the frames into an atlas, replacing the contents of `data`. Returns
+ * false, and describes the problem in `error`, if the atlas can not be represented.
+ */
+bool pack(const std::vector<std::shared_ptr<const kdk::image>>& frames, std::vector<char>& data, std::string& error);
+
+};
+
+};
+
+#endif
@@ -0,0 +1,145 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "image/cicn.hpp"
+
+// MARK: - Constants
+
+static const uint8_t opaque_threshold = 128;
+
+// Row bytes are stored in 14 bits, as the top bits of the field are flags.
+static const uint32_t max_row_bytes = 0x3FFE;
+static const uint32_t pixmap_flag = 0x8000;
+
+// MARK: - Helpers
+
+static inline void put_u16(std::vector<char>& data, uint32_t value)
+{
+    data.push_back(static_cast<char>(value >> 8));
+    data.push_back(static_cast<char>(value));
+}
+
+static inline void put_u32(std::vector<char>& data, uint32_t value)
+{
+    put_u16(data, value >> 16);
+    put_u16(data, value & 0xFFFF);
+}
+
+/**
+ * Returns the number of bytes in each row of an image of the specified width and depth.
+ * Rows are padded to a whole number of 16-bit words.
+ */
+static inline uint32_t row_bytes(uint32_t width, uint32_t depth)
+{
+    return ((width * depth + 15) / 16) * 2;
+}
+
+static inline void put_bitmap(std::vector<char>& data, uint32_t row_bytes, const kdk::image& image)
+{
+    put_u32(data, 0);
+    put_u16(data, row_bytes);
+    put_u16(data, 0);
+    put_u16(data, 0);
+    put_u16(data, image.height);
+    put_u16(data, image.width);
+}
+
+// MARK: - Encoding
+
+bool kdk::cicn::validate(const kdk::image& image, std::string& error)
+{
+    if (row_bytes(image.width, 8) > max_row_bytes || image.height > 0x7FFF) {
+        error = "The image is too large to be stored as a color icon.";
+        return false;
+    }
+    return true;
+}
+
+void kdk::cicn::assemble(const kdk::image& image, const kdk::quantizer::palette& palette, const std::vector<uint8_t>& indices, std::vector<char>& data)
+{
+    auto pixel_row_bytes = row_bytes(image.width, 8);
+    auto bit_row_bytes = row_bytes(image.width, 1);
+    data.clear();
+    
+    // The pixel map, whose base address and color table handle are filled in when the
+    // icon is loaded.
+    put_u32(data, 0);
+    put_u16(data, pixmap_flag | pixel_row_bytes);
+    put_u16(data, 0);
+    put_u16(data, 0);
+    put_u16(data, image.height);
+    put_u16(data, image.width);
+    put_u16(data, 0);
+    put_u16(data, 0);
+    put_u32(data, 0);
+    put_u32(data, 0x00480000);
+    put_u32(data, 0x00480000);
+    put_u16(data, 0);
+    put_u16(data, 8);
+    put_u16(data, 1);
+    put_u16(data, 8);
+    put_u32(data, 0);
+    put_u32(data, 0);
+    put_u32(data, 0);
+    
+    // The mask and monochrome bitmaps, and the handle of the icon's data.
+    put_bitmap(data, bit_row_bytes, image);
+    put_bitmap(data, bit_row_bytes, image);
+    put_u32(data, 0);
+    
+    // The mask is set for every pixel that is at least half opaque, and the monochrome
+    // image for every such pixel that is dark.
+    auto mask = data.size();
+    data.resize(mask + 2 * bit_row_bytes * image.height, 0);
+    auto bitmap = mask + bit_row_bytes * image.height;
+    for (std::size_t y = 0; y < image.height; ++y) {
+        for (std::size_t x = 0; x < image.width; ++x) {
+            auto pixel = image.pixels.data() + (y * image.width + x) * 4;
+            if (pixel[3] < opaque_threshold) {
+                continue;
+            }
+            auto bit = static_cast<char>(0x80 >> (x % 8));
+            data[mask + y * bit_row_bytes + x / 8] |= bit;
+            if (pixel[0] * 299 + pixel[1] * 587 + pixel[2] * 114 < 128000) {
+                data[bitmap + y * bit_row_bytes + x / 8] |= bit;
+            }
+        }
+    }
+    
+    // The color table, whose entries are numbered in order, with 16-bit components.
+    put_u32(data, 0);
+    put_u16(data, 0);
+    put_u16(data, static_cast<uint32_t>(palette.colors.size() - 1));
+    for (std::size_t n = 0; n < palette.colors.size(); ++n) {
+        put_u16(data, static_cast<uint32_t>(n));
+        for (auto component : palette.colors[n]) {
+            put_u16(data, component * 0x101);
+        }
+    }
+    
+    // The pixels, padded to the row bytes of the pixel map.
+    for (std::size_t y = 0; y < image.height; ++y) {
+        auto row = indices.begin() + y * image.width;
+        data.insert(data.end(), row, row + image.width);
+        data.resize(data.size() + pixel_row_bytes - image.width, 0);
+    }
+}
@@ -0,0 +1,58 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "image/image.hpp"
+#include "image/quantizer.hpp"
+
+#if !defined(KDK_IMAGE_CICN)
+#define KDK_IMAGE_CICN
+
+namespace kdk
+{
+
+/**
+ * The cicn format holds a Macintosh color icon: an 8-bit indexed image with its color
+ * table, a 1-bit mask, and a 1-bit image for monochrome displays.
+ */
+namespace cicn
+{
+
+/**
+ * Check that the image can be stored as a color icon. Returns false, and describes the
+ * problem in `error`, if it can not.
+ */
+bool validate(const kdk::image& image, std::string& error);
+
+/**
+ * Assemble a color icon from the image and its pixels quantized to the palette, replacing
+ * the contents of `data`. Pixels that are less than half opaque are masked out.
+ */
+void assemble(const kdk::image& image, const kdk::quantizer::palette& palette, const std::vector<uint8_t>& indices, std::vector<char>& data);
+
+};
+
+};
+
+#endif
@@ -0,0 +1,61 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <vector>
+#include <cstdint>
+
+#if !defined(KDK_IMAGE)
+#define KDK_IMAGE
+
+namespace kdk
+{
+
+/**
+ * A decoded image. Pixels are stored as 8-bit red, green, blue and alpha components,
+ * row by row from the top left corner, with no padding between rows.
+ */
+struct image
+{
+    /**
+     * The largest number of pixels that a decoded image may have.
+     */
+    static const uint64_t max_pixels = 1 << 26;
+    
+    /**
+     * The width of the image in pixels.
+     */
+    uint32_t width { 0 };
+    
+    /**
+     * The height of the image in pixels.
+     */
+    uint32_t height { 0 };
+    
+    /**
+     * The components of each pixel, four bytes per pixel.
+     */
+    std::vector<uint8_t> pixels;
+};
+
+};
+
+#endif
@@ -0,0 +1,605 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <cerrno>
+#include <cstring>
+#include <cctype>
+#include <set>
+#include <algorithm>
+#include "image/image_cache.hpp"
+#include "image/png.hpp"
+#include "image/tga.hpp"
+#include "image/rled.hpp"
+#include "image/cicn.hpp"
+#include "image/pict.hpp"
+#include "image/atlas.hpp"
+#include "image/quantizer.hpp"
+#include "cache/hasher.hpp"
+#include "diagnostic/log.hpp"
+
+// MARK: - Helpers
+
+static inline std::vector<uint8_t> read_file(const std::string& path)
+{
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || ::fstat(fd, &info) != 0) {
+        log::error(path, 0, "Unable to read image: " + std::string(strerror(errno)));
+    }
+    
+    std::vector<uint8_t> contents(static_cast<std::size_t>(info.st_size));
+    std::size_t offset = 0;
+    while (offset < contents.size()) {
+        auto count = ::read(fd, contents.data() + offset, contents.size() - offset);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            ::close(fd);
+            log::error(path, 0, "Unable to read image.");
+        }
+        offset += count;
+    }
+    ::close(fd);
+    return contents;
+}
+
+static inline bool has_extension(const std::string& path, const std::string& extension)
+{
+    if (path.size() < extension.size()) {
+        return false;
+    }
+    return std::equal(extension.begin(), extension.end(), path.end() - extension.size(), [] (char a, char b) {
+        return std::tolower(a) == std::tolower(b);
+    });
+}
+
+// MARK: - Conversions
+
+// Images that are quantized or compressed by row are divided into bands of about this
+// many pixels, which are converted in parallel.
+static const std::size_t band_pixels = 1 << 16;
+
+/**
+ * Split a format into its name and its arguments. `rleD(48,32)` has the name `rleD` and
+ * the arguments `48` and `32`.
+ */
+static inline std::tuple<std::string, std::vector<std::string>> parse_format(const std::string& format)
+{
+    auto open = format.find('(');
+    if (open == std::string::npos || format.back() != ')') {
+        return std::make_tuple(format, std::vector<std::string>());
+    }
+    
+    std::vector<std::string> arguments;
+    for (auto start = open + 1; start < format.size();) {
+        auto end = format.find_first_of(",)", start);
+        arguments.push_back(format.substr(start, end - start));
+        start = end + 1;
+    }
+    return std::make_tuple(format.substr(0, open), arguments);
+}
+
+/**
+ * Returns the value of an argument that should be a positive integer, or zero if it is
+ * not one.
+ */
+static inline uint32_t dimension(const std::string& argument)
+{
+    if (argument.empty() || argument.size() > 5 || !std::all_of(argument.begin(), argument.end(), [] (char c) { return std::isdigit(static_cast<unsigned char>(c)); }) || argument[0] == '0') {
+        return 0;
+    }
+    return static_cast<uint32_t>(std::stoul(argument));
+}
+
+static inline bool has_argument(const std::vector<std::string>& arguments, const std::string& argument)
+{
+    return std::find(arguments.begin(), arguments.end(), argument) != arguments.end();
+}
+
+/**
+ * Returns the size of the frames of an rlëD sprite, which is the whole image unless the
+ * format specifies it.
+ */
+static inline std::tuple<uint32_t, uint32_t> frame_size(const std::vector<std::string>& arguments, const kdk::image& image)
+{
+    if (arguments.size() == 2) {
+        return std::make_tuple(dimension(arguments[0]), dimension(arguments[1]));
+    }
+    return std::make_tuple(image.width, image.height);
+}
+
+static inline std::size_t band_rows(const kdk::image& image)
+{
+    return std::max<std::size_t>(1, band_pixels / image.width);
+}
+
+/**
+ * Returns the number of parts that the conversion of an image to a format is divided
+ * into. The parts are independent of each other, and may be converted in parallel.
+ */
+static std::size_t conversion_parts(const std::string& path, const std::string& format, const kdk::image& image)
+{
+    auto parsed = parse_format(format);
+    std::string error;
+    if (std::get<0>(parsed) == "rleD") {
+        auto size = frame_size(std::get<1>(parsed), image);
+        std::size_t count = 0;
+        if (!kdk::rled::frame_count(image, std::get<0>(size), std::get<1>(size), count, error)) {
+            log::error(path, 0, "Unable to import image as rlëD: " + error);
+        }
+        return count;
+    }
+    if (std::get<0>(parsed) == "cicn") {
+        if (!kdk::cicn::validate(image, error)) {
+            log::error(path, 0, "Unable to import image as cicn: " + error);
+        }
+        return (image.height + band_rows(image) - 1) / band_rows(image);
+    }
+    if (std::get<0>(parsed) == "PICT") {
+        if (!kdk::pict::validate(image, error)) {
+            log::error(path, 0, "Unable to import image as PICT: " + error);
+        }
+        return (image.height + band_rows(image) - 1) / band_rows(image);
+    }
+    return 1;
+}
+
+/**
+ * Returns the palette that an image is quantized to when it is converted to a format, or
+ * nothing if the format is not indexed.
+ */
+static std::shared_ptr<const kdk::quantizer::palette> conversion_palette(const std::string& format, const kdk::image& image)
+{
+    auto parsed = parse_format(format);
+    if (std::get<0>(parsed) != "cicn") {
+        return nullptr;
+    }
+    if (has_argument(std::get<1>(parsed), "system")) {
+        return kdk::quantizer::system_palette();
+    }
+    return kdk::quantizer::adaptive_palette(image, 256);
+}
+
+/**
+ * Perform a part of a conversion. Every format converts a single image, except for an
+ * atlas which packs all of its images together.
+ */
+static void convert_part(const std::string& path, const std::string& format, const std::vector<std::shared_ptr<const kdk::image>>& images, const kdk::quantizer::palette *palette, std::size_t part, std::vector<char>& data)
+{
+    const auto& image = *images.front();
+    auto parsed = parse_format(format);
+    std::string error;
+    bool converted = true;
+    if (std::get<0>(parsed) == "atlas") {
+        converted = kdk::atlas::validate(images, error) && kdk::atlas::pack(images, data, error);
+    }
+    else if (std::get<0>(parsed) == "PNG") {
+        converted = kdk::png::encode(image, data, error);
+    }
+    else if (std::get<0>(parsed) == "TGA") {
+        converted = kdk::tga::encode(image, data, error);
+    }
+    else if (std::get<0>(parsed) == "rleD") {
+        auto size = frame_size(std::get<1>(parsed), image);
+        kdk::rled::encode_frame(image, std::get<0>(size), std::get<1>(size), part, data);
+    }
+    else if (std::get<0>(parsed) == "PICT") {
+        auto first = part * band_rows(image);
+        auto rows = std::min<std::size_t>(band_rows(image), image.height - first);
+        kdk::pict::encode_rows(image, static_cast<uint32_t>(first), static_cast<uint32_t>(rows), data);
+    }
+    else if (palette) {
+        auto first = part * band_rows(image);
+        auto rows = std::min<std::size_t>(band_rows(image), image.height - first);
+        data.resize(rows * image.width);
+        auto dither = has_argument(std::get<1>(parsed), "dither");
+        kdk::quantizer::quantize(image, *palette, dither, static_cast<uint32_t>(first), static_cast<uint32_t>(rows), reinterpret_cast<uint8_t *>(data.data()));
+    }
+    if (!converted) {
+        log::error(path, 0, "Unable to import image as " + std::get<0>(parsed) + ": " + error);
+    }
+}
+
+static void join_parts(const std::string& format, const kdk::image& image, const kdk::quantizer::palette *palette, std::vector<std::vector<char>>& parts, std::vector<char>& data)
+{
+    auto parsed = parse_format(format);
+    if (std::get<0>(parsed) == "rleD") {
+        auto size = frame_size(std::get<1>(parsed), image);
+        kdk::rled::assemble(std::get<0>(size), std::get<1>(size), parts, data);
+    }
+    else if (std::get<0>(parsed) == "cicn") {
+        std::vector<uint8_t> indices;
+        indices.reserve(static_cast<std::size_t>(image.width) * image.height);
+        for (const auto& part : parts) {
+            indices.insert(indices.end(), part.begin(), part.end());
+        }
+        kdk::cicn::assemble(image, *palette, indices, data);
+    }
+    else if (std::get<0>(parsed) == "PICT") {
+        kdk::pict::assemble(image, parts, data);
+    }
+    else {
+        data = std::move(parts.front());
+    }
+}
+
+// MARK: - Singleton
+
+kdk::image_cache::image_cache()
+{
+    
+}
+
+kdk::image_cache& kdk::image_cache::shared()
+{
+    static kdk::image_cache instance;
+    return instance;
+}
+
+// MARK: - Configuration
+
+void kdk::image_cache::set_retains_images(bool retains)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_retains = retains;
+    if (!m_retains) {
+        m_files.clear();
+        m_images.clear();
+        m_data.clear();
+    }
+}
+
+void kdk::image_cache::begin_build()
+{
+    // Builds that run at the same time, such as the targets of a batch, share the images
+    // that they import.
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_active_builds++ > 0) {
+        return;
+    }
+    if (!m_retains) {
+        m_files.clear();
+        m_images.clear();
+        m_data.clear();
+    }
+    
+    for (auto it = m_images.begin(); it != m_images.end();) {
+        it = std::get<1>(it->second) == m_build ? std::next(it) : m_images.erase(it);
+    }
+    for (auto it = m_data.begin(); it != m_data.end();) {
+        it = std::get<1>(it->second) == m_build ? std::next(it) : m_data.erase(it);
+    }
+    m_build++;
+}
+
+void kdk::image_cache::end_build()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_active_builds > 0 && --m_active_builds == 0 && !m_retains) {
+        m_files.clear();
+        m_images.clear();
+        m_data.clear();
+    }
+}
+
+uint64_t kdk::image_cache::footprint()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    uint64_t bytes = 0;
+    for (const auto& image : m_images) {
+        bytes += std::get<0>(image.second)->pixels.size();
+    }
+    for (const auto& data : m_data) {
+        bytes += std::get<0>(data.second)->size();
+    }
+    return bytes;
+}
+
+// MARK: - References
+
+bool kdk::image_cache::format_named(const std::string& format)
+{
+    auto parsed = parse_format(format);
+    const auto& name = std::get<0>(parsed);
+    const auto& arguments = std::get<1>(parsed);
+    
+    // Formats are compared in the form that the parser writes them, so that each format
+    // has a single spelling.
+    std::string canonical = name;
+    for (std::size_t n = 0; n < arguments.size(); ++n) {
+        canonical += (n == 0 ? "(" : ",") + arguments[n];
+    }
+    canonical += arguments.empty() ? "" : ")";
+    if (canonical != format) {
+        return false;
+    }
+    
+    if (name == "PNG" || name == "TGA" || name == "PICT" || name == "atlas") {
+        return arguments.empty();
+    }
+    if (name == "rleD") {
+        return arguments.empty() || (arguments.size() == 2 && dimension(arguments[0]) > 0 && dimension(arguments[1]) > 0);
+    }
+    if (name == "cicn") {
+        std::set<std::string> options(arguments.begin(), arguments.end());
+        return options.size() == arguments.size() && std::all_of(arguments.begin(), arguments.end(), [] (const std::string& argument) {
+            return argument == "system" || argument == "dither";
+        });
+    }
+    return false;
+}
+
+std::string kdk::image_cache::reference(const std::vector<std::string>& paths, const std::string& format)
+{
+    std::string reference = format + ":";
+    for (std::size_t n = 0; n < paths.size(); ++n) {
+        reference += (n == 0 ? "" : "\n") + paths[n];
+    }
+    return reference;
+}
+
+std::tuple<std::string, std::string> kdk::image_cache::parse_reference(const std::string& reference)
+{
+    auto separator = reference.find(':');
+    if (separator == std::string::npos) {
+        return std::make_tuple(reference, "");
+    }
+    return std::make_tuple(reference.substr(separator + 1), reference.substr(0, separator));
+}
+
+std::vector<std::string> kdk::image_cache::reference_paths(const std::string& reference)
+{
+    auto paths = std::get<0>(parse_reference(reference));
+    std::vector<std::string> result;
+    for (std::size_t start = 0; start <= paths.size();) {
+        auto end = std::min(paths.find('\n', start), paths.size());
+        result.push_back(paths.substr(start, end - start));
+        start = end + 1;
+    }
+    return result;
+}
+
+std::vector<std::string> kdk::image_cache::frame_paths(const std::string& path)
+{
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+        return { path };
+    }
+    
+    // The frames of a directory are its PNG and TGA images, in name order.
+    std::vector<std::string> paths;
+    if (auto directory = ::opendir(path.c_str())) {
+        while (auto entry = ::readdir(directory)) {
+            std::string name = entry->d_name;
+            if (name[0] != '.' && (has_extension(name, ".png") || has_extension(name, ".tga"))) {
+                paths.push_back(path + (path.back() == '/' ? "" : "/") + name);
+            }
+        }
+        ::closedir(directory);
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+bool kdk::image_cache::image_size(const std::string& path, uint32_t& width, uint32_t& height)
+{
+    // Only the header of the image is read. PNG images hold their size in the header
+    // chunk that follows the signature, and TGA images at a fixed offset.
+    uint8_t header[24];
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    auto count = ::read(fd, header, sizeof(header));
+    ::close(fd);
+    
+    if (count == sizeof(header) && header[0] == 0x89 && header[1] == 'P' && header[2] == 'N' && header[3] == 'G') {
+        width = (header[16] << 24) | (header[17] << 16) | (header[18] << 8) | header[19];
+        height = (header[20] << 24) | (header[21] << 16) | (header[22] << 8) | header[23];
+        return true;
+    }
+    if (count >= 18 && has_extension(path, ".tga")) {
+        width = header[12] | (header[13] << 8);
+        height = header[14] | (header[15] << 8);
+        return true;
+    }
+    return false;
+}
+
+// MARK: - Importing
+
+std::string kdk::image_cache::digest(const std::string& path, std::vector<uint8_t>& contents)
+{
+    // The file is only read, and its digest computed, if it has changed since it was
+    // last seen.
+    auto identity = kdk::hasher::file_identity(path);
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        const auto& file = m_files[path];
+        if (!identity.empty() && file.identity == identity) {
+            return file.digest;
+        }
+    }
+    
+    contents = read_file(path);
+    auto digest = kdk::hasher().update(contents.data(), contents.size()).digest();
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_files[path] = { identity, digest };
+    return digest;
+}
+
+std::tuple<std::string, std::shared_ptr<const kdk::image>> kdk::image_cache::decode(const std::string& path)
+{
+    std::vector<uint8_t> contents;
+    auto digest = this->digest(path, contents);
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto it = m_images.find(digest);
+        if (it != m_images.end()) {
+            std::get<1>(it->second) = m_build;
+            return std::make_tuple(digest, std::get<0>(it->second));
+        }
+    }
+    
+    // PNG images are recognised by their signature. TGA images have no signature, and
+    // are recognised by their extension.
+    if (contents.empty()) {
+        contents = read_file(path);
+    }
+    auto image = std::make_shared<kdk::image>();
+    std::string error;
+    bool decoded = false;
+    if (contents.size() >= 8 && contents[0] == 0x89 && contents[1] == 'P' && contents[2] == 'N' && contents[3] == 'G') {
+        decoded = kdk::png::decode(contents.data(), contents.size(), *image, error);
+    }
+    else if (has_extension(path, ".tga")) {
+        decoded = kdk::tga::decode(contents.data(), contents.size(), *image, error);
+    }
+    else {
+        error = "The file is not a PNG or TGA image.";
+    }
+    if (!decoded) {
+        log::error(path, 0, "Unable to import image: " + error);
+    }
+    
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_images[digest] = std::make_tuple(image, m_build);
+    return std::make_tuple(digest, image);
+}
+
+std::shared_ptr<const kdk::image> kdk::image_cache::image(const std::string& path)
+{
+    return std::get<1>(decode(path));
+}
+
+std::shared_ptr<const std::vector<char>> kdk::image_cache::data(const std::string& reference)
+{
+    // Conversions are found by the digests of their images, which need not be decoded.
+    auto key = std::get<1>(parse_reference(reference)) + ":";
+    for (const auto& path : reference_paths(reference)) {
+        std::vector<uint8_t> contents;
+        key += digest(path, contents);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto it = m_data.find(key);
+        if (it != m_data.end()) {
+            std::get<1>(it->second) = m_build;
+            return std::get<0>(it->second);
+        }
+    }
+    
+    kdk::worker_pool serial { 1 };
+    import({ reference }, serial);
+    
+    std::lock_guard<std::mutex> lock(m_lock);
+    return std::get<0>(m_data.at(key));
+}
+
+void kdk::image_cache::import(const std::vector<std::string>& references, kdk::worker_pool& pool)
+{
+    // Every image is decoded before any is converted, so that an image imported as
+    // several formats is still only decoded once.
+    std::set<std::string> unique_references(references.begin(), references.end());
+    std::set<std::string> unique_paths;
+    for (const auto& reference : unique_references) {
+        auto reference_paths = kdk::image_cache::reference_paths(reference);
+        unique_paths.insert(reference_paths.begin(), reference_paths.end());
+    }
+    
+    std::vector<std::string> paths(unique_paths.begin(), unique_paths.end());
+    std::vector<std::tuple<std::string, std::shared_ptr<const kdk::image>>> images(paths.size());
+    pool.parallel_for(paths.size(), [&] (std::size_t n) {
+        images[n] = decode(paths[n]);
+    });
+    
+    // Each conversion that is not already held is divided into parts, such as the frames
+    // of a sprite or the bands of a quantized image. The palettes of the conversions are
+    // chosen first, and then the parts of every conversion are performed across the pool.
+    std::vector<std::tuple<std::string, std::string, std::string, std::vector<std::shared_ptr<const kdk::image>>>> conversions;
+    std::vector<std::tuple<std::size_t, std::size_t>> parts;
+    for (const auto& reference : unique_references) {
+        auto reference_paths = kdk::image_cache::reference_paths(reference);
+        const auto& path = reference_paths.front();
+        auto format = std::get<1>(parse_reference(reference));
+        auto key = format + ":";
+        std::vector<std::shared_ptr<const kdk::image>> frames;
+        for (const auto& frame_path : reference_paths) {
+            const auto& decoded = images[std::lower_bound(paths.begin(), paths.end(), frame_path) - paths.begin()];
+            key += std::get<0>(decoded);
+            frames.push_back(std::get<1>(decoded));
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            auto it = m_data.find(key);
+            if (it != m_data.end()) {
+                std::get<1>(it->second) = m_build;
+                continue;
+            }
+        }
+        
+        auto count = conversion_parts(path, format, *frames.front());
+        for (std::size_t part = 0; part < count; ++part) {
+            parts.push_back(std::make_tuple(conversions.size(), part));
+        }
+        conversions.push_back(std::make_tuple(key, path, format, frames));
+    }
+    
+    std::vector<std::shared_ptr<const kdk::quantizer::palette>> palettes(conversions.size());
+    pool.parallel_for(conversions.size(), [&] (std::size_t n) {
+        palettes[n] = conversion_palette(std::get<2>(conversions[n]), *std::get<3>(conversions[n]).front());
+    });
+    
+    std::vector<std::vector<char>> converted(parts.size());
+    pool.parallel_for(parts.size(), [&] (std::size_t n) {
+        auto index = std::get<0>(parts[n]);
+        const auto& conversion = conversions[index];
+        convert_part(std::get<1>(conversion), std::get<2>(conversion), std::get<3>(conversion), palettes[index].get(), std::get<1>(parts[n]), converted[n]);
+    });
+    
+    for (std::size_t first = 0, n = 0; n < conversions.size(); ++n) {
+        auto last = first;
+        while (last < parts.size() && std::get<0>(parts[last]) == n) {
+            last++;
+        }
+        
+        auto data = std::make_shared<std::vector<char>>();
+        std::vector<std::vector<char>> pieces(std::make_move_iterator(converted.begin() + first), std::make_move_iterator(converted.begin() + last));
+        join_parts(std::get<2>(conversions[n]), *std::get<3>(conversions[n]).front(), palettes[n].get(), pieces, *data);
+        first = last;
+        
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_data[std::get<0>(conversions[n])] = std::make_tuple(data, m_build);
+    }
+    
+    // Resources are assembled from the conversions alone, so decoded images are only kept
+    // if they are retained for later builds.
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (!m_retains) {
+        m_images.clear();
+    }
+}
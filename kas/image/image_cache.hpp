@@ -0,0 +1,179 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <memory>
+#include "image/image.hpp"
+#include "concurrency/worker_pool.hpp"
+
+#if !defined(KDK_IMAGE_CACHE)
+#define KDK_IMAGE_CACHE
+
+namespace kdk
+{
+
+/**
+ * The image cache imports the images that resources refer to. Each image is decoded
+ * from a PNG or TGA file, and then converted to the format that it is imported as.
+ * Conversions that can be divided, such as the frames of a sprite, are performed in
+ * parts across the pool.
+ *
+ * Images are identified by the digest of their contents, so an image is decoded at most
+ * once however many resources refer to it, and whatever path it is referred to by. When
+ * retention is enabled, images that are unchanged are not decoded again by later builds.
+ * Otherwise decoded images are released once they have been converted, and conversions
+ * are released when the last build that is in progress ends.
+ *
+ * Resources refer to images through values of the form `FORMAT:path`, which are made by
+ * `reference()`. An atlas refers to the image of each of its frames, with their paths
+ * separated by newlines.
+ */
+class image_cache
+{
+public:
+    image_cache(const image_cache&) = delete;
+    image_cache& operator=(const image_cache &) = delete;
+    
+    static image_cache& shared();
+    
+    /**
+     * Set whether decoded images, and their conversions, should be retained between
+     * builds.
+     */
+    void set_retains_images(bool retains);
+    
+    /**
+     * Begin a build. If no other build is in progress, images that were not used by the
+     * previous build are released, or every image if images are not retained.
+     */
+    void begin_build();
+    
+    /**
+     * End a build that was begun with `begin_build()`. Once no build is in progress, every
+     * image is released unless images are retained.
+     */
+    void end_build();
+    
+    /**
+     * Returns the approximate number of bytes of memory that are held by decoded images
+     * and their conversions.
+     */
+    uint64_t footprint();
+    
+    /**
+     * Returns true if images can be imported as the specified format, which is one of
+     * 'PNG', 'TGA', 'PICT', 'rleD', 'cicn' or 'atlas'. The frames of an rlëD sprite are the
+     * whole image, unless their width and height are given as in 'rleD(48,48)'. Color
+     * icons take the options 'system', to use the system palette, and 'dither', as in
+     * 'cicn(system,dither)'.
+     */
+    static bool format_named(const std::string& format);
+    
+    /**
+     * Returns the value through which a resource refers to the images at the specified
+     * paths, imported as the specified format. Only an atlas has more than one image.
+     */
+    static std::string reference(const std::vector<std::string>& paths, const std::string& format);
+    
+    /**
+     * Returns the path and the format of an image reference.
+     */
+    static std::tuple<std::string, std::string> parse_reference(const std::string& reference);
+    
+    /**
+     * Returns the path of each image of an image reference.
+     */
+    static std::vector<std::string> reference_paths(const std::string& reference);
+    
+    /**
+     * Returns the images that are the frames of an atlas imported from the specified
+     * path. The frames of a directory are its PNG and TGA images in name order, and any
+     * other path is a single frame.
+     */
+    static std::vector<std::string> frame_paths(const std::string& path);
+    
+    /**
+     * Read the width and height of the image at the specified path from its header,
+     * without decoding it. Returns false if the file is not a recognised image.
+     */
+    static bool image_size(const std::string& path, uint32_t& width, uint32_t& height);
+    
+    /**
+     * Decode the images of the specified references, and convert them to the formats
+     * that they are imported as, using the threads of the pool. Each image is decoded
+     * once, however many references there are to it.
+     */
+    void import(const std::vector<std::string>& references, kdk::worker_pool& pool);
+    
+    /**
+     * Returns the data of the image reference, in the format that it is imported as. The
+     * image is decoded and converted now if that has not already been done.
+     */
+    std::shared_ptr<const std::vector<char>> data(const std::string& reference);
+    
+    /**
+     * Returns the decoded image at the specified path.
+     */
+    std::shared_ptr<const kdk::image> image(const std::string& path);
+    
+private:
+    /**
+     * The identity (device, inode, size and modification time) and contents digest of
+     * an image file.
+     */
+    struct file_entry
+    {
+        std::string identity;
+        std::string digest;
+    };
+    
+    bool m_retains { false };
+    uint64_t m_build { 0 };
+    std::size_t m_active_builds { 0 };
+    std::mutex m_lock;
+    std::map<std::string, kdk::image_cache::file_entry> m_files;
+    std::map<std::string, std::tuple<std::shared_ptr<const kdk::image>, uint64_t>> m_images;
+    std::map<std::string, std::tuple<std::shared_ptr<const std::vector<char>>, uint64_t>> m_data;
+    
+    image_cache();
+    
+    /**
+     * Returns the digest of the contents of the image at the specified path. The file is
+     * only read if its identity has changed, in which case its contents are returned.
+     */
+    std::string digest(const std::string& path, std::vector<uint8_t>& contents);
+    
+    /**
+     * Returns the digest of the image at the specified path, along with the decoded
+     * image. The file is only read if its identity has changed or the image with its
+     * digest is not held.
+     */
+    std::tuple<std::string, std::shared_ptr<const kdk::image>> decode(const std::string& path);
+};
+
+};
+
+#endif
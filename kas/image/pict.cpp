@@ -0,0 +1,262 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "image/pict.hpp"
+
+// MARK: - Constants
+
+// The opcodes of a version 2 picture.
+static const uint32_t version_opcode = 0x0011;
+static const uint32_t header_opcode = 0x0C00;
+static const uint32_t clip_opcode = 0x0001;
+static const uint32_t direct_bits_opcode = 0x009A;
+static const uint32_t end_opcode = 0x00FF;
+
+// Row bytes are stored in 14 bits, as the top bits of the field are flags.
+static const uint32_t max_row_bytes = 0x3FFE;
+static const uint32_t pixmap_flag = 0x8000;
+
+// Rows are stored as planes of red, green and blue, each packed with PackBits. Rows of
+// fewer than 8 bytes are not packed, and rows of more than 250 bytes have a 16-bit
+// byte count.
+static const uint32_t packed_components = 4;
+static const uint32_t direct_pixels = 16;
+static const uint32_t min_packed_row_bytes = 8;
+static const uint32_t max_short_row_bytes = 250;
+static const std::size_t max_packet = 128;
+
+// MARK: - Helpers
+
+static inline void put_u16(std::vector<char>& data, uint32_t value)
+{
+    data.push_back(static_cast<char>(value >> 8));
+    data.push_back(static_cast<char>(value));
+}
+
+static inline void put_u32(std::vector<char>& data, uint32_t value)
+{
+    put_u16(data, value >> 16);
+    put_u16(data, value & 0xFFFF);
+}
+
+static inline void put_rect(std::vector<char>& data, const kdk::image& image)
+{
+    put_u16(data, 0);
+    put_u16(data, 0);
+    put_u16(data, image.height);
+    put_u16(data, image.width);
+}
+
+/**
+ * Returns the offset of the first run of at least three identical bytes in [from, size),
+ * or `size` if there is none. Sixteen offsets are tested at a time where SSE2 is
+ * available.
+ */
+static inline std::size_t find_run(const uint8_t *bytes, std::size_t from, std::size_t size)
+{
+    auto offset = from;
+    
+#if defined(__SSE2__)
+    for (; offset + 18 <= size; offset += 16) {
+        auto first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + offset));
+        auto second = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + offset + 1));
+        auto third = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + offset + 2));
+        auto starts = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, second), _mm_cmpeq_epi8(second, third)));
+        if (starts) {
+            return offset + __builtin_ctz(static_cast<uint32_t>(starts));
+        }
+    }
+#endif
+    
+    for (; offset + 2 < size; ++offset) {
+        if (bytes[offset] == bytes[offset + 1] && bytes[offset] == bytes[offset + 2]) {
+            return offset;
+        }
+    }
+    return size;
+}
+
+/**
+ * Returns the length of the run of bytes that begins at `from`, up to the largest run
+ * that a packet can hold.
+ */
+static inline std::size_t run_length(const uint8_t *bytes, std::size_t from, std::size_t size)
+{
+    auto limit = std::min(size, from + max_packet);
+    auto offset = from + 1;
+    
+#if defined(__SSE2__)
+    const auto value = _mm_set1_epi8(static_cast<char>(bytes[from]));
+    for (; offset + 16 <= limit; offset += 16) {
+        auto same = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + offset)), value));
+        if (same != 0xFFFF) {
+            return offset + __builtin_ctz(~static_cast<uint32_t>(same)) - from;
+        }
+    }
+#endif
+    
+    while (offset < limit && bytes[offset] == bytes[from]) {
+        offset++;
+    }
+    return offset - from;
+}
+
+/**
+ * Compress the bytes with PackBits, appending them to `data`. Runs of three or more
+ * identical bytes are stored as repeat packets, and everything between them as literal
+ * packets.
+ */
+static void pack_bits(const uint8_t *bytes, std::size_t size, std::vector<char>& data)
+{
+    for (std::size_t offset = 0; offset < size;) {
+        auto run = find_run(bytes, offset, size);
+        while (offset < run) {
+            auto count = std::min(run - offset, max_packet);
+            data.push_back(static_cast<char>(count - 1));
+            data.insert(data.end(), bytes + offset, bytes + offset + count);
+            offset += count;
+        }
+        if (run == size) {
+            break;
+        }
+        
+        auto count = run_length(bytes, run, size);
+        data.push_back(static_cast<char>(1 - static_cast<int32_t>(count)));
+        data.push_back(static_cast<char>(bytes[run]));
+        offset = run + count;
+    }
+}
+
+// MARK: - Encoding
+
+bool kdk::pict::validate(const kdk::image& image, std::string& error)
+{
+    if (image.width * 4 > max_row_bytes || image.height > 0x7FFF) {
+        error = "The image is too large to be stored as a picture.";
+        return false;
+    }
+    return true;
+}
+
+void kdk::pict::encode_rows(const kdk::image& image, uint32_t first_row, uint32_t row_count, std::vector<char>& data)
+{
+    const std::size_t width = image.width;
+    const std::size_t row_bytes = width * 4;
+    std::vector<uint8_t> planes(width * 3);
+    data.clear();
+    
+    for (std::size_t y = first_row; y < first_row + row_count; ++y) {
+        auto row = image.pixels.data() + y * row_bytes;
+        
+        // Narrow rows are stored as they are, as unused bytes then red, green and blue.
+        if (row_bytes < min_packed_row_bytes) {
+            for (std::size_t x = 0; x < width; ++x) {
+                data.push_back(0);
+                data.insert(data.end(), row + x * 4, row + x * 4 + 3);
+            }
+            continue;
+        }
+        
+        for (std::size_t x = 0; x < width; ++x) {
+            planes[x] = row[x * 4];
+            planes[width + x] = row[x * 4 + 1];
+            planes[width * 2 + x] = row[x * 4 + 2];
+        }
+        
+        auto count = data.size();
+        data.resize(count + (row_bytes > max_short_row_bytes ? 2 : 1));
+        pack_bits(planes.data(), planes.size(), data);
+        
+        auto packed = data.size() - count - (row_bytes > max_short_row_bytes ? 2 : 1);
+        if (row_bytes > max_short_row_bytes) {
+            data[count] = static_cast<char>(packed >> 8);
+            data[count + 1] = static_cast<char>(packed);
+        }
+        else {
+            data[count] = static_cast<char>(packed);
+        }
+    }
+}
+
+void kdk::pict::assemble(const kdk::image& image, const std::vector<std::vector<char>>& bands, std::vector<char>& data)
+{
+    data.clear();
+    
+    // The size of the picture, which is filled in once it is known, and its frame.
+    put_u16(data, 0);
+    put_rect(data, image);
+    
+    // The version, and the extended version 2 header.
+    put_u16(data, version_opcode);
+    put_u16(data, 0x02FF);
+    put_u16(data, header_opcode);
+    put_u16(data, 0xFFFE);
+    put_u16(data, 0);
+    put_u32(data, 0x00480000);
+    put_u32(data, 0x00480000);
+    put_rect(data, image);
+    put_u32(data, 0);
+    
+    // The clip region, which is the frame.
+    put_u16(data, clip_opcode);
+    put_u16(data, 10);
+    put_rect(data, image);
+    
+    // The pixel map, which has no color table, followed by the source and destination
+    // rectangles, the copy mode and the rows.
+    put_u16(data, direct_bits_opcode);
+    put_u32(data, 0x000000FF);
+    put_u16(data, pixmap_flag | (image.width * 4));
+    put_rect(data, image);
+    put_u16(data, 0);
+    put_u16(data, packed_components);
+    put_u32(data, 0);
+    put_u32(data, 0x00480000);
+    put_u32(data, 0x00480000);
+    put_u16(data, direct_pixels);
+    put_u16(data, 32);
+    put_u16(data, 3);
+    put_u16(data, 8);
+    put_u32(data, 0);
+    put_u32(data, 0);
+    put_u32(data, 0);
+    put_rect(data, image);
+    put_rect(data, image);
+    put_u16(data, 0);
+    
+    for (const auto& band : bands) {
+        data.insert(data.end(), band.begin(), band.end());
+    }
+    
+    // Opcodes begin on even offsets.
+    if (data.size() & 1) {
+        data.push_back(0);
+    }
+    put_u16(data, end_opcode);
+    
+    data[0] = static_cast<char>((data.size() >> 8) & 0xFF);
+    data[1] = static_cast<char>(data.size() & 0xFF);
+}
@@ -0,0 +1,66 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "image/image.hpp"
+
+#if !defined(KDK_IMAGE_PICT)
+#define KDK_IMAGE_PICT
+
+namespace kdk
+{
+
+/**
+ * The PICT format holds a QuickDraw picture. Images are stored as version 2 pictures
+ * holding a single 32-bit direct pixel map, whose rows are compressed with PackBits.
+ *
+ * Each row is compressed independently of the others, so the bands of an image may be
+ * encoded in parallel and then assembled.
+ */
+namespace pict
+{
+
+/**
+ * Check that the image can be stored as a picture. Returns false, and describes the
+ * problem in `error`, if it can not.
+ */
+bool validate(const kdk::image& image, std::string& error);
+
+/**
+ * Encode `row_count` rows of the image, starting at `first_row`, replacing the contents
+ * of `data`. The alpha component of each pixel is discarded.
+ */
+void encode_rows(const kdk::image& image, uint32_t first_row, uint32_t row_count, std::vector<char>& data);
+
+/**
+ * Assemble encoded bands of rows, in order, into a picture, replacing the contents of
+ * `data`.
+ */
+void assemble(const kdk::image& image, const std::vector<std::vector<char>>& bands, std::vector<char>& data);
+
+};
+
+};
+
+#endif
@@ -0,0 +1,451 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <tuple>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include "image/png.hpp"
+#include "image/zlib.hpp"
+
+// MARK: - Constants
+
+static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+// The first column and row, and the spacing between columns and rows, of the pixels in
+// each of the seven passes of an interlaced image.
+static const uint32_t adam7_passes[7][4] = {
+    { 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 },
+    { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 }
+};
+
+// MARK: - Helpers
+
+static inline uint32_t read_u32(const uint8_t *p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static inline void put_u32(std::vector<uint8_t>& bytes, uint32_t value)
+{
+    bytes.push_back(static_cast<uint8_t>(value >> 24));
+    bytes.push_back(static_cast<uint8_t>(value >> 16));
+    bytes.push_back(static_cast<uint8_t>(value >> 8));
+    bytes.push_back(static_cast<uint8_t>(value));
+}
+
+static inline void put_chunk(std::vector<char>& png, const char *type, const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> chunk;
+    chunk.reserve(data.size() + 12);
+    put_u32(chunk, static_cast<uint32_t>(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    put_u32(chunk, kdk::zlib::crc32(chunk.data() + 4, data.size() + 4));
+    png.insert(png.end(), chunk.begin(), chunk.end());
+}
+
+static inline uint8_t paeth(uint8_t a, uint8_t b, uint8_t c)
+{
+    int p = a + b - c;
+    int pa = std::abs(p - a);
+    int pb = std::abs(p - b);
+    int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return a;
+    }
+    return pb <= pc ? b : c;
+}
+
+/**
+ * Reverse the filter of a row in place, given the unfiltered row above it, which is null
+ * for the first row. `stride` is the number of bytes per pixel, and at least one.
+ */
+static bool unfilter_row(uint8_t filter, uint8_t *row, const uint8_t *above, std::size_t size, std::size_t stride)
+{
+    switch (filter) {
+        case 0: {
+            return true;
+        }
+        case 1: {
+            for (std::size_t n = stride; n < size; ++n) {
+                row[n] += row[n - stride];
+            }
+            return true;
+        }
+        case 2: {
+            for (std::size_t n = 0; above && n < size; ++n) {
+                row[n] += above[n];
+            }
+            return true;
+        }
+        case 3: {
+            for (std::size_t n = 0; n < size; ++n) {
+                int left = n >= stride ? row[n - stride] : 0;
+                int up = above ? above[n] : 0;
+                row[n] += static_cast<uint8_t>((left + up) >> 1);
+            }
+            return true;
+        }
+        case 4: {
+            for (std::size_t n = 0; n < size; ++n) {
+                uint8_t left = n >= stride ? row[n - stride] : 0;
+                uint8_t up = above ? above[n] : 0;
+                uint8_t corner = (above && n >= stride) ? above[n - stride] : 0;
+                row[n] += paeth(left, up, corner);
+            }
+            return true;
+        }
+        default: {
+            return false;
+        }
+    }
+}
+
+/**
+ * Returns the sample at the specified index of a row, scaled to 8 bits, along with its
+ * unscaled value for comparison with a transparent color.
+ */
+static inline uint8_t read_sample(const uint8_t *row, std::size_t index, uint8_t depth, uint16_t& raw)
+{
+    switch (depth) {
+        case 16: {
+            raw = static_cast<uint16_t>((row[2 * index] << 8) | row[2 * index + 1]);
+            return row[2 * index];
+        }
+        case 8: {
+            raw = row[index];
+            return row[index];
+        }
+        default: {
+            auto bit = index * depth;
+            auto shift = 8 - depth - (bit & 7);
+            raw = static_cast<uint16_t>((row[bit >> 3] >> shift) & ((1 << depth) - 1));
+            return static_cast<uint8_t>(raw * 255 / ((1 << depth) - 1));
+        }
+    }
+}
+
+// MARK: - Decoding
+
+bool kdk::png::decode(const uint8_t *bytes, std::size_t size, kdk::image& image, std::string& error)
+{
+    if (size < sizeof(signature) || std::memcmp(bytes, signature, sizeof(signature)) != 0) {
+        error = "The file is not a PNG image.";
+        return false;
+    }
+    
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint8_t depth = 0;
+    uint8_t color_type = 0;
+    uint8_t interlace = 0;
+    bool has_header = false;
+    bool has_end = false;
+    std::vector<uint8_t> palette;
+    std::vector<uint8_t> transparency;
+    std::vector<uint8_t> compressed;
+    
+    for (std::size_t offset = sizeof(signature); offset + 12 <= size && !has_end;) {
+        auto length = read_u32(bytes + offset);
+        if (length > size - offset - 12) {
+            break;
+        }
+        
+        std::string type(reinterpret_cast<const char *>(bytes + offset + 4), 4);
+        auto data = bytes + offset + 8;
+        if (kdk::zlib::crc32(bytes + offset + 4, length + 4) != read_u32(data + length)) {
+            error = "The '" + type + "' chunk of the image is corrupt.";
+            return false;
+        }
+        offset += length + 12;
+        
+        if (type == "IHDR") {
+            if (length != 13) {
+                error = "The header of the image is malformed.";
+                return false;
+            }
+            width = read_u32(data);
+            height = read_u32(data + 4);
+            depth = data[8];
+            color_type = data[9];
+            interlace = data[12];
+            if (data[10] != 0 || data[11] != 0 || interlace > 1) {
+                error = "The image uses an unknown compression, filter or interlace method.";
+                return false;
+            }
+            has_header = true;
+        }
+        else if (!has_header) {
+            error = "The image does not begin with a header.";
+            return false;
+        }
+        else if (type == "PLTE") {
+            if (length % 3 != 0 || length > 768) {
+                error = "The palette of the image is malformed.";
+                return false;
+            }
+            palette.assign(data, data + length);
+        }
+        else if (type == "tRNS") {
+            transparency.assign(data, data + length);
+        }
+        else if (type == "IDAT") {
+            compressed.insert(compressed.end(), data, data + length);
+        }
+        else if (type == "IEND") {
+            has_end = true;
+        }
+        else if (!(type[0] & 0x20)) {
+            error = "The image requires the unsupported '" + type + "' chunk.";
+            return false;
+        }
+    }
+    
+    if (!has_end) {
+        error = "The image is truncated.";
+        return false;
+    }
+    
+    std::size_t channels = 0;
+    switch (color_type) {
+        case 0: {
+            channels = (depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16) ? 1 : 0;
+            break;
+        }
+        case 2: {
+            channels = (depth == 8 || depth == 16) ? 3 : 0;
+            break;
+        }
+        case 3: {
+            channels = (depth == 1 || depth == 2 || depth == 4 || depth == 8) ? 1 : 0;
+            break;
+        }
+        case 4: {
+            channels = (depth == 8 || depth == 16) ? 2 : 0;
+            break;
+        }
+        case 6: {
+            channels = (depth == 8 || depth == 16) ? 4 : 0;
+            break;
+        }
+    }
+    if (channels == 0) {
+        error = "The image has an invalid combination of color type and bit depth.";
+        return false;
+    }
+    if (color_type == 3 && palette.empty()) {
+        error = "The image is missing its palette.";
+        return false;
+    }
+    if (width == 0 || height == 0 || static_cast<uint64_t>(width) * height > kdk::image::max_pixels) {
+        error = "The image is empty, or too large to be imported.";
+        return false;
+    }
+    
+    // Each pass of an interlaced image is filtered separately, with its rows one after
+    // another. An image that is not interlaced has a single pass of every pixel.
+    std::vector<std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>> passes;
+    if (interlace) {
+        for (const auto& pass : adam7_passes) {
+            passes.push_back(std::make_tuple(pass[0], pass[1], pass[2], pass[3]));
+        }
+    }
+    else {
+        passes.push_back(std::make_tuple(0, 0, 1, 1));
+    }
+    
+    auto bits_per_pixel = channels * depth;
+    auto stride = std::max<std::size_t>(1, bits_per_pixel / 8);
+    std::size_t expected = 0;
+    for (const auto& pass : passes) {
+        std::size_t columns = (width + std::get<2>(pass) - std::get<0>(pass) - 1) / std::get<2>(pass);
+        std::size_t rows = (height + std::get<3>(pass) - std::get<1>(pass) - 1) / std::get<3>(pass);
+        if (columns > 0 && rows > 0) {
+            expected += rows * (1 + (columns * bits_per_pixel + 7) / 8);
+        }
+    }
+    
+    std::vector<uint8_t> raw;
+    if (!kdk::zlib::inflate(compressed.data(), compressed.size(), raw, expected) || raw.size() != expected) {
+        error = "The pixel data of the image is corrupt.";
+        return false;
+    }
+    
+    image.width = width;
+    image.height = height;
+    image.pixels.assign(static_cast<std::size_t>(width) * height * 4, 0);
+    
+    auto cursor = raw.data();
+    for (const auto& pass : passes) {
+        std::size_t columns = (width + std::get<2>(pass) - std::get<0>(pass) - 1) / std::get<2>(pass);
+        std::size_t rows = (height + std::get<3>(pass) - std::get<1>(pass) - 1) / std::get<3>(pass);
+        if (columns == 0 || rows == 0) {
+            continue;
+        }
+        
+        auto row_size = (columns * bits_per_pixel + 7) / 8;
+        const uint8_t *above = nullptr;
+        for (std::size_t y = 0; y < rows; ++y, cursor += row_size + 1) {
+            auto row = cursor + 1;
+            if (!unfilter_row(cursor[0], row, above, row_size, stride)) {
+                error = "The image uses an unknown row filter.";
+                return false;
+            }
+            above = row;
+            
+            auto target_y = std::get<1>(pass) + y * std::get<3>(pass);
+            for (std::size_t x = 0; x < columns; ++x) {
+                auto target_x = std::get<0>(pass) + x * std::get<2>(pass);
+                auto pixel = image.pixels.data() + (target_y * width + target_x) * 4;
+                uint16_t raw_value[4] = { 0 };
+                
+                switch (color_type) {
+                    case 0: {
+                        auto gray = read_sample(row, x, depth, raw_value[0]);
+                        auto transparent = transparency.size() >= 2 && raw_value[0] == ((transparency[0] << 8) | transparency[1]);
+                        pixel[0] = pixel[1] = pixel[2] = gray;
+                        pixel[3] = transparent ? 0 : 255;
+                        break;
+                    }
+                    case 2: {
+                        for (auto c = 0; c < 3; ++c) {
+                            pixel[c] = read_sample(row, x * 3 + c, depth, raw_value[c]);
+                        }
+                        auto transparent = transparency.size() >= 6;
+                        for (auto c = 0; transparent && c < 3; ++c) {
+                            transparent = raw_value[c] == ((transparency[2 * c] << 8) | transparency[2 * c + 1]);
+                        }
+                        pixel[3] = transparent ? 0 : 255;
+                        break;
+                    }
+                    case 3: {
+                        read_sample(row, x, depth, raw_value[0]);
+                        auto index = raw_value[0];
+                        if (index * 3 >= palette.size()) {
+                            error = "The image refers to a color that is not in its palette.";
+                            return false;
+                        }
+                        pixel[0] = palette[index * 3];
+                        pixel[1] = palette[index * 3 + 1];
+                        pixel[2] = palette[index * 3 + 2];
+                        pixel[3] = index < transparency.size() ? transparency[index] : 255;
+                        break;
+                    }
+                    case 4: {
+                        auto gray = read_sample(row, x * 2, depth, raw_value[0]);
+                        pixel[0] = pixel[1] = pixel[2] = gray;
+                        pixel[3] = read_sample(row, x * 2 + 1, depth, raw_value[1]);
+                        break;
+                    }
+                    case 6: {
+                        for (auto c = 0; c < 4; ++c) {
+                            pixel[c] = read_sample(row, x * 4 + c, depth, raw_value[c]);
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    
+    return true;
+}
+
+// MARK: - Encoding
+
+bool kdk::png::encode(const kdk::image& image, std::vector<char>& data, std::string& error)
+{
+    if (image.width == 0 || image.height == 0) {
+        error = "An empty image can not be stored as a PNG image.";
+        return false;
+    }
+    
+    bool opaque = true;
+    for (std::size_t n = 3; n < image.pixels.size() && opaque; n += 4) {
+        opaque = image.pixels[n] == 255;
+    }
+    std::size_t channels = opaque ? 3 : 4;
+    std::size_t row_size = image.width * channels;
+    
+    // Each row is filtered with whichever filter leaves the smallest sum of absolute
+    // differences, which tends to compress best.
+    std::vector<uint8_t> filtered;
+    filtered.reserve((row_size + 1) * image.height);
+    std::vector<uint8_t> above(row_size, 0);
+    std::vector<uint8_t> row(row_size, 0);
+    std::vector<uint8_t> candidates[5];
+    for (auto& candidate : candidates) {
+        candidate.resize(row_size);
+    }
+    
+    for (std::size_t y = 0; y < image.height; ++y) {
+        auto source = image.pixels.data() + y * image.width * 4;
+        for (std::size_t x = 0; x < image.width; ++x) {
+            std::copy(source + x * 4, source + x * 4 + channels, row.data() + x * channels);
+        }
+        
+        std::size_t best = 0;
+        uint64_t best_sum = UINT64_MAX;
+        for (std::size_t filter = 0; filter < 5; ++filter) {
+            auto& candidate = candidates[filter];
+            uint64_t sum = 0;
+            for (std::size_t n = 0; n < row_size; ++n) {
+                uint8_t left = n >= channels ? row[n - channels] : 0;
+                uint8_t corner = n >= channels ? above[n - channels] : 0;
+                uint8_t predicted = 0;
+                if (filter == 1) {
+                    predicted = left;
+                }
+                else if (filter == 2) {
+                    predicted = above[n];
+                }
+                else if (filter == 3) {
+                    predicted = static_cast<uint8_t>((left + above[n]) >> 1);
+                }
+                else if (filter == 4) {
+                    predicted = paeth(left, above[n], corner);
+                }
+                candidate[n] = static_cast<uint8_t>(row[n] - predicted);
+                sum += std::abs(static_cast<int8_t>(candidate[n]));
+            }
+            if (sum < best_sum) {
+                best = filter;
+                best_sum = sum;
+            }
+        }
+        
+        filtered.push_back(static_cast<uint8_t>(best));
+        filtered.insert(filtered.end(), candidates[best].begin(), candidates[best].end());
+        std::swap(above, row);
+    }
+    
+    data.assign(signature, signature + sizeof(signature));
+    std::vector<uint8_t> header;
+    put_u32(header, image.width);
+    put_u32(header, image.height);
+    header.insert(header.end(), { 8, static_cast<uint8_t>(opaque ? 2 : 6), 0, 0, 0 });
+    put_chunk(data, "IHDR", header);
+    put_chunk(data, "IDAT", kdk::zlib::deflate(filtered.data(), filtered.size()));
+    put_chunk(data, "IEND", {});
+    return true;
+}
@@ -0,0 +1,409 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <algorithm>
+#include <queue>
+#include <climits>
+#include <cstdlib>
+#include <functional>
+#include <tuple>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "image/quantizer.hpp"
+
+// MARK: - Constants
+
+static const uint32_t table_size = 1 << (3 * kdk::quantizer::palette::table_bits);
+static const uint32_t cell_shift = 8 - kdk::quantizer::palette::table_bits;
+static const uint8_t opaque_threshold = 128;
+
+// The octree divides the space of colors in half along each component at every level.
+// Its leaves are the cells of the lookup table.
+static const uint32_t octree_depth = kdk::quantizer::palette::table_bits;
+
+// The 8x8 Bayer matrix, from which the offsets of the ordered dither are taken.
+static const uint8_t bayer[8][8] = {
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 }
+};
+
+// MARK: - Helpers
+
+static inline uint32_t cell_of(uint32_t red, uint32_t green, uint32_t blue)
+{
+    return ((red >> cell_shift) << 10) | ((green >> cell_shift) << 5) | (blue >> cell_shift);
+}
+
+/**
+ * Fill the lookup table of the palette with the nearest color to the center of each
+ * cell, and measure the spread of its colors.
+ *
+ * The distance to each color is accumulated for every cell at once, so that the inner
+ * loop is a simple comparison that the compiler can vectorize.
+ */
+static void index_palette(kdk::quantizer::palette& palette)
+{
+    const uint32_t cells = 1 << kdk::quantizer::palette::table_bits;
+    std::vector<uint32_t> nearest(table_size, UINT32_MAX);
+    std::vector<uint32_t> distance(cells);
+    palette.table.assign(table_size, 0);
+    
+    for (std::size_t n = 0; n < palette.colors.size(); ++n) {
+        const auto& color = palette.colors[n];
+        auto index = static_cast<uint8_t>(n);
+        for (uint32_t blue = 0; blue < cells; ++blue) {
+            auto delta = static_cast<int32_t>((blue << cell_shift) | (1 << (cell_shift - 1))) - color[2];
+            distance[blue] = static_cast<uint32_t>(delta * delta);
+        }
+        
+        for (uint32_t red = 0; red < cells; ++red) {
+            auto red_delta = static_cast<int32_t>((red << cell_shift) | (1 << (cell_shift - 1))) - color[0];
+            for (uint32_t green = 0; green < cells; ++green) {
+                auto green_delta = static_cast<int32_t>((green << cell_shift) | (1 << (cell_shift - 1))) - color[1];
+                auto base = static_cast<uint32_t>(red_delta * red_delta + green_delta * green_delta);
+                auto cell = (red << 10) | (green << 5);
+                auto best = nearest.data() + cell;
+                auto table = palette.table.data() + cell;
+                for (uint32_t blue = 0; blue < cells; ++blue) {
+                    auto d = base + distance[blue];
+                    table[blue] = d < best[blue] ? index : table[blue];
+                    best[blue] = std::min(d, best[blue]);
+                }
+            }
+        }
+    }
+    
+    // The spread is the mean distance from each color to its nearest neighbour, measured
+    // along the component in which they differ most.
+    uint64_t total = 0;
+    for (std::size_t n = 0; n < palette.colors.size(); ++n) {
+        int32_t closest = 255;
+        for (std::size_t k = 0; k < palette.colors.size(); ++k) {
+            if (k == n) {
+                continue;
+            }
+            int32_t d = 0;
+            for (std::size_t c = 0; c < 3; ++c) {
+                d = std::max(d, std::abs(palette.colors[n][c] - palette.colors[k][c]));
+            }
+            closest = std::min(closest, d);
+        }
+        total += palette.colors.size() > 1 ? closest : 0;
+    }
+    palette.spread = static_cast<uint32_t>(total / std::max<std::size_t>(palette.colors.size(), 1));
+}
+
+/**
+ * Map a row of pixels to the palette through its lookup table, adding the dither offsets
+ * for the row if they are specified. Eight pixels are dithered, and reduced to cells of
+ * the table, at a time where SSE2 is available.
+ *
+ * The offsets are given for eight pixels, four components each, and split into the
+ * amounts to add and to subtract so that both can saturate.
+ */
+static void map_row(const uint8_t *rgba, std::size_t width, const uint8_t *table, const uint8_t *add, const uint8_t *subtract, uint8_t *indices)
+{
+    std::size_t x = 0;
+    
+#if defined(__SSE2__)
+    const auto component_mask = _mm_set1_epi32(0x1F);
+    auto reduce = [&] (__m128i rgba) {
+        auto red = _mm_and_si128(_mm_srli_epi32(rgba, cell_shift), component_mask);
+        auto green = _mm_and_si128(_mm_srli_epi32(rgba, 8 + cell_shift), component_mask);
+        auto blue = _mm_and_si128(_mm_srli_epi32(rgba, 16 + cell_shift), component_mask);
+        return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(red, 10), _mm_slli_epi32(green, 5)), blue);
+    };
+    
+    const auto zero = _mm_setzero_si128();
+    const auto add_low = add ? _mm_loadu_si128(reinterpret_cast<const __m128i *>(add)) : zero;
+    const auto add_high = add ? _mm_loadu_si128(reinterpret_cast<const __m128i *>(add + 16)) : zero;
+    const auto subtract_low = subtract ? _mm_loadu_si128(reinterpret_cast<const __m128i *>(subtract)) : zero;
+    const auto subtract_high = subtract ? _mm_loadu_si128(reinterpret_cast<const __m128i *>(subtract + 16)) : zero;
+    
+    alignas(16) uint16_t cells[8];
+    for (; x + 8 <= width; x += 8) {
+        auto low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgba + x * 4));
+        auto high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgba + x * 4 + 16));
+        low = _mm_subs_epu8(_mm_adds_epu8(low, add_low), subtract_low);
+        high = _mm_subs_epu8(_mm_adds_epu8(high, add_high), subtract_high);
+        
+        // Cells fit in 15 bits, so packing them with signed saturation is exact.
+        _mm_store_si128(reinterpret_cast<__m128i *>(cells), _mm_packs_epi32(reduce(low), reduce(high)));
+        for (std::size_t k = 0; k < 8; ++k) {
+            indices[x + k] = table[cells[k]];
+        }
+    }
+#endif
+    
+    for (; x < width; ++x) {
+        auto pixel = rgba + x * 4;
+        uint32_t components[3];
+        for (std::size_t c = 0; c < 3; ++c) {
+            auto offset = (x % 8) * 4 + c;
+            auto value = static_cast<int32_t>(pixel[c]) + (add ? add[offset] - subtract[offset] : 0);
+            components[c] = static_cast<uint32_t>(std::min(std::max(value, 0), 255));
+        }
+        indices[x] = table[cell_of(components[0], components[1], components[2])];
+    }
+}
+
+// MARK: - Palettes
+
+std::shared_ptr<const kdk::quantizer::palette> kdk::quantizer::system_palette()
+{
+    static auto palette = [] {
+        auto palette = std::make_shared<kdk::quantizer::palette>();
+        
+        // A cube of six levels of each component, from white down to, but not including,
+        // black. Then ramps of red, green, blue and gray, and finally black.
+        const uint8_t levels[] = { 0xFF, 0xCC, 0x99, 0x66, 0x33, 0x00 };
+        for (auto red : levels) {
+            for (auto green : levels) {
+                for (auto blue : levels) {
+                    if (red || green || blue) {
+                        palette->colors.push_back({{ red, green, blue }});
+                    }
+                }
+            }
+        }
+        
+        const uint8_t ramp[] = { 0xEE, 0xDD, 0xBB, 0xAA, 0x88, 0x77, 0x55, 0x44, 0x22, 0x11 };
+        for (std::size_t component = 0; component < 4; ++component) {
+            for (auto level : ramp) {
+                std::array<uint8_t, 3> color {{ 0, 0, 0 }};
+                for (std::size_t c = 0; c < 3; ++c) {
+                    color[c] = (component == c || component == 3) ? level : 0;
+                }
+                palette->colors.push_back(color);
+            }
+        }
+        palette->colors.push_back({{ 0, 0, 0 }});
+        
+        index_palette(*palette);
+        return std::shared_ptr<const kdk::quantizer::palette>(palette);
+    }();
+    return palette;
+}
+
+/**
+ * A node of the octree. The colors of every pixel within the node are summed, so that a
+ * leaf's color is the mean of the pixels that it represents.
+ */
+struct octree_node
+{
+    int32_t parent { -1 };
+    std::array<int32_t, 8> children {{ -1, -1, -1, -1, -1, -1, -1, -1 }};
+    uint32_t child_count { 0 };
+    bool leaf { false };
+    uint64_t count { 0 };
+    std::array<uint64_t, 3> sums {{ 0, 0, 0 }};
+};
+
+std::shared_ptr<const kdk::quantizer::palette> kdk::quantizer::adaptive_palette(const kdk::image& image, std::size_t max_colors)
+{
+    auto palette = std::make_shared<kdk::quantizer::palette>();
+    const auto pixel_count = image.pixels.size() / 4;
+    
+    // Images with few enough colors are given exactly those colors, and are mapped
+    // exactly. Runs of identical pixels are common, so they are only looked up once.
+    bool exact = true;
+    uint32_t previous = UINT32_MAX;
+    for (std::size_t n = 0; n < pixel_count && exact; ++n) {
+        auto pixel = image.pixels.data() + n * 4;
+        if (pixel[3] < opaque_threshold) {
+            continue;
+        }
+        uint32_t color = (pixel[0] << 16) | (pixel[1] << 8) | pixel[2];
+        if (color == previous) {
+            continue;
+        }
+        previous = color;
+        if (palette->exact.find(color) == palette->exact.end()) {
+            exact = palette->exact.size() < max_colors;
+            palette->exact.emplace(color, 0);
+        }
+    }
+    
+    if (exact) {
+        std::vector<uint32_t> colors;
+        for (const auto& color : palette->exact) {
+            colors.push_back(color.first);
+        }
+        std::sort(colors.begin(), colors.end());
+        for (const auto color : colors) {
+            palette->exact[color] = static_cast<uint8_t>(palette->colors.size());
+            palette->colors.push_back({{ static_cast<uint8_t>(color >> 16), static_cast<uint8_t>(color >> 8), static_cast<uint8_t>(color) }});
+        }
+        if (palette->colors.empty()) {
+            palette->colors.push_back({{ 0, 0, 0 }});
+        }
+        return palette;
+    }
+    palette->exact.clear();
+    
+    // Otherwise the pixels are first gathered into the cells of the lookup table, and the
+    // cells are inserted into an octree. The octree is then reduced, by merging the
+    // children of the node that represents the fewest pixels, until there are few
+    // enough leaves.
+    std::vector<octree_node> histogram(table_size);
+    for (std::size_t n = 0; n < pixel_count; ++n) {
+        auto pixel = image.pixels.data() + n * 4;
+        if (pixel[3] < opaque_threshold) {
+            continue;
+        }
+        auto& cell = histogram[cell_of(pixel[0], pixel[1], pixel[2])];
+        cell.count++;
+        for (std::size_t c = 0; c < 3; ++c) {
+            cell.sums[c] += pixel[c];
+        }
+    }
+    
+    std::vector<octree_node> nodes(1);
+    std::size_t leaves = 0;
+    for (uint32_t cell = 0; cell < table_size; ++cell) {
+        if (histogram[cell].count == 0) {
+            continue;
+        }
+        int32_t node = 0;
+        for (uint32_t level = 0; level <= octree_depth; ++level) {
+            nodes[node].count += histogram[cell].count;
+            for (std::size_t c = 0; c < 3; ++c) {
+                nodes[node].sums[c] += histogram[cell].sums[c];
+            }
+            if (level == octree_depth) {
+                nodes[node].leaf = true;
+                leaves++;
+                break;
+            }
+            
+            auto shift = octree_depth - 1 - level;
+            auto branch = (((cell >> (10 + shift)) & 1) << 2) | (((cell >> (5 + shift)) & 1) << 1) | ((cell >> shift) & 1);
+            if (nodes[node].children[branch] < 0) {
+                nodes[node].children[branch] = static_cast<int32_t>(nodes.size());
+                nodes[node].child_count++;
+                octree_node child;
+                child.parent = node;
+                nodes.push_back(child);
+            }
+            node = nodes[node].children[branch];
+        }
+    }
+    
+    auto reducible = [&] (int32_t node) {
+        if (nodes[node].leaf) {
+            return false;
+        }
+        for (auto child : nodes[node].children) {
+            if (child >= 0 && !nodes[child].leaf) {
+                return false;
+            }
+        }
+        return true;
+    };
+    
+    using candidate = std::tuple<uint64_t, int32_t>;
+    std::priority_queue<candidate, std::vector<candidate>, std::greater<candidate>> candidates;
+    for (std::size_t n = 0; n < nodes.size(); ++n) {
+        if (reducible(static_cast<int32_t>(n))) {
+            candidates.push(std::make_tuple(nodes[n].count, static_cast<int32_t>(n)));
+        }
+    }
+    while (leaves > max_colors && !candidates.empty()) {
+        auto node = std::get<1>(candidates.top());
+        candidates.pop();
+        nodes[node].leaf = true;
+        leaves -= nodes[node].child_count - 1;
+        auto parent = nodes[node].parent;
+        if (parent >= 0 && reducible(parent)) {
+            candidates.push(std::make_tuple(nodes[parent].count, parent));
+        }
+    }
+    
+    // The leaves that remain are those that are not within another leaf.
+    std::vector<int32_t> pending { 0 };
+    while (!pending.empty()) {
+        auto node = pending.back();
+        pending.pop_back();
+        if (nodes[node].leaf) {
+            std::array<uint8_t, 3> color;
+            for (std::size_t c = 0; c < 3; ++c) {
+                color[c] = static_cast<uint8_t>((nodes[node].sums[c] + nodes[node].count / 2) / nodes[node].count);
+            }
+            palette->colors.push_back(color);
+            continue;
+        }
+        for (auto child : nodes[node].children) {
+            if (child >= 0) {
+                pending.push_back(child);
+            }
+        }
+    }
+    
+    index_palette(*palette);
+    return palette;
+}
+
+// MARK: - Quantizing
+
+void kdk::quantizer::quantize(const kdk::image& image, const kdk::quantizer::palette& palette, bool dither, uint32_t first_row, uint32_t row_count, uint8_t *indices)
+{
+    const std::size_t width = image.width;
+    
+    if (!palette.exact.empty() || palette.table.empty()) {
+        for (std::size_t y = first_row; y < first_row + row_count; ++y) {
+            auto row = image.pixels.data() + y * width * 4;
+            auto out = indices + (y - first_row) * width;
+            for (std::size_t x = 0; x < width; ++x) {
+                auto it = palette.exact.find((row[x * 4] << 16) | (row[x * 4 + 1] << 8) | row[x * 4 + 2]);
+                out[x] = it != palette.exact.end() ? it->second : 0;
+            }
+        }
+        return;
+    }
+    
+    // The offsets of the dither are centered on zero, and span the spread of the palette.
+    // Alpha is never dithered.
+    std::array<std::array<uint8_t, 32>, 8> add {};
+    std::array<std::array<uint8_t, 32>, 8> subtract {};
+    for (std::size_t y = 0; y < 8; ++y) {
+        for (std::size_t x = 0; x < 8; ++x) {
+            auto offset = static_cast<int32_t>(((bayer[y][x] * 2 + 1) * palette.spread) / 128) - static_cast<int32_t>(palette.spread / 2);
+            for (std::size_t c = 0; c < 3; ++c) {
+                add[y][x * 4 + c] = static_cast<uint8_t>(std::max(offset, 0));
+                subtract[y][x * 4 + c] = static_cast<uint8_t>(std::max(-offset, 0));
+            }
+        }
+    }
+    
+    for (std::size_t y = first_row; y < first_row + row_count; ++y) {
+        auto row = image.pixels.data() + y * width * 4;
+        auto out = indices + (y - first_row) * width;
+        map_row(row, width, palette.table.data(), dither ? add[y % 8].data() : nullptr, dither ? subtract[y % 8].data() : nullptr, out);
+    }
+}
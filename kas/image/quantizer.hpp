@@ -0,0 +1,102 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <array>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "image/image.hpp"
+
+#if !defined(KDK_IMAGE_QUANTIZER)
+#define KDK_IMAGE_QUANTIZER
+
+namespace kdk
+{
+
+/**
+ * The quantizer reduces images to a palette of at most 256 colors, so that they can be
+ * stored in indexed formats such as color icons.
+ *
+ * Pixels are mapped to the palette through a lookup table, indexed by the top 5 bits of
+ * each component, so quantizing an image costs a table lookup per pixel however large
+ * the palette is. Rows are quantized independently, so an image may be quantized in
+ * bands in parallel.
+ */
+namespace quantizer
+{
+
+/**
+ * A palette, along with the table through which pixels are mapped to it.
+ */
+struct palette
+{
+    /**
+     * The number of bits of each component that index the lookup table.
+     */
+    static const uint32_t table_bits = 5;
+    
+    /**
+     * The red, green and blue components of each color.
+     */
+    std::vector<std::array<uint8_t, 3>> colors;
+    
+    /**
+     * The index of the nearest color to the center of each cell of the lookup table.
+     */
+    std::vector<uint8_t> table;
+    
+    /**
+     * The index of each color of the image, if the palette holds every color of the
+     * image exactly. Such images are mapped exactly, rather than through the table.
+     */
+    std::unordered_map<uint32_t, uint8_t> exact;
+    
+    /**
+     * The typical distance between neighbouring colors, which scales dithering.
+     */
+    uint32_t spread { 0 };
+};
+
+/**
+ * Returns the standard 256 color palette of the Macintosh.
+ */
+std::shared_ptr<const kdk::quantizer::palette> system_palette();
+
+/**
+ * Returns a palette of at most `max_colors` colors chosen for the image, using an octree
+ * of the colors of its pixels. Pixels that are less than half opaque are ignored.
+ */
+std::shared_ptr<const kdk::quantizer::palette> adaptive_palette(const kdk::image& image, std::size_t max_colors);
+
+/**
+ * Map `row_count` rows of the image, starting at `first_row`, to the palette, writing
+ * the index of each pixel to `indices`. If `dither` is set, an ordered dither is applied
+ * before pixels are mapped.
+ */
+void quantize(const kdk::image& image, const kdk::quantizer::palette& palette, bool dither, uint32_t first_row, uint32_t row_count, uint8_t *indices);
+
+};
+
+};
+
+#endif
@@ -0,0 +1,200 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "image/rled.hpp"
+
+// MARK: - Constants
+
+// Each token is a big endian word, holding an opcode in its top byte and a number of bytes
+// in the rest. Every row of a frame begins with a line start, which counts the bytes of
+// the row that follow it.
+static const uint32_t end_of_frame = 0x00;
+static const uint32_t line_start = 0x01;
+static const uint32_t pixel_data = 0x02;
+static const uint32_t transparent_run = 0x03;
+
+static const uint32_t max_dimension = 0x7FFF;
+static const uint8_t opaque_threshold = 128;
+
+// MARK: - Helpers
+
+static inline void put_u16(std::vector<char>& data, uint32_t value)
+{
+    data.push_back(static_cast<char>(value >> 8));
+    data.push_back(static_cast<char>(value));
+}
+
+static inline void put_token(std::vector<char>& data, uint32_t opcode, std::size_t count)
+{
+    put_u16(data, (opcode << 8) | static_cast<uint32_t>(count >> 16));
+    put_u16(data, static_cast<uint32_t>(count & 0xFFFF));
+}
+
+/**
+ * Convert a row of pixels to big endian 16-bit pixels, and set a bit in `opaque` for
+ * every pixel that is at least half opaque. Eight pixels are converted, and compared,
+ * at a time where SSE2 is available.
+ */
+static void convert_row(const uint8_t *rgba, std::size_t width, uint8_t *pixels, uint64_t *opaque)
+{
+    std::fill(opaque, opaque + (width + 63) / 64, 0);
+    std::size_t x = 0;
+    
+#if defined(__SSE2__)
+    const auto component_mask = _mm_set1_epi32(0x1F);
+    const auto threshold = _mm_set1_epi32(opaque_threshold - 1);
+    auto reduce = [&] (__m128i rgba) {
+        auto red = _mm_and_si128(_mm_srli_epi32(rgba, 3), component_mask);
+        auto green = _mm_and_si128(_mm_srli_epi32(rgba, 11), component_mask);
+        auto blue = _mm_and_si128(_mm_srli_epi32(rgba, 19), component_mask);
+        return _mm_or_si128(_mm_or_si128(_mm_slli_epi32(red, 10), _mm_slli_epi32(green, 5)), blue);
+    };
+    
+    for (; x + 8 <= width; x += 8) {
+        auto low = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgba + x * 4));
+        auto high = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rgba + x * 4 + 16));
+        
+        auto low_opaque = _mm_cmpgt_epi32(_mm_srli_epi32(low, 24), threshold);
+        auto high_opaque = _mm_cmpgt_epi32(_mm_srli_epi32(high, 24), threshold);
+        uint64_t bits = _mm_movemask_ps(_mm_castsi128_ps(low_opaque)) | (_mm_movemask_ps(_mm_castsi128_ps(high_opaque)) << 4);
+        opaque[x / 64] |= bits << (x % 64);
+        
+        // The reduced pixels fit in 15 bits, so packing them with signed saturation is
+        // exact. They are then swapped to big endian.
+        auto packed = _mm_packs_epi32(reduce(low), reduce(high));
+        packed = _mm_or_si128(_mm_slli_epi16(packed, 8), _mm_srli_epi16(packed, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pixels + x * 2), packed);
+    }
+#endif
+    
+    for (; x < width; ++x) {
+        auto pixel = rgba + x * 4;
+        auto value = ((pixel[0] >> 3) << 10) | ((pixel[1] >> 3) << 5) | (pixel[2] >> 3);
+        pixels[x * 2] = static_cast<uint8_t>(value >> 8);
+        pixels[x * 2 + 1] = static_cast<uint8_t>(value);
+        if (pixel[3] >= opaque_threshold) {
+            opaque[x / 64] |= 1ULL << (x % 64);
+        }
+    }
+}
+
+/**
+ * Returns the end of the run of pixels that begins at `from`, which is the first pixel
+ * after it whose opacity differs, or the width of the row.
+ */
+static inline std::size_t run_end(const uint64_t *opaque, std::size_t from, std::size_t width, bool is_opaque)
+{
+    for (auto word = from / 64; word * 64 < width; ++word) {
+        auto differs = is_opaque ? ~opaque[word] : opaque[word];
+        if (word == from / 64) {
+            differs &= ~0ULL << (from % 64);
+        }
+        if (differs) {
+            return std::min<std::size_t>(width, word * 64 + __builtin_ctzll(differs));
+        }
+    }
+    return width;
+}
+
+// MARK: - Encoding
+
+bool kdk::rled::frame_count(const kdk::image& image, uint32_t frame_width, uint32_t frame_height, std::size_t& count, std::string& error)
+{
+    if (frame_width == 0 || frame_height == 0 || image.width % frame_width != 0 || image.height % frame_height != 0) {
+        error = "The image can not be divided into frames of " + std::to_string(frame_width) + "x" + std::to_string(frame_height) + " pixels.";
+        return false;
+    }
+    
+    count = static_cast<std::size_t>(image.width / frame_width) * (image.height / frame_height);
+    if (frame_width > max_dimension || frame_height > max_dimension || count > max_dimension) {
+        error = "The frames are too large, or too many, to be stored as an rlëD sprite.";
+        return false;
+    }
+    return true;
+}
+
+void kdk::rled::encode_frame(const kdk::image& image, uint32_t frame_width, uint32_t frame_height, std::size_t frame, std::vector<char>& data)
+{
+    auto columns = image.width / frame_width;
+    std::size_t left = (frame % columns) * frame_width;
+    std::size_t top = (frame / columns) * frame_height;
+    
+    std::vector<uint8_t> pixels(frame_width * 2);
+    std::vector<uint64_t> opaque((frame_width + 63) / 64);
+    data.clear();
+    
+    for (std::size_t y = 0; y < frame_height; ++y) {
+        convert_row(image.pixels.data() + ((top + y) * image.width + left) * 4, frame_width, pixels.data(), opaque.data());
+        
+        auto line = data.size();
+        put_token(data, line_start, 0);
+        
+        // Runs of transparent pixels are skipped, except at the end of a row where they
+        // are left out entirely. Runs of opaque pixels are stored, padded to a multiple
+        // of four bytes.
+        for (std::size_t x = 0; x < frame_width;) {
+            auto is_opaque = (opaque[x / 64] >> (x % 64)) & 1;
+            auto end = run_end(opaque.data(), x, frame_width, is_opaque);
+            if (is_opaque) {
+                put_token(data, pixel_data, (end - x) * 2);
+                data.insert(data.end(), pixels.begin() + x * 2, pixels.begin() + end * 2);
+                if ((end - x) & 1) {
+                    put_u16(data, 0);
+                }
+            }
+            else if (end < frame_width) {
+                put_token(data, transparent_run, (end - x) * 2);
+            }
+            x = end;
+        }
+        
+        auto length = data.size() - line - 4;
+        data[line + 1] = static_cast<char>(length >> 16);
+        data[line + 2] = static_cast<char>(length >> 8);
+        data[line + 3] = static_cast<char>(length);
+    }
+    
+    put_token(data, end_of_frame, 0);
+}
+
+void kdk::rled::assemble(uint32_t frame_width, uint32_t frame_height, const std::vector<std::vector<char>>& frames, std::vector<char>& data)
+{
+    // The header holds the size of the frames, their depth, an unused palette id, the
+    // number of frames and three reserved words.
+    data.clear();
+    put_u16(data, frame_width);
+    put_u16(data, frame_height);
+    put_u16(data, 16);
+    put_u16(data, 0);
+    put_u16(data, static_cast<uint32_t>(frames.size()));
+    put_u16(data, 0);
+    put_u16(data, 0);
+    put_u16(data, 0);
+    
+    for (const auto& frame : frames) {
+        data.insert(data.end(), frame.begin(), frame.end());
+    }
+}
@@ -0,0 +1,69 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "image/image.hpp"
+
+#if !defined(KDK_IMAGE_RLED)
+#define KDK_IMAGE_RLED
+
+namespace kdk
+{
+
+/**
+ * The rlëD format holds the frames of an EV Nova sprite as run length encoded 16-bit
+ * pixels. The image is divided into a grid of equally sized frames, which are taken from
+ * left to right and then top to bottom.
+ *
+ * Each frame is encoded independently of the others, so the frames of a sprite may be
+ * encoded in parallel and then assembled.
+ */
+namespace rled
+{
+
+/**
+ * Determine the number of frames of the specified size in the image. Returns false, and
+ * describes the problem in `error`, if the image can not be divided into such frames or
+ * the sprite can not be represented in the format.
+ */
+bool frame_count(const kdk::image& image, uint32_t frame_width, uint32_t frame_height, std::size_t& count, std::string& error);
+
+/**
+ * Encode the frame at the specified index of the image, replacing the contents of `data`.
+ *
+ * Pixels are reduced to 5 bits per component, and pixels that are less than half opaque
+ * are transparent.
+ */
+void encode_frame(const kdk::image& image, uint32_t frame_width, uint32_t frame_height, std::size_t frame, std::vector<char>& data);
+
+/**
+ * Assemble encoded frames into an rlëD resource, replacing the contents of `data`.
+ */
+void assemble(uint32_t frame_width, uint32_t frame_height, const std::vector<std::vector<char>>& frames, std::vector<char>& data);
+
+};
+
+};
+
+#endif
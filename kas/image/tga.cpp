@@ -0,0 +1,230 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <algorithm>
+#include "image/tga.hpp"
+
+// MARK: - Constants
+
+static const std::size_t header_size = 18;
+
+// The bits of the image type, and of the image descriptor.
+static const uint8_t run_length_encoded = 0x08;
+static const uint8_t right_to_left = 0x10;
+static const uint8_t top_to_bottom = 0x20;
+
+// MARK: - Helpers
+
+static inline uint16_t read_u16(const uint8_t *p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static inline uint8_t expand_5_bits(uint32_t value)
+{
+    return static_cast<uint8_t>((value << 3) | (value >> 2));
+}
+
+/**
+ * Convert a truecolor pixel, or color map entry, of the specified depth to 8-bit red,
+ * green, blue and alpha components. 16-bit pixels only use their top bit as alpha if
+ * the image declares a single bit of alpha.
+ */
+static inline void read_color(const uint8_t *p, uint8_t depth, bool alpha_bit, uint8_t *pixel)
+{
+    if (depth == 15 || depth == 16) {
+        auto value = read_u16(p);
+        pixel[0] = expand_5_bits((value >> 10) & 0x1F);
+        pixel[1] = expand_5_bits((value >> 5) & 0x1F);
+        pixel[2] = expand_5_bits(value & 0x1F);
+        pixel[3] = (depth == 16 && alpha_bit && !(value & 0x8000)) ? 0 : 255;
+        return;
+    }
+    pixel[0] = p[2];
+    pixel[1] = p[1];
+    pixel[2] = p[0];
+    pixel[3] = depth == 32 ? p[3] : 255;
+}
+
+// MARK: - Decoding
+
+bool kdk::tga::decode(const uint8_t *bytes, std::size_t size, kdk::image& image, std::string& error)
+{
+    if (size < header_size) {
+        error = "The file is too short to be a TGA image.";
+        return false;
+    }
+    
+    auto id_length = bytes[0];
+    auto map_type = bytes[1];
+    auto image_type = static_cast<uint8_t>(bytes[2] & ~run_length_encoded);
+    auto encoded = (bytes[2] & run_length_encoded) != 0;
+    auto map_first = read_u16(bytes + 3);
+    auto map_length = read_u16(bytes + 5);
+    auto map_depth = bytes[7];
+    uint32_t width = read_u16(bytes + 12);
+    uint32_t height = read_u16(bytes + 14);
+    auto depth = bytes[16];
+    auto descriptor = bytes[17];
+    auto alpha_bit = (descriptor & 0x0F) == 1;
+    
+    bool supported = false;
+    switch (image_type) {
+        case 1: {
+            supported = map_type == 1 && (depth == 8 || depth == 16) && (map_depth == 15 || map_depth == 16 || map_depth == 24 || map_depth == 32);
+            break;
+        }
+        case 2: {
+            supported = map_type <= 1 && (depth == 15 || depth == 16 || depth == 24 || depth == 32);
+            break;
+        }
+        case 3: {
+            supported = map_type <= 1 && (depth == 8 || depth == 16);
+            break;
+        }
+    }
+    if (!supported) {
+        error = "The image uses an unsupported image type or pixel depth.";
+        return false;
+    }
+    if (width == 0 || height == 0 || static_cast<uint64_t>(width) * height > kdk::image::max_pixels) {
+        error = "The image is empty, or too large to be imported.";
+        return false;
+    }
+    
+    // The color map follows the image identifier. Images that are not color mapped may
+    // still carry a color map, which is skipped.
+    std::size_t offset = header_size + id_length;
+    std::size_t map_entry_size = map_type ? (map_depth + 7) / 8 : 0;
+    if (offset + map_length * map_entry_size > size) {
+        error = "The image is truncated.";
+        return false;
+    }
+    std::vector<uint8_t> palette;
+    if (image_type == 1) {
+        palette.resize(map_length * 4);
+        for (std::size_t n = 0; n < map_length; ++n) {
+            read_color(bytes + offset + n * map_entry_size, map_depth, alpha_bit, palette.data() + n * 4);
+        }
+    }
+    offset += map_length * map_entry_size;
+    
+    std::size_t pixel_size = (depth + 7) / 8;
+    std::size_t pixel_count = static_cast<std::size_t>(width) * height;
+    std::vector<uint8_t> pixels(pixel_count * 4);
+    
+    auto convert = [&] (const uint8_t *p, uint8_t *pixel) {
+        if (image_type == 2) {
+            read_color(p, depth, alpha_bit, pixel);
+            return true;
+        }
+        if (image_type == 3) {
+            pixel[0] = pixel[1] = pixel[2] = p[0];
+            pixel[3] = depth == 16 ? p[1] : 255;
+            return true;
+        }
+        auto index = (depth == 16 ? read_u16(p) : p[0]) - map_first;
+        if (index < 0 || index >= map_length) {
+            return false;
+        }
+        std::copy(palette.data() + index * 4, palette.data() + index * 4 + 4, pixel);
+        return true;
+    };
+    
+    // Pixels are stored in rows, either raw or as packets that hold a run of identical
+    // pixels or a run of raw pixels. Packets may cross the ends of rows.
+    std::size_t decoded = 0;
+    while (decoded < pixel_count) {
+        std::size_t count = 1;
+        bool repeated = false;
+        if (encoded) {
+            if (offset >= size) {
+                break;
+            }
+            count = (bytes[offset] & 0x7F) + 1;
+            repeated = (bytes[offset] & 0x80) != 0;
+            offset++;
+        }
+        count = std::min(count, pixel_count - decoded);
+        
+        auto stored = repeated ? 1 : count;
+        if (offset + stored * pixel_size > size) {
+            break;
+        }
+        for (std::size_t k = 0; k < count; ++k) {
+            if (!convert(bytes + offset + (repeated ? 0 : k * pixel_size), pixels.data() + (decoded + k) * 4)) {
+                error = "The image refers to a color that is not in its color map.";
+                return false;
+            }
+        }
+        offset += stored * pixel_size;
+        decoded += count;
+    }
+    if (decoded < pixel_count) {
+        error = "The image is truncated.";
+        return false;
+    }
+    
+    // Rows are stored from the bottom up, and left to right, unless the descriptor says
+    // otherwise.
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(pixel_count * 4);
+    for (std::size_t row = 0; row < height; ++row) {
+        auto y = (descriptor & top_to_bottom) ? row : height - 1 - row;
+        for (std::size_t column = 0; column < width; ++column) {
+            auto x = (descriptor & right_to_left) ? width - 1 - column : column;
+            auto source = pixels.data() + (row * width + column) * 4;
+            std::copy(source, source + 4, image.pixels.data() + (y * width + x) * 4);
+        }
+    }
+    return true;
+}
+
+// MARK: - Encoding
+
+bool kdk::tga::encode(const kdk::image& image, std::vector<char>& data, std::string& error)
+{
+    if (image.width == 0 || image.height == 0 || image.width > 0xFFFF || image.height > 0xFFFF) {
+        error = "The image must be between 1 and 65535 pixels wide and high to be stored as a TGA image.";
+        return false;
+    }
+    
+    data.assign(header_size, 0);
+    data[2] = 2;
+    data[12] = static_cast<char>(image.width & 0xFF);
+    data[13] = static_cast<char>(image.width >> 8);
+    data[14] = static_cast<char>(image.height & 0xFF);
+    data[15] = static_cast<char>(image.height >> 8);
+    data[16] = 32;
+    data[17] = static_cast<char>(top_to_bottom | 8);
+    
+    data.resize(header_size + image.pixels.size());
+    auto pixel = data.data() + header_size;
+    for (std::size_t n = 0; n < image.pixels.size(); n += 4, pixel += 4) {
+        pixel[0] = static_cast<char>(image.pixels[n + 2]);
+        pixel[1] = static_cast<char>(image.pixels[n + 1]);
+        pixel[2] = static_cast<char>(image.pixels[n]);
+        pixel[3] = static_cast<char>(image.pixels[n + 3]);
+    }
+    return true;
+}
@@ -0,0 +1,59 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "image/image.hpp"
+
+#if !defined(KDK_IMAGE_TGA)
+#define KDK_IMAGE_TGA
+
+namespace kdk
+{
+
+namespace tga
+{
+
+/**
+ * Decode a TGA image. Returns false, and describes the problem in `error`, if the
+ * image is malformed or uses a feature that is not supported.
+ *
+ * Color mapped, truecolor and grayscale images are supported, with or without run
+ * length encoding.
+ */
+bool decode(const uint8_t *bytes, std::size_t size, kdk::image& image, std::string& error);
+
+/**
+ * Encode the image as a TGA image, replacing the contents of `data`. Returns false, and
+ * describes the problem in `error`, if the image can not be represented in the format.
+ *
+ * The image is stored uncompressed, with 32-bit pixels from top to bottom. Images may
+ * be at most 65535 pixels wide and high.
+ */
+bool encode(const kdk::image& image, std::vector<char>& data, std::string& error);
+
+};
+
+};
+
+#endif
@@ -0,0 +1,839 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <queue>
+#include <array>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include "image/zlib.hpp"
+
+// MARK: - Constants
+
+// Huffman codes are at most fifteen bits long. Codes of up to `fast_bits` bits are
+// decoded with a single table lookup, and longer codes a bit at a time.
+static const unsigned max_bits = 15;
+static const unsigned fast_bits = 10;
+
+// Matches are between 3 and 258 bytes long, and at most 32KiB behind the bytes they
+// replace. The encoder follows a limited number of earlier candidates for each match, and
+// emits a block for every `block_tokens` matches and literals.
+static const std::size_t window_size = 32768;
+static const std::size_t min_match = 3;
+static const std::size_t max_match = 258;
+static const std::size_t max_chain = 64;
+static const unsigned hash_bits = 15;
+static const std::size_t block_tokens = 1 << 16;
+static const std::size_t max_stored = 65535;
+
+static const uint16_t length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t distance_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t distance_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t code_length_order[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+// MARK: - Checksums
+
+static std::array<uint32_t, 256> make_crc_table()
+{
+    std::array<uint32_t, 256> table;
+    for (uint32_t n = 0; n < 256; ++n) {
+        auto c = n;
+        for (auto k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : (c >> 1);
+        }
+        table[n] = c;
+    }
+    return table;
+}
+
+uint32_t kdk::zlib::crc32(const uint8_t *bytes, std::size_t size, uint32_t crc)
+{
+    static const auto table = make_crc_table();
+    crc ^= 0xFFFFFFFFU;
+    for (std::size_t n = 0; n < size; ++n) {
+        crc = table[(crc ^ bytes[n]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFU;
+}
+
+uint32_t kdk::zlib::adler32(const uint8_t *bytes, std::size_t size, uint32_t adler)
+{
+    // 5552 is the most bytes that can be summed before the sums may overflow.
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (size > 0) {
+        auto chunk = std::min<std::size_t>(size, 5552);
+        for (std::size_t n = 0; n < chunk; ++n) {
+            a += bytes[n];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        bytes += chunk;
+        size -= chunk;
+    }
+    return (b << 16) | a;
+}
+
+// MARK: - Huffman Codes
+
+static inline uint32_t reverse_bits(uint32_t code, unsigned length)
+{
+    uint32_t reversed = 0;
+    for (unsigned n = 0; n < length; ++n) {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    return reversed;
+}
+
+/**
+ * Returns the canonical code of each symbol, from the lengths of the codes. Codes are
+ * returned bit reversed, as they are written least significant bit first.
+ */
+static std::vector<uint16_t> canonical_codes(const uint8_t *lengths, std::size_t count)
+{
+    uint16_t length_counts[max_bits + 1] = { 0 };
+    for (std::size_t n = 0; n < count; ++n) {
+        length_counts[lengths[n]]++;
+    }
+    length_counts[0] = 0;
+    
+    uint32_t next_code[max_bits + 1] = { 0 };
+    uint32_t code = 0;
+    for (unsigned bits = 1; bits <= max_bits; ++bits) {
+        code = (code + length_counts[bits - 1]) << 1;
+        next_code[bits] = code;
+    }
+    
+    std::vector<uint16_t> codes(count, 0);
+    for (std::size_t n = 0; n < count; ++n) {
+        if (lengths[n]) {
+            codes[n] = static_cast<uint16_t>(reverse_bits(next_code[lengths[n]]++, lengths[n]));
+        }
+    }
+    return codes;
+}
+
+/**
+ * Returns the lengths of the Huffman codes for the specified symbol frequencies, with no
+ * code longer than `limit` bits. Whilst the optimal code is too long, the frequencies are
+ * flattened and the code built again. At least two symbols are always given codes, as
+ * decoders do not accept a code of a single symbol.
+ */
+static std::vector<uint8_t> code_lengths(std::vector<uint32_t> frequencies, unsigned limit)
+{
+    auto count = frequencies.size();
+    std::vector<uint8_t> lengths(count, 0);
+    
+    for (;;) {
+        typedef std::tuple<uint64_t, std::size_t> node;
+        std::priority_queue<node, std::vector<node>, std::greater<node>> queue;
+        for (std::size_t n = 0; n < count; ++n) {
+            if (frequencies[n]) {
+                queue.push(std::make_tuple(frequencies[n], n));
+            }
+        }
+        
+        if (queue.size() < 2) {
+            auto only = queue.empty() ? 0 : std::get<1>(queue.top());
+            lengths[only] = 1;
+            lengths[only == 0 ? 1 : 0] = 1;
+            return lengths;
+        }
+        
+        std::vector<std::size_t> parent(2 * count, 0);
+        auto next = count;
+        while (queue.size() > 1) {
+            auto a = queue.top();
+            queue.pop();
+            auto b = queue.top();
+            queue.pop();
+            parent[std::get<1>(a)] = next;
+            parent[std::get<1>(b)] = next;
+            queue.push(std::make_tuple(std::get<0>(a) + std::get<0>(b), next++));
+        }
+        auto root = std::get<1>(queue.top());
+        
+        unsigned longest = 0;
+        for (std::size_t n = 0; n < count; ++n) {
+            if (!frequencies[n]) {
+                continue;
+            }
+            unsigned depth = 0;
+            for (auto node = n; node != root; node = parent[node]) {
+                depth++;
+            }
+            lengths[n] = static_cast<uint8_t>(depth);
+            longest = std::max(longest, depth);
+        }
+        if (longest <= limit) {
+            return lengths;
+        }
+        
+        for (auto& frequency : frequencies) {
+            if (frequency) {
+                frequency = (frequency >> 1) | 1;
+            }
+        }
+    }
+}
+
+// MARK: - Inflate
+
+/**
+ * A Huffman code prepared for decoding: the number of codes of each length, the symbols
+ * in canonical order, and a table of the codes that are at most `fast_bits` long. Each
+ * entry of the table holds the length of the code above its 9-bit symbol, or is zero.
+ */
+struct huffman_decoder
+{
+    uint16_t counts[max_bits + 1];
+    uint16_t symbols[288];
+    uint16_t fast[1 << fast_bits];
+};
+
+/**
+ * Reads bits from a stream, least significant bit first.
+ */
+struct bit_reader
+{
+    const uint8_t *next;
+    const uint8_t *end;
+    uint64_t bits;
+    unsigned count;
+    
+    void refill()
+    {
+        while (count <= 56 && next < end) {
+            bits |= static_cast<uint64_t>(*next++) << count;
+            count += 8;
+        }
+    }
+    
+    bool need(unsigned n)
+    {
+        if (count < n) {
+            refill();
+        }
+        return count >= n;
+    }
+    
+    uint32_t take(unsigned n)
+    {
+        auto value = static_cast<uint32_t>(bits & ((1ULL << n) - 1));
+        bits >>= n;
+        count -= n;
+        return value;
+    }
+};
+
+static bool build_decoder(huffman_decoder& decoder, const uint8_t *lengths, std::size_t count)
+{
+    std::fill(std::begin(decoder.counts), std::end(decoder.counts), 0);
+    for (std::size_t n = 0; n < count; ++n) {
+        decoder.counts[lengths[n]]++;
+    }
+    decoder.counts[0] = 0;
+    
+    // Reject codes that are over-subscribed. Incomplete codes are accepted, and any of
+    // their unused codes fail to decode.
+    int left = 1;
+    for (unsigned bits = 1; bits <= max_bits; ++bits) {
+        left = (left << 1) - decoder.counts[bits];
+        if (left < 0) {
+            return false;
+        }
+    }
+    
+    uint16_t offsets[max_bits + 2] = { 0 };
+    for (unsigned bits = 1; bits <= max_bits; ++bits) {
+        offsets[bits + 1] = offsets[bits] + decoder.counts[bits];
+    }
+    for (std::size_t n = 0; n < count; ++n) {
+        if (lengths[n]) {
+            decoder.symbols[offsets[lengths[n]]++] = static_cast<uint16_t>(n);
+        }
+    }
+    
+    std::fill(std::begin(decoder.fast), std::end(decoder.fast), 0);
+    auto codes = canonical_codes(lengths, count);
+    for (std::size_t n = 0; n < count; ++n) {
+        auto length = lengths[n];
+        if (length == 0 || length > fast_bits) {
+            continue;
+        }
+        for (auto index = codes[n]; index < (1U << fast_bits); index += (1U << length)) {
+            decoder.fast[index] = static_cast<uint16_t>((length << 9) | n);
+        }
+    }
+    return true;
+}
+
+static inline int decode_symbol(bit_reader& reader, const huffman_decoder& decoder)
+{
+    if (reader.count < max_bits) {
+        reader.refill();
+    }
+    
+    auto entry = decoder.fast[reader.bits & ((1U << fast_bits) - 1)];
+    if (entry && (entry >> 9) <= reader.count) {
+        reader.take(entry >> 9);
+        return entry & 0x1FF;
+    }
+    
+    // Walk the canonical code a bit at a time, as codes of each length are consecutive.
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (unsigned length = 1; length <= max_bits && length <= reader.count; ++length) {
+        code |= (reader.bits >> (length - 1)) & 1;
+        int count = decoder.counts[length];
+        if (code - count < first) {
+            reader.take(length);
+            return decoder.symbols[index + (code - first)];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+static bool read_dynamic_codes(bit_reader& reader, huffman_decoder& literals, huffman_decoder& distances)
+{
+    if (!reader.need(14)) {
+        return false;
+    }
+    auto literal_count = reader.take(5) + 257;
+    auto distance_count = reader.take(5) + 1;
+    auto code_length_count = reader.take(4) + 4;
+    if (literal_count > 286 || distance_count > 30) {
+        return false;
+    }
+    
+    uint8_t code_length_lengths[19] = { 0 };
+    for (uint32_t n = 0; n < code_length_count; ++n) {
+        if (!reader.need(3)) {
+            return false;
+        }
+        code_length_lengths[code_length_order[n]] = static_cast<uint8_t>(reader.take(3));
+    }
+    
+    huffman_decoder code_lengths;
+    if (!build_decoder(code_lengths, code_length_lengths, 19)) {
+        return false;
+    }
+    
+    // The lengths of both codes are run length encoded as a single sequence.
+    uint8_t lengths[286 + 30] = { 0 };
+    uint32_t total = literal_count + distance_count;
+    for (uint32_t n = 0; n < total;) {
+        auto symbol = decode_symbol(reader, code_lengths);
+        if (symbol < 0) {
+            return false;
+        }
+        if (symbol < 16) {
+            lengths[n++] = static_cast<uint8_t>(symbol);
+            continue;
+        }
+        
+        uint8_t value = 0;
+        uint32_t repeat = 0;
+        if (symbol == 16) {
+            if (n == 0 || !reader.need(2)) {
+                return false;
+            }
+            value = lengths[n - 1];
+            repeat = 3 + reader.take(2);
+        }
+        else if (symbol == 17) {
+            if (!reader.need(3)) {
+                return false;
+            }
+            repeat = 3 + reader.take(3);
+        }
+        else {
+            if (!reader.need(7)) {
+                return false;
+            }
+            repeat = 11 + reader.take(7);
+        }
+        if (n + repeat > total) {
+            return false;
+        }
+        std::fill(lengths + n, lengths + n + repeat, value);
+        n += repeat;
+    }
+    
+    // A block that can not end is malformed.
+    if (lengths[256] == 0) {
+        return false;
+    }
+    return build_decoder(literals, lengths, literal_count) && build_decoder(distances, lengths + literal_count, distance_count);
+}
+
+bool kdk::zlib::inflate(const uint8_t *stream, std::size_t size, std::vector<uint8_t>& output, std::size_t limit)
+{
+    output.clear();
+    
+    // The stream is a two byte header, the deflated data and an Adler-32 checksum. Only
+    // the deflate method is defined, and preset dictionaries are not supported.
+    if (size < 6 || (stream[0] & 0x0F) != 8 || (stream[0] >> 4) > 7 || ((stream[0] << 8) | stream[1]) % 31 != 0 || (stream[1] & 0x20)) {
+        return false;
+    }
+    
+    // Deflate can not compress by more than 1032:1, which bounds the initial allocation.
+    std::size_t produced = 0;
+    output.resize(std::min(limit, std::max<std::size_t>(size * 4, 1 << 16)));
+    auto reserve = [&] (std::size_t count) {
+        if (produced + count > output.size()) {
+            if (produced + count > limit) {
+                return false;
+            }
+            output.resize(std::min(limit, std::max(produced + count, std::min(output.size() * 2, size * 1032))));
+        }
+        return true;
+    };
+    
+    bit_reader reader { stream + 2, stream + size - 4, 0, 0 };
+    huffman_decoder literals;
+    huffman_decoder distances;
+    bool last = false;
+    
+    while (!last) {
+        if (!reader.need(3)) {
+            return false;
+        }
+        last = reader.take(1) != 0;
+        auto type = reader.take(2);
+        
+        if (type == 0) {
+            // Stored blocks begin on a byte boundary, with their length and its complement.
+            reader.take(reader.count % 8);
+            if (!reader.need(32)) {
+                return false;
+            }
+            auto length = reader.take(16);
+            if (length != (~reader.take(16) & 0xFFFF) || !reserve(length)) {
+                return false;
+            }
+            for (; length > 0 && reader.count >= 8; --length) {
+                output[produced++] = static_cast<uint8_t>(reader.take(8));
+            }
+            if (static_cast<std::size_t>(reader.end - reader.next) < length) {
+                return false;
+            }
+            std::memcpy(output.data() + produced, reader.next, length);
+            reader.next += length;
+            produced += length;
+            continue;
+        }
+        
+        if (type == 1) {
+            uint8_t lengths[288 + 30];
+            std::fill(lengths, lengths + 144, 8);
+            std::fill(lengths + 144, lengths + 256, 9);
+            std::fill(lengths + 256, lengths + 280, 7);
+            std::fill(lengths + 280, lengths + 288, 8);
+            std::fill(lengths + 288, lengths + 318, 5);
+            build_decoder(literals, lengths, 288);
+            build_decoder(distances, lengths + 288, 30);
+        }
+        else if (type != 2 || !read_dynamic_codes(reader, literals, distances)) {
+            return false;
+        }
+        
+        for (;;) {
+            auto symbol = decode_symbol(reader, literals);
+            if (symbol < 0) {
+                return false;
+            }
+            if (symbol < 256) {
+                if (!reserve(1)) {
+                    return false;
+                }
+                output[produced++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            if (symbol == 256) {
+                break;
+            }
+            
+            symbol -= 257;
+            if (symbol >= 29 || !reader.need(length_extra[symbol])) {
+                return false;
+            }
+            std::size_t length = length_base[symbol] + reader.take(length_extra[symbol]);
+            
+            auto distance_symbol = decode_symbol(reader, distances);
+            if (distance_symbol < 0 || distance_symbol >= 30 || !reader.need(distance_extra[distance_symbol])) {
+                return false;
+            }
+            std::size_t distance = distance_base[distance_symbol] + reader.take(distance_extra[distance_symbol]);
+            if (distance > produced || !reserve(length)) {
+                return false;
+            }
+            
+            // Matches may overlap the bytes they produce, repeating them.
+            auto from = output.data() + produced - distance;
+            auto to = output.data() + produced;
+            if (distance >= length) {
+                std::memcpy(to, from, length);
+            }
+            else {
+                for (std::size_t n = 0; n < length; ++n) {
+                    to[n] = from[n];
+                }
+            }
+            produced += length;
+        }
+    }
+    
+    output.resize(produced);
+    auto trailer = stream + size - 4;
+    auto checksum = (static_cast<uint32_t>(trailer[0]) << 24) | (trailer[1] << 16) | (trailer[2] << 8) | trailer[3];
+    return kdk::zlib::adler32(output.data(), output.size()) == checksum;
+}
+
+// MARK: - Deflate
+
+/**
+ * A literal, or a match of `length` bytes at `distance` bytes back. Literals have a
+ * distance of zero, and hold the byte as their length.
+ */
+struct deflate_token
+{
+    uint16_t length;
+    uint16_t distance;
+};
+
+/**
+ * Writes bits to a stream, least significant bit first.
+ */
+struct bit_writer
+{
+    std::vector<uint8_t>& bytes;
+    uint64_t bits;
+    unsigned count;
+    
+    void put(uint32_t value, unsigned n)
+    {
+        bits |= static_cast<uint64_t>(value) << count;
+        count += n;
+        while (count >= 8) {
+            bytes.push_back(static_cast<uint8_t>(bits));
+            bits >>= 8;
+            count -= 8;
+        }
+    }
+    
+    void align()
+    {
+        if (count > 0) {
+            put(0, 8 - count);
+        }
+    }
+};
+
+static inline std::size_t length_symbol(std::size_t length)
+{
+    return std::upper_bound(length_base, length_base + 29, length) - length_base - 1;
+}
+
+static inline std::size_t distance_symbol(std::size_t distance)
+{
+    return std::upper_bound(distance_base, distance_base + 30, distance) - distance_base - 1;
+}
+
+static uint64_t token_bits(const std::vector<deflate_token>& tokens, const std::vector<uint8_t>& literal_lengths, const std::vector<uint8_t>& distance_lengths)
+{
+    uint64_t bits = literal_lengths[256];
+    for (const auto& token : tokens) {
+        if (token.distance == 0) {
+            bits += literal_lengths[token.length];
+            continue;
+        }
+        auto length = length_symbol(token.length);
+        auto distance = distance_symbol(token.distance);
+        bits += literal_lengths[257 + length] + length_extra[length] + distance_lengths[distance] + distance_extra[distance];
+    }
+    return bits;
+}
+
+static void put_tokens(bit_writer& writer, const std::vector<deflate_token>& tokens, const std::vector<uint8_t>& literal_lengths, const std::vector<uint8_t>& distance_lengths)
+{
+    auto literal_codes = canonical_codes(literal_lengths.data(), literal_lengths.size());
+    auto distance_codes = canonical_codes(distance_lengths.data(), distance_lengths.size());
+    
+    for (const auto& token : tokens) {
+        if (token.distance == 0) {
+            writer.put(literal_codes[token.length], literal_lengths[token.length]);
+            continue;
+        }
+        auto length = length_symbol(token.length);
+        writer.put(literal_codes[257 + length], literal_lengths[257 + length]);
+        writer.put(token.length - length_base[length], length_extra[length]);
+        auto distance = distance_symbol(token.distance);
+        writer.put(distance_codes[distance], distance_lengths[distance]);
+        writer.put(token.distance - distance_base[distance], distance_extra[distance]);
+    }
+    writer.put(literal_codes[256], literal_lengths[256]);
+}
+
+/**
+ * Write a block holding the specified tokens, which encode the raw bytes given. The block
+ * uses whichever of a dynamic code, the fixed code or stored bytes is smallest.
+ */
+static void put_block(bit_writer& writer, const std::vector<deflate_token>& tokens, const uint8_t *raw, std::size_t raw_size, bool last)
+{
+    std::vector<uint32_t> literal_frequencies(286, 0);
+    std::vector<uint32_t> distance_frequencies(30, 0);
+    literal_frequencies[256] = 1;
+    for (const auto& token : tokens) {
+        if (token.distance == 0) {
+            literal_frequencies[token.length]++;
+        }
+        else {
+            literal_frequencies[257 + length_symbol(token.length)]++;
+            distance_frequencies[distance_symbol(token.distance)]++;
+        }
+    }
+    auto literal_lengths = code_lengths(literal_frequencies, max_bits);
+    auto distance_lengths = code_lengths(distance_frequencies, max_bits);
+    
+    std::size_t literal_count = 286;
+    while (literal_count > 257 && literal_lengths[literal_count - 1] == 0) {
+        literal_count--;
+    }
+    std::size_t distance_count = 30;
+    while (distance_count > 1 && distance_lengths[distance_count - 1] == 0) {
+        distance_count--;
+    }
+    
+    // Run length encode the lengths of both codes as a single sequence of code length
+    // symbols, each with the value of its extra bits.
+    std::vector<uint8_t> sequence(literal_lengths.begin(), literal_lengths.begin() + literal_count);
+    sequence.insert(sequence.end(), distance_lengths.begin(), distance_lengths.begin() + distance_count);
+    std::vector<std::tuple<uint8_t, uint8_t>> runs;
+    for (std::size_t n = 0; n < sequence.size();) {
+        auto value = sequence[n];
+        std::size_t run = 1;
+        while (n + run < sequence.size() && sequence[n + run] == value) {
+            run++;
+        }
+        n += run;
+        
+        if (value == 0) {
+            for (; run >= 11; run -= std::min<std::size_t>(run, 138)) {
+                runs.push_back(std::make_tuple(18, static_cast<uint8_t>(std::min<std::size_t>(run, 138) - 11)));
+            }
+            if (run >= 3) {
+                runs.push_back(std::make_tuple(17, static_cast<uint8_t>(run - 3)));
+                run = 0;
+            }
+        }
+        else {
+            runs.push_back(std::make_tuple(value, 0));
+            run--;
+            for (; run >= 3; run -= std::min<std::size_t>(run, 6)) {
+                runs.push_back(std::make_tuple(16, static_cast<uint8_t>(std::min<std::size_t>(run, 6) - 3)));
+            }
+        }
+        for (; run > 0; --run) {
+            runs.push_back(std::make_tuple(value, 0));
+        }
+    }
+    
+    static const uint8_t run_extra[19] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 3, 7 };
+    std::vector<uint32_t> run_frequencies(19, 0);
+    for (const auto& run : runs) {
+        run_frequencies[std::get<0>(run)]++;
+    }
+    auto run_lengths = code_lengths(run_frequencies, 7);
+    std::size_t run_length_count = 19;
+    while (run_length_count > 4 && run_lengths[code_length_order[run_length_count - 1]] == 0) {
+        run_length_count--;
+    }
+    
+    uint64_t dynamic_bits = 17 + 3 * run_length_count + token_bits(tokens, literal_lengths, distance_lengths);
+    for (const auto& run : runs) {
+        dynamic_bits += run_lengths[std::get<0>(run)] + run_extra[std::get<0>(run)];
+    }
+    
+    std::vector<uint8_t> fixed_literal_lengths(288, 8);
+    std::fill(fixed_literal_lengths.begin() + 144, fixed_literal_lengths.begin() + 256, 9);
+    std::fill(fixed_literal_lengths.begin() + 256, fixed_literal_lengths.begin() + 280, 7);
+    std::vector<uint8_t> fixed_distance_lengths(30, 5);
+    uint64_t fixed_bits = 3 + token_bits(tokens, fixed_literal_lengths, fixed_distance_lengths);
+    
+    uint64_t stored_bits = 8 * (raw_size + 5 * std::max<std::size_t>(1, (raw_size + max_stored - 1) / max_stored)) + 7;
+    
+    if (stored_bits < dynamic_bits && stored_bits < fixed_bits) {
+        std::size_t offset = 0;
+        do {
+            auto length = std::min(raw_size - offset, max_stored);
+            writer.put((last && offset + length == raw_size) ? 1 : 0, 1);
+            writer.put(0, 2);
+            writer.align();
+            writer.put(static_cast<uint32_t>(length), 16);
+            writer.put(static_cast<uint32_t>(~length & 0xFFFF), 16);
+            writer.bytes.insert(writer.bytes.end(), raw + offset, raw + offset + length);
+            offset += length;
+        } while (offset < raw_size);
+    }
+    else if (fixed_bits <= dynamic_bits) {
+        writer.put(last ? 1 : 0, 1);
+        writer.put(1, 2);
+        put_tokens(writer, tokens, fixed_literal_lengths, fixed_distance_lengths);
+    }
+    else {
+        writer.put(last ? 1 : 0, 1);
+        writer.put(2, 2);
+        writer.put(static_cast<uint32_t>(literal_count - 257), 5);
+        writer.put(static_cast<uint32_t>(distance_count - 1), 5);
+        writer.put(static_cast<uint32_t>(run_length_count - 4), 4);
+        for (std::size_t n = 0; n < run_length_count; ++n) {
+            writer.put(run_lengths[code_length_order[n]], 3);
+        }
+        auto run_codes = canonical_codes(run_lengths.data(), run_lengths.size());
+        for (const auto& run : runs) {
+            auto symbol = std::get<0>(run);
+            writer.put(run_codes[symbol], run_lengths[symbol]);
+            writer.put(std::get<1>(run), run_extra[symbol]);
+        }
+        put_tokens(writer, tokens, literal_lengths, distance_lengths);
+    }
+}
+
+static inline uint32_t hash_sequence(const uint8_t *bytes)
+{
+    uint32_t sequence = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16);
+    return (sequence * 2654435761U) >> (32 - hash_bits);
+}
+
+std::vector<uint8_t> kdk::zlib::deflate(const uint8_t *bytes, std::size_t size)
+{
+    std::vector<uint8_t> stream { 0x78, 0x9C };
+    stream.reserve(size / 2 + 64);
+    bit_writer writer { stream, 0, 0 };
+    
+    // Earlier positions with the same three byte hash are chained together, so that the
+    // longest match among the most recent candidates can be found.
+    std::vector<int64_t> head(1 << hash_bits, -1);
+    std::vector<int64_t> previous(window_size, -1);
+    auto insert = [&] (std::size_t position) {
+        if (position + min_match <= size) {
+            auto hash = hash_sequence(bytes + position);
+            previous[position & (window_size - 1)] = head[hash];
+            head[hash] = static_cast<int64_t>(position);
+        }
+    };
+    
+    std::vector<deflate_token> tokens;
+    tokens.reserve(block_tokens);
+    std::size_t block_start = 0;
+    std::size_t position = 0;
+    
+    while (position < size) {
+        std::size_t best_length = 0;
+        std::size_t best_distance = 0;
+        
+        if (position + min_match <= size) {
+            auto longest = std::min(max_match, size - position);
+            auto candidate = head[hash_sequence(bytes + position)];
+            for (std::size_t chain = 0; chain < max_chain && candidate >= 0; ++chain) {
+                auto distance = position - static_cast<std::size_t>(candidate);
+                if (distance > window_size) {
+                    break;
+                }
+                
+                auto match = bytes + candidate;
+                if (match[best_length] == bytes[position + best_length]) {
+                    std::size_t length = 0;
+                    while (length < longest && match[length] == bytes[position + length]) {
+                        length++;
+                    }
+                    if (length > best_length) {
+                        best_length = length;
+                        best_distance = distance;
+                        if (length == longest) {
+                            break;
+                        }
+                    }
+                }
+                
+                auto next = previous[candidate & (window_size - 1)];
+                if (next >= candidate) {
+                    break;
+                }
+                candidate = next;
+            }
+        }
+        
+        if (best_length >= min_match) {
+            tokens.push_back({ static_cast<uint16_t>(best_length), static_cast<uint16_t>(best_distance) });
+            for (std::size_t n = 0; n < best_length; ++n) {
+                insert(position + n);
+            }
+            position += best_length;
+        }
+        else {
+            tokens.push_back({ bytes[position], 0 });
+            insert(position);
+            position++;
+        }
+        
+        if (tokens.size() == block_tokens) {
+            put_block(writer, tokens, bytes + block_start, position - block_start, position == size);
+            tokens.clear();
+            block_start = position;
+        }
+    }
+    
+    if (!tokens.empty() || block_start == 0) {
+        put_block(writer, tokens, bytes + block_start, position - block_start, true);
+    }
+    writer.align();
+    
+    auto checksum = kdk::zlib::adler32(bytes, size);
+    stream.push_back(static_cast<uint8_t>(checksum >> 24));
+    stream.push_back(static_cast<uint8_t>(checksum >> 16));
+    stream.push_back(static_cast<uint8_t>(checksum >> 8));
+    stream.push_back(static_cast<uint8_t>(checksum));
+    return stream;
+}
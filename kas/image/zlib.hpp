@@ -0,0 +1,63 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#if !defined(KDK_IMAGE_ZLIB)
+#define KDK_IMAGE_ZLIB
+
+namespace kdk
+{
+
+namespace zlib
+{
+
+/**
+ * Returns the CRC-32 of the specified bytes, continuing from a previous CRC.
+ */
+uint32_t crc32(const uint8_t *bytes, std::size_t size, uint32_t crc = 0);
+
+/**
+ * Returns the Adler-32 checksum of the specified bytes, continuing from a previous
+ * checksum.
+ */
+uint32_t adler32(const uint8_t *bytes, std::size_t size, uint32_t adler = 1);
+
+/**
+ * Decompress a zlib stream, replacing the contents of `output`. Returns false if the
+ * stream is malformed, fails its checksum, or would decompress to more than `limit`
+ * bytes. The stream is never read out of bounds.
+ */
+bool inflate(const uint8_t *stream, std::size_t size, std::vector<uint8_t>& output, std::size_t limit);
+
+/**
+ * Compress the specified bytes into a zlib stream.
+ */
+std::vector<uint8_t> deflate(const uint8_t *bytes, std::size_t size);
+
+};
+
+};
+
+#endif
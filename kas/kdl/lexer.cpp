@@ -71,10 +71,15 @@ bool kdl::lexer::token::is_a(kdl::lexer::token::type type) const
     return (m_type == type);
 }
 
+kdl::lexer::token::type kdl::lexer::token::kind() const
+{
+    return m_type;
+}
+
 // MARK: - Lexer Constructor
 
-kdl::lexer::lexer(const std::string path, const std::string& content)
-    : m_path(path), m_source(content + "\n"), m_pos(0), m_length(content.length() + 1)
+kdl::lexer::lexer(const std::string path, const std::string& content, int first_line)
+    : m_path(path), m_source(content + "\n"), m_pos(0), m_length(content.length() + 1), m_line(first_line)
 {
     
 }
@@ -83,6 +88,9 @@ kdl::lexer kdl::lexer::open_file(const std::string path)
 {
     std::ifstream f(path);
     std::string str;
+    if (!f.is_open()) {
+        log::error(path, 0, "Unable to open the file '" + path + "'.");
+    }
 
     f.seekg(0, std::ios::end);
     str.reserve(f.tellg());
@@ -102,12 +110,14 @@ std::vector<kdl::lexer::token> kdl::lexer::analyze()
         
         // Consume any leading (nonbreaking) whitespace.
         consume_while(set<' ', '\t'>::contains);
+        m_token_start = m_pos;
         
         // Check if we're looking at a new line character. If we are then simply consume it, and
         // increment the current line number.
         if (test_if(match<'\n'>::yes)) {
             advance();
             m_line++;
+            m_line_start = m_pos;
             continue;
         }
         
@@ -124,16 +134,20 @@ std::vector<kdl::lexer::token> kdl::lexer::analyze()
             advance();
             consume_while(identifier_set::contains);
             
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, m_slice, token::type::directive));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), m_slice, token::type::directive));
         }
         
         // Literals
         else if (test_if(match<'"'>::yes)) {
             // We're looking at a string literal.
-            // The string continues until a corresponding '"' is found.
+            // The string continues until a corresponding '"' is found, which must be on the
+            // same line.
             advance();
-            consume_while(match<'"'>::no);
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, m_slice, token::type::string));
+            consume_while(set<'"', '\n'>::not_contains);
+            if (test_if(match<'\n'>::yes)) {
+                log::error(m_path, m_line + 1, "Unterminated string literal.");
+            }
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), m_slice, token::type::string));
             advance();
         }
         else if (test_if(match<'#'>::yes)) {
@@ -141,13 +155,13 @@ std::vector<kdl::lexer::token> kdl::lexer::analyze()
             // These take the form of #128, #129, etc.
             advance();
             consume_while(number_set::contains);
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, m_slice, token::type::resource_id));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), m_slice, token::type::resource_id));
         }
         else if (test_if(match<'$'>::yes)) {
             // We're looking at the beginning of a variable
             advance();
             consume_while(identifier_set::contains);
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, m_slice, token::type::variable));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), m_slice, token::type::variable));
         }
         else if (test_if(number_set::contains)) {
             // We're looking at a number, slice it out of the source, and then check the following
@@ -158,10 +172,10 @@ std::vector<kdl::lexer::token> kdl::lexer::analyze()
             if (test_if(match<'%'>::yes)) {
                 // This is a percentage.
                 advance();
-                m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, number_text, token::type::percentage));
+                m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), number_text, token::type::percentage));
             }
             else {
-                m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, number_text, token::type::integer));
+                m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), number_text, token::type::integer));
             }
         }
         else if (test_if(identifier_set::contains)) {
@@ -171,82 +185,105 @@ std::vector<kdl::lexer::token> kdl::lexer::analyze()
             
             // TODO: Check for keywords
             
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, text, token::type::identifier));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), text, token::type::identifier));
         }
         
         // Symbols
         else if (test_if(match<';'>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::semi_colon));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::semi_colon));
         }
         else if (test_if(match<'{'>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::lbrace));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::lbrace));
         }
         else if (test_if(match<'}'>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::rbrace));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::rbrace));
         }
         else if (test_if(match<'['>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::lbracket));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::lbracket));
         }
         else if (test_if(match<']'>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::rbracket));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::rbracket));
         }
         else if (test_if(match<'('>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::lparen));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::lparen));
         }
         else if (test_if(match<')'>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::rparen));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::rparen));
         }
         else if (test_if(match<'<'>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::langle));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::langle));
         }
         else if (test_if(match<'>'>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::rangle));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::rangle));
         }
         else if (test_if(match<'='>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::equals));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::equals));
         }
         else if (test_if(match<'+'>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::plus));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::plus));
         }
         else if (test_if(match<'-'>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::minus));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::minus));
         }
         else if (test_if(match<'*'>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::star));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::star));
         }
         else if (test_if(match<'/'>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::slash));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::slash));
         }
         else if (test_if(match<':'>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::colon));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::colon));
         }
         else if (test_if(match<','>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::comma));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::comma));
         }
         else if (test_if(match<'.'>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::dot));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::dot));
         }
         else if (test_if(match<'&'>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::ampersand));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::ampersand));
         }
         else if (test_if(match<'|'>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::pipe));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::pipe));
         }
         else if (test_if(match<'^'>::yes)) {
-            m_tokens.push_back(kdl::lexer::token(m_path, m_line, 0, read(), token::type::caret));
+            m_tokens.push_back(kdl::lexer::token(m_path, m_line, column(), read(), token::type::caret));
         }
         
         // Error States
         else {
-            log::error(m_path, m_line, "Unrecognised character '" + peek() + "' encountered.");
+            std::string::size_type length = 1;
+            while (available(length) && (static_cast<unsigned char>(m_source[m_pos + length]) & 0xC0) == 0x80) {
+                length++;
+            }
+            log::error(m_path, m_line + 1, "Unrecognised character '" + peek(0, length) + "' encountered.");
         }
     }
     
     return m_tokens;
 }
 
+void kdl::lexer::skip()
+{
+    // Line breaks are never skipped, so that lines continue to be counted.
+    if (test_if(match<'\n'>::yes)) {
+        return;
+    }
+    
+    // Skip the entire UTF-8 sequence of the character.
+    advance();
+    while (available() && (static_cast<unsigned char>(m_source[m_pos]) & 0xC0) == 0x80) {
+        advance();
+    }
+}
+
 // MARK: - Lexer Accessors
 
+int kdl::lexer::column() const
+{
+    return static_cast<int>(m_token_start - m_line_start);
+}
+
 bool kdl::lexer::available(long offset, std::string::size_type size) const
 {
     auto start = m_pos + offset;
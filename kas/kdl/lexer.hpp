@@ -95,6 +95,11 @@ public:
          */
         bool is_a(token::type type) const;
         
+        /**
+         * Returns the type of the token.
+         */
+        token::type kind() const;
+        
     private:
         int m_line;
         int m_offset;
@@ -105,9 +110,10 @@ public:
     
 public:
     /**
-     * Construct a new lexical analyser using the source code provided.
+     * Construct a new lexical analyser using the source code provided. The source may
+     * be a fragment of a larger file, beginning at the specified (zero based) line.
      */
-    lexer(const std::string path, const std::string& source);
+    lexer(const std::string path, const std::string& source, int first_line = 0);
     
     /**
      * Create a new lexer, using the contents of the specified file as the source.
@@ -128,6 +134,12 @@ public:
      */
     std::vector<kdl::lexer::token> analyze();
     
+    /**
+     * Skip the character at the current position of the lexer. If errors are recoverable,
+     * this allows analysis to be resumed after an unrecognised character is reported.
+     */
+    void skip();
+    
     /**
      * Test if there is any more characters in source to parse.
      */
@@ -178,12 +190,19 @@ public:
     
 private:
     int m_line;
+    std::string::size_type m_line_start { 0 };
+    std::string::size_type m_token_start { 0 };
     std::string::size_type m_pos;
     std::string::size_type m_length;
     std::string m_source;
     std::vector<token> m_tokens;
     std::string m_slice;
     std::string m_path;
+    
+    /**
+     * Returns the column of the current token within its line.
+     */
+    int column() const;
 };
 
 // MARK: - Test Functions
@@ -0,0 +1,81 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "kdl/lexer_cache.hpp"
+#include "cache/hasher.hpp"
+
+// MARK: - Singleton
+
+kdl::lexer_cache::lexer_cache()
+{
+    
+}
+
+kdl::lexer_cache& kdl::lexer_cache::shared()
+{
+    static kdl::lexer_cache instance;
+    return instance;
+}
+
+// MARK: - Configuration
+
+void kdl::lexer_cache::set_retains_tokens(bool retains)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_retains = retains;
+    if (!m_retains) {
+        m_entries.clear();
+    }
+}
+
+// MARK: - Analysis
+
+std::vector<kdl::lexer::token> kdl::lexer_cache::analyze(const std::string& path)
+{
+    // Files that are not retained are analysed without holding the lock, so that several
+    // builds may analyse files at once.
+    std::unique_lock<std::mutex> lock(m_lock);
+    if (!m_retains) {
+        lock.unlock();
+        return kdl::lexer::open_file(path).analyze();
+    }
+    
+    auto identity = kdk::hasher::file_identity(path);
+    auto& entry = m_entries[path];
+    if (!identity.empty() && entry.identity == identity) {
+        return entry.tokens;
+    }
+    
+    // The identity has changed, but the contents may not have. Touching a file, or
+    // replacing it with an identical copy, does not require it to be analysed again.
+    std::string digest;
+    if (kdk::hasher::digest_file(path, digest) && digest == entry.digest) {
+        entry.identity = identity;
+        return entry.tokens;
+    }
+    
+    auto tokens = kdl::lexer::open_file(path).analyze();
+    entry.identity = identity;
+    entry.digest = digest;
+    entry.tokens = tokens;
+    return tokens;
+}
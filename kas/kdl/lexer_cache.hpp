@@ -0,0 +1,82 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include "kdl/lexer.hpp"
+
+#if !defined(KDL_LEXER_CACHE)
+#define KDL_LEXER_CACHE
+
+namespace kdl
+{
+
+/**
+ * The lexer cache holds the tokens of each source file that has been analysed, so that
+ * a long running process does not need to analyse unchanged files again.
+ *
+ * A file is only analysed again if its identity (device, inode, size and modification
+ * time) has changed, and the digest of its contents no longer matches. When retention
+ * is disabled, which is the default, every file is analysed when requested and nothing
+ * is held.
+ */
+class lexer_cache
+{
+public:
+    lexer_cache(const lexer_cache&) = delete;
+    lexer_cache& operator=(const lexer_cache &) = delete;
+    
+    static lexer_cache& shared();
+    
+    /**
+     * Set whether the tokens of analysed files should be retained.
+     */
+    void set_retains_tokens(bool retains);
+    
+    /**
+     * Returns the tokens of the specified file.
+     */
+    std::vector<kdl::lexer::token> analyze(const std::string& path);
+    
+private:
+    /**
+     * The identity, contents digest and tokens of a source file.
+     */
+    struct entry
+    {
+        std::string identity;
+        std::string digest;
+        std::vector<kdl::lexer::token> tokens;
+    };
+    
+    bool m_retains { false };
+    std::mutex m_lock;
+    std::map<std::string, kdl::lexer_cache::entry> m_entries;
+    
+    lexer_cache();
+};
+
+};
+
+#endif
@@ -22,10 +22,12 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <algorithm>
 #include "kdl/sema/declaration.hpp"
 #include "structures/resource.hpp"
 #include "diagnostic/log.hpp"
 #include "assemblers/pool.hpp"
+#include "image/image_cache.hpp"
 
 // MARK: - Parser
 
@@ -63,6 +65,10 @@ void kdl::declaration::parse(kdl::sema *sema)
         if (sema->expect({ condition(lexer::token::type::identifier, "new").truthy() })) {
             m_instances.push_back(parse_instance(sema, structure_name));
         }
+        else {
+            auto tk = sema->peek();
+            log::error(tk.file(), tk.line(), "Expected a resource instance, but found '" + tk.text() + "' instead.");
+        }
         
     }
     
@@ -71,7 +77,7 @@ void kdl::declaration::parse(kdl::sema *sema)
     });
     
     // Prepare to add the structure type and all instances into the target.
-    sema->target()->add_resources(m_instances);
+    sema->target()->add_resources(std::move(m_instances));
 }
 
 kdk::resource kdl::declaration::parse_instance(kdl::sema *sema, const std::string type, bool ignore_attributes, int64_t default_id, std::string default_name)
@@ -130,6 +136,7 @@ kdk::resource kdl::declaration::parse_instance(kdl::sema *sema, const std::strin
     
     // Construct the base resource object in preparation for adding fields and values to it.
     kdk::resource resource { type, resource_id, resource_name };
+    std::vector<std::string> atlas_frames;
     
     // All fields are contained with in a block ( { ... } ). Ensure we have an opening brace, and then keep
     // parsing until the corresponding closing brace is found.
@@ -150,6 +157,7 @@ kdk::resource kdl::declaration::parse_instance(kdl::sema *sema, const std::strin
         //      percentage
         //      identifier
         //      identifier<file> ( string )
+        //      identifier<import> ( string ) identifier<as> identifier
         //
         // Each of these need to be correctly parsed and encoded into a field structure
         // and stored in the resource. This part of the parser is not validing the valuetypes
@@ -169,7 +177,7 @@ kdk::resource kdl::declaration::parse_instance(kdl::sema *sema, const std::strin
         if (sema->expect({ kdl::condition(kdl::lexer::token::type::identifier, "new").truthy() })) {
             // We're trying to construct a referenced resource. Ensure that the field_name specified correlates to a reference
             // in the resource definition.
-            auto assembler_info = kdk::assembler_pool::shared().assembler_named(type);
+            auto assembler_info = sema->target()->assemblers().assembler_named(type);
             auto assembler = std::get<1>(assembler_info);
             if (assembler == nullptr) {
                 log::error(sema->peek().file(), sema->peek().line(), "Unable to handle referenced resource declaration. Unable to identify it.");
@@ -248,9 +256,84 @@ kdk::resource kdl::declaration::parse_instance(kdl::sema *sema, const std::strin
                         log::error(sema->peek().file(), sema->peek().line(), "Malformed file reference found.");
                     }
                     
-                    values.push_back( std::make_tuple(sema->read().text(), kdk::resource::field::value_type::file_reference) );
+                    auto file_path = sema->read().text();
+                    sema->target()->add_dependency(file_path);
+                    values.push_back( std::make_tuple(file_path, kdk::resource::field::value_type::file_reference) );
                     sema->advance();
                 }
+                else if ( sema->expect({ condition(lexer::token::type::identifier, "import").truthy() }) ) {
+                    // Imported image value...
+                    sema->ensure({
+                        condition(lexer::token::type::identifier, "import").truthy(),
+                        condition(lexer::token::type::lparen).truthy()
+                    });
+                    
+                    // An atlas may import several images, or directories of images.
+                    std::vector<std::string> image_paths;
+                    do {
+                        if (!image_paths.empty()) {
+                            sema->advance();
+                        }
+                        if (!sema->expect({ condition(lexer::token::type::string).truthy() })) {
+                            log::error(sema->peek().file(), sema->peek().line(), "Malformed image import found.");
+                        }
+                        image_paths.push_back(sema->read().text());
+                    } while (sema->expect({ condition(lexer::token::type::comma).truthy() }));
+                    
+                    if (!sema->expect({
+                        condition(lexer::token::type::rparen).truthy(),
+                        condition(lexer::token::type::identifier, "as").truthy(),
+                        condition(lexer::token::type::identifier).truthy()
+                    })) {
+                        log::error(sema->peek().file(), sema->peek().line(), "Malformed image import found.");
+                    }
+                    sema->advance(2);
+                    auto format_token = sema->read();
+                    auto format = format_token.text();
+                    
+                    // Some formats take arguments, such as the frame size of a sprite or the
+                    // options of a color icon.
+                    if (sema->expect({ condition(lexer::token::type::lparen).truthy() })) {
+                        do {
+                            format += sema->read().text() == "(" ? "(" : ",";
+                            if (!sema->expect({ condition(lexer::token::type::integer).truthy() }) && !sema->expect({ condition(lexer::token::type::identifier).truthy() })) {
+                                log::error(format_token.file(), format_token.line(), "Malformed arguments for image format '" + format_token.text() + "'.");
+                            }
+                            format += sema->read().text();
+                        } while (sema->expect({ condition(lexer::token::type::comma).truthy() }));
+                        
+                        if (!sema->expect({ condition(lexer::token::type::rparen).truthy() })) {
+                            log::error(format_token.file(), format_token.line(), "Malformed arguments for image format '" + format_token.text() + "'.");
+                        }
+                        format += sema->read().text();
+                    }
+                    
+                    if (!kdk::image_cache::format_named(format)) {
+                        log::error(format_token.file(), format_token.line(), "Unrecognised image format '" + format + "'.");
+                    }
+                    
+                    if (format == "atlas") {
+                        std::vector<std::string> frame_paths;
+                        for (const auto& image_path : image_paths) {
+                            auto paths = kdk::image_cache::frame_paths(image_path);
+                            frame_paths.insert(frame_paths.end(), paths.begin(), paths.end());
+                            sema->target()->add_dependency(image_path);
+                        }
+                        if (frame_paths.empty()) {
+                            log::error(format_token.file(), format_token.line(), "The atlas has no frames.");
+                        }
+                        image_paths = frame_paths;
+                        atlas_frames = frame_paths;
+                    }
+                    else if (image_paths.size() != 1) {
+                        log::error(format_token.file(), format_token.line(), "Only an atlas may import more than one image.");
+                    }
+                    
+                    for (const auto& image_path : image_paths) {
+                        sema->target()->add_dependency(image_path);
+                    }
+                    values.push_back( std::make_tuple(kdk::image_cache::reference(image_paths, format), kdk::resource::field::value_type::image_reference) );
+                }
                 else if ( sema->expect({ condition(lexer::token::type::identifier, "rgb").truthy() }) ) {
                     // RGB Color value...
                     sema->ensure({
@@ -298,5 +381,33 @@ kdk::resource kdl::declaration::parse_instance(kdl::sema *sema, const std::strin
         condition(lexer::token::type::rbrace).truthy()
     });
     
+    // A resource that imports an atlas describes the frames of its animation with its
+    // 'size' and 'tiles' fields, if its type has them. They are filled in from the frames
+    // unless they were given. The frames are not laid out in a grid, so 'tiles' is given
+    // as a single row of every frame, which keeps the number of frames that it describes
+    // correct. Their positions are only given by the frame table of the atlas.
+    if (!atlas_frames.empty()) {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        auto assembler = std::get<1>(sema->target()->assemblers().assembler_named(type, true));
+        if (assembler && kdk::image_cache::image_size(atlas_frames.front(), width, height)) {
+            const std::tuple<std::string, uint32_t, uint32_t> derived[] = {
+                std::make_tuple("size", width, height),
+                std::make_tuple("tiles", static_cast<uint32_t>(atlas_frames.size()), 1)
+            };
+            for (const auto& field : derived) {
+                auto defined = std::any_of(assembler->fields().begin(), assembler->fields().end(), [&] (const kdk::assembler::field& definition) {
+                    return definition.name() == std::get<0>(field);
+                });
+                if (defined && !resource.field_named(std::get<0>(field))) {
+                    resource.add_field(kdk::resource::field(std::get<0>(field), {
+                        std::make_tuple(std::to_string(std::get<1>(field)), kdk::resource::field::value_type::integer),
+                        std::make_tuple(std::to_string(std::get<2>(field)), kdk::resource::field::value_type::integer)
+                    }));
+                }
+            }
+        }
+    }
+    
     return resource;
 }
@@ -22,10 +22,12 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <algorithm>
 #include "kdl/sema/define_directive.hpp"
 #include "diagnostic/log.hpp"
 #include "assemblers/assembler.hpp"
 #include "assemblers/pool.hpp"
+#include "cache/hasher.hpp"
 
 // MARK: - Private Parser Functions
 
@@ -37,7 +39,7 @@ static inline kdk::assembler::field::value::type parse_value_type(kdl::sema *sem
     
     auto type_symbol = sema->read().text();
     
-    if (type_symbol == "resource_reference") {
+    if (type_symbol == "resource_reference" || type_symbol == "reference") {
         return kdk::assembler::field::value::type::resource_reference;
     }
     else if (type_symbol == "integer") {
@@ -56,7 +58,10 @@ static inline kdk::assembler::field::value::type parse_value_type(kdl::sema *sem
         return kdk::assembler::field::value::type::color;
     }
     else if (type_symbol == "bitmask") {
-        return kdk::assembler::field::value::type::resource_reference;
+        return kdk::assembler::field::value::type::bitmask;
+    }
+    else if (type_symbol == "data") {
+        return kdk::assembler::field::value::type::data;
     }
     else {
         log::error(sema->peek().file(), sema->peek().line(), "Unrecognised type '" + type_symbol + "'.");
@@ -96,6 +101,68 @@ static inline uint64_t parse_value_size(kdl::sema *sema)
     throw std::runtime_error("Fatal error whilst resolving value size.");
 }
 
+static inline std::string parse_integer(kdl::sema *sema)
+{
+    // Integers may be negated with a leading minus.
+    std::string sign;
+    if (sema->expect({
+        kdl::condition(kdl::lexer::token::type::minus).truthy(),
+        kdl::condition(kdl::lexer::token::type::integer).truthy()
+    })) {
+        sema->advance();
+        sign = "-";
+    }
+    
+    if (sema->expect({ kdl::condition(kdl::lexer::token::type::integer).falsey() })) {
+        log::error(sema->peek().file(), sema->peek().line(), "Expected an integer.");
+    }
+    return sign + sema->read().text();
+}
+
+static inline std::tuple<std::string, kdk::resource::field::value_type> parse_default_value(kdl::sema *sema)
+{
+    if (sema->expect({ kdl::condition(kdl::lexer::token::type::integer).truthy() }) ||
+        sema->expect({ kdl::condition(kdl::lexer::token::type::minus).truthy() })) {
+        return std::make_tuple(parse_integer(sema), kdk::resource::field::value_type::integer);
+    }
+    else if (sema->expect({ kdl::condition(kdl::lexer::token::type::resource_id).truthy() })) {
+        return std::make_tuple(sema->read().text(), kdk::resource::field::value_type::resource_id);
+    }
+    else if (sema->expect({ kdl::condition(kdl::lexer::token::type::string).truthy() })) {
+        return std::make_tuple(sema->read().text(), kdk::resource::field::value_type::string);
+    }
+    else if (sema->expect({ kdl::condition(kdl::lexer::token::type::identifier, "rgb").truthy() })) {
+        sema->ensure({
+            kdl::condition(kdl::lexer::token::type::identifier, "rgb").truthy(),
+            kdl::condition(kdl::lexer::token::type::lparen).truthy()
+        });
+        
+        if (sema->expect({
+            kdl::condition(kdl::lexer::token::type::integer).falsey(),
+            kdl::condition(kdl::lexer::token::type::integer).falsey(),
+            kdl::condition(kdl::lexer::token::type::integer).falsey(),
+            kdl::condition(kdl::lexer::token::type::rparen).falsey()
+        })) {
+            log::error(sema->peek().file(), sema->peek().line(), "Malformed RGB color found.");
+        }
+        
+        auto red = static_cast<uint8_t>(std::stoi(sema->read().text()));
+        auto green = static_cast<uint8_t>(std::stoi(sema->read().text()));
+        auto blue = static_cast<uint8_t>(std::stoi(sema->read().text()));
+        uint32_t rgb = (red << 16) | (green << 8) | (blue);
+        sema->advance();
+        
+        return std::make_tuple(std::to_string(rgb), kdk::resource::field::value_type::color);
+    }
+    else if (sema->expect({ kdl::condition(kdl::lexer::token::type::identifier).truthy() })) {
+        // Symbol names are resolved once the symbol list of the value has been parsed.
+        return std::make_tuple(sema->read().text(), kdk::resource::field::value_type::identifier);
+    }
+    
+    log::error(sema->peek().file(), sema->peek().line(), "Unrecognised default value '" + sema->peek().text() + "'.");
+    throw std::runtime_error("Fatal error whilst resolving default value.");
+}
+
 static inline std::string parse_constant_item(kdl::sema *sema)
 {
     // Specify the name of the directive.
@@ -136,6 +203,8 @@ static inline kdk::assembler::field::value parse_field_value(kdl::sema *sema)
     uint64_t value_length { 0 };
     std::string value_name;
     uint64_t value_offset { 0 };
+    std::tuple<std::string, kdk::resource::field::value_type> value_default;
+    bool has_default = false;
     
     bool length_required = false;
     bool size_required = false;
@@ -169,6 +238,10 @@ static inline kdk::assembler::field::value parse_field_value(kdl::sema *sema)
         else if (attribute == "size") {
             value_size = parse_value_size(sema);
         }
+        else if (attribute == "default") {
+            value_default = parse_default_value(sema);
+            has_default = true;
+        }
         else if (attribute == "type") {
             value_type = parse_value_type(sema);
             
@@ -222,7 +295,11 @@ static inline kdk::assembler::field::value parse_field_value(kdl::sema *sema)
         log::error(file, line, "Expected the 'length' attribute to be specified on type definition field value.");
     }
     
-    return kdk::assembler::field::value(value_name, value_type, value_offset, length_required ? value_length : value_size);
+    auto value = kdk::assembler::field::value(value_name, value_type, value_offset, length_required ? value_length : value_size);
+    if (has_default) {
+        value.set_default_value(std::get<0>(value_default), std::get<1>(value_default));
+    }
+    return value;
 }
 
 static inline void parse_symbol_list(kdl::sema *sema, kdk::assembler::field::value& value)
@@ -240,11 +317,12 @@ static inline void parse_symbol_list(kdl::sema *sema, kdk::assembler::field::val
         
         sema->ensure({ kdl::condition(kdl::lexer::token::type::equals).truthy() });
         
-        // Get the value of the symbol. These are _always_ integers.
-        if (sema->expect({ kdl::condition(kdl::lexer::token::type::integer).falsey() })) {
+        // Get the value of the symbol. These are _always_ integers, but may be negative.
+        if (sema->expect({ kdl::condition(kdl::lexer::token::type::integer).falsey() }) &&
+            sema->expect({ kdl::condition(kdl::lexer::token::type::minus).falsey() })) {
             log::error(sema->peek().file(), sema->peek().line(), "Symbol value should be an integer.");
         }
-        auto symbol_value = sema->read().text();
+        auto symbol_value = parse_integer(sema);
         
         sema->ensure({ kdl::condition(kdl::lexer::token::type::semi_colon).truthy() });
         
@@ -258,6 +336,27 @@ static inline void parse_symbol_list(kdl::sema *sema, kdk::assembler::field::val
 
 // MARK: - Parser
 
+static inline std::tuple<std::string, long> definition_digest(kdl::sema *sema)
+{
+    // The definition extends up to the brace that closes the directive. Nested braces
+    // are balanced.
+    kdk::hasher hasher;
+    long count = 0;
+    long depth = 0;
+    while (!sema->finished(count)) {
+        auto tk = sema->peek(count);
+        if (tk.is_a(kdl::lexer::token::type::lbrace)) {
+            depth++;
+        }
+        else if (tk.is_a(kdl::lexer::token::type::rbrace) && depth-- == 0) {
+            break;
+        }
+        hasher.update(tk.kind()).update(tk.text());
+        count++;
+    }
+    return std::make_tuple(hasher.digest(), count);
+}
+
 void kdl::define_directive::parse(kdl::sema *sema)
 {
     std::string resource_type_name;
@@ -268,6 +367,14 @@ void kdl::define_directive::parse(kdl::sema *sema)
     auto file = sema->peek().file();
     auto line = sema->peek().line();
     
+    // Definitions that were compiled by an earlier build, from identical source, are
+    // reused rather than being parsed and compiled again.
+    auto digest = definition_digest(sema);
+    if (sema->target()->assemblers().reuse_assembler(std::get<0>(digest))) {
+        sema->advance(std::get<1>(digest));
+        return;
+    }
+    
     // Keep going until we encounter the closing brace.
     while (sema->expect({ kdl::condition(kdl::lexer::token::type::rbrace).falsey() })) {
         
@@ -323,6 +430,8 @@ void kdl::define_directive::parse(kdl::sema *sema)
                     }
                 }
                 else if (attribute_name == "value") {
+                    auto value_file = sema->peek().file();
+                    auto value_line = sema->peek().line();
                     auto value = parse_field_value(sema);
                     
                     // Check if there is a symbol list attached.
@@ -330,6 +439,18 @@ void kdl::define_directive::parse(kdl::sema *sema)
                         parse_symbol_list(sema, value);
                     }
                     
+                    // Default values that name a symbol must refer to a symbol of the value.
+                    auto default_value = value.default_value();
+                    if (value.has_default_value() && std::get<1>(default_value) == kdk::resource::field::value_type::identifier) {
+                        auto symbols = value.symbols();
+                        auto it = std::find_if(symbols.begin(), symbols.end(), [&default_value] (const std::tuple<std::string, std::string>& symbol) {
+                            return std::get<0>(symbol) == std::get<0>(default_value);
+                        });
+                        if (it == symbols.end()) {
+                            log::error(value_file, value_line, "The default value '" + std::get<0>(default_value) + "' is not a symbol of the value.");
+                        }
+                    }
+                    
                     field_values.push_back(value);
                 }
                 
@@ -488,6 +609,7 @@ void kdl::define_directive::parse(kdl::sema *sema)
     for (auto reference : resource_references) {
         assembler->add_reference(reference);
     }
-    kdk::assembler_pool::shared().register_assembler(resource_type_name, resource_type_code, assembler);
+    assembler->compile();
+    sema->target()->assemblers().register_assembler(resource_type_name, resource_type_code, assembler, std::get<0>(digest));
     
 }
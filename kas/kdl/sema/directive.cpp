@@ -26,6 +26,7 @@
 #include "kdl/sema/define_directive.hpp"
 #include "diagnostic/log.hpp"
 #include "kdl/lexer.hpp"
+#include "kdl/lexer_cache.hpp"
 
 // MARK: - Parser
 
@@ -45,6 +46,7 @@ void kdl::directive::parse(kdl::sema *sema)
     
     // Directive structure: @directive { <args> }
     auto directive = sema->read().text();
+    std::vector<kdl::lexer::token> imported_tokens;
     
     if (sema->expect(condition(kdl::lexer::token::type::lbrace).falsey())) {
         auto tk = sema->peek();
@@ -71,11 +73,11 @@ void kdl::directive::parse(kdl::sema *sema)
         auto args = sema->consume(condition(kdl::lexer::token::type::rbrace).falsey());
         
         // The `@import` directive imports the contents of another file and inserts it
-        // into the current token stream.
+        // into the current token stream, once the directive has been closed.
         for (auto a : args) {
-            auto lexer = kdl::lexer::open_file(a.text());
-            auto tokens = lexer.analyze();
-            sema->insert_tokens(tokens);
+            auto tokens = kdl::lexer_cache::shared().analyze(a.text());
+            imported_tokens.insert(imported_tokens.end(), tokens.begin(), tokens.end());
+            sema->target()->add_dependency(a.text());
         }
     }
     else {
@@ -87,4 +89,8 @@ void kdl::directive::parse(kdl::sema *sema)
         log::error(tk.file(), tk.line(), "Expected '}' whilst finishing directive, but found '" + tk.text() + "' instead.");
     }
     sema->advance();
+    
+    if (!imported_tokens.empty()) {
+        sema->insert_tokens(imported_tokens);
+    }
 }
@@ -0,0 +1,224 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <cstring>
+#include <algorithm>
+#include "kestrel/compression.hpp"
+
+// MARK: - Constants
+
+// A match must be at least four bytes long, and may be at most 64KiB behind the bytes it
+// replaces. The last five bytes of a block are always literals, and no match may begin
+// within the last twelve bytes, so that decoders may copy in wide chunks.
+static const std::size_t min_match = 4;
+static const std::size_t max_offset = 0xFFFF;
+static const std::size_t last_literals = 5;
+static const std::size_t match_find_limit = 12;
+static const std::size_t min_input = 32;
+
+// MARK: - Helpers
+
+static inline uint32_t read_u32(const uint8_t *p)
+{
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hash_sequence(uint32_t sequence, unsigned bits)
+{
+    return (sequence * 2654435761U) >> (32 - bits);
+}
+
+static inline void put_length(std::vector<char>& block, std::size_t length)
+{
+    for (; length >= 255; length -= 255) {
+        block.push_back(static_cast<char>(255));
+    }
+    block.push_back(static_cast<char>(length));
+}
+
+static inline void put_sequence(std::vector<char>& block, const uint8_t *literals, std::size_t literal_count, std::size_t offset, std::size_t match_length)
+{
+    // A sequence is a token holding the literal and match lengths, any extra length
+    // bytes, the literals themselves and then the match offset. The final sequence of a
+    // block has literals only.
+    auto extra = match_length >= min_match ? match_length - min_match : 0;
+    block.push_back(static_cast<char>((std::min<std::size_t>(literal_count, 15) << 4) | std::min<std::size_t>(extra, 15)));
+    if (literal_count >= 15) {
+        put_length(block, literal_count - 15);
+    }
+    block.insert(block.end(), literals, literals + literal_count);
+    if (match_length == 0) {
+        return;
+    }
+    block.push_back(static_cast<char>(offset & 0xFF));
+    block.push_back(static_cast<char>(offset >> 8));
+    if (extra >= 15) {
+        put_length(block, extra - 15);
+    }
+}
+
+static inline bool get_length(const uint8_t *block, std::size_t block_size, std::size_t& position, std::size_t& length)
+{
+    uint8_t byte;
+    do {
+        if (position >= block_size) {
+            return false;
+        }
+        byte = block[position++];
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+// MARK: - Compression
+
+bool kdk::kestrel::compress(const char *source, std::size_t size, std::vector<char>& block, std::size_t limit)
+{
+    block.clear();
+    if (size < min_input || size > UINT32_MAX) {
+        return false;
+    }
+    
+    // The hash table holds the most recent position of each hashed four byte sequence. It
+    // is sized to the input, so that small resources do not pay for a large table.
+    unsigned bits = 8;
+    while (bits < 16 && (std::size_t(1) << bits) < size) {
+        ++bits;
+    }
+    std::vector<uint32_t> table(std::size_t(1) << bits, 0);
+    
+    auto in = reinterpret_cast<const uint8_t *>(source);
+    std::size_t anchor = 0;
+    std::size_t position = 0;
+    auto match_end_limit = size - last_literals;
+    auto search_limit = size - match_find_limit;
+    
+    while (position <= search_limit) {
+        auto sequence = read_u32(in + position);
+        auto& slot = table[hash_sequence(sequence, bits)];
+        std::size_t candidate = slot;
+        slot = static_cast<uint32_t>(position);
+        
+        if (candidate >= position || position - candidate > max_offset || read_u32(in + candidate) != sequence) {
+            // Incompressible runs are skipped over increasingly quickly.
+            position += 1 + ((position - anchor) >> 6);
+            continue;
+        }
+        
+        while (position > anchor && candidate > 0 && in[position - 1] == in[candidate - 1]) {
+            --position;
+            --candidate;
+        }
+        auto length = min_match;
+        while (position + length < match_end_limit && in[position + length] == in[candidate + length]) {
+            ++length;
+        }
+        
+        put_sequence(block, in + anchor, position - anchor, position - candidate, length);
+        if (block.size() > limit) {
+            return false;
+        }
+        
+        position += length;
+        anchor = position;
+        if (position <= search_limit) {
+            table[hash_sequence(read_u32(in + position - 2), bits)] = static_cast<uint32_t>(position - 2);
+        }
+    }
+    
+    put_sequence(block, in + anchor, size - anchor, 0, 0);
+    return block.size() <= limit;
+}
+
+// MARK: - Decompression
+
+bool kdk::kestrel::decompress(const char *block, std::size_t block_size, char *destination, std::size_t size)
+{
+    auto in = reinterpret_cast<const uint8_t *>(block);
+    auto out = reinterpret_cast<uint8_t *>(destination);
+    std::size_t position = 0;
+    std::size_t written = 0;
+    
+    while (position < block_size) {
+        auto token = in[position++];
+        
+        std::size_t literal_count = token >> 4;
+        if (literal_count == 15 && !get_length(in, block_size, position, literal_count)) {
+            return false;
+        }
+        if (literal_count > block_size - position || literal_count > size - written) {
+            return false;
+        }
+        if (literal_count <= 16 && block_size - position >= 16 && size - written >= 16) {
+            // Short runs of literals are copied as a fixed sixteen bytes, which is much
+            // faster than a copy of variable length. The excess is overwritten later.
+            std::memcpy(out + written, in + position, 16);
+        }
+        else {
+            std::memcpy(out + written, in + position, literal_count);
+        }
+        position += literal_count;
+        written += literal_count;
+        
+        // The final sequence has no match.
+        if (position == block_size) {
+            break;
+        }
+        
+        if (block_size - position < 2) {
+            return false;
+        }
+        std::size_t offset = in[position] | (in[position + 1] << 8);
+        position += 2;
+        
+        std::size_t length = token & 0xF;
+        if (length == 15 && !get_length(in, block_size, position, length)) {
+            return false;
+        }
+        length += min_match;
+        if (offset == 0 || offset > written || length > size - written) {
+            return false;
+        }
+        
+        // A match may overlap the bytes it produces, in which case it repeats them. Copies
+        // of eight bytes never overlap when the offset is at least that large.
+        auto from = out + written - offset;
+        auto to = out + written;
+        written += length;
+        if (offset >= 16 && length <= 16 && size - (to - out) >= 16) {
+            std::memcpy(to, from, 16);
+            continue;
+        }
+        if (offset >= 8) {
+            for (; length >= 8; length -= 8, from += 8, to += 8) {
+                std::memcpy(to, from, 8);
+            }
+        }
+        while (length-- > 0) {
+            *to++ = *from++;
+        }
+    }
+    
+    return written == size;
+}
@@ -0,0 +1,54 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#if !defined(KDK_KESTREL_COMPRESSION)
+#define KDK_KESTREL_COMPRESSION
+
+namespace kdk
+{
+
+namespace kestrel
+{
+
+/**
+ * Compress the specified bytes into an LZ4 block, replacing the contents of `block`.
+ * Compression is abandoned, and false is returned, if the block would be longer than
+ * the specified limit. Inputs that are too short to benefit are never compressed.
+ */
+bool compress(const char *source, std::size_t size, std::vector<char>& block, std::size_t limit);
+
+/**
+ * Decompress an LZ4 block into exactly `size` bytes at the destination. Returns false
+ * if the block is malformed or does not decompress to exactly that many bytes. The
+ * block is never read, nor the destination written, out of bounds.
+ */
+bool decompress(const char *block, std::size_t block_size, char *destination, std::size_t size);
+
+};
+
+};
+
+#endif
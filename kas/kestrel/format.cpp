@@ -0,0 +1,55 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "kestrel/format.hpp"
+#include "output/macroman.hpp"
+
+// MARK: - Type Codes
+
+bool kdk::kestrel::pack_type_code(const std::string& code, uint32_t& packed)
+{
+    auto bytes = kdk::macroman::from_utf8(code);
+    if (bytes.size() != 4) {
+        return false;
+    }
+    
+    packed = 0;
+    for (auto c : bytes) {
+        packed = (packed << 8) | static_cast<uint8_t>(c);
+    }
+    return true;
+}
+
+// MARK: - Hashing
+
+uint64_t kdk::kestrel::name_hash(uint32_t type, const char *name, std::size_t length)
+{
+    // 64-bit FNV-1a of the type code, most significant byte first, followed by the name.
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (auto shift = 24; shift >= 0; shift -= 8) {
+        hash = (hash ^ ((type >> shift) & 0xFF)) * 0x100000001B3ULL;
+    }
+    for (std::size_t n = 0; n < length; ++n) {
+        hash = (hash ^ static_cast<uint8_t>(name[n])) * 0x100000001B3ULL;
+    }
+    return hash;
+}
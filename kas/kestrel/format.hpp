@@ -0,0 +1,137 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <cstdint>
+
+#if !defined(KDK_KESTREL_FORMAT)
+#define KDK_KESTREL_FORMAT
+
+namespace kdk
+{
+
+/**
+ * The layout of the indexed Kestrel data file. The file is designed to be mapped into
+ * memory and used in place: resources are found by binary search of a sorted index, or
+ * through a hash table of names, and their data is read directly from the mapping.
+ *
+ * Every value is little-endian. The file begins with a header, followed by the data of
+ * each resource, the resource index, the type table, the name table and the names. See
+ * `documentation/kestrel-format.md` for the complete description.
+ */
+namespace kestrel
+{
+
+/**
+ * The identifying bytes at the start of every Kestrel data file.
+ */
+static const char magic[8] = { 'K', 'E', 'S', 'T', 'R', 'E', 'L', '\0' };
+
+/**
+ * The version of the format described here.
+ */
+static const uint32_t version = 1;
+
+/**
+ * The alignment of the data of each resource within the file.
+ */
+static const uint32_t data_alignment = 16;
+
+/**
+ * The flag of the header that is set if the data of any resource is compressed.
+ */
+static const uint32_t file_has_compressed_resources = 1 << 0;
+
+/**
+ * The flag of a resource entry that is set if its data is compressed. Compressed data
+ * is the decompressed size, as a 64-bit value, followed by an LZ4 block.
+ */
+static const uint32_t resource_compressed = 1 << 0;
+
+/**
+ * The header at the start of the file, locating each of its tables.
+ */
+struct header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t file_size;
+    uint64_t resource_count;
+    uint64_t index_offset;
+    uint64_t type_count;
+    uint64_t type_offset;
+    uint64_t name_slot_count;
+    uint64_t name_table_offset;
+    uint64_t names_offset;
+    uint64_t names_size;
+    uint32_t data_alignment;
+    uint32_t reserved;
+};
+static_assert(sizeof(header) == 96, "The Kestrel header must be 96 bytes.");
+
+/**
+ * An entry of the type table, giving the range of the resource index that holds the
+ * resources of a type. Entries are sorted by type code.
+ */
+struct type_entry
+{
+    uint32_t code;
+    uint32_t reserved;
+    uint64_t first;
+    uint64_t count;
+};
+static_assert(sizeof(type_entry) == 24, "A Kestrel type entry must be 24 bytes.");
+
+/**
+ * An entry of the resource index. Entries are sorted by type code and then by id.
+ */
+struct resource_entry
+{
+    uint32_t type;
+    uint32_t flags;
+    int64_t id;
+    uint64_t data_offset;
+    uint64_t data_size;
+    uint32_t name_offset;
+    uint32_t name_length;
+};
+static_assert(sizeof(resource_entry) == 40, "A Kestrel resource entry must be 40 bytes.");
+
+/**
+ * Pack a four character type code, given in UTF-8 and stored in MacRoman, into the
+ * value used by the file. The first character is the most significant byte, so that
+ * codes sort in the same order as their characters. Returns false if the code is not
+ * four characters long.
+ */
+bool pack_type_code(const std::string& code, uint32_t& packed);
+
+/**
+ * Returns the hash of a resource name, used to place the resource in the name table.
+ */
+uint64_t name_hash(uint32_t type, const char *name, std::size_t length);
+
+};
+
+};
+
+#endif
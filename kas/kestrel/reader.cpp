@@ -0,0 +1,230 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include "kestrel/reader.hpp"
+#include "kestrel/compression.hpp"
+#include "output/macroman.hpp"
+#include "diagnostic/log.hpp"
+
+// MARK: - Constructor
+
+kdk::kestrel_reader::kestrel_reader(const std::string& path)
+    : m_path(path)
+{
+    const uint16_t probe = 1;
+    if (*reinterpret_cast<const uint8_t *>(&probe) != 1) {
+        log::error(m_path, 0, "Kestrel data files can only be read on little-endian hosts.");
+    }
+    
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd < 0 || ::fstat(fd, &info) != 0) {
+        auto reason = std::string(strerror(errno));
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        log::error(m_path, 0, "Unable to open the Kestrel data file: " + reason);
+    }
+    
+    m_size = static_cast<uint64_t>(info.st_size);
+    if (m_size >= sizeof(kdk::kestrel::header)) {
+        auto mapping = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        m_base = mapping == MAP_FAILED ? nullptr : static_cast<const char *>(mapping);
+    }
+    ::close(fd);
+    
+    // Only the header and the extents of the tables are validated. Entries are checked
+    // as they are used.
+    m_header = reinterpret_cast<const kdk::kestrel::header *>(m_base);
+    if (!m_base
+        || std::memcmp(m_header->magic, kdk::kestrel::magic, sizeof(kdk::kestrel::magic)) != 0
+        || m_header->version != kdk::kestrel::version
+        || (m_header->flags & ~kdk::kestrel::file_has_compressed_resources) != 0
+        || m_header->file_size != m_size
+        || !contains(m_header->index_offset, m_header->resource_count, sizeof(kdk::kestrel::resource_entry))
+        || !contains(m_header->type_offset, m_header->type_count, sizeof(kdk::kestrel::type_entry))
+        || !contains(m_header->name_table_offset, m_header->name_slot_count, sizeof(uint64_t))
+        || !contains(m_header->names_offset, m_header->names_size, 1)
+        || (m_header->name_slot_count & (m_header->name_slot_count - 1)) != 0
+        || (m_header->names_size > 0 && m_base[m_header->names_offset + m_header->names_size - 1] != '\0'))
+    {
+        log::error(m_path, 0, "The file is not a valid Kestrel data file.");
+    }
+    
+    m_resources = reinterpret_cast<const kdk::kestrel::resource_entry *>(m_base + m_header->index_offset);
+    m_types = reinterpret_cast<const kdk::kestrel::type_entry *>(m_base + m_header->type_offset);
+    m_name_slots = reinterpret_cast<const uint64_t *>(m_base + m_header->name_table_offset);
+    m_names = m_base + m_header->names_offset;
+}
+
+kdk::kestrel_reader::~kestrel_reader()
+{
+    if (m_base) {
+        ::munmap(const_cast<char *>(m_base), m_size);
+    }
+}
+
+bool kdk::kestrel_reader::contains(uint64_t offset, uint64_t count, uint64_t size) const
+{
+    // Tables must be aligned to 8 bytes, so that their entries may be used in place.
+    return offset % 8 == 0 && offset <= m_size && count <= (m_size - offset) / size;
+}
+
+// MARK: - Look-up
+
+std::size_t kdk::kestrel_reader::resource_count() const
+{
+    return m_header->resource_count;
+}
+
+const kdk::kestrel::resource_entry& kdk::kestrel_reader::resource(std::size_t index) const
+{
+    return m_resources[index];
+}
+
+const kdk::kestrel::type_entry *kdk::kestrel_reader::find_type(const std::string& type) const
+{
+    uint32_t code;
+    if (!kdk::kestrel::pack_type_code(type, code)) {
+        return nullptr;
+    }
+    
+    auto end = m_types + m_header->type_count;
+    auto it = std::lower_bound(m_types, end, code, [] (const kdk::kestrel::type_entry& entry, uint32_t code) {
+        return entry.code < code;
+    });
+    if (it == end || it->code != code || it->first > m_header->resource_count || it->count > m_header->resource_count - it->first) {
+        return nullptr;
+    }
+    return it;
+}
+
+const kdk::kestrel::resource_entry *kdk::kestrel_reader::find(const std::string& type, int64_t id) const
+{
+    auto type_entry = find_type(type);
+    if (!type_entry) {
+        return nullptr;
+    }
+    
+    auto first = m_resources + type_entry->first;
+    auto end = first + type_entry->count;
+    auto it = std::lower_bound(first, end, id, [] (const kdk::kestrel::resource_entry& entry, int64_t id) {
+        return entry.id < id;
+    });
+    return it != end && it->id == id ? it : nullptr;
+}
+
+const kdk::kestrel::resource_entry *kdk::kestrel_reader::find(const std::string& type, const std::string& name) const
+{
+    uint32_t code;
+    auto slot_count = m_header->name_slot_count;
+    if (slot_count == 0 || name.empty() || !kdk::kestrel::pack_type_code(type, code)) {
+        return nullptr;
+    }
+    
+    // The table is never full, so probing always reaches an empty slot.
+    auto slot = kdk::kestrel::name_hash(code, name.data(), name.size()) & (slot_count - 1);
+    for (uint64_t probes = 0; probes < slot_count && m_name_slots[slot] != 0; ++probes) {
+        auto index = m_name_slots[slot] - 1;
+        if (index < m_header->resource_count) {
+            const auto& entry = m_resources[index];
+            auto entry_name = this->name(entry);
+            if (entry.type == code && entry_name && entry.name_length == name.size() && std::memcmp(entry_name, name.data(), name.size()) == 0) {
+                return &entry;
+            }
+        }
+        slot = (slot + 1) & (slot_count - 1);
+    }
+    return nullptr;
+}
+
+// MARK: - Resources
+
+std::string kdk::kestrel_reader::type(const kdk::kestrel::resource_entry& resource) const
+{
+    std::string code;
+    for (auto shift = 24; shift >= 0; shift -= 8) {
+        code.push_back(static_cast<char>(resource.type >> shift));
+    }
+    return kdk::macroman::to_utf8(code);
+}
+
+const char *kdk::kestrel_reader::name(const kdk::kestrel::resource_entry& resource) const
+{
+    if (resource.name_offset > m_header->names_size || resource.name_length >= m_header->names_size - resource.name_offset) {
+        return nullptr;
+    }
+    return m_names + resource.name_offset;
+}
+
+const char *kdk::kestrel_reader::data(const kdk::kestrel::resource_entry& resource) const
+{
+    if (resource.data_offset > m_size || resource.data_size > m_size - resource.data_offset) {
+        return nullptr;
+    }
+    return m_base + resource.data_offset;
+}
+
+bool kdk::kestrel_reader::compressed(const kdk::kestrel::resource_entry& resource) const
+{
+    return (resource.flags & kdk::kestrel::resource_compressed) != 0;
+}
+
+uint64_t kdk::kestrel_reader::size(const kdk::kestrel::resource_entry& resource) const
+{
+    auto bytes = data(resource);
+    if (!bytes) {
+        return 0;
+    }
+    if (!compressed(resource)) {
+        return resource.data_size;
+    }
+    
+    uint64_t size = 0;
+    if (resource.data_size < sizeof(size)) {
+        return 0;
+    }
+    std::memcpy(&size, bytes, sizeof(size));
+    return size;
+}
+
+bool kdk::kestrel_reader::read(const kdk::kestrel::resource_entry& resource, char *destination) const
+{
+    auto bytes = data(resource);
+    if (!bytes) {
+        return false;
+    }
+    if (!compressed(resource)) {
+        std::memcpy(destination, bytes, resource.data_size);
+        return true;
+    }
+    
+    auto size = this->size(resource);
+    return resource.data_size >= sizeof(size) && kdk::kestrel::decompress(bytes + sizeof(size), resource.data_size - sizeof(size), destination, size);
+}
@@ -0,0 +1,141 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <cstdint>
+#include "kestrel/format.hpp"
+
+#if !defined(KDK_KESTREL_READER)
+#define KDK_KESTREL_READER
+
+namespace kdk
+{
+
+/**
+ * The Kestrel reader maps a Kestrel data file into memory and finds resources within
+ * it in place. Opening a file only validates its header; nothing is parsed or copied.
+ * Resources are found by binary search of the index, or through the name table, and
+ * their names and data are returned as pointers into the mapping. Compressed resources
+ * are decompressed by `read`.
+ *
+ * The reader requires a little-endian host, as the tables of the file are used
+ * directly.
+ */
+class kestrel_reader
+{
+public:
+    kestrel_reader(const kestrel_reader&) = delete;
+    kestrel_reader& operator=(const kestrel_reader &) = delete;
+    
+    /**
+     * Map the Kestrel data file at the specified path. It is an error if the file can
+     * not be mapped or is not a valid Kestrel data file.
+     */
+    kestrel_reader(const std::string& path);
+    
+    /**
+     * Unmap the file.
+     */
+    ~kestrel_reader();
+    
+    /**
+     * Returns the number of resources in the file.
+     */
+    std::size_t resource_count() const;
+    
+    /**
+     * Returns the resource at the specified position of the index.
+     */
+    const kdk::kestrel::resource_entry& resource(std::size_t index) const;
+    
+    /**
+     * Returns the resource of the specified type with the specified id, or `nullptr` if
+     * there is no such resource.
+     */
+    const kdk::kestrel::resource_entry *find(const std::string& type, int64_t id) const;
+    
+    /**
+     * Returns the resource of the specified type with the specified name, or `nullptr`
+     * if there is no such resource.
+     */
+    const kdk::kestrel::resource_entry *find(const std::string& type, const std::string& name) const;
+    
+    /**
+     * Returns the type code of the resource in UTF-8.
+     */
+    std::string type(const kdk::kestrel::resource_entry& resource) const;
+    
+    /**
+     * Returns the NUL terminated name of the resource, or `nullptr` if the entry is
+     * invalid.
+     */
+    const char *name(const kdk::kestrel::resource_entry& resource) const;
+    
+    /**
+     * Returns the data of the resource as it is stored in the file, or `nullptr` if the
+     * entry is invalid. The data is aligned to `kdk::kestrel::data_alignment` bytes. The
+     * stored data of a compressed resource must be decompressed with `read`.
+     */
+    const char *data(const kdk::kestrel::resource_entry& resource) const;
+    
+    /**
+     * Returns true if the data of the resource is compressed.
+     */
+    bool compressed(const kdk::kestrel::resource_entry& resource) const;
+    
+    /**
+     * Returns the size of the data of the resource once decompressed, or zero if the
+     * entry is invalid.
+     */
+    uint64_t size(const kdk::kestrel::resource_entry& resource) const;
+    
+    /**
+     * Copy the data of the resource to the destination, decompressing it if necessary.
+     * The destination must have room for `size(resource)` bytes. Returns false if the
+     * entry or its compressed data is invalid.
+     */
+    bool read(const kdk::kestrel::resource_entry& resource, char *destination) const;
+    
+private:
+    std::string m_path;
+    const char *m_base { nullptr };
+    uint64_t m_size { 0 };
+    const kdk::kestrel::header *m_header { nullptr };
+    const kdk::kestrel::resource_entry *m_resources { nullptr };
+    const kdk::kestrel::type_entry *m_types { nullptr };
+    const uint64_t *m_name_slots { nullptr };
+    const char *m_names { nullptr };
+    
+    /**
+     * Returns the entry of the type table for the specified type, or `nullptr`.
+     */
+    const kdk::kestrel::type_entry *find_type(const std::string& type) const;
+    
+    /**
+     * Returns true if the table at the specified offset lies entirely within the file.
+     */
+    bool contains(uint64_t offset, uint64_t count, uint64_t size) const;
+};
+
+};
+
+#endif
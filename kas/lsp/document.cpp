@@ -0,0 +1,396 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include "lsp/document.hpp"
+#include "diagnostic/log.hpp"
+
+// MARK: - Helpers
+
+static inline kdk::document::diagnostic lexer_diagnostic(const std::string& path, const std::string& what)
+{
+    // Errors are described as `path:L<line>: message`.
+    auto prefix = path + ":L";
+    if (what.compare(0, prefix.size(), prefix) != 0) {
+        return { -1, true, what };
+    }
+    auto line = std::atoi(what.c_str() + prefix.size());
+    auto message = what.find(": ", prefix.size());
+    return { line, true, message == std::string::npos ? what : what.substr(message + 2) };
+}
+
+// MARK: - Blocks
+
+int kdk::document::block::line_of(const kdl::lexer::token& token) const
+{
+    return token.line() - 1 + bias;
+}
+
+// MARK: - Constructor
+
+kdk::document::document(const std::string& path, const std::string& text)
+    : m_path(path)
+{
+    replace(text);
+}
+
+// MARK: - Accessors
+
+const std::string& kdk::document::path() const
+{
+    return m_path;
+}
+
+const std::string& kdk::document::text() const
+{
+    return m_text;
+}
+
+int kdk::document::line_count() const
+{
+    return static_cast<int>(m_lines.size());
+}
+
+std::vector<kdk::document::block>& kdk::document::blocks()
+{
+    return m_blocks;
+}
+
+const std::vector<kdk::document::block>& kdk::document::blocks() const
+{
+    return m_blocks;
+}
+
+long kdk::document::block_at(int line) const
+{
+    auto it = std::upper_bound(m_blocks.begin(), m_blocks.end(), line, [] (int line, const kdk::document::block& block) {
+        return line < block.first_line;
+    });
+    return static_cast<long>(it - m_blocks.begin()) - 1;
+}
+
+int kdk::document::lexed_lines() const
+{
+    return m_lexed_lines;
+}
+
+std::size_t kdk::document::offset_of(int line, int column) const
+{
+    if (line < 0) {
+        return 0;
+    }
+    if (line >= m_lines.size()) {
+        return m_text.size();
+    }
+    return std::min(m_lines[line] + std::max(column, 0), end_of_line(line));
+}
+
+std::size_t kdk::document::end_of_line(int line) const
+{
+    return line + 1 < m_lines.size() ? m_lines[line + 1] : m_text.size();
+}
+
+// MARK: - Editing
+
+void kdk::document::replace(const std::string& text)
+{
+    m_text = text;
+    m_lines.assign(1, 0);
+    for (std::size_t i = 0; i < m_text.size(); ++i) {
+        if (m_text[i] == '\n') {
+            m_lines.push_back(i + 1);
+        }
+    }
+    
+    m_blocks.clear();
+    relex(0, 0);
+}
+
+bool kdk::document::edit(int start_line, int start_column, int end_line, int end_column, const std::string& text)
+{
+    auto last_line = line_count() - 1;
+    start_line = std::max(0, std::min(start_line, last_line));
+    end_line = std::max(start_line, std::min(end_line, last_line));
+    auto start = offset_of(start_line, start_column);
+    auto end = std::max(start, offset_of(end_line, end_column));
+    
+    // Apply the edit to the text, and then to the line table. Only the lines of the edit
+    // are replaced, and the lines that follow it are moved.
+    m_text.replace(start, end - start, text);
+    
+    std::vector<std::size_t> inserted;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\n') {
+            inserted.push_back(start + i + 1);
+        }
+    }
+    
+    auto delta = static_cast<long>(text.size()) - static_cast<long>(end - start);
+    for (auto i = end_line + 1; i < m_lines.size(); ++i) {
+        m_lines[i] += delta;
+    }
+    m_lines.erase(m_lines.begin() + start_line + 1, m_lines.begin() + end_line + 1);
+    m_lines.insert(m_lines.begin() + start_line + 1, inserted.begin(), inserted.end());
+    auto line_delta = static_cast<int>(inserted.size()) - (end_line - start_line);
+    
+    // Find the blocks that the edit touched, and move the blocks that follow them.
+    auto first = std::lower_bound(m_blocks.begin(), m_blocks.end(), start_line, [] (const kdk::document::block& block, int line) {
+        return block.last_line < line;
+    }) - m_blocks.begin();
+    auto last = std::upper_bound(m_blocks.begin(), m_blocks.end(), end_line, [] (int line, const kdk::document::block& block) {
+        return line < block.first_line;
+    }) - m_blocks.begin();
+    
+    if (line_delta != 0) {
+        for (auto i = last; i < m_blocks.size(); ++i) {
+            m_blocks[i].first_line += line_delta;
+            m_blocks[i].last_line += line_delta;
+            m_blocks[i].bias += line_delta;
+        }
+    }
+    
+    return relex(first, std::max(first, last));
+}
+
+bool kdk::document::relex(std::size_t first, std::size_t last)
+{
+    // A construct left incomplete before the region may continue into it, as may one
+    // that only a line of unrecognised characters separates from the region.
+    while (first > 0 && (!m_blocks[first - 1].complete || m_blocks[first - 1].tokens.empty())) {
+        first--;
+    }
+    
+    auto directives_changed = false;
+    for (auto i = first; i < last; ++i) {
+        directives_changed |= m_blocks[i].has_directive;
+    }
+    
+    auto scope = first > 0 ? m_blocks[first - 1].scope_after : "";
+    auto expected = last > first ? m_blocks[last - 1].scope_after : scope;
+    
+    std::vector<kdk::document::block> blocks;
+    std::vector<kdk::document::diagnostic> lexer_diagnostics;
+    int first_line = 0;
+    int last_line = 0;
+    while (true) {
+        first_line = first > 0 ? m_blocks[first - 1].last_line + 1 : 0;
+        last_line = last < m_blocks.size() ? m_blocks[last].first_line - 1 : line_count() - 1;
+        
+        // Unrecognised characters are reported and skipped, so that the rest of the
+        // region can still be analysed.
+        std::vector<kdl::lexer::token> tokens;
+        lexer_diagnostics.clear();
+        if (first_line <= last_line) {
+            auto start = m_lines[first_line];
+            kdl::lexer lexer { m_path, m_text.substr(start, end_of_line(last_line) - start), first_line };
+            while (true) {
+                try {
+                    tokens = lexer.analyze();
+                    break;
+                }
+                catch (const log::fatal_error& error) {
+                    lexer_diagnostics.push_back(lexer_diagnostic(m_path, error.what()));
+                    lexer.skip();
+                }
+            }
+        }
+        blocks = split(std::move(tokens), scope);
+        
+        // If the region ends part way through a construct, or in or out of a declaration
+        // when the blocks that follow it expect otherwise, then the next block must be
+        // lexed with it.
+        auto after = blocks.empty() ? scope : blocks.back().scope_after;
+        auto incomplete = !blocks.empty() && !blocks.back().complete;
+        if ((incomplete || after.empty() != expected.empty()) && last < m_blocks.size()) {
+            directives_changed |= m_blocks[last].has_directive;
+            expected = m_blocks[last].scope_after;
+            last++;
+            continue;
+        }
+        break;
+    }
+    
+    // Lexer diagnostics belong to the block containing their line. A line without any
+    // tokens is given a block of its own.
+    for (const auto& diagnostic : lexer_diagnostics) {
+        auto line = std::max(first_line, std::min(diagnostic.line - 1, last_line));
+        auto it = std::find_if(blocks.begin(), blocks.end(), [line] (const kdk::document::block& block) {
+            return block.last_line >= line;
+        });
+        if (it == blocks.end() || it->first_line > line) {
+            kdk::document::block block;
+            block.first_line = block.last_line = line;
+            block.scope_before = block.scope_after = it == blocks.begin() ? scope : (it - 1)->scope_after;
+            it = blocks.insert(it, block);
+        }
+        it->lexer_diagnostics.push_back(diagnostic);
+    }
+    
+    m_lexed_lines = std::max(0, last_line - first_line + 1);
+    for (const auto& block : blocks) {
+        directives_changed |= block.has_directive;
+    }
+    
+    auto after = blocks.empty() ? scope : blocks.back().scope_after;
+    auto next = first + blocks.size();
+    m_blocks.erase(m_blocks.begin() + first, m_blocks.begin() + last);
+    m_blocks.insert(m_blocks.begin() + first, std::make_move_iterator(blocks.begin()), std::make_move_iterator(blocks.end()));
+    
+    // If the name of the declaration changed, then the blocks that belong to it must be
+    // analysed again, but their tokens are unchanged.
+    if (after != expected) {
+        for (auto i = next; i < m_blocks.size(); ++i) {
+            m_blocks[i].dirty = true;
+            m_blocks[i].scope_before = after;
+            if (!m_blocks[i].inherits_scope) {
+                break;
+            }
+            m_blocks[i].scope_after = after;
+        }
+    }
+    
+    return directives_changed;
+}
+
+// MARK: - Blocks
+
+std::vector<kdk::document::block> kdk::document::split(std::vector<kdl::lexer::token> tokens, const std::string& scope) const
+{
+    enum construct { none, directive, declaration, instance, closing, unexpected };
+    
+    std::vector<kdk::document::block> blocks;
+    kdk::document::block current;
+    auto kind = none;
+    auto current_scope = scope;
+    auto depth = 0;
+    auto opened = false;
+    
+    auto finish = [&] (bool complete) {
+        current.complete = complete;
+        current.scope_after = current_scope;
+        
+        // Blocks that share a line are merged.
+        if (!blocks.empty() && blocks.back().last_line == current.first_line) {
+            auto& previous = blocks.back();
+            previous.tokens.insert(previous.tokens.end(), current.tokens.begin(), current.tokens.end());
+            previous.last_line = current.last_line;
+            previous.scope_after = current.scope_after;
+            previous.complete = current.complete;
+            previous.has_directive |= current.has_directive;
+            previous.inherits_scope &= current.inherits_scope;
+        }
+        else {
+            blocks.push_back(std::move(current));
+        }
+        
+        current = kdk::document::block();
+        kind = none;
+    };
+    
+    for (auto i = 0; i < tokens.size(); ++i) {
+        const auto& token = tokens[i];
+        auto is_directive = token.is_a(kdl::lexer::token::type::directive);
+        auto is_declare = token.is_a(kdl::lexer::token::type::identifier) && token.text() == "declare";
+        auto is_new = token.is_a(kdl::lexer::token::type::identifier) && token.text() == "new";
+        
+        // A construct that is interrupted by the start of a directive, declaration or
+        // unassigned resource instance is unterminated. Ending it there prevents the
+        // remainder of the document from being consumed by it.
+        if (kind != none) {
+            auto nested_instance = i > 0 && tokens[i - 1].is_a(kdl::lexer::token::type::equals);
+            if (is_directive || is_declare || (kind == instance && is_new && depth > 0 && !nested_instance)) {
+                finish(false);
+            }
+        }
+        
+        if (kind == none) {
+            current.first_line = token.line() - 1;
+            current.scope_before = current_scope;
+            depth = 0;
+            opened = false;
+            
+            if (is_directive) {
+                kind = directive;
+                current.has_directive = true;
+            }
+            else if (is_declare) {
+                kind = declaration;
+            }
+            else if (!current_scope.empty() && token.is_a(kdl::lexer::token::type::rbrace)) {
+                kind = closing;
+            }
+            else if (!current_scope.empty() && is_new) {
+                kind = instance;
+            }
+            else {
+                kind = unexpected;
+            }
+        }
+        
+        current.tokens.push_back(token);
+        current.last_line = token.line() - 1;
+        
+        switch (kind) {
+            case declaration: {
+                // The declaration is opened by `declare Type {`.
+                if (token.is_a(kdl::lexer::token::type::lbrace)) {
+                    auto count = current.tokens.size();
+                    current_scope = count >= 2 ? current.tokens[count - 2].text() : "";
+                    current.inherits_scope = false;
+                    finish(true);
+                }
+                break;
+            }
+            case closing: {
+                current_scope = "";
+                current.inherits_scope = false;
+                finish(true);
+                break;
+            }
+            case directive:
+            case instance: {
+                if (token.is_a(kdl::lexer::token::type::lbrace)) {
+                    depth++;
+                    opened = true;
+                }
+                else if (token.is_a(kdl::lexer::token::type::rbrace)) {
+                    depth--;
+                }
+                if (opened && depth <= 0) {
+                    finish(true);
+                }
+                break;
+            }
+            default: {
+                finish(true);
+                break;
+            }
+        }
+    }
+    
+    if (kind != none) {
+        finish(false);
+    }
+    
+    return blocks;
+}
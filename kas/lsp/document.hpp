@@ -0,0 +1,209 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <tuple>
+#include "kdl/lexer.hpp"
+#include "assemblers/assembler.hpp"
+
+#if !defined(KDK_LSP_DOCUMENT)
+#define KDK_LSP_DOCUMENT
+
+namespace kdk
+{
+
+/**
+ * A document is a KDL source file that is open in an editor. The document keeps its
+ * text along with a table of the offset of each line, and divides its tokens into
+ * blocks that can be lexed and analysed independently of one another.
+ *
+ * Each directive is a block, as is each resource instance of a declaration, and the
+ * lines that open and close the declaration. Blocks that share a line are merged, so
+ * that every block spans whole lines. When the document is edited, only the lines
+ * between the blocks either side of the edit are lexed again, extended to further
+ * blocks if the edit leaves a block unterminated or changes the declaration that the
+ * blocks which follow belong to.
+ */
+class document
+{
+public:
+    
+    /**
+     * A diagnostic produced by analysing a block. The line is the line reported by the
+     * token it refers to, or -1 if the diagnostic refers to the block as a whole.
+     */
+    struct diagnostic
+    {
+    public:
+        int line;
+        bool error;
+        std::string message;
+    };
+    
+    /**
+     * A block of tokens that can be analysed independently of the rest of the document.
+     */
+    struct block
+    {
+    public:
+        /**
+         * The first and last lines of the block.
+         */
+        int first_line { 0 };
+        int last_line { 0 };
+        
+        /**
+         * The number of lines that the block has moved since it was lexed. Tokens report
+         * the line they were lexed on.
+         */
+        int bias { 0 };
+        
+        /**
+         * The declared type that the tokens at the start and end of the block belong to.
+         * This is empty outside of a declaration.
+         */
+        std::string scope_before;
+        std::string scope_after;
+        
+        /**
+         * Whether the block contains a directive.
+         */
+        bool has_directive { false };
+        
+        /**
+         * Whether the block neither opens nor closes a declaration, so that it belongs
+         * to the same declaration as the blocks before it.
+         */
+        bool inherits_scope { true };
+        
+        /**
+         * Whether the final construct of the block is terminated.
+         */
+        bool complete { true };
+        
+        std::vector<kdl::lexer::token> tokens;
+        
+        /**
+         * Characters that the lexer could not recognise, and skipped.
+         */
+        std::vector<kdk::document::diagnostic> lexer_diagnostics;
+        
+        /**
+         * Whether the block must be analysed again, the assemblers of the types it uses
+         * as they were when it was last analysed, and the diagnostics that produced.
+         */
+        bool dirty { true };
+        std::vector<std::tuple<std::string, std::shared_ptr<kdk::assembler>>> types;
+        std::vector<kdk::document::diagnostic> diagnostics;
+        
+        /**
+         * Returns the current line of a token of the block.
+         */
+        int line_of(const kdl::lexer::token& token) const;
+    };
+    
+    /**
+     * Construct a new document for the file at the specified path.
+     */
+    document(const std::string& path, const std::string& text);
+    
+    /**
+     * Returns the path of the document.
+     */
+    const std::string& path() const;
+    
+    /**
+     * Returns the text of the document.
+     */
+    const std::string& text() const;
+    
+    /**
+     * Returns the number of lines in the document.
+     */
+    int line_count() const;
+    
+    /**
+     * Returns the blocks of the document, in order.
+     */
+    std::vector<kdk::document::block>& blocks();
+    const std::vector<kdk::document::block>& blocks() const;
+    
+    /**
+     * Returns the index of the last block that begins on or before the specified line,
+     * or -1 if there is no such block.
+     */
+    long block_at(int line) const;
+    
+    /**
+     * Replace the text between two positions, given as a line and a byte offset into
+     * the line. The blocks spanning the edit are lexed again and marked as dirty.
+     *
+     * \return Whether a block containing a directive was added or removed.
+     */
+    bool edit(int start_line, int start_column, int end_line, int end_column, const std::string& text);
+    
+    /**
+     * Replace the entire text of the document.
+     */
+    void replace(const std::string& text);
+    
+    /**
+     * Returns the number of lines that were lexed by the last edit.
+     */
+    int lexed_lines() const;
+    
+private:
+    std::string m_path;
+    std::string m_text;
+    std::vector<std::size_t> m_lines;
+    std::vector<kdk::document::block> m_blocks;
+    int m_lexed_lines { 0 };
+    
+    /**
+     * Returns the offset of a position in the text, clamped to the text.
+     */
+    std::size_t offset_of(int line, int column) const;
+    
+    /**
+     * Returns the offset of the end of the specified line, including its line break.
+     */
+    std::size_t end_of_line(int line) const;
+    
+    /**
+     * Lex the lines between the blocks either side of the range of blocks `first` to
+     * `last` (exclusive) and replace those blocks.
+     *
+     * \return Whether a block containing a directive was added or removed.
+     */
+    bool relex(std::size_t first, std::size_t last);
+    
+    /**
+     * Divide the tokens of a region into blocks, starting in the specified scope.
+     */
+    std::vector<kdk::document::block> split(std::vector<kdl::lexer::token> tokens, const std::string& scope) const;
+};
+
+};
+
+#endif
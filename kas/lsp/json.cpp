@@ -0,0 +1,451 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include "lsp/json.hpp"
+
+// MARK: - Constructors
+
+kdk::json::json()
+{
+    
+}
+
+kdk::json::json(bool value)
+    : m_type(boolean), m_boolean(value)
+{
+    
+}
+
+kdk::json::json(int value)
+    : m_type(number), m_number(value)
+{
+    
+}
+
+kdk::json::json(int64_t value)
+    : m_type(number), m_number(static_cast<double>(value))
+{
+    
+}
+
+kdk::json::json(double value)
+    : m_type(number), m_number(value)
+{
+    
+}
+
+kdk::json::json(const char *value)
+    : m_type(string), m_string(value)
+{
+    
+}
+
+kdk::json::json(const std::string& value)
+    : m_type(string), m_string(value)
+{
+    
+}
+
+kdk::json kdk::json::make_array()
+{
+    kdk::json value;
+    value.m_type = array;
+    return value;
+}
+
+kdk::json kdk::json::make_object()
+{
+    kdk::json value;
+    value.m_type = object;
+    return value;
+}
+
+// MARK: - Parsing
+
+static inline void skip_whitespace(const std::string& text, std::size_t& pos)
+{
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) {
+        pos++;
+    }
+}
+
+static inline void append_utf8(std::string& out, uint32_t code)
+{
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    }
+    else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+    else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+static bool parse_hex4(const std::string& text, std::size_t& pos, uint32_t& code)
+{
+    if (pos + 4 > text.size()) {
+        return false;
+    }
+    code = 0;
+    for (auto i = 0; i < 4; ++i) {
+        auto c = text[pos++];
+        code <<= 4;
+        if (c >= '0' && c <= '9') code |= c - '0';
+        else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+        else return false;
+    }
+    return true;
+}
+
+static bool parse_string(const std::string& text, std::size_t& pos, std::string& out)
+{
+    if (pos >= text.size() || text[pos] != '"') {
+        return false;
+    }
+    pos++;
+    
+    while (pos < text.size()) {
+        auto c = text[pos++];
+        if (c == '"') {
+            return true;
+        }
+        if (c != '\\') {
+            out += c;
+            continue;
+        }
+        if (pos >= text.size()) {
+            return false;
+        }
+        switch (text[pos++]) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t code = 0;
+                if (!parse_hex4(text, pos, code)) {
+                    return false;
+                }
+                // Characters outside of the basic multilingual plane are encoded as a
+                // surrogate pair.
+                if (code >= 0xD800 && code < 0xDC00 && text.compare(pos, 2, "\\u") == 0) {
+                    uint32_t low = 0;
+                    pos += 2;
+                    if (!parse_hex4(text, pos, low)) {
+                        return false;
+                    }
+                    code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                }
+                append_utf8(out, code);
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return false;
+}
+
+static bool parse_value(const std::string& text, std::size_t& pos, kdk::json& value, int depth)
+{
+    if (depth > 256) {
+        return false;
+    }
+    
+    skip_whitespace(text, pos);
+    if (pos >= text.size()) {
+        return false;
+    }
+    
+    auto c = text[pos];
+    if (c == '{') {
+        value = kdk::json::make_object();
+        pos++;
+        skip_whitespace(text, pos);
+        if (pos < text.size() && text[pos] == '}') {
+            pos++;
+            return true;
+        }
+        while (true) {
+            std::string name;
+            skip_whitespace(text, pos);
+            if (!parse_string(text, pos, name)) {
+                return false;
+            }
+            skip_whitespace(text, pos);
+            if (pos >= text.size() || text[pos++] != ':') {
+                return false;
+            }
+            if (!parse_value(text, pos, value[name], depth + 1)) {
+                return false;
+            }
+            skip_whitespace(text, pos);
+            if (pos >= text.size()) {
+                return false;
+            }
+            if (text[pos] == ',') {
+                pos++;
+                continue;
+            }
+            return text[pos++] == '}';
+        }
+    }
+    else if (c == '[') {
+        value = kdk::json::make_array();
+        pos++;
+        skip_whitespace(text, pos);
+        if (pos < text.size() && text[pos] == ']') {
+            pos++;
+            return true;
+        }
+        while (true) {
+            kdk::json item;
+            if (!parse_value(text, pos, item, depth + 1)) {
+                return false;
+            }
+            value.push_back(item);
+            skip_whitespace(text, pos);
+            if (pos >= text.size()) {
+                return false;
+            }
+            if (text[pos] == ',') {
+                pos++;
+                continue;
+            }
+            return text[pos++] == ']';
+        }
+    }
+    else if (c == '"') {
+        std::string str;
+        if (!parse_string(text, pos, str)) {
+            return false;
+        }
+        value = kdk::json(str);
+        return true;
+    }
+    else if (text.compare(pos, 4, "true") == 0) {
+        value = kdk::json(true);
+        pos += 4;
+        return true;
+    }
+    else if (text.compare(pos, 5, "false") == 0) {
+        value = kdk::json(false);
+        pos += 5;
+        return true;
+    }
+    else if (text.compare(pos, 4, "null") == 0) {
+        value = kdk::json();
+        pos += 4;
+        return true;
+    }
+    
+    char *end = nullptr;
+    auto number = std::strtod(text.c_str() + pos, &end);
+    if (end == text.c_str() + pos) {
+        return false;
+    }
+    pos = end - text.c_str();
+    value = kdk::json(number);
+    return true;
+}
+
+bool kdk::json::parse(const std::string& text, kdk::json& value)
+{
+    std::size_t pos = 0;
+    if (!parse_value(text, pos, value, 0)) {
+        return false;
+    }
+    skip_whitespace(text, pos);
+    return pos == text.size();
+}
+
+// MARK: - Serialisation
+
+static inline void dump_string(std::string& out, const std::string& str)
+{
+    out += '"';
+    for (auto c : str) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default: {
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escape[8];
+                    std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+                    out += escape;
+                }
+                else {
+                    out += c;
+                }
+            }
+        }
+    }
+    out += '"';
+}
+
+std::string kdk::json::dump() const
+{
+    std::string out;
+    dump(out);
+    return out;
+}
+
+void kdk::json::dump(std::string& out) const
+{
+    switch (m_type) {
+        case null: {
+            out += "null";
+            break;
+        }
+        case boolean: {
+            out += m_boolean ? "true" : "false";
+            break;
+        }
+        case number: {
+            // Integers are written without a fractional part.
+            if (std::floor(m_number) == m_number && std::fabs(m_number) < 9007199254740992.0) {
+                out += std::to_string(static_cast<int64_t>(m_number));
+            }
+            else {
+                char buffer[32];
+                std::snprintf(buffer, sizeof(buffer), "%.17g", m_number);
+                out += buffer;
+            }
+            break;
+        }
+        case string: {
+            dump_string(out, m_string);
+            break;
+        }
+        case array: {
+            out += '[';
+            for (auto i = 0; i < m_items.size(); ++i) {
+                if (i > 0) {
+                    out += ',';
+                }
+                m_items[i].dump(out);
+            }
+            out += ']';
+            break;
+        }
+        case object: {
+            out += '{';
+            auto first = true;
+            for (const auto& member : m_members) {
+                if (!first) {
+                    out += ',';
+                }
+                first = false;
+                dump_string(out, member.first);
+                out += ':';
+                member.second.dump(out);
+            }
+            out += '}';
+            break;
+        }
+    }
+}
+
+// MARK: - Accessors
+
+kdk::json::type kdk::json::kind() const
+{
+    return m_type;
+}
+
+bool kdk::json::is_null() const
+{
+    return m_type == null;
+}
+
+bool kdk::json::as_bool() const
+{
+    return m_type == boolean && m_boolean;
+}
+
+int64_t kdk::json::as_integer() const
+{
+    return m_type == number ? static_cast<int64_t>(m_number) : 0;
+}
+
+double kdk::json::as_number() const
+{
+    return m_type == number ? m_number : 0;
+}
+
+const std::string& kdk::json::as_string() const
+{
+    return m_string;
+}
+
+const kdk::json& kdk::json::operator[](const std::string& name) const
+{
+    static const kdk::json missing;
+    if (m_type != object) {
+        return missing;
+    }
+    auto it = m_members.find(name);
+    return it == m_members.end() ? missing : it->second;
+}
+
+kdk::json& kdk::json::operator[](const std::string& name)
+{
+    if (m_type == null) {
+        m_type = object;
+    }
+    return m_members[name];
+}
+
+const std::vector<kdk::json>& kdk::json::items() const
+{
+    return m_items;
+}
+
+kdk::json& kdk::json::push_back(const kdk::json& value)
+{
+    if (m_type == null) {
+        m_type = array;
+    }
+    m_items.push_back(value);
+    return *this;
+}
@@ -0,0 +1,124 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+
+#if !defined(KDK_LSP_JSON)
+#define KDK_LSP_JSON
+
+namespace kdk
+{
+
+/**
+ * A minimal JSON value, sufficient for the messages of the Language Server Protocol.
+ * Objects keep their members in name order.
+ */
+class json
+{
+public:
+    enum type { null, boolean, number, string, array, object };
+    
+    /**
+     * Construct a null value.
+     */
+    json();
+    
+    json(bool value);
+    json(int value);
+    json(int64_t value);
+    json(double value);
+    json(const char *value);
+    json(const std::string& value);
+    
+    /**
+     * Construct an empty array.
+     */
+    static kdk::json make_array();
+    
+    /**
+     * Construct an empty object.
+     */
+    static kdk::json make_object();
+    
+    /**
+     * Parse a JSON document. Returns false if the document is malformed.
+     */
+    static bool parse(const std::string& text, kdk::json& value);
+    
+    /**
+     * Serialise the value without any whitespace.
+     */
+    std::string dump() const;
+    
+    /**
+     * Returns the type of the value.
+     */
+    kdk::json::type kind() const;
+    
+    bool is_null() const;
+    bool as_bool() const;
+    int64_t as_integer() const;
+    double as_number() const;
+    const std::string& as_string() const;
+    
+    /**
+     * Returns the member of an object with the specified name, or a null value if there
+     * is no such member or the value is not an object.
+     */
+    const kdk::json& operator[](const std::string& name) const;
+    
+    /**
+     * Returns the member of an object with the specified name, creating it if required.
+     * A null value becomes an object.
+     */
+    kdk::json& operator[](const std::string& name);
+    
+    /**
+     * Returns the elements of an array.
+     */
+    const std::vector<kdk::json>& items() const;
+    
+    /**
+     * Append an element to an array. A null value becomes an array.
+     */
+    kdk::json& push_back(const kdk::json& value);
+    
+private:
+    kdk::json::type m_type { null };
+    bool m_boolean { false };
+    double m_number { 0 };
+    std::string m_string;
+    std::vector<kdk::json> m_items;
+    std::map<std::string, kdk::json> m_members;
+    
+    /**
+     * Serialise the value onto the end of the output.
+     */
+    void dump(std::string& out) const;
+};
+
+};
+
+#endif
@@ -0,0 +1,796 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <set>
+#include <cctype>
+#include <cstdio>
+#include <unistd.h>
+#include "lsp/language_server.hpp"
+#include "kdl/sema.hpp"
+#include "kdl/lexer_cache.hpp"
+#include "assemblers/pool.hpp"
+#include "diagnostic/log.hpp"
+
+// MARK: - Helpers
+
+static inline std::string path_for_uri(const std::string& uri)
+{
+    auto encoded = uri.compare(0, 7, "file://") == 0 ? uri.substr(7) : uri;
+    std::string path;
+    for (std::size_t i = 0; i < encoded.size(); ++i) {
+        if (encoded[i] == '%' && i + 2 < encoded.size() && std::isxdigit(encoded[i + 1]) && std::isxdigit(encoded[i + 2])) {
+            path += static_cast<char>(std::stoi(encoded.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        }
+        else {
+            path += encoded[i];
+        }
+    }
+    return path;
+}
+
+static inline std::string uri_for_path(const std::string& path)
+{
+    std::string absolute = path;
+    if (absolute.empty() || absolute[0] != '/') {
+        char cwd[4096];
+        if (::getcwd(cwd, sizeof(cwd))) {
+            absolute = std::string(cwd) + "/" + absolute;
+        }
+    }
+    
+    std::string uri { "file://" };
+    for (auto c : absolute) {
+        if (std::isalnum(static_cast<unsigned char>(c)) || std::string("/-_.~").find(c) != std::string::npos) {
+            uri += c;
+        }
+        else {
+            char escape[4];
+            std::snprintf(escape, sizeof(escape), "%%%02X", static_cast<unsigned char>(c));
+            uri += escape;
+        }
+    }
+    return uri;
+}
+
+static inline kdk::json range(int first_line, int first_column, int last_line, int last_column)
+{
+    kdk::json range;
+    range["start"]["line"] = first_line;
+    range["start"]["character"] = first_column;
+    range["end"]["line"] = last_line;
+    range["end"]["character"] = last_column;
+    return range;
+}
+
+static inline int token_length(const kdl::lexer::token& token)
+{
+    // The text of a string token does not include its quotes.
+    auto length = static_cast<int>(token.text().size());
+    return token.is_a(kdl::lexer::token::type::string) ? length + 2 : length;
+}
+
+// MARK: - Context
+
+/**
+ * The syntactic context of a position in a document: the declaration it is within, the
+ * depth of braces, and the tokens of the statement preceding it.
+ */
+struct cursor_context
+{
+    std::string scope;
+    int depth { 0 };
+    bool in_directive { false };
+    std::vector<kdl::lexer::token> statement;
+};
+
+static cursor_context context_at(const kdk::document& document, int line, int column, bool exclude_word)
+{
+    cursor_context context;
+    auto index = document.block_at(line);
+    if (index < 0) {
+        return context;
+    }
+    
+    const auto& block = document.blocks()[index];
+    if (line > block.last_line) {
+        context.scope = block.scope_after;
+        context.depth = context.scope.empty() ? 0 : 1;
+        return context;
+    }
+    
+    std::vector<kdl::lexer::token> before;
+    for (const auto& token : block.tokens) {
+        auto token_line = block.line_of(token);
+        if (token_line > line || (token_line == line && token.offset() >= column)) {
+            break;
+        }
+        before.push_back(token);
+    }
+    
+    // The word that is being typed is not part of the context.
+    if (exclude_word && !before.empty()) {
+        const auto& last = before.back();
+        if (last.is_a(kdl::lexer::token::type::identifier) && block.line_of(last) == line && last.offset() + token_length(last) >= column) {
+            before.pop_back();
+        }
+    }
+    
+    context.scope = block.scope_before;
+    context.depth = context.scope.empty() ? 0 : 1;
+    for (const auto& token : before) {
+        if (token.is_a(kdl::lexer::token::type::lbrace)) {
+            if (context.depth == 0 && context.statement.size() >= 2 && context.statement[0].text() == "declare") {
+                context.scope = context.statement[1].text();
+            }
+            else if (context.depth == 0 && !context.statement.empty() && context.statement[0].is_a(kdl::lexer::token::type::directive)) {
+                context.in_directive = true;
+            }
+            context.depth++;
+            context.statement.clear();
+        }
+        else if (token.is_a(kdl::lexer::token::type::rbrace)) {
+            if (--context.depth <= 0) {
+                context.depth = 0;
+                context.scope = "";
+                context.in_directive = false;
+            }
+            context.statement.clear();
+        }
+        else if (token.is_a(kdl::lexer::token::type::semi_colon)) {
+            context.statement.clear();
+        }
+        else {
+            context.statement.push_back(token);
+        }
+    }
+    return context;
+}
+
+// MARK: - Definitions
+
+static const kdl::lexer::token *find_definition(const std::vector<kdl::lexer::token>& tokens, const std::string& type_name, const std::string& field_name)
+{
+    for (std::size_t i = 0; i < tokens.size(); ++i) {
+        if (!tokens[i].is_a(kdl::lexer::token::type::directive) || tokens[i].text() != "define") {
+            continue;
+        }
+        
+        // Find the name of the type, and the fields, at the top level of the definition.
+        const kdl::lexer::token *name = nullptr;
+        const kdl::lexer::token *field = nullptr;
+        auto depth = 0;
+        for (++i; i < tokens.size(); ++i) {
+            if (tokens[i].is_a(kdl::lexer::token::type::lbrace)) {
+                depth++;
+            }
+            else if (tokens[i].is_a(kdl::lexer::token::type::rbrace) && --depth <= 0) {
+                break;
+            }
+            else if (depth == 1 && i + 2 < tokens.size() && tokens[i].is_a(kdl::lexer::token::type::identifier)) {
+                if (tokens[i].text() == "name" && tokens[i + 2].text() == type_name && tokens[i + 2].is_a(kdl::lexer::token::type::string)) {
+                    name = &tokens[i + 2];
+                }
+                else if (tokens[i].text() == "field" && tokens[i + 2].text() == field_name && tokens[i + 2].is_a(kdl::lexer::token::type::string)) {
+                    field = &tokens[i + 2];
+                }
+            }
+        }
+        
+        if (name) {
+            return field_name.empty() ? name : field;
+        }
+    }
+    return nullptr;
+}
+
+static std::vector<std::string> imports_of(const std::vector<kdl::lexer::token>& tokens)
+{
+    std::vector<std::string> paths;
+    for (std::size_t i = 0; i < tokens.size(); ++i) {
+        if (!tokens[i].is_a(kdl::lexer::token::type::directive) || tokens[i].text() != "import") {
+            continue;
+        }
+        for (++i; i < tokens.size() && !tokens[i].is_a(kdl::lexer::token::type::rbrace); ++i) {
+            if (tokens[i].is_a(kdl::lexer::token::type::string)) {
+                paths.push_back(tokens[i].text());
+            }
+        }
+    }
+    return paths;
+}
+
+// MARK: - Constructor
+
+kdk::language_server::language_server(std::istream& in, std::ostream& out)
+    : m_in(in), m_out(out)
+{
+    // Diagnostics are collected by the block that is being analysed.
+    log::set_recoverable(true);
+    log::set_sink([this] (bool error, const std::string& file, int line, const std::string& message) {
+        if (!m_diagnostics) {
+            return;
+        }
+        if (file == m_analysing && line > 0) {
+            m_diagnostics->push_back({ line, error, message });
+        }
+        else if (line > 0 && file != "<missing>") {
+            m_diagnostics->push_back({ -1, error, file + ":L" + std::to_string(line) + ": " + message });
+        }
+        else {
+            m_diagnostics->push_back({ -1, error, message });
+        }
+    });
+    kdl::lexer_cache::shared().set_retains_tokens(true);
+}
+
+kdk::language_server::~language_server()
+{
+    log::set_sink(nullptr);
+}
+
+// MARK: - Configuration
+
+void kdk::language_server::set_scenario(const std::vector<std::string>& files)
+{
+    m_scenario = files;
+}
+
+void kdk::language_server::set_trace(bool trace)
+{
+    m_trace = trace;
+}
+
+// MARK: - Messages
+
+bool kdk::language_server::receive(kdk::json& message)
+{
+    // Each message is preceded by a header, of which only the length of the content is
+    // of any interest.
+    std::string header;
+    std::size_t length = 0;
+    auto has_length = false;
+    while (std::getline(m_in, header)) {
+        if (!header.empty() && header.back() == '\r') {
+            header.pop_back();
+        }
+        if (header.empty()) {
+            if (has_length) {
+                break;
+            }
+            continue;
+        }
+        
+        auto colon = header.find(':');
+        auto name = header.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        if (name == "content-length" && colon != std::string::npos) {
+            length = std::strtoul(header.c_str() + colon + 1, nullptr, 10);
+            has_length = true;
+        }
+    }
+    if (!m_in) {
+        return false;
+    }
+    
+    std::string content(length, '\0');
+    m_in.read(&content[0], length);
+    if (static_cast<std::size_t>(m_in.gcount()) != length) {
+        return false;
+    }
+    
+    if (!kdk::json::parse(content, message)) {
+        message = kdk::json();
+    }
+    return true;
+}
+
+void kdk::language_server::send(const kdk::json& message)
+{
+    auto content = message.dump();
+    m_out << "Content-Length: " << content.size() << "\r\n\r\n" << content;
+    m_out.flush();
+}
+
+void kdk::language_server::respond(const kdk::json& id, const kdk::json& result)
+{
+    kdk::json message;
+    message["jsonrpc"] = "2.0";
+    message["id"] = id;
+    message["result"] = result;
+    send(message);
+}
+
+void kdk::language_server::fail(const kdk::json& id, int code, const std::string& error)
+{
+    kdk::json message;
+    message["jsonrpc"] = "2.0";
+    message["id"] = id;
+    message["error"]["code"] = code;
+    message["error"]["message"] = error;
+    send(message);
+}
+
+void kdk::language_server::notify(const std::string& method, const kdk::json& params)
+{
+    kdk::json message;
+    message["jsonrpc"] = "2.0";
+    message["method"] = method;
+    message["params"] = params;
+    send(message);
+}
+
+// MARK: - Main Loop
+
+int kdk::language_server::run()
+{
+    kdk::json message;
+    while (receive(message)) {
+        if (message.is_null()) {
+            fail(kdk::json(), -32700, "The message could not be parsed.");
+            continue;
+        }
+        if (!handle(message)) {
+            return m_shutdown ? 0 : 1;
+        }
+    }
+    return 1;
+}
+
+bool kdk::language_server::handle(const kdk::json& message)
+{
+    auto start = std::chrono::steady_clock::now();
+    const auto& method = message["method"].as_string();
+    const auto& id = message["id"];
+    const auto& params = message["params"];
+    auto is_request = !id.is_null();
+    auto uri = params["textDocument"]["uri"].as_string();
+    const auto& position = params["position"];
+    auto lexed_lines = -1;
+    m_analysed = 0;
+    
+    if (method == "initialize") {
+        respond(id, initialize(params));
+    }
+    else if (method == "initialized") {
+        
+    }
+    else if (method == "shutdown") {
+        m_shutdown = true;
+        respond(id, kdk::json());
+    }
+    else if (method == "exit") {
+        return false;
+    }
+    else if (m_shutdown && is_request) {
+        fail(id, -32600, "The server is shutting down.");
+    }
+    else if (method == "textDocument/didOpen") {
+        auto& document = m_documents[uri];
+        document.reset(new kdk::document(path_for_uri(uri), params["textDocument"]["text"].as_string()));
+        lexed_lines = document->line_count();
+        analyse(uri, *document, true);
+    }
+    else if (method == "textDocument/didChange") {
+        if (auto document = document_for(uri)) {
+            auto directives_changed = false;
+            lexed_lines = 0;
+            for (const auto& change : params["contentChanges"].items()) {
+                const auto& range = change["range"];
+                if (range.is_null()) {
+                    document->replace(change["text"].as_string());
+                    directives_changed = true;
+                }
+                else {
+                    directives_changed |= document->edit(static_cast<int>(range["start"]["line"].as_integer()),
+                                                         static_cast<int>(range["start"]["character"].as_integer()),
+                                                         static_cast<int>(range["end"]["line"].as_integer()),
+                                                         static_cast<int>(range["end"]["character"].as_integer()),
+                                                         change["text"].as_string());
+                }
+                lexed_lines += document->lexed_lines();
+            }
+            analyse(uri, *document, directives_changed);
+        }
+    }
+    else if (method == "textDocument/didClose") {
+        m_documents.erase(uri);
+        if (m_definitions_owner == uri) {
+            m_definitions_owner.clear();
+        }
+        kdk::json params;
+        params["uri"] = uri;
+        params["diagnostics"] = kdk::json::make_array();
+        notify("textDocument/publishDiagnostics", params);
+    }
+    else if (method == "textDocument/completion") {
+        auto document = document_for(uri);
+        respond(id, document ? completion(*document, static_cast<int>(position["line"].as_integer()), static_cast<int>(position["character"].as_integer())) : kdk::json());
+    }
+    else if (method == "textDocument/definition") {
+        auto document = document_for(uri);
+        respond(id, document ? definition(*document, static_cast<int>(position["line"].as_integer()), static_cast<int>(position["character"].as_integer())) : kdk::json());
+    }
+    else if (is_request) {
+        fail(id, -32601, "Unsupported method '" + method + "'.");
+    }
+    
+    if (m_trace) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        std::cerr << "kas-lsp: " << method << " handled in " << (elapsed.count() / 1000.0) << "ms";
+        if (lexed_lines >= 0) {
+            std::cerr << ", lexed " << lexed_lines << " lines, analysed " << m_analysed << " blocks";
+        }
+        std::cerr << std::endl;
+    }
+    return true;
+}
+
+kdk::json kdk::language_server::initialize(const kdk::json& params) const
+{
+    kdk::json result;
+    auto& capabilities = result["capabilities"];
+    capabilities["textDocumentSync"]["openClose"] = true;
+    capabilities["textDocumentSync"]["change"] = 2;
+    capabilities["completionProvider"]["resolveProvider"] = false;
+    capabilities["definitionProvider"] = true;
+    
+    // Columns are byte offsets into a line, which is what clients that support UTF-8
+    // positions expect.
+    for (const auto& encoding : params["capabilities"]["general"]["positionEncodings"].items()) {
+        if (encoding.as_string() == "utf-8") {
+            capabilities["positionEncoding"] = "utf-8";
+        }
+    }
+    
+    result["serverInfo"]["name"] = "kas-lsp";
+    result["serverInfo"]["version"] = "0.2";
+    return result;
+}
+
+kdk::document *kdk::language_server::document_for(const std::string& uri)
+{
+    auto it = m_documents.find(uri);
+    return it == m_documents.end() ? nullptr : it->second.get();
+}
+
+// MARK: - Analysis
+
+void kdk::language_server::analyse(const std::string& uri, kdk::document& document, bool directives_changed)
+{
+    auto& pool = kdk::assembler_pool::shared();
+    
+    if (directives_changed || m_definitions_owner != uri) {
+        // The scenario and the directives of the document are analysed again from the
+        // beginning. Definitions that are unchanged reuse their existing assemblers.
+        pool.begin_build();
+        
+        std::vector<kdk::document::diagnostic> ignored;
+        m_diagnostics = &ignored;
+        for (const auto& file : m_scenario) {
+            m_analysing = file;
+            try {
+                kdl::sema(std::make_shared<kdk::target>(file), kdl::lexer_cache::shared().analyze(file)).run();
+            }
+            catch (const std::exception&) {
+                
+            }
+        }
+        m_diagnostics = nullptr;
+        
+        for (auto& block : document.blocks()) {
+            if (block.has_directive) {
+                analyse_block(document, block);
+            }
+        }
+        m_definitions_owner = uri;
+        
+        // Blocks only need to be analysed again if the definition of a type that they use
+        // has changed.
+        for (auto& block : document.blocks()) {
+            for (const auto& type : block.types) {
+                if (std::get<1>(pool.assembler_named(std::get<0>(type), true)) != std::get<1>(type)) {
+                    block.dirty = true;
+                    break;
+                }
+            }
+        }
+    }
+    
+    for (auto& block : document.blocks()) {
+        if (block.dirty && !block.has_directive) {
+            analyse_block(document, block);
+        }
+    }
+    
+    publish(uri, document);
+}
+
+void kdk::language_server::analyse_block(kdk::document& document, kdk::document::block& block)
+{
+    auto& pool = kdk::assembler_pool::shared();
+    const auto& path = document.path();
+    block.diagnostics = block.lexer_diagnostics;
+    block.types.clear();
+    m_analysing = path;
+    m_diagnostics = &block.diagnostics;
+    m_analysed++;
+    
+    // The block is completed by the parts of the declaration that it belongs to, so that
+    // it can be analysed on its own.
+    std::vector<kdl::lexer::token> tokens;
+    auto first_line = block.tokens.empty() ? 0 : block.tokens.front().line() - 1;
+    auto last_line = block.tokens.empty() ? 0 : block.tokens.back().line() - 1;
+    if (!block.scope_before.empty()) {
+        tokens.emplace_back(path, first_line, 0, "declare", kdl::lexer::token::type::identifier);
+        tokens.emplace_back(path, first_line, 0, block.scope_before, kdl::lexer::token::type::identifier);
+        tokens.emplace_back(path, first_line, 0, "{", kdl::lexer::token::type::lbrace);
+    }
+    tokens.insert(tokens.end(), block.tokens.begin(), block.tokens.end());
+    if (!block.scope_after.empty()) {
+        tokens.emplace_back(path, last_line, 0, "}", kdl::lexer::token::type::rbrace);
+    }
+    
+    auto target = std::make_shared<kdk::target>(path);
+    try {
+        kdl::sema(target, tokens).run();
+    }
+    catch (const log::fatal_error&) {
+        
+    }
+    catch (const std::exception&) {
+        block.diagnostics.push_back({ last_line + 1, true, "Unexpected end of input." });
+    }
+    
+    // Check that the resources can be assembled with the definitions of their types.
+    std::set<std::string> types;
+    for (const auto& scope : { block.scope_before, block.scope_after }) {
+        if (!scope.empty()) {
+            types.insert(scope);
+        }
+    }
+    for (std::size_t i = 0; i + 1 < block.tokens.size(); ++i) {
+        const auto& name = block.tokens[i + 1];
+        if (block.tokens[i].text() != "declare" || !block.tokens[i].is_a(kdl::lexer::token::type::identifier)) {
+            continue;
+        }
+        types.insert(name.text());
+        if (!std::get<1>(pool.assembler_named(name.text(), true))) {
+            block.diagnostics.push_back({ name.line(), true, "The type '" + name.text() + "' has not been defined." });
+        }
+    }
+    
+    for (const auto& resource : target->resources()) {
+        auto assembler = std::get<1>(pool.assembler_named(resource.type(), true));
+        if (types.insert(resource.type()).second && !assembler) {
+            block.diagnostics.push_back({ -1, true, "The type '" + resource.type() + "' has not been defined." });
+        }
+        if (assembler) {
+            try {
+                assembler->assemble_resource(resource);
+            }
+            catch (const log::fatal_error&) {
+                
+            }
+            catch (const std::exception& e) {
+                block.diagnostics.push_back({ -1, true, e.what() });
+            }
+        }
+    }
+    
+    for (const auto& type : types) {
+        block.types.push_back(std::make_tuple(type, std::get<1>(pool.assembler_named(type, true))));
+    }
+    
+    m_diagnostics = nullptr;
+    block.dirty = false;
+}
+
+void kdk::language_server::publish(const std::string& uri, const kdk::document& document)
+{
+    auto diagnostics = kdk::json::make_array();
+    for (const auto& block : document.blocks()) {
+        for (const auto& diagnostic : block.diagnostics) {
+            auto line = diagnostic.line < 0 ? block.first_line : diagnostic.line - 1 + block.bias;
+            kdk::json item;
+            item["range"] = range(line, 0, line + 1, 0);
+            item["severity"] = diagnostic.error ? 1 : 2;
+            item["source"] = "kas";
+            item["message"] = diagnostic.message;
+            diagnostics.push_back(item);
+        }
+    }
+    
+    kdk::json params;
+    params["uri"] = uri;
+    params["diagnostics"] = diagnostics;
+    notify("textDocument/publishDiagnostics", params);
+}
+
+// MARK: - Completion
+
+kdk::json kdk::language_server::completion(const kdk::document& document, int line, int column) const
+{
+    auto items = kdk::json::make_array();
+    auto add = [&items] (const std::string& label, int kind, const std::string& detail) {
+        kdk::json item;
+        item["label"] = label;
+        item["kind"] = kind;
+        if (!detail.empty()) {
+            item["detail"] = detail;
+        }
+        items.push_back(item);
+    };
+    
+    // Completion item kinds, as defined by the protocol.
+    enum { field_kind = 5, class_kind = 7, keyword_kind = 14, enum_member_kind = 20 };
+    
+    auto& pool = kdk::assembler_pool::shared();
+    auto context = context_at(document, line, column, true);
+    const auto& statement = context.statement;
+    if (context.in_directive) {
+        return items;
+    }
+    
+    if (context.depth == 0) {
+        // Type names follow `declare`, and otherwise a declaration or directive begins.
+        if (statement.size() == 1 && statement[0].text() == "declare") {
+            for (const auto& name : pool.type_names()) {
+                add(name, class_kind, "");
+            }
+        }
+        else if (statement.empty()) {
+            for (const auto& keyword : { "declare", "@define", "@import", "@out" }) {
+                add(keyword, keyword_kind, "");
+            }
+        }
+    }
+    else if (context.depth == 1) {
+        // Resource instances, and their attributes.
+        auto in_attributes = false;
+        for (const auto& token : statement) {
+            in_attributes = token.is_a(kdl::lexer::token::type::lparen) || (in_attributes && !token.is_a(kdl::lexer::token::type::rparen));
+        }
+        if (in_attributes && (statement.back().is_a(kdl::lexer::token::type::lparen) || statement.back().is_a(kdl::lexer::token::type::comma))) {
+            add("id", keyword_kind, "");
+            add("name", keyword_kind, "");
+        }
+        else if (statement.empty()) {
+            add("new", keyword_kind, "");
+        }
+    }
+    else if (auto assembler = std::get<1>(pool.assembler_named(context.scope, true))) {
+        // Field names begin a statement, and the symbols of the field follow the `=`.
+        if (statement.empty()) {
+            for (const auto& field : assembler->fields()) {
+                add(field.name(), field_kind, field.is_required() ? "required" : "");
+            }
+        }
+        else if (statement.size() >= 2 && statement[1].is_a(kdl::lexer::token::type::equals)) {
+            for (const auto& field : assembler->fields()) {
+                if (field.name() != statement[0].text()) {
+                    continue;
+                }
+                for (const auto& value : field.expected_values()) {
+                    for (const auto& symbol : value.symbols()) {
+                        add(std::get<0>(symbol), enum_member_kind, std::get<1>(symbol));
+                    }
+                }
+            }
+        }
+    }
+    
+    kdk::json list;
+    list["isIncomplete"] = false;
+    list["items"] = items;
+    return list;
+}
+
+// MARK: - Definitions
+
+kdk::json kdk::language_server::definition(const kdk::document& document, int line, int column) const
+{
+    auto index = document.block_at(line);
+    if (index < 0 || line > document.blocks()[index].last_line) {
+        return kdk::json();
+    }
+    
+    // Find the identifier at the position.
+    const auto& block = document.blocks()[index];
+    const kdl::lexer::token *identifier = nullptr;
+    for (const auto& token : block.tokens) {
+        if (block.line_of(token) == line && token.offset() <= column && column <= token.offset() + token_length(token)) {
+            identifier = token.is_a(kdl::lexer::token::type::identifier) ? &token : nullptr;
+            break;
+        }
+    }
+    if (!identifier) {
+        return kdk::json();
+    }
+    
+    // The identifier is either the name of a type, or of a field of the type of the
+    // resource it is within.
+    std::string type_name;
+    std::string field_name;
+    auto names = kdk::assembler_pool::shared().type_names();
+    if (std::find(names.begin(), names.end(), identifier->text()) != names.end()) {
+        type_name = identifier->text();
+    }
+    else {
+        auto context = context_at(document, line, identifier->offset(), false);
+        if (context.depth >= 2 && !context.in_directive && context.statement.empty()) {
+            type_name = context.scope;
+            field_name = identifier->text();
+        }
+    }
+    if (type_name.empty()) {
+        return kdk::json();
+    }
+    
+    auto location = [] (const std::string& path, int line, const kdl::lexer::token& token) {
+        kdk::json location;
+        location["uri"] = uri_for_path(path);
+        location["range"] = range(line, token.offset(), line, token.offset() + token_length(token));
+        return location;
+    };
+    
+    // Search the document, and then the files that it and the scenario import.
+    std::deque<std::string> files { m_scenario.begin(), m_scenario.end() };
+    for (const auto& block : document.blocks()) {
+        if (!block.has_directive) {
+            continue;
+        }
+        if (auto token = find_definition(block.tokens, type_name, field_name)) {
+            return location(document.path(), block.line_of(*token), *token);
+        }
+        auto imports = imports_of(block.tokens);
+        files.insert(files.end(), imports.begin(), imports.end());
+    }
+    
+    std::set<std::string> searched;
+    while (!files.empty()) {
+        auto file = files.front();
+        files.pop_front();
+        if (!searched.insert(file).second) {
+            continue;
+        }
+        
+        std::vector<kdl::lexer::token> tokens;
+        try {
+            tokens = kdl::lexer_cache::shared().analyze(file);
+        }
+        catch (const log::fatal_error&) {
+            continue;
+        }
+        if (auto token = find_definition(tokens, type_name, field_name)) {
+            return location(file, token->line() - 1, *token);
+        }
+        auto imports = imports_of(tokens);
+        files.insert(files.end(), imports.begin(), imports.end());
+    }
+    
+    return kdk::json();
+}
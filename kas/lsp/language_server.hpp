@@ -0,0 +1,164 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <iostream>
+#include "lsp/json.hpp"
+#include "lsp/document.hpp"
+
+#if !defined(KDK_LSP_LANGUAGE_SERVER)
+#define KDK_LSP_LANGUAGE_SERVER
+
+namespace kdk
+{
+
+/**
+ * The language server provides diagnostics, completion and go-to-definition for KDL
+ * documents to an editor, using the Language Server Protocol over a pair of streams.
+ *
+ * Documents are edited incrementally. Each edit lexes only the blocks of the document
+ * that it touched, and only those blocks are analysed again, unless a directive was
+ * changed. Definitions are then analysed again, reusing the assemblers of those that
+ * are unchanged, and only the blocks using a type whose definition changed are
+ * analysed again.
+ */
+class language_server
+{
+public:
+    /**
+     * Construct a new language server that reads messages from `in` and writes them to
+     * `out`.
+     */
+    language_server(std::istream& in, std::ostream& out);
+    
+    /**
+     * Stop receiving diagnostics.
+     */
+    ~language_server();
+    
+    /**
+     * Set the definition files that are analysed ahead of every document.
+     */
+    void set_scenario(const std::vector<std::string>& files);
+    
+    /**
+     * Set whether the time taken to handle each message should be written to the
+     * standard error.
+     */
+    void set_trace(bool trace);
+    
+    /**
+     * Handle messages until the client asks the server to exit.
+     *
+     * \return The exit status of the server.
+     */
+    int run();
+    
+private:
+    std::istream& m_in;
+    std::ostream& m_out;
+    bool m_trace { false };
+    bool m_shutdown { false };
+    std::vector<std::string> m_scenario;
+    std::map<std::string, std::unique_ptr<kdk::document>> m_documents;
+    std::string m_definitions_owner;
+    std::string m_analysing;
+    std::vector<kdk::document::diagnostic> *m_diagnostics { nullptr };
+    std::size_t m_analysed { 0 };
+    
+    /**
+     * Read the next message. Returns false at the end of the input.
+     */
+    bool receive(kdk::json& message);
+    
+    /**
+     * Write a message.
+     */
+    void send(const kdk::json& message);
+    
+    /**
+     * Send the result of a request.
+     */
+    void respond(const kdk::json& id, const kdk::json& result);
+    
+    /**
+     * Send an error in response to a request.
+     */
+    void fail(const kdk::json& id, int code, const std::string& message);
+    
+    /**
+     * Send a notification.
+     */
+    void notify(const std::string& method, const kdk::json& params);
+    
+    /**
+     * Handle a request or notification.
+     *
+     * \return False if the client asked the server to exit.
+     */
+    bool handle(const kdk::json& message);
+    
+    /**
+     * Returns the capabilities of the server, for the `initialize` request.
+     */
+    kdk::json initialize(const kdk::json& params) const;
+    
+    /**
+     * Returns the open document with the specified URI, or `nullptr`.
+     */
+    kdk::document *document_for(const std::string& uri);
+    
+    /**
+     * Analyse the dirty blocks of a document, and then publish its diagnostics. If the
+     * directives of the document changed, or the definitions currently registered
+     * belong to another document, the definitions are analysed first.
+     */
+    void analyse(const std::string& uri, kdk::document& document, bool directives_changed);
+    
+    /**
+     * Analyse a single block of a document.
+     */
+    void analyse_block(kdk::document& document, kdk::document::block& block);
+    
+    /**
+     * Publish the diagnostics of every block of a document.
+     */
+    void publish(const std::string& uri, const kdk::document& document);
+    
+    /**
+     * Returns the completion items for a position in a document.
+     */
+    kdk::json completion(const kdk::document& document, int line, int column) const;
+    
+    /**
+     * Returns the location of the definition of the type or field at a position in a
+     * document, or null.
+     */
+    kdk::json definition(const kdk::document& document, int line, int column) const;
+};
+
+};
+
+#endif
@@ -0,0 +1,73 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include "lsp/language_server.hpp"
+#include "driver/driver.hpp"
+
+// MARK: - Entry Point
+
+int main(int argc, const char **argv)
+{
+    std::vector<std::string> scenario;
+    auto trace = false;
+    
+    for (auto i = 1; i < argc; ++i) {
+        std::string option { argv[i] };
+        if (option == "--help" || option == "-h") {
+            std::cout   << "The Kestrel Assembler Language Server -- Version 0.2" << std::endl
+                        << "    kas-lsp [options]" << std::endl << std::endl
+                        << "Messages are exchanged with the editor over the standard input and output." << std::endl << std::endl
+                        << "Options" << std::endl
+                        << "  --scenario        The scenario definition files that every document is analysed against." << std::endl
+                        << "  --trace           Report the time taken to handle each message on the standard error." << std::endl
+                        << "  -h, --help        Display this help message." << std::endl;
+            return 0;
+        }
+        else if (option == "--scenario" && i + 1 < argc) {
+            auto files = kdk::driver::scenario_files(argv[++i]);
+            scenario.insert(scenario.end(), files.begin(), files.end());
+        }
+        else if (option == "--trace") {
+            trace = true;
+        }
+        else {
+            std::cerr << "kas-lsp: \x1b[31merror: \x1b[0mbad argument supplied: " << option << std::endl;
+            return 2;
+        }
+    }
+    
+    // The standard output carries the protocol. Anything else that would be written to
+    // it, such as the output of `@out`, is written to the standard error instead.
+    std::ostream protocol { std::cout.rdbuf() };
+    std::cout.rdbuf(std::cerr.rdbuf());
+    
+    kdk::language_server server { std::cin, protocol };
+    server.set_scenario(scenario);
+    server.set_trace(trace);
+    auto status = server.run();
+    
+    std::cout.rdbuf(protocol.rdbuf());
+    return status;
+}
@@ -21,11 +21,12 @@
 */
 
 #include <string>
+#include <vector>
 #include <iostream>
 #include <algorithm>
-#include "kdl/lexer.hpp"
-#include "kdl/sema.hpp"
-#include "libGraphite/rsrc/file.hpp"
+#include "driver/driver.hpp"
+#include "driver/server.hpp"
+#include "driver/batch.hpp"
 
 // MARK: - Command Line Helpers
 
@@ -51,70 +52,52 @@ int main(int argc, const char **argv)
     // page.
     if (option_exists(argv, argv + argc, "--help") || option_exists(argv, argv + argc, "-h")) {
         std::cout   << "The Kestrel Assembler -- Version 0.2" << std::endl
-                    << "    kas [options] input_file ..." << std::endl << std::endl
+                    << "    kas [options] input_file ..." << std::endl
+                    << "    kas --serve socket" << std::endl
+                    << "    kas --connect socket [options] input_file ..." << std::endl
+                    << "    kas --watch [options] input_file ..." << std::endl
+                    << "    kas --batch manifest [--scenario path] [-j jobs] [--cache-dir path] [--compress]" << std::endl << std::endl
                     << "Multiple files added to the build will be included into the same output file." << std::endl << std::endl
                     << "Options" << std::endl
                     << "  --scenario        The scenario definition files to assemble against." << std::endl
-                    << "  --format          The output data format to be assembled. Should be 'classic', 'extended' or 'rez'." << std::endl
+                    << "  --format          The output data format to be assembled. Should be 'classic', 'extended', 'rez' or 'kestrel'." << std::endl
                     << "  -o                The destination file for the assembled data to be written to." << std::endl
+                    << "  --emit            An output to write, as format:path, in place of --format and -o. May be repeated" << std::endl
+                    << "                    to write several formats whilst assembling each resource only once." << std::endl
+                    << "  -j                The number of threads to assemble resources with. 0 uses every hardware thread." << std::endl
+                    << "  --cache-dir       A directory in which to cache assembled resources between builds." << std::endl
+                    << "  --depfile         Write a Make/Ninja dependency file, and skip the build if no dependency has changed." << std::endl
+                    << "  --compress        Compress the data of each resource when that makes it smaller. Only the 'extended'" << std::endl
+                    << "                    and 'kestrel' formats support compression; others are written uncompressed." << std::endl
+                    << "  --pipeline        Assemble and write each declaration as soon as it has been parsed." << std::endl
+                    << "  --max-memory      The approximate memory budget for a pipelined build, including imported images, e.g. 512M. Implies --pipeline." << std::endl
+                    << "  --serve           Run a compile server on the Unix domain socket, keeping definitions warm between builds." << std::endl
+                    << "  --connect         Send the build to the compile server on the Unix domain socket." << std::endl
+                    << "  --watch           Rebuild whenever an input, imported or referenced file changes." << std::endl
+                    << "  --batch           Build every target listed in the manifest, parsing the scenario once. Each line of" << std::endl
+                    << "                    the manifest is an output file, its format and its input files. -j sets the number" << std::endl
+                    << "                    of targets built at once, and defaults to every hardware thread." << std::endl
                     << "  -h, --help        Display this help message." << std::endl;
         return 0;
     }
 
-    // Step through all of the arguments and determine where the _first_ input file is located.
-    std::string scenario_path { "" };
-    std::string output_file { "plugin.kdat" };
-    graphite::rsrc::file::format format { graphite::rsrc::file::format::classic };
-    std::vector<std::string> input_files;
-
-    for (auto i = 1; i < argc; ++i) {
-        // If the argument starts with a '-' then skip it. If the argument depends on additional arguments, then
-        // skip those as well.
-        if (argv[i][0] != '-') {
-            input_files.push_back(argv[i]);
-            continue;
-        }
-
-        std::string option { argv[i] };
-        if (option == "--scenario" && i < argc - 1) {
-            scenario_path = std::string(argv[++i]);
-        }
-        else if (option == "--format" && i < argc - 1) {
-            std::string format_name { argv[++i] };
-            if (format_name == "classic") {
-                format = graphite::rsrc::file::format::classic;
-            }
-            else if (format_name == "extended") {
-                format = graphite::rsrc::file::format::extended;
-            }
-            else if (format_name == "rez") {
-                format = graphite::rsrc::file::format::rez;
-            }
-            else {
-                std::cout << "kas: \x1b[31merror: \x1b[0minvalid output format: " << format_name << std::endl;
-                return 3;
-            }
-        }
-        else if (option == "-o" && i < argc - 1) {
-            output_file = std::string(argv[++i]);
-        }
-        else {
-            std::cout << "kas: \x1b[31merror: \x1b[0mbad argument supplied: " << option << std::endl;
-            return 2;
-        }
+    if (argc == 3 && std::string(argv[1]) == "--serve") {
+        kdk::server server { argv[2] };
+        return server.run();
     }
 
-    // Setup a new target.
-    auto target = std::make_shared<kdk::target>(output_file);
-
-    // Iterate through each of the input files.
-    for (auto file : input_files) {
-        auto lexer = kdl::lexer::open_file(file);
-        auto sema = kdl::sema(target, lexer.analyze());
-        sema.run();
+    if (argc >= 3 && std::string(argv[1]) == "--connect") {
+        return kdk::server::request(argv[2], std::vector<std::string>(argv + 3, argv + argc));
     }
 
-    target->build(format);
+    if (argc >= 3 && std::string(argv[1]) == "--batch") {
+        kdk::batch batch { argv[2] };
+        return batch.run(std::vector<std::string>(argv + 3, argv + argc));
+    }
 
-    return 0;
+    kdk::driver driver;
+    if (argc >= 2 && std::string(argv[1]) == "--watch") {
+        return driver.watch(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    return driver.run(std::vector<std::string>(argv + 1, argv + argc));
 }
@@ -0,0 +1,214 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "output/classic_writer.hpp"
+#include "output/macroman.hpp"
+#include "diagnostic/log.hpp"
+
+// The resource data area begins after the header and the reserved system and
+// application areas.
+static const uint32_t data_area_offset = 256;
+
+// MARK: - Helpers
+
+static inline void put_u8(std::vector<char>& out, uint8_t v)
+{
+    out.push_back(static_cast<char>(v));
+}
+
+static inline void put_u16(std::vector<char>& out, uint16_t v)
+{
+    out.push_back(static_cast<char>(v >> 8));
+    out.push_back(static_cast<char>(v));
+}
+
+static inline void put_u24(std::vector<char>& out, uint32_t v)
+{
+    out.push_back(static_cast<char>(v >> 16));
+    out.push_back(static_cast<char>(v >> 8));
+    out.push_back(static_cast<char>(v));
+}
+
+static inline void put_u32(std::vector<char>& out, uint32_t v)
+{
+    out.push_back(static_cast<char>(v >> 24));
+    out.push_back(static_cast<char>(v >> 16));
+    out.push_back(static_cast<char>(v >> 8));
+    out.push_back(static_cast<char>(v));
+}
+
+// MARK: - Constructor
+
+kdk::classic_writer::classic_writer(const std::string& path)
+    : m_path(path), m_file(path)
+{
+    // Reserve the header and the system/application areas. The header is patched
+    // once the layout of the file is known.
+    std::vector<char> reserved(data_area_offset, 0);
+    m_file.append(reserved.data(), reserved.size());
+}
+
+// MARK: - Resources
+
+void kdk::classic_writer::add_resource(const std::string& code, int64_t id, const std::string& name, std::shared_ptr<graphite::data::data> data)
+{
+    add_resources({ std::make_tuple(code, id, name, data) }, m_serial);
+}
+
+void kdk::classic_writer::add_resources(const std::vector<assembled_resource>& resources, kdk::worker_pool& pool)
+{
+    // Every resource is validated, and its type found, before any data is written.
+    std::vector<std::tuple<std::size_t, std::string>> entries;
+    std::vector<kdk::output_file::blob> blobs;
+    entries.reserve(resources.size());
+    blobs.reserve(resources.size());
+    for (const auto& resource : resources) {
+        const auto& code = std::get<0>(resource);
+        auto id = std::get<1>(resource);
+        const auto& name = std::get<2>(resource);
+        const auto& data = std::get<3>(resource);
+        
+        if (id < INT16_MIN || id > INT16_MAX) {
+            log::error(m_path, 0, "Resource id " + std::to_string(id) + " of type '" + code + "' can not be represented in a classic resource file.");
+        }
+        
+        auto type_code = kdk::macroman::from_utf8(code);
+        if (type_code.size() != 4) {
+            log::error(m_path, 0, "Resource type code '" + code + "' must be exactly 4 characters.");
+        }
+        
+        auto resource_name = kdk::macroman::from_utf8(name);
+        if (resource_name.size() > 255) {
+            log::error(m_path, 0, "Resource name '" + name + "' is longer than 255 characters.");
+        }
+        
+        // Types are recorded in the order in which they are first encountered. Resources
+        // are typically added grouped by type, so the most recent type is checked first.
+        auto type_index = m_types.size();
+        if (!m_types.empty() && m_types.back().code == type_code) {
+            type_index = m_types.size() - 1;
+        }
+        else {
+            for (auto n = 0; n < m_types.size(); ++n) {
+                if (m_types[n].code == type_code) {
+                    type_index = n;
+                    break;
+                }
+            }
+            if (type_index == m_types.size()) {
+                m_types.push_back({ type_code, {} });
+            }
+        }
+        entries.emplace_back(type_index, resource_name);
+        
+        // Each resource in the data area is preceded by its length.
+        kdk::output_file::blob blob { {}, data->get()->data() + data->start(), data->size() };
+        put_u32(blob.header, static_cast<uint32_t>(data->size()));
+        blobs.push_back(std::move(blob));
+    }
+    
+    // Resources with identical data refer to the same entry of the data area. Resource
+    // data offsets are stored as 24-bit values in the map.
+    auto offsets = m_file.append_unique(blobs, 1, pool);
+    for (auto n = 0; n < resources.size(); ++n) {
+        auto offset = offsets[n] - data_area_offset;
+        if (offset > 0xFFFFFF) {
+            log::error(m_path, 0, "Resource data exceeds the 16MiB limit of a classic resource file.");
+        }
+        
+        const auto& entry = entries[n];
+        m_types[std::get<0>(entry)].references.push_back({ static_cast<int16_t>(std::get<1>(resources[n])), std::get<1>(entry), static_cast<uint32_t>(offset) });
+    }
+    m_data_length = m_file.size() - data_area_offset;
+}
+
+std::tuple<uint64_t, uint64_t> kdk::classic_writer::shared_data() const
+{
+    return std::make_tuple(m_file.shared_count(), m_file.shared_bytes());
+}
+
+void kdk::classic_writer::finish()
+{
+    // Construct the resource map. The type list immediately follows the 28 byte map
+    // header, and the reference lists follow the type list.
+    uint32_t reference_count = 0;
+    for (const auto& t : m_types) {
+        reference_count += t.references.size();
+    }
+    
+    uint32_t type_list_offset = 28;
+    uint32_t type_list_length = 2 + 8 * m_types.size();
+    uint32_t name_list_offset = type_list_offset + type_list_length + 12 * reference_count;
+    if (name_list_offset > 0xFFFF) {
+        log::error(m_path, 0, "Too many resources to be represented in a classic resource file.");
+    }
+    
+    std::vector<char> names;
+    std::vector<char> references;
+    std::vector<char> map;
+    map.resize(24, 0);
+    put_u16(map, static_cast<uint16_t>(type_list_offset));
+    put_u16(map, static_cast<uint16_t>(name_list_offset));
+    put_u16(map, static_cast<uint16_t>(m_types.size() - 1));
+    
+    uint32_t reference_list_offset = type_list_length;
+    for (const auto& t : m_types) {
+        map.insert(map.end(), t.code.begin(), t.code.end());
+        put_u16(map, static_cast<uint16_t>(t.references.size() - 1));
+        put_u16(map, static_cast<uint16_t>(reference_list_offset));
+        reference_list_offset += 12 * t.references.size();
+        
+        for (const auto& ref : t.references) {
+            put_u16(references, static_cast<uint16_t>(ref.id));
+            if (ref.name.empty()) {
+                put_u16(references, 0xFFFF);
+            }
+            else {
+                if (names.size() > 0x7FFF) {
+                    log::error(m_path, 0, "Too many resource names to be represented in a classic resource file.");
+                }
+                put_u16(references, static_cast<uint16_t>(names.size()));
+                put_u8(names, static_cast<uint8_t>(ref.name.size()));
+                names.insert(names.end(), ref.name.begin(), ref.name.end());
+            }
+            put_u8(references, 0);
+            put_u24(references, ref.data_offset);
+            put_u32(references, 0);
+        }
+    }
+    map.insert(map.end(), references.begin(), references.end());
+    map.insert(map.end(), names.begin(), names.end());
+    
+    // The header describes the location of the data area and the map. A copy of it is
+    // also kept at the start of the map.
+    auto map_offset = data_area_offset + m_data_length;
+    std::vector<char> header;
+    put_u32(header, data_area_offset);
+    put_u32(header, static_cast<uint32_t>(map_offset));
+    put_u32(header, static_cast<uint32_t>(m_data_length));
+    put_u32(header, static_cast<uint32_t>(map.size()));
+    std::copy(header.begin(), header.end(), map.begin());
+    
+    m_file.append(map.data(), map.size());
+    m_file.write_at(header.data(), header.size(), 0);
+    m_file.close();
+}
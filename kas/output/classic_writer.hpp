@@ -0,0 +1,88 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include "output/resource_writer.hpp"
+#include "output/output_file.hpp"
+
+#if !defined(KDK_CLASSIC_WRITER)
+#define KDK_CLASSIC_WRITER
+
+namespace kdk
+{
+
+/**
+ * The classic writer produces a classic Resource Manager fork. Resource data goes
+ * straight into the data area of the file, and only the resource map is kept in memory.
+ * The map is written once all resources have been added, and the header at the start of
+ * the file is then patched to describe it.
+ *
+ * Resources with identical data share a single copy of it in the data area.
+ */
+class classic_writer : public kdk::resource_writer
+{
+public:
+    classic_writer(const classic_writer&) = delete;
+    classic_writer& operator=(const classic_writer &) = delete;
+    
+    /**
+     * Construct a new classic writer, creating (or truncating) the file at the
+     * specified path.
+     */
+    classic_writer(const std::string& path);
+    
+    void add_resource(const std::string& code, int64_t id, const std::string& name, std::shared_ptr<graphite::data::data> data) override;
+    void add_resources(const std::vector<assembled_resource>& resources, kdk::worker_pool& pool) override;
+    void finish() override;
+    std::tuple<uint64_t, uint64_t> shared_data() const override;
+    
+private:
+    /**
+     * A reference to a resource that has been written into the data area.
+     */
+    struct reference
+    {
+        int16_t id;
+        std::string name;
+        uint32_t data_offset;
+    };
+    
+    /**
+     * All of the references of a single resource type.
+     */
+    struct type
+    {
+        std::string code;
+        std::vector<reference> references;
+    };
+    
+    std::string m_path;
+    kdk::output_file m_file;
+    std::vector<type> m_types;
+    uint64_t m_data_length { 0 };
+    kdk::worker_pool m_serial { 1 };
+};
+
+};
+
+#endif
@@ -0,0 +1,63 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <fstream>
+#include "output/depfile.hpp"
+#include "diagnostic/log.hpp"
+
+// MARK: - Helpers
+
+static std::string escape(const std::string& path)
+{
+    // Make treats spaces, '#' and '$' specially in rules. Ninja follows the same rules
+    // when reading depfiles.
+    std::string result;
+    for (auto c : path) {
+        if (c == ' ' || c == '#') {
+            result.push_back('\\');
+        }
+        else if (c == '$') {
+            result.push_back('$');
+        }
+        result.push_back(c);
+    }
+    return result;
+}
+
+// MARK: - Writing
+
+void kdk::depfile::write(const std::string& path, const std::vector<std::string>& outputs, const std::vector<std::string>& dependencies)
+{
+    std::ofstream f(path, std::ios::trunc);
+    if (!f.is_open()) {
+        log::error(path, 0, "Unable to write the dependency file.");
+    }
+    
+    for (auto n = 0; n < outputs.size(); ++n) {
+        f << (n > 0 ? " " : "") << escape(outputs[n]);
+    }
+    f << ":";
+    for (const auto& dependency : dependencies) {
+        f << " \\" << std::endl << "  " << escape(dependency);
+    }
+    f << std::endl;
+}
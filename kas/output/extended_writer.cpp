@@ -0,0 +1,254 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <limits>
+#include "output/extended_writer.hpp"
+#include "output/macroman.hpp"
+#include "kestrel/compression.hpp"
+#include "diagnostic/log.hpp"
+
+// The version of the format, given at the start of the preamble.
+static const uint64_t format_version = 1;
+
+// The resource data area begins after the preamble and its reserved space.
+static const uint64_t data_area_offset = 256;
+
+// The map begins with a copy of the preamble without its version: the offsets and
+// lengths of the data area and map. That is followed by the handle of the next map, the
+// file reference number, the attributes of the file, and the offsets of the type, name
+// and attribute lists.
+static const uint64_t map_preamble_length = 4 * sizeof(uint64_t);
+static const uint64_t map_header_length = map_preamble_length + sizeof(uint64_t) + sizeof(uint32_t) + sizeof(uint16_t) + 3 * sizeof(uint64_t);
+
+// A type in the type list is its code, the number of its resources less one, the offset
+// of its reference list, and the number and offset of its attributes.
+static const uint64_t type_entry_length = 4 + 4 * sizeof(uint64_t);
+
+// A reference is the id of the resource, the offset of its name, its attributes, the
+// offset of its data and a reserved handle.
+static const uint64_t reference_entry_length = sizeof(int64_t) + sizeof(uint64_t) + sizeof(uint8_t) + sizeof(uint64_t) + sizeof(uint32_t);
+
+// The name offset of a resource without a name.
+static const uint64_t no_name = std::numeric_limits<uint64_t>::max();
+
+// The attribute of a resource whose data is compressed, as in the classic format.
+static const uint8_t resource_compressed = 1 << 0;
+
+// MARK: - Helpers
+
+static inline void put_u8(std::vector<char>& out, uint8_t v)
+{
+    out.push_back(static_cast<char>(v));
+}
+
+static inline void put_u16(std::vector<char>& out, uint16_t v)
+{
+    out.push_back(static_cast<char>(v >> 8));
+    out.push_back(static_cast<char>(v));
+}
+
+static inline void put_u32(std::vector<char>& out, uint32_t v)
+{
+    out.push_back(static_cast<char>(v >> 24));
+    out.push_back(static_cast<char>(v >> 16));
+    out.push_back(static_cast<char>(v >> 8));
+    out.push_back(static_cast<char>(v));
+}
+
+static inline void put_u64(std::vector<char>& out, uint64_t v)
+{
+    put_u32(out, static_cast<uint32_t>(v >> 32));
+    put_u32(out, static_cast<uint32_t>(v));
+}
+
+// MARK: - Constructor
+
+kdk::extended_writer::extended_writer(const std::string& path, bool compresses)
+    : m_path(path), m_compresses(compresses), m_file(path)
+{
+    // Reserve the preamble, which is patched once the layout of the file is known.
+    std::vector<char> reserved(data_area_offset, 0);
+    m_file.append(reserved.data(), reserved.size());
+}
+
+// MARK: - Resources
+
+void kdk::extended_writer::add_resource(const std::string& code, int64_t id, const std::string& name, std::shared_ptr<graphite::data::data> data)
+{
+    add_resources({ std::make_tuple(code, id, name, data) }, m_serial);
+}
+
+void kdk::extended_writer::add_resources(const std::vector<assembled_resource>& resources, kdk::worker_pool& pool)
+{
+    // Every resource is validated, and its type found, before any data is written.
+    std::vector<std::tuple<std::size_t, std::string>> entries;
+    entries.reserve(resources.size());
+    for (const auto& resource : resources) {
+        const auto& code = std::get<0>(resource);
+        const auto& name = std::get<2>(resource);
+        
+        auto type_code = kdk::macroman::from_utf8(code);
+        if (type_code.size() != 4) {
+            log::error(m_path, 0, "Resource type code '" + code + "' must be exactly 4 characters.");
+        }
+        
+        auto resource_name = kdk::macroman::from_utf8(name);
+        if (resource_name.size() > 255) {
+            log::error(m_path, 0, "Resource name '" + name + "' is longer than 255 characters.");
+        }
+        
+        // Types are recorded in the order in which they are first encountered. Resources
+        // are typically added grouped by type, so the most recent type is checked first.
+        auto type_index = m_types.size();
+        if (!m_types.empty() && m_types.back().code == type_code) {
+            type_index = m_types.size() - 1;
+        }
+        else {
+            for (auto n = 0; n < m_types.size(); ++n) {
+                if (m_types[n].code == type_code) {
+                    type_index = n;
+                    break;
+                }
+            }
+            if (type_index == m_types.size()) {
+                m_types.push_back({ type_code, {} });
+            }
+        }
+        entries.emplace_back(type_index, resource_name);
+    }
+    
+    // Each resource in the data area is preceded by its length. Resources are compressed
+    // in parallel, and compressed data, which is preceded by its decompressed size, is
+    // only kept if it is smaller than the original data.
+    std::vector<std::vector<char>> blocks(resources.size());
+    std::vector<kdk::output_file::blob> blobs(resources.size());
+    std::vector<uint8_t> attributes(resources.size(), 0);
+    pool.parallel_for(resources.size(), [&] (std::size_t n) {
+        const auto& data = std::get<3>(resources[n]);
+        auto& blob = blobs[n];
+        blob.bytes = data->get()->data() + data->start();
+        blob.size = data->size();
+        if (m_compresses && blob.size > sizeof(uint64_t) && kdk::kestrel::compress(blob.bytes, blob.size, blocks[n], blob.size - sizeof(uint64_t) - 1)) {
+            put_u64(blob.header, sizeof(uint64_t) + blocks[n].size());
+            put_u64(blob.header, blob.size);
+            blob.bytes = blocks[n].data();
+            blob.size = blocks[n].size();
+            attributes[n] = resource_compressed;
+        }
+        else {
+            put_u64(blob.header, blob.size);
+        }
+    });
+    
+    // Resources with identical data refer to the same entry of the data area.
+    auto offsets = m_file.append_unique(blobs, 1, pool);
+    for (auto n = 0; n < resources.size(); ++n) {
+        const auto& entry = entries[n];
+        m_types[std::get<0>(entry)].references.push_back({ std::get<1>(resources[n]), std::get<1>(entry), attributes[n], offsets[n] - data_area_offset });
+    }
+    m_data_length = m_file.size() - data_area_offset;
+}
+
+std::tuple<uint64_t, uint64_t> kdk::extended_writer::shared_data() const
+{
+    return std::make_tuple(m_file.shared_count(), m_file.shared_bytes());
+}
+
+void kdk::extended_writer::finish()
+{
+    // Construct the resource map. The type list immediately follows the map header, the
+    // reference lists follow the type list, and the names follow the reference lists.
+    // KAS gives types no attributes, so the attribute list is empty.
+    uint64_t reference_count = 0;
+    for (const auto& t : m_types) {
+        reference_count += t.references.size();
+    }
+    
+    uint64_t type_list_offset = map_header_length;
+    uint64_t type_list_length = sizeof(uint64_t) + type_entry_length * m_types.size();
+    uint64_t name_list_offset = type_list_offset + type_list_length + reference_entry_length * reference_count;
+    
+    std::vector<char> names;
+    std::vector<char> references;
+    std::vector<char> map;
+    // The copy of the preamble is filled in last. The handle of the next map, the file
+    // reference number and the attributes of the file are all zero.
+    map.resize(map_preamble_length, 0);
+    put_u64(map, 0);
+    put_u32(map, 0);
+    put_u16(map, 0);
+    put_u64(map, type_list_offset);
+    put_u64(map, name_list_offset);
+    // The empty attribute list follows the names, so its offset is patched once their
+    // length is known.
+    auto attribute_list_field = map.size();
+    put_u64(map, 0);
+    put_u64(map, m_types.size() - 1);
+    
+    uint64_t reference_list_offset = type_list_length;
+    for (const auto& t : m_types) {
+        map.insert(map.end(), t.code.begin(), t.code.end());
+        put_u64(map, t.references.size() - 1);
+        put_u64(map, reference_list_offset);
+        
+        // The type has no attributes.
+        put_u64(map, 0);
+        put_u64(map, 0);
+        reference_list_offset += reference_entry_length * t.references.size();
+        
+        for (const auto& ref : t.references) {
+            put_u64(references, static_cast<uint64_t>(ref.id));
+            if (ref.name.empty()) {
+                put_u64(references, no_name);
+            }
+            else {
+                put_u64(references, names.size());
+                put_u8(names, static_cast<uint8_t>(ref.name.size()));
+                names.insert(names.end(), ref.name.begin(), ref.name.end());
+            }
+            put_u8(references, ref.attributes);
+            put_u64(references, ref.data_offset);
+            put_u32(references, 0);
+        }
+    }
+    map.insert(map.end(), references.begin(), references.end());
+    map.insert(map.end(), names.begin(), names.end());
+    
+    std::vector<char> attribute_list_offset;
+    put_u64(attribute_list_offset, map.size());
+    std::copy(attribute_list_offset.begin(), attribute_list_offset.end(), map.begin() + attribute_list_field);
+    
+    // The preamble describes the location of the data area and the map. A copy of it,
+    // without the version, is also kept at the start of the map.
+    auto map_offset = data_area_offset + m_data_length;
+    std::vector<char> preamble;
+    put_u64(preamble, format_version);
+    put_u64(preamble, data_area_offset);
+    put_u64(preamble, map_offset);
+    put_u64(preamble, m_data_length);
+    put_u64(preamble, map.size());
+    std::copy(preamble.end() - map_preamble_length, preamble.end(), map.begin());
+    
+    m_file.append(map.data(), map.size());
+    m_file.write_at(preamble.data(), preamble.size(), 0);
+    m_file.close();
+}
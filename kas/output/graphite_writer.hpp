@@ -0,0 +1,56 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "output/resource_writer.hpp"
+#include "libGraphite/rsrc/file.hpp"
+
+#if !defined(KDK_GRAPHITE_WRITER)
+#define KDK_GRAPHITE_WRITER
+
+namespace kdk
+{
+
+/**
+ * The Graphite writer collects resources into an in-memory `graphite::rsrc::file`
+ * and writes the complete file when finished. It is used for the formats that are
+ * only implemented by Graphite.
+ */
+class graphite_writer : public kdk::resource_writer
+{
+public:
+    /**
+     * Construct a new Graphite writer for the specified output path and format.
+     */
+    graphite_writer(const std::string& path, graphite::rsrc::file::format format);
+    
+    void add_resource(const std::string& code, int64_t id, const std::string& name, std::shared_ptr<graphite::data::data> data) override;
+    void finish() override;
+    
+private:
+    std::string m_path;
+    graphite::rsrc::file::format m_format;
+    std::shared_ptr<graphite::rsrc::file> m_file;
+};
+
+};
+
+#endif
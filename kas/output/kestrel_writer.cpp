@@ -0,0 +1,211 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <algorithm>
+#include <tuple>
+#include "output/kestrel_writer.hpp"
+#include "kestrel/compression.hpp"
+#include "diagnostic/log.hpp"
+
+// MARK: - Helpers
+
+static inline void put_u32(std::vector<char>& out, uint32_t v)
+{
+    for (auto n = 0; n < 4; ++n) {
+        out.push_back(static_cast<char>(v >> (8 * n)));
+    }
+}
+
+static inline void put_u64(std::vector<char>& out, uint64_t v)
+{
+    for (auto n = 0; n < 8; ++n) {
+        out.push_back(static_cast<char>(v >> (8 * n)));
+    }
+}
+
+static inline void align(std::vector<char>& out, uint64_t base, std::size_t alignment)
+{
+    while ((base + out.size()) % alignment != 0) {
+        out.push_back(0);
+    }
+}
+
+// MARK: - Constructor
+
+kdk::kestrel_writer::kestrel_writer(const std::string& path, bool compresses)
+    : m_path(path), m_compresses(compresses), m_file(path)
+{
+    // Reserve the header, which is written once the layout of the file is known.
+    std::vector<char> header(sizeof(kdk::kestrel::header), 0);
+    m_file.append(header.data(), header.size());
+    m_file.align(kdk::kestrel::data_alignment);
+}
+
+// MARK: - Resources
+
+void kdk::kestrel_writer::add_resource(const std::string& code, int64_t id, const std::string& name, std::shared_ptr<graphite::data::data> data)
+{
+    add_resources({ std::make_tuple(code, id, name, data) }, m_serial);
+}
+
+void kdk::kestrel_writer::add_resources(const std::vector<assembled_resource>& resources, kdk::worker_pool& pool)
+{
+    std::vector<uint32_t> types(resources.size(), 0);
+    for (auto n = 0; n < resources.size(); ++n) {
+        const auto& code = std::get<0>(resources[n]);
+        if (!kdk::kestrel::pack_type_code(code, types[n])) {
+            log::error(m_path, 0, "Resource type code '" + code + "' must be exactly 4 characters.");
+        }
+    }
+    
+    // Resources are compressed in parallel. Compressed data is only kept if it, along
+    // with its decompressed size, is smaller than the original data.
+    std::vector<std::vector<char>> blocks(resources.size());
+    std::vector<kdk::output_file::blob> blobs(resources.size());
+    pool.parallel_for(resources.size(), [&] (std::size_t n) {
+        const auto& data = std::get<3>(resources[n]);
+        auto& blob = blobs[n];
+        blob.bytes = data->get()->data() + data->start();
+        blob.size = data->size();
+        if (m_compresses && blob.size > sizeof(uint64_t) && kdk::kestrel::compress(blob.bytes, blob.size, blocks[n], blob.size - sizeof(uint64_t) - 1)) {
+            put_u64(blob.header, blob.size);
+            blob.bytes = blocks[n].data();
+            blob.size = blocks[n].size();
+        }
+    });
+    
+    // Compression is deterministic, so resources with identical data also have identical
+    // stored data, which is shared between them.
+    auto offsets = m_file.append_unique(blobs, kdk::kestrel::data_alignment, pool);
+    for (auto n = 0; n < resources.size(); ++n) {
+        const auto& blob = blobs[n];
+        auto flags = blob.header.empty() ? 0 : kdk::kestrel::resource_compressed;
+        m_references.push_back({ types[n], std::get<0>(resources[n]), std::get<1>(resources[n]), std::get<2>(resources[n]), flags, offsets[n], blob.header.size() + blob.size });
+    }
+}
+
+std::tuple<uint64_t, uint64_t> kdk::kestrel_writer::shared_data() const
+{
+    return std::make_tuple(m_file.shared_count(), m_file.shared_bytes());
+}
+
+void kdk::kestrel_writer::finish()
+{
+    // The index is sorted so that resources can be found by binary search. Resources of
+    // the same type and id can not be told apart, and so are not allowed.
+    std::stable_sort(m_references.begin(), m_references.end(), [] (const reference& lhs, const reference& rhs) {
+        return std::tie(lhs.type, lhs.id) < std::tie(rhs.type, rhs.id);
+    });
+    for (auto n = 1; n < m_references.size(); ++n) {
+        if (m_references[n - 1].type == m_references[n].type && m_references[n - 1].id == m_references[n].id) {
+            log::error(m_path, 0, "Duplicate resource id " + std::to_string(m_references[n].id) + " of type '" + m_references[n].code + "'.");
+        }
+    }
+    
+    // The tables follow the resource data. Each name is followed by a NUL, so that it may
+    // be used directly as a C string.
+    auto index_offset = m_file.size();
+    std::vector<char> tables;
+    std::vector<char> names;
+    std::vector<std::tuple<uint32_t, uint64_t, uint64_t>> types;
+    std::size_t named_count = 0;
+    uint32_t file_flags = 0;
+    for (auto n = 0; n < m_references.size(); ++n) {
+        const auto& ref = m_references[n];
+        if (types.empty() || std::get<0>(types.back()) != ref.type) {
+            types.emplace_back(ref.type, n, 0);
+        }
+        std::get<2>(types.back())++;
+        
+        if (names.size() + ref.name.size() + 1 > UINT32_MAX) {
+            log::error(m_path, 0, "Resource names exceed the 4GiB limit of a Kestrel data file.");
+        }
+        put_u32(tables, ref.type);
+        put_u32(tables, ref.flags);
+        put_u64(tables, static_cast<uint64_t>(ref.id));
+        put_u64(tables, ref.data_offset);
+        put_u64(tables, ref.data_size);
+        put_u32(tables, static_cast<uint32_t>(names.size()));
+        put_u32(tables, static_cast<uint32_t>(ref.name.size()));
+        names.insert(names.end(), ref.name.begin(), ref.name.end());
+        names.push_back(0);
+        named_count += ref.name.empty() ? 0 : 1;
+        if (ref.flags & kdk::kestrel::resource_compressed) {
+            file_flags |= kdk::kestrel::file_has_compressed_resources;
+        }
+    }
+    
+    auto type_offset = index_offset + tables.size();
+    for (const auto& type : types) {
+        put_u32(tables, std::get<0>(type));
+        put_u32(tables, 0);
+        put_u64(tables, std::get<1>(type));
+        put_u64(tables, std::get<2>(type));
+    }
+    
+    // The name table is an open addressed hash table, kept at most half full, of which
+    // each slot holds one more than the index of a named resource, or zero if empty.
+    uint64_t slot_count = 0;
+    if (named_count > 0) {
+        for (slot_count = 1; slot_count < 2 * named_count; slot_count <<= 1);
+    }
+    std::vector<uint64_t> slots(slot_count, 0);
+    for (auto n = 0; n < m_references.size(); ++n) {
+        const auto& ref = m_references[n];
+        if (ref.name.empty()) {
+            continue;
+        }
+        auto slot = kdk::kestrel::name_hash(ref.type, ref.name.data(), ref.name.size()) & (slot_count - 1);
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        slots[slot] = n + 1;
+    }
+    
+    auto name_table_offset = index_offset + tables.size();
+    for (auto slot : slots) {
+        put_u64(tables, slot);
+    }
+    
+    auto names_offset = index_offset + tables.size();
+    tables.insert(tables.end(), names.begin(), names.end());
+    align(tables, index_offset, 8);
+    m_file.append(tables.data(), tables.size());
+    
+    std::vector<char> header(kdk::kestrel::magic, kdk::kestrel::magic + sizeof(kdk::kestrel::magic));
+    put_u32(header, kdk::kestrel::version);
+    put_u32(header, file_flags);
+    put_u64(header, m_file.size());
+    put_u64(header, m_references.size());
+    put_u64(header, index_offset);
+    put_u64(header, types.size());
+    put_u64(header, type_offset);
+    put_u64(header, slot_count);
+    put_u64(header, name_table_offset);
+    put_u64(header, names_offset);
+    put_u64(header, names.size());
+    put_u32(header, kdk::kestrel::data_alignment);
+    put_u32(header, 0);
+    
+    m_file.write_at(header.data(), header.size(), 0);
+    m_file.close();
+}
@@ -0,0 +1,86 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include "output/resource_writer.hpp"
+#include "output/output_file.hpp"
+#include "kestrel/format.hpp"
+
+#if !defined(KDK_KESTREL_WRITER)
+#define KDK_KESTREL_WRITER
+
+namespace kdk
+{
+
+/**
+ * The Kestrel writer produces an indexed Kestrel data file. The data of each resource
+ * is aligned for direct use from a memory mapping. The index, type table and name table
+ * are built once all resources have been added, and the header at the start of the file
+ * is then patched to locate them.
+ *
+ * Resources with identical data share a single copy of it. When compression is enabled,
+ * the data of each resource is compressed if doing so makes it smaller, and is flagged
+ * as compressed in the index.
+ */
+class kestrel_writer : public kdk::resource_writer
+{
+public:
+    kestrel_writer(const kestrel_writer&) = delete;
+    kestrel_writer& operator=(const kestrel_writer &) = delete;
+    
+    /**
+     * Construct a new Kestrel writer, creating (or truncating) the file at the
+     * specified path, and optionally compressing the data of resources.
+     */
+    kestrel_writer(const std::string& path, bool compresses = false);
+    
+    void add_resource(const std::string& code, int64_t id, const std::string& name, std::shared_ptr<graphite::data::data> data) override;
+    void add_resources(const std::vector<assembled_resource>& resources, kdk::worker_pool& pool) override;
+    void finish() override;
+    std::tuple<uint64_t, uint64_t> shared_data() const override;
+    
+private:
+    /**
+     * A resource whose data has been written into the file.
+     */
+    struct reference
+    {
+        uint32_t type;
+        std::string code;
+        int64_t id;
+        std::string name;
+        uint32_t flags;
+        uint64_t data_offset;
+        uint64_t data_size;
+    };
+    
+    std::string m_path;
+    bool m_compresses { false };
+    kdk::output_file m_file;
+    std::vector<reference> m_references;
+    kdk::worker_pool m_serial { 1 };
+};
+
+};
+
+#endif
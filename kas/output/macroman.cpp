@@ -0,0 +1,124 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <cstdint>
+#include "output/macroman.hpp"
+
+// The Unicode code points of MacRoman characters 0x80 - 0xFF.
+static const uint16_t macroman_table[128] = {
+    0x00C4, 0x00C5, 0x00C7, 0x00C9, 0x00D1, 0x00D6, 0x00DC, 0x00E1,
+    0x00E0, 0x00E2, 0x00E4, 0x00E3, 0x00E5, 0x00E7, 0x00E9, 0x00E8,
+    0x00EA, 0x00EB, 0x00ED, 0x00EC, 0x00EE, 0x00EF, 0x00F1, 0x00F3,
+    0x00F2, 0x00F4, 0x00F6, 0x00F5, 0x00FA, 0x00F9, 0x00FB, 0x00FC,
+    0x2020, 0x00B0, 0x00A2, 0x00A3, 0x00A7, 0x2022, 0x00B6, 0x00DF,
+    0x00AE, 0x00A9, 0x2122, 0x00B4, 0x00A8, 0x2260, 0x00C6, 0x00D8,
+    0x221E, 0x00B1, 0x2264, 0x2265, 0x00A5, 0x00B5, 0x2202, 0x2211,
+    0x220F, 0x03C0, 0x222B, 0x00AA, 0x00BA, 0x03A9, 0x00E6, 0x00F8,
+    0x00BF, 0x00A1, 0x00AC, 0x221A, 0x0192, 0x2248, 0x2206, 0x00AB,
+    0x00BB, 0x2026, 0x00A0, 0x00C0, 0x00C3, 0x00D5, 0x0152, 0x0153,
+    0x2013, 0x2014, 0x201C, 0x201D, 0x2018, 0x2019, 0x00F7, 0x25CA,
+    0x00FF, 0x0178, 0x2044, 0x20AC, 0x2039, 0x203A, 0xFB01, 0xFB02,
+    0x2021, 0x00B7, 0x201A, 0x201E, 0x2030, 0x00C2, 0x00CA, 0x00C1,
+    0x00CB, 0x00C8, 0x00CD, 0x00CE, 0x00CF, 0x00CC, 0x00D3, 0x00D4,
+    0xF8FF, 0x00D2, 0x00DA, 0x00DB, 0x00D9, 0x0131, 0x02C6, 0x02DC,
+    0x00AF, 0x02D8, 0x02D9, 0x02DA, 0x00B8, 0x02DD, 0x02DB, 0x02C7,
+};
+
+std::string kdk::macroman::from_utf8(const std::string& str)
+{
+    std::string result;
+    result.reserve(str.size());
+    
+    for (auto n = 0; n < str.size();) {
+        auto c = static_cast<uint8_t>(str[n]);
+        
+        // Decode the next code point.
+        uint32_t code_point = 0;
+        auto length = 1;
+        if (c < 0x80) {
+            code_point = c;
+        }
+        else if ((c & 0xE0) == 0xC0) {
+            code_point = c & 0x1F;
+            length = 2;
+        }
+        else if ((c & 0xF0) == 0xE0) {
+            code_point = c & 0x0F;
+            length = 3;
+        }
+        else if ((c & 0xF8) == 0xF0) {
+            code_point = c & 0x07;
+            length = 4;
+        }
+        
+        for (auto i = 1; i < length && n + i < str.size(); ++i) {
+            code_point = (code_point << 6) | (static_cast<uint8_t>(str[n + i]) & 0x3F);
+        }
+        n += length;
+        
+        // Map it onto MacRoman.
+        if (code_point < 0x80) {
+            result.push_back(static_cast<char>(code_point));
+            continue;
+        }
+        
+        auto mapped = '?';
+        for (auto i = 0; i < 128; ++i) {
+            if (macroman_table[i] == code_point) {
+                mapped = static_cast<char>(0x80 + i);
+                break;
+            }
+        }
+        result.push_back(mapped);
+    }
+    
+    return result;
+}
+
+std::string kdk::macroman::to_utf8(const std::string& str)
+{
+    std::string result;
+    result.reserve(str.size());
+    
+    for (auto c : str) {
+        uint32_t code_point = static_cast<uint8_t>(c);
+        if (code_point >= 0x80) {
+            code_point = macroman_table[code_point - 0x80];
+        }
+        
+        // Encode the code point, which is always within the Basic Multilingual Plane.
+        if (code_point < 0x80) {
+            result.push_back(static_cast<char>(code_point));
+        }
+        else if (code_point < 0x800) {
+            result.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+            result.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        }
+        else {
+            result.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+            result.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+            result.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+        }
+    }
+    
+    return result;
+}
@@ -0,0 +1,53 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+
+#if !defined(KDK_MACROMAN)
+#define KDK_MACROMAN
+
+namespace kdk
+{
+
+/**
+ * Conversions between UTF-8, as used in KDL source, and the MacRoman encoding used by
+ * resource type codes and resource names in classic resource files.
+ */
+namespace macroman
+{
+
+/**
+ * Convert a UTF-8 string to MacRoman. Characters that can not be represented in
+ * MacRoman are replaced with '?'.
+ */
+std::string from_utf8(const std::string& str);
+
+/**
+ * Convert a MacRoman string to UTF-8.
+ */
+std::string to_utf8(const std::string& str);
+
+};
+
+};
+
+#endif
@@ -0,0 +1,128 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <thread>
+#include <exception>
+#include <algorithm>
+#include <functional>
+#include "output/multi_writer.hpp"
+#include "diagnostic/log.hpp"
+
+// MARK: - Constructor
+
+kdk::multi_writer::multi_writer(std::vector<std::shared_ptr<kdk::resource_writer>> writers)
+    : m_writers(std::move(writers))
+{
+    
+}
+
+// MARK: - Writing
+
+void kdk::multi_writer::each_writer(const std::function<void(std::size_t)>& task)
+{
+    // Every writer but the first is driven by a thread of its own, and the first by the
+    // calling thread. The first error is reported once every writer has finished.
+    auto scoped = log::scope::active();
+    auto sink = log::scope::current();
+    std::vector<std::exception_ptr> errors(m_writers.size());
+    std::vector<std::thread> threads;
+    for (auto n = 1; n < m_writers.size(); ++n) {
+        threads.emplace_back([&, n] {
+            try {
+                if (scoped) {
+                    log::scope scope { sink };
+                    task(n);
+                }
+                else {
+                    task(n);
+                }
+            }
+            catch (...) {
+                errors[n] = std::current_exception();
+            }
+        });
+    }
+    
+    try {
+        if (!m_writers.empty()) {
+            task(0);
+        }
+    }
+    catch (...) {
+        errors[0] = std::current_exception();
+    }
+    
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+void kdk::multi_writer::add_resource(const std::string& code, int64_t id, const std::string& name, std::shared_ptr<graphite::data::data> data)
+{
+    each_writer([&] (std::size_t n) {
+        m_writers[n]->add_resource(code, id, name, data);
+    });
+}
+
+void kdk::multi_writer::add_resources(const std::vector<assembled_resource>& resources, kdk::worker_pool& pool)
+{
+    // A worker pool performs one task at a time, so the writers can not share the pool of
+    // the caller whilst they run at once. Its threads are instead divided between pools
+    // of their own.
+    if (m_pools.empty()) {
+        auto threads = std::max<std::size_t>(1, pool.thread_count() / std::max<std::size_t>(1, m_writers.size()));
+        for (auto n = 0; n < m_writers.size(); ++n) {
+            m_pools.emplace_back(new kdk::worker_pool(threads));
+        }
+    }
+    
+    each_writer([&] (std::size_t n) {
+        m_writers[n]->add_resources(resources, *m_pools[n]);
+    });
+}
+
+void kdk::multi_writer::finish()
+{
+    // Formats such as rez are only serialised once every resource has been added, so
+    // finishing the outputs at once also saves time.
+    each_writer([&] (std::size_t n) {
+        m_writers[n]->finish();
+    });
+}
+
+// MARK: - Statistics
+
+std::tuple<uint64_t, uint64_t> kdk::multi_writer::shared_data() const
+{
+    // Outputs that share data share the same resources, but save different amounts in
+    // their own formats. The greatest saving is reported.
+    std::tuple<uint64_t, uint64_t> shared { 0, 0 };
+    for (const auto& writer : m_writers) {
+        shared = std::max(shared, writer->shared_data());
+    }
+    return shared;
+}
@@ -0,0 +1,68 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include "output/resource_writer.hpp"
+
+#if !defined(KDK_MULTI_WRITER)
+#define KDK_MULTI_WRITER
+
+namespace kdk
+{
+
+/**
+ * The multi writer writes the same resources to several outputs, so that a build may
+ * produce several formats whilst assembling each resource only once. The assembled data
+ * of each resource is shared by every output. Each batch of resources is added to every
+ * output at once, each output being written by a thread of its own, and the outputs are
+ * finished in parallel in the same way.
+ */
+class multi_writer : public kdk::resource_writer
+{
+public:
+    /**
+     * Construct a new multi writer for the specified writers.
+     */
+    multi_writer(std::vector<std::shared_ptr<kdk::resource_writer>> writers);
+    
+    void add_resource(const std::string& code, int64_t id, const std::string& name, std::shared_ptr<graphite::data::data> data) override;
+    void add_resources(const std::vector<assembled_resource>& resources, kdk::worker_pool& pool) override;
+    void finish() override;
+    std::tuple<uint64_t, uint64_t> shared_data() const override;
+    
+private:
+    std::vector<std::shared_ptr<kdk::resource_writer>> m_writers;
+    std::vector<std::unique_ptr<kdk::worker_pool>> m_pools;
+    
+    /**
+     * Invoke the task once for each writer, with its index, each on a thread of its own.
+     * This does not return until every invocation has finished. If any invocation throws,
+     * the first exception is rethrown.
+     */
+    void each_writer(const std::function<void(std::size_t)>& task);
+};
+
+};
+
+#endif
@@ -0,0 +1,261 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <tuple>
+#include "output/output_file.hpp"
+#include "cache/hasher.hpp"
+#include "diagnostic/log.hpp"
+
+// Buffered data is written to disk once this many bytes have accumulated.
+static const std::size_t flush_threshold = 1 << 20;
+
+// MARK: - Constructor
+
+kdk::output_file::output_file(const std::string& path)
+    : m_path(path)
+{
+    // The file is also opened for reading, so that bytes appended as unique can be
+    // compared with those that have already been written.
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0) {
+        log::error(m_path, 0, "Unable to open output file: " + std::string(strerror(errno)));
+    }
+    m_buffer.reserve(flush_threshold);
+}
+
+kdk::output_file::~output_file()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+// MARK: - Writing
+
+void kdk::output_file::append(const char *bytes, std::size_t size)
+{
+    m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+    m_size += size;
+    if (m_buffer.size() >= flush_threshold) {
+        flush();
+    }
+}
+
+std::vector<uint64_t> kdk::output_file::append_unique(const std::vector<blob>& blobs, std::size_t alignment, kdk::worker_pool& pool)
+{
+    // Everything appended so far is written to disk first, so that earlier blobs can be
+    // read back for comparison, and new blobs written directly to their place.
+    flush();
+    
+    // Blobs with the same digest are almost certainly identical, but are compared to be
+    // sure before they are shared. Digests are computed in parallel.
+    std::vector<std::string> digests(blobs.size());
+    pool.parallel_for(blobs.size(), [&] (std::size_t n) {
+        const auto& blob = blobs[n];
+        digests[n] = kdk::hasher()
+            .update(static_cast<uint64_t>(blob.header.size() + blob.size))
+            .update(blob.header.data(), blob.header.size())
+            .update(blob.bytes, blob.size)
+            .digest();
+    });
+    
+    // The offset of each blob is the sum of the sizes of the new blobs before it. A blob
+    // that matches one earlier in the batch is compared in memory, as the earlier blob
+    // has not been written yet.
+    auto start = m_size;
+    auto end = m_size;
+    std::vector<uint64_t> offsets(blobs.size(), 0);
+    std::vector<char> fresh(blobs.size(), 0);
+    std::unordered_map<uint64_t, std::size_t> batch_offsets;
+    for (std::size_t n = 0; n < blobs.size(); ++n) {
+        const auto& blob = blobs[n];
+        auto size = blob.header.size() + blob.size;
+        end = (end + alignment - 1) / alignment * alignment;
+        offsets[n] = end;
+        if (size == 0) {
+            continue;
+        }
+        
+        auto& candidates = m_unique[digests[n]];
+        auto shared = false;
+        for (auto offset : candidates) {
+            if (offset < start) {
+                shared = matches(blob, offset);
+            }
+            else {
+                const auto& other = blobs[batch_offsets.at(offset)];
+                shared = blob.header == other.header && blob.size == other.size && std::memcmp(blob.bytes, other.bytes, blob.size) == 0;
+            }
+            if (shared) {
+                offsets[n] = offset;
+                m_shared_count++;
+                m_shared_bytes += size;
+                break;
+            }
+        }
+        if (!shared) {
+            candidates.push_back(end);
+            batch_offsets[end] = n;
+            fresh[n] = 1;
+            end += size;
+        }
+    }
+    end = (end + alignment - 1) / alignment * alignment;
+    
+    // Extending the file fills it with zeros, so any padding between blobs does not need
+    // to be written.
+    if (end > start && ::ftruncate(m_fd, static_cast<off_t>(end)) != 0) {
+        log::error(m_path, 0, "Unable to extend output file: " + std::string(strerror(errno)));
+    }
+    m_size = end;
+    
+    // New blobs are written in runs of about the size of the buffer, each gathered into
+    // a single write, as writing small blobs one at a time is dominated by system calls.
+    std::vector<std::tuple<std::size_t, std::size_t>> runs;
+    for (std::size_t n = 0; n < blobs.size(); ++n) {
+        if (!fresh[n]) {
+            continue;
+        }
+        if (runs.empty() || offsets[n] - offsets[std::get<0>(runs.back())] >= flush_threshold) {
+            runs.emplace_back(n, n + 1);
+        }
+        std::get<1>(runs.back()) = n + 1;
+    }
+    
+    pool.parallel_for(runs.size(), [&] (std::size_t r) {
+        auto first = std::get<0>(runs[r]);
+        auto last = std::get<1>(runs[r]);
+        if (last - first == 1) {
+            const auto& blob = blobs[first];
+            write_fully(blob.header.data(), blob.header.size(), offsets[first]);
+            write_fully(blob.bytes, blob.size, offsets[first] + blob.header.size());
+            return;
+        }
+        
+        // Padding between the blobs of the run is left as zeros.
+        uint64_t run_start = offsets[first];
+        uint64_t run_end = run_start;
+        for (auto n = first; n < last; ++n) {
+            if (fresh[n]) {
+                run_end = offsets[n] + blobs[n].header.size() + blobs[n].size;
+            }
+        }
+        std::vector<char> buffer(run_end - run_start, 0);
+        for (auto n = first; n < last; ++n) {
+            if (fresh[n]) {
+                const auto& blob = blobs[n];
+                auto destination = buffer.data() + (offsets[n] - run_start);
+                std::copy(blob.header.begin(), blob.header.end(), destination);
+                std::memcpy(destination + blob.header.size(), blob.bytes, blob.size);
+            }
+        }
+        write_fully(buffer.data(), buffer.size(), run_start);
+    });
+    return offsets;
+}
+
+bool kdk::output_file::matches(const kdk::output_file::blob& blob, uint64_t offset)
+{
+    auto size = blob.header.size() + blob.size;
+    m_compare.resize(size);
+    std::size_t position = 0;
+    while (position < size) {
+        auto count = ::pread(m_fd, m_compare.data() + position, size - position, static_cast<off_t>(offset + position));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            log::error(m_path, 0, "Unable to read output file: " + std::string(strerror(errno)));
+        }
+        position += count;
+    }
+    return std::equal(blob.header.begin(), blob.header.end(), m_compare.begin())
+        && std::memcmp(m_compare.data() + blob.header.size(), blob.bytes, blob.size) == 0;
+}
+
+void kdk::output_file::align(std::size_t alignment)
+{
+    static const char zeros[64] = { 0 };
+    while (m_size % alignment != 0) {
+        append(zeros, std::min<std::size_t>(sizeof(zeros), alignment - m_size % alignment));
+    }
+}
+
+uint64_t kdk::output_file::size() const
+{
+    return m_size;
+}
+
+void kdk::output_file::flush()
+{
+    // The buffer is written at its own offset, rather than at the position of the file,
+    // as blobs may have been written beyond it.
+    write_fully(m_buffer.data(), m_buffer.size(), m_size - m_buffer.size());
+    m_buffer.clear();
+}
+
+void kdk::output_file::write_at(const char *bytes, std::size_t size, uint64_t offset)
+{
+    // Buffered bytes are written first, so that they do not later overwrite these.
+    flush();
+    write_fully(bytes, size, offset);
+}
+
+void kdk::output_file::write_fully(const char *bytes, std::size_t size, uint64_t offset) const
+{
+    while (size > 0) {
+        auto written = ::pwrite(m_fd, bytes, size, static_cast<off_t>(offset));
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            log::error(m_path, 0, "Unable to write output file: " + std::string(strerror(errno)));
+        }
+        bytes += written;
+        size -= written;
+        offset += written;
+    }
+}
+
+void kdk::output_file::close()
+{
+    flush();
+    ::close(m_fd);
+    m_fd = -1;
+}
+
+// MARK: - Statistics
+
+uint64_t kdk::output_file::shared_count() const
+{
+    return m_shared_count;
+}
+
+uint64_t kdk::output_file::shared_bytes() const
+{
+    return m_shared_bytes;
+}
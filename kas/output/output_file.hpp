@@ -0,0 +1,146 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "concurrency/worker_pool.hpp"
+
+#if !defined(KDK_OUTPUT_FILE)
+#define KDK_OUTPUT_FILE
+
+namespace kdk
+{
+
+/**
+ * An output file that is written sequentially through a buffer. Parts of the file that
+ * can only be completed once everything else has been written, such as headers, may
+ * later be written in place. Failure to write the file is an error.
+ *
+ * Blobs that are appended as unique are shared with any identical blobs that were
+ * previously appended as unique, rather than being written again.
+ */
+class output_file
+{
+public:
+    output_file(const output_file&) = delete;
+    output_file& operator=(const output_file &) = delete;
+    
+    /**
+     * Create (or truncate) the file at the specified path.
+     */
+    output_file(const std::string& path);
+    
+    /**
+     * Close the file, if it has not already been closed.
+     */
+    ~output_file();
+    
+    /**
+     * Append bytes to the file, writing them to disk once enough have accumulated.
+     */
+    void append(const char *bytes, std::size_t size);
+    
+    /**
+     * A blob of bytes to be appended to the file, consisting of a short header followed
+     * by a body. The body is not copied, and must remain valid until it has been written.
+     */
+    struct blob
+    {
+        std::vector<char> header;
+        const char *bytes;
+        std::size_t size;
+    };
+    
+    /**
+     * Append each of the blobs to the file, starting each one at a multiple of the
+     * alignment, unless an identical blob has already been appended by this method. The
+     * offset of every blob is determined first, and the file is extended to its new
+     * size. The blobs are then written into place, in parallel, by the threads of the
+     * pool, so a batch is written as soon as it is appended. Returns the offset of each
+     * blob in the file.
+     */
+    std::vector<uint64_t> append_unique(const std::vector<blob>& blobs, std::size_t alignment, kdk::worker_pool& pool);
+    
+    /**
+     * Append zero bytes until the size of the file is a multiple of the alignment.
+     */
+    void align(std::size_t alignment);
+    
+    /**
+     * Returns the number of bytes that have been appended to the file.
+     */
+    uint64_t size() const;
+    
+    /**
+     * Overwrite bytes that have already been appended to the file.
+     */
+    void write_at(const char *bytes, std::size_t size, uint64_t offset);
+    
+    /**
+     * Write all buffered bytes to disk and close the file.
+     */
+    void close();
+    
+    /**
+     * Returns the number of times that bytes appended as unique were shared with earlier
+     * identical bytes.
+     */
+    uint64_t shared_count() const;
+    
+    /**
+     * Returns the number of bytes that were not written because they were shared.
+     */
+    uint64_t shared_bytes() const;
+    
+private:
+    std::string m_path;
+    int m_fd { -1 };
+    std::vector<char> m_buffer;
+    uint64_t m_size { 0 };
+    std::unordered_map<std::string, std::vector<uint64_t>> m_unique;
+    std::vector<char> m_compare;
+    uint64_t m_shared_count { 0 };
+    uint64_t m_shared_bytes { 0 };
+    
+    /**
+     * Write all buffered bytes to disk.
+     */
+    void flush();
+    
+    /**
+     * Write bytes to the specified offset of the file, bypassing the buffer. This may be
+     * called from several threads at once, provided that they write to different bytes.
+     */
+    void write_fully(const char *bytes, std::size_t size, uint64_t offset) const;
+    
+    /**
+     * Returns true if the bytes at the specified offset of the file, which must already
+     * have been written to disk, are identical to the blob.
+     */
+    bool matches(const kdk::output_file::blob& blob, uint64_t offset);
+};
+
+};
+
+#endif
@@ -0,0 +1,69 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "output/resource_writer.hpp"
+#include "output/classic_writer.hpp"
+#include "output/extended_writer.hpp"
+#include "output/graphite_writer.hpp"
+#include "output/kestrel_writer.hpp"
+
+// MARK: - Destructor
+
+kdk::resource_writer::~resource_writer()
+{
+    
+}
+
+// MARK: - Resources
+
+void kdk::resource_writer::add_resources(const std::vector<assembled_resource>& resources, kdk::worker_pool& pool)
+{
+    for (const auto& resource : resources) {
+        add_resource(std::get<0>(resource), std::get<1>(resource), std::get<2>(resource), std::get<3>(resource));
+    }
+}
+
+// MARK: - Statistics
+
+std::tuple<uint64_t, uint64_t> kdk::resource_writer::shared_data() const
+{
+    return std::make_tuple(0, 0);
+}
+
+// MARK: - Factory
+
+std::shared_ptr<kdk::resource_writer> kdk::resource_writer::open(const std::string& path, kdk::output_format format, bool compresses)
+{
+    // The classic, extended and Kestrel formats are written by KAS directly, and stream
+    // resource data to disk. Rez is handed to Graphite, which builds the file in memory.
+    switch (format) {
+        case kdk::output_format::classic:
+            return std::make_shared<kdk::classic_writer>(path);
+        case kdk::output_format::kestrel:
+            return std::make_shared<kdk::kestrel_writer>(path, compresses);
+        case kdk::output_format::extended:
+            return std::make_shared<kdk::extended_writer>(path, compresses);
+        case kdk::output_format::rez:
+        default:
+            return std::make_shared<kdk::graphite_writer>(path, graphite::rsrc::file::format::rez);
+    }
+}
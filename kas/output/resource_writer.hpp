@@ -0,0 +1,99 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <tuple>
+#include <cstdint>
+#include "libGraphite/data/data.hpp"
+#include "concurrency/worker_pool.hpp"
+
+#if !defined(KDK_RESOURCE_WRITER)
+#define KDK_RESOURCE_WRITER
+
+namespace kdk
+{
+
+/**
+ * The formats in which resources may be written.
+ */
+enum class output_format
+{
+    classic,
+    extended,
+    rez,
+    kestrel,
+};
+
+/**
+ * The resource writer is the interface through which assembled resources are written
+ * into an output file. Resources are handed to the writer in their final order, as
+ * soon as they have been assembled. Writers that are able to will write the data of
+ * each resource out immediately, rather than holding it until the end of the build.
+ */
+class resource_writer
+{
+public:
+    /**
+     * An assembled resource: its type code, id, name and data.
+     */
+    typedef std::tuple<std::string, int64_t, std::string, std::shared_ptr<graphite::data::data>> assembled_resource;
+    
+    virtual ~resource_writer();
+    
+    /**
+     * Open a new resource writer for the specified output path and format. Resource data
+     * is compressed if requested and if the format supports it, which the extended and
+     * Kestrel formats do.
+     */
+    static std::shared_ptr<kdk::resource_writer> open(const std::string& path, kdk::output_format format, bool compresses = false);
+    
+    /**
+     * Add an assembled resource to the output.
+     */
+    virtual void add_resource(const std::string& code, int64_t id, const std::string& name, std::shared_ptr<graphite::data::data> data) = 0;
+    
+    /**
+     * Add a batch of assembled resources to the output, in order. Writers may use the
+     * threads of the pool to prepare and write the resources of the batch in parallel.
+     * By default, each resource is added in turn.
+     */
+    virtual void add_resources(const std::vector<assembled_resource>& resources, kdk::worker_pool& pool);
+    
+    /**
+     * Finish writing the output. No more resources may be added once the output has
+     * been finished.
+     */
+    virtual void finish() = 0;
+    
+    /**
+     * Returns the number of resources whose data was identical to that of an earlier
+     * resource, and so was shared with it rather than written again, along with the
+     * number of bytes that this saved. Writers that do not share data return zeros.
+     */
+    virtual std::tuple<uint64_t, uint64_t> shared_data() const;
+};
+
+};
+
+#endif
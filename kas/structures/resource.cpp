@@ -43,7 +43,7 @@ std::string kdk::resource::field::name() const
     return m_name;
 }
 
-std::vector<std::tuple<std::string, kdk::resource::field::value_type>> kdk::resource::field::values() const
+const std::vector<std::tuple<std::string, kdk::resource::field::value_type>>& kdk::resource::field::values() const
 {
     return m_values;
 }
@@ -63,6 +63,23 @@ std::shared_ptr<kdk::resource::field> kdk::resource::field_named(const std::stri
     return nullptr;
 }
 
+const std::vector<kdk::resource::field>& kdk::resource::fields() const
+{
+    return m_fields;
+}
+
+std::size_t kdk::resource::footprint() const
+{
+    auto size = sizeof(kdk::resource) + m_type.capacity() + m_name.capacity();
+    for (const auto& field : m_fields) {
+        size += sizeof(kdk::resource::field) + field.name().capacity();
+        for (const auto& value : field.values()) {
+            size += sizeof(value) + std::get<0>(value).capacity();
+        }
+    }
+    return size;
+}
+
 // MARK: - Accessors
 
 int64_t kdk::resource::id() const
@@ -51,7 +51,8 @@ public:
     public:
         
         /**
-         * The type of a value encoded in the field.
+         * The type of a value encoded in the field. Image references are made by
+         * `kdk::image_cache::reference()`.
          */
         enum value_type
         {
@@ -62,6 +63,7 @@ public:
             percentage,
             file_reference,
             color,
+            image_reference,
         };
         
     public:
@@ -78,7 +80,7 @@ public:
         /**
          * Returns the vector containing the values.
          */
-        std::vector<std::tuple<std::string, resource::field::value_type>> values() const;
+        const std::vector<std::tuple<std::string, resource::field::value_type>>& values() const;
         
     private:
         std::string m_name;
@@ -117,6 +119,16 @@ public:
      */
     std::shared_ptr<resource::field> field_named(const std::string name, bool required = false) const;
     
+    /**
+     * Returns all of the fields of the resource, in the order they were added.
+     */
+    const std::vector<resource::field>& fields() const;
+    
+    /**
+     * Returns an estimate of the number of bytes of memory occupied by the resource.
+     */
+    std::size_t footprint() const;
+    
 private:
     int64_t m_id { 0 };
     std::string m_type { "" };
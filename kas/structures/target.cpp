@@ -20,47 +20,370 @@
 * SOFTWARE.
 */
 
+#include <map>
 #include "structures/target.hpp"
 #include "assemblers/assembler.hpp"
 #include "assemblers/pool.hpp"
+#include "output/multi_writer.hpp"
+#include "image/image_cache.hpp"
+#include "diagnostic/log.hpp"
+
+// The approximate number of bytes of assembled resource data that is held in memory
+// at once whilst building, when no memory limit has been set.
+static const uint64_t default_batch_limit = 32 << 20;
 
 // MARK: - Constructor
 
-kdk::target::target(std::string path)
-    : m_path(path)
+kdk::target::target(std::string path, std::shared_ptr<kdk::assembler_pool> assemblers)
+    : m_path(path), m_assemblers(assemblers)
 {
-    
+    // Targets that are not given an assembler pool share the pool of the process.
+    if (!m_assemblers) {
+        m_assemblers = std::shared_ptr<kdk::assembler_pool>(std::shared_ptr<kdk::assembler_pool>(), &kdk::assembler_pool::shared());
+    }
+}
+
+kdk::target::~target()
+{
+    if (m_pipeline.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_queue_lock);
+            m_closing = true;
+            m_queue_changed.notify_all();
+        }
+        m_pipeline.join();
+    }
+    end_importing();
 }
 
 // MARK: - Resource Management
 
-void kdk::target::add_resources(const std::vector<kdk::resource> resources)
+void kdk::target::add_resources(std::vector<kdk::resource> resources)
 {
+    if (m_writer) {
+        uint64_t footprint = 0;
+        for (const auto& resource : resources) {
+            footprint += resource.footprint();
+        }
+        
+        // Apply backpressure whilst the queued resources exceed their share of the memory
+        // limit. A block is always accepted when the queue is empty, so that a single block
+        // that is larger than the limit can still be built.
+        std::unique_lock<std::mutex> lock(m_queue_lock);
+        if (m_memory_limit > 0) {
+            auto queue_limit = m_memory_limit - batch_limit();
+            m_queue_changed.wait(lock, [&] {
+                return m_pipeline_error || m_queue.empty() || m_queued_bytes + footprint <= queue_limit;
+            });
+        }
+        
+        // If assembly has failed then there is no point in continuing to parse.
+        if (m_pipeline_error) {
+            std::rethrow_exception(m_pipeline_error);
+        }
+        m_queue.emplace_back(std::move(resources), footprint);
+        m_queued_bytes += footprint;
+        m_queue_changed.notify_all();
+        return;
+    }
+    
     m_resources.reserve(m_resources.size() + resources.size());
     m_resources.insert(m_resources.end(),
                        std::make_move_iterator(resources.begin()),
                        std::make_move_iterator(resources.end()));
 }
 
+const std::vector<kdk::resource>& kdk::target::resources() const
+{
+    return m_resources;
+}
+
+kdk::assembler_pool& kdk::target::assemblers() const
+{
+    return *m_assemblers;
+}
+
+// MARK: - Dependencies
+
+void kdk::target::add_dependency(const std::string& path)
+{
+    if (m_dependency_set.insert(path).second) {
+        m_dependencies.push_back(path);
+    }
+}
+
+const std::vector<std::string>& kdk::target::dependencies() const
+{
+    return m_dependencies;
+}
+
 // MARK: - Build
 
-void kdk::target::build(graphite::rsrc::file::format format)
+void kdk::target::set_job_count(std::size_t jobs)
 {
-    auto rf = std::make_shared<graphite::rsrc::file>();
+    m_jobs = jobs;
+}
+
+void kdk::target::set_memory_limit(uint64_t bytes)
+{
+    m_memory_limit = bytes;
+}
+
+void kdk::target::set_outputs(std::vector<std::tuple<std::string, kdk::output_format>> outputs)
+{
+    m_outputs = std::move(outputs);
+}
+
+void kdk::target::set_compression(bool compresses)
+{
+    m_compresses = compresses;
+}
+
+void kdk::target::set_cache(std::shared_ptr<kdk::assembly_cache> cache)
+{
+    m_cache = cache;
+}
+
+std::shared_ptr<kdk::resource_writer> kdk::target::open_writer(kdk::output_format format) const
+{
+    if (m_outputs.empty()) {
+        return kdk::resource_writer::open(m_path, format, m_compresses);
+    }
     
-    // Iterate through each of the resources and construct the data for each of them.
-    // Currently this is done by manually testing the type and invoking the appropriate
-    // type assembler. This could be improved by making KDL more extensible.
-    for (auto resource : m_resources) {
-        auto type = resource.type();
+    std::vector<std::shared_ptr<kdk::resource_writer>> writers;
+    for (const auto& output : m_outputs) {
+        writers.push_back(kdk::resource_writer::open(std::get<0>(output), std::get<1>(output), m_compresses));
+    }
+    return writers.size() == 1 ? writers.front() : std::make_shared<kdk::multi_writer>(writers);
+}
+
+uint64_t kdk::target::batch_limit() const
+{
+    // When a memory limit is set, half of it is given to assembled data and the other
+    // half to resources waiting to be assembled.
+    if (m_memory_limit > 0) {
+        return m_memory_limit / 2;
+    }
+    return default_batch_limit;
+}
+
+void kdk::target::begin_importing()
+{
+    if (!m_importing) {
+        m_importing = true;
+        kdk::image_cache::shared().begin_build();
+    }
+}
+
+void kdk::target::end_importing()
+{
+    if (m_importing) {
+        m_importing = false;
+        kdk::image_cache::shared().end_build();
+    }
+}
+
+void kdk::target::begin(kdk::output_format format)
+{
+    m_writer = open_writer(format);
+    m_pool = std::make_shared<kdk::worker_pool>(m_jobs);
+    begin_importing();
+    
+    // The pipeline thread reports its diagnostics to the scope of the thread that began
+    // the build, if it has one.
+    if (log::scope::active()) {
+        auto sink = log::scope::current();
+        m_pipeline = std::thread([this, sink] {
+            log::scope scope { sink };
+            pipeline_main();
+        });
+        return;
+    }
+    m_pipeline = std::thread(&kdk::target::pipeline_main, this);
+}
+
+void kdk::target::pipeline_main()
+{
+    try {
+        while (true) {
+            std::vector<kdk::resource> resources;
+            uint64_t footprint = 0;
+            {
+                std::unique_lock<std::mutex> lock(m_queue_lock);
+                m_queue_changed.wait(lock, [&] { return m_closing || !m_queue.empty(); });
+                if (m_queue.empty()) {
+                    return;
+                }
+                std::tie(resources, footprint) = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            
+            write_resources(resources);
+            
+            // The source model of the resources is no longer needed once they have been written.
+            resources.clear();
+            resources.shrink_to_fit();
+            
+            std::lock_guard<std::mutex> lock(m_queue_lock);
+            m_queued_bytes -= footprint;
+            m_queue_changed.notify_all();
+        }
+    }
+    catch (...) {
+        // The error is reported to the thread that is adding resources, or building.
+        std::lock_guard<std::mutex> lock(m_queue_lock);
+        m_pipeline_error = std::current_exception();
+        m_queue.clear();
+        m_queued_bytes = 0;
+        m_queue_changed.notify_all();
+    }
+}
+
+void kdk::target::build(kdk::output_format format)
+{
+    // The build's use of the image cache ends with the build, whether or not it succeeds.
+    try {
+        if (m_writer) {
+            {
+                std::lock_guard<std::mutex> lock(m_queue_lock);
+                m_closing = true;
+                m_queue_changed.notify_all();
+            }
+            m_pipeline.join();
+            
+            if (m_pipeline_error) {
+                std::rethrow_exception(m_pipeline_error);
+            }
+        }
+        else {
+            m_writer = open_writer(format);
+            m_pool = std::make_shared<kdk::worker_pool>(m_jobs);
+            begin_importing();
+            write_resources(m_resources);
+        }
         
-        auto assembler = kdk::assembler_pool::shared().assembler_named(type);
-        if (std::get<1>(assembler)) {
-            auto data = std::get<1>(assembler)->assemble_resource(resource);
-            rf->add_resource(std::get<0>(assembler), resource.id(), resource.name(), data);
+        m_writer->finish();
+    }
+    catch (...) {
+        end_importing();
+        throw;
+    }
+    end_importing();
+}
+
+std::tuple<uint64_t, uint64_t> kdk::target::shared_data() const
+{
+    return m_writer ? m_writer->shared_data() : std::make_tuple(uint64_t(0), uint64_t(0));
+}
+
+void kdk::target::write_resources(const std::vector<kdk::resource>& resources)
+{
+    auto& pool = *m_pool;
+    
+    // Resolve the assembler for each resource and measure exactly how much space it will
+    // occupy once assembled. This allows a single buffer to be allocated for each resource
+    // type, with every resource of the type being assembled directly into a slice of it.
+    std::vector<std::tuple<std::string, std::shared_ptr<kdk::assembler>>> assemblers;
+    assemblers.reserve(resources.size());
+    for (auto& resource : resources) {
+        assemblers.push_back(m_assemblers->assembler_named(resource.type()));
+    }
+    
+    // Resources whose assembled data is in the cache do not need to be measured, as the
+    // size of the cached data is known.
+    std::vector<uint64_t> sizes(resources.size(), 0);
+    std::vector<std::string> keys(m_cache ? resources.size() : 0);
+    std::vector<char> cached(resources.size(), 0);
+    if (m_cache) {
+        pool.parallel_for(resources.size(), [&] (std::size_t n) {
+            keys[n] = std::get<1>(assemblers[n])->cache_key(resources[n]);
+            cached[n] = m_cache->find(keys[n], sizes[n]) ? 1 : 0;
+        });
+    }
+    
+    // The images imported by the resources that need assembling are decoded up front,
+    // across the whole pool, so that measuring and assembling only copy their data.
+    std::vector<std::string> images;
+    for (auto n = 0; n < resources.size(); ++n) {
+        if (cached[n]) {
+            continue;
+        }
+        for (const auto& field : resources[n].fields()) {
+            for (const auto& value : field.values()) {
+                if (std::get<1>(value) == kdk::resource::field::value_type::image_reference) {
+                    images.push_back(std::get<0>(value));
+                }
+            }
         }
     }
+    kdk::image_cache::shared().import(images, pool);
     
-    // The resource file should be assembled at this point and just needs writting to disk.
-    rf->write(m_path, format);
+    pool.parallel_for(resources.size(), [&] (std::size_t n) {
+        if (!cached[n]) {
+            sizes[n] = std::get<1>(assemblers[n])->measure_resource(resources[n]);
+        }
+    });
+    
+    // Resources are assembled in batches, and each batch is handed to the writer as soon
+    // as it has been assembled. Only the data of the current batch is held in memory.
+    // Imported images are held until the build ends, so they count against the memory
+    // that is given to assembled data.
+    auto limit = batch_limit();
+    if (m_memory_limit > 0) {
+        auto images = kdk::image_cache::shared().footprint();
+        limit = images < limit ? limit - images : 0;
+    }
+    for (std::size_t first = 0; first < resources.size();) {
+        std::size_t last = first;
+        uint64_t batch_size = 0;
+        while (last < resources.size() && (last == first || batch_size + sizes[last] <= limit)) {
+            batch_size += sizes[last++];
+        }
+        
+        // The offset of each resource in the buffer of its type is determined by the order
+        // of the resources, so the output does not depend on how the work was scheduled.
+        std::vector<uint64_t> offsets(last - first, 0);
+        std::map<kdk::assembler *, uint64_t> type_sizes;
+        for (auto n = first; n < last; ++n) {
+            auto& type_size = type_sizes[std::get<1>(assemblers[n]).get()];
+            offsets[n - first] = type_size;
+            type_size += sizes[n];
+        }
+        
+        std::map<kdk::assembler *, std::shared_ptr<std::vector<char>>> type_buffers;
+        for (auto type_size : type_sizes) {
+            type_buffers[type_size.first] = std::make_shared<std::vector<char>>(type_size.second, 0);
+        }
+        
+        // Assemble each of the resources into its pre-indexed slot. Assembly only reads the
+        // resource and the compiled type definition, so resources can be assembled in parallel.
+        // Cached resources are read straight into their slot instead.
+        std::vector<std::shared_ptr<graphite::data::data>> data(last - first);
+        pool.parallel_for(last - first, [&] (std::size_t n) {
+            auto assembler = std::get<1>(assemblers[first + n]);
+            auto buffer = type_buffers.at(assembler.get());
+            if (cached[first + n]) {
+                m_cache->load(keys[first + n], buffer->data() + offsets[n], sizes[first + n]);
+                data[n] = std::make_shared<graphite::data::data>(buffer, sizes[first + n], offsets[n]);
+                return;
+            }
+            
+            data[n] = assembler->assemble_resource(resources[first + n], buffer, offsets[n], sizes[first + n]);
+            if (m_cache) {
+                m_cache->store(keys[first + n], buffer->data() + offsets[n], data[n]->size());
+            }
+        });
+        
+        // Hand the batch to the writer in its original order. The writer decides where each
+        // resource is placed in the output before writing them in parallel.
+        std::vector<kdk::resource_writer::assembled_resource> assembled;
+        assembled.reserve(last - first);
+        for (auto n = first; n < last; ++n) {
+            const auto& resource = resources[n];
+            assembled.emplace_back(std::get<0>(assemblers[n]), resource.id(), resource.name(), data[n - first]);
+        }
+        m_writer->add_resources(assembled, pool);
+        
+        first = last;
+    }
 }
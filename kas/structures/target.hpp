@@ -22,8 +22,18 @@
 
 #include <string>
 #include <vector>
+#include <deque>
+#include <set>
+#include <tuple>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 #include "structures/resource.hpp"
-#include "libGraphite/rsrc/file.hpp"
+#include "concurrency/worker_pool.hpp"
+#include "output/resource_writer.hpp"
+#include "cache/assembly_cache.hpp"
+#include "assemblers/pool.hpp"
 
 #if !defined(KDK_TARGET)
 #define KDK_TARGET
@@ -43,27 +53,158 @@ class target
 {
 public:
     /**
-     * Construct a new target with the specified output path.
+     * Construct a new target with the specified output path. The types of the resources
+     * of the target are resolved, and defined, through the specified assembler pool, or
+     * the shared pool if none is specified.
      */
-    target(std::string path);
+    target(std::string path, std::shared_ptr<kdk::assembler_pool> assemblers = nullptr);
+    
+    /**
+     * Stop the pipeline thread, if a pipelined build was started but not completed.
+     */
+    ~target();
     
     /**
      * Add resources to the target.
+     *
+     * If a pipelined build has been started, then the resources are queued to be assembled
+     * and written immediately. This blocks whilst the resources that are waiting to be
+     * assembled exceed the memory limit of the target.
      */
-    void add_resources(const std::vector<kdk::resource> resources);
+    void add_resources(std::vector<kdk::resource> resources);
+    
+    /**
+     * Returns the resources that have been added to the target, and that are waiting to
+     * be built. Resources added to a pipelined build are not retained.
+     */
+    const std::vector<kdk::resource>& resources() const;
+    
+    /**
+     * Returns the assembler pool through which the types of the target are resolved.
+     */
+    kdk::assembler_pool& assemblers() const;
+    
+    /**
+     * Record that the output of the target depends upon the specified file.
+     */
+    void add_dependency(const std::string& path);
+    
+    /**
+     * Returns every file that the output of the target depends upon, in the order in
+     * which they were first recorded.
+     */
+    const std::vector<std::string>& dependencies() const;
+    
+    /**
+     * Set the number of threads that should be used to assemble resources.
+     * If zero is specified then the number of hardware threads is used.
+     */
+    void set_job_count(std::size_t jobs);
+    
+    /**
+     * Set the approximate number of bytes of memory that the build may use to hold
+     * resources, their assembled data and the images that they import. Zero means no
+     * limit.
+     */
+    void set_memory_limit(uint64_t bytes);
+    
+    /**
+     * Set the outputs that the target is written to, as a path and format for each,
+     * in place of its own path. The resources are assembled once and written to every
+     * output, and the format passed to `begin` or `build` is ignored.
+     */
+    void set_outputs(std::vector<std::tuple<std::string, kdk::output_format>> outputs);
+    
+    /**
+     * Set whether the data of resources should be compressed, in those outputs whose
+     * format supports it.
+     */
+    void set_compression(bool compresses);
+    
+    /**
+     * Set the assembly cache that should be used to reuse the assembled data of resources
+     * that have not changed since a previous build.
+     */
+    void set_cache(std::shared_ptr<kdk::assembly_cache> cache);
+    
+    /**
+     * Begin a pipelined build of the target.
+     *
+     * Resources added after this point are assembled and written to the output on a
+     * separate thread as they are added, rather than being held until the build. All of
+     * the types used by a resource must have been defined before it is added.
+     */
+    void begin(kdk::output_format = kdk::output_format::classic);
     
     /**
      * Build the kestrel data file.
      *
      * This method will begin the process of validating all of the resources added
      * to the target, converting them into data objects and assembling the resource
-     * file.
+     * file. If a pipelined build was started, then this waits for every resource to be
+     * written and completes the output file. The format passed to `begin` is used.
+     */
+    void build(kdk::output_format = kdk::output_format::classic);
+    
+    /**
+     * Returns the number of resources of the last build whose data was shared with an
+     * identical resource, rather than written again, and the number of bytes saved.
      */
-    void build(graphite::rsrc::file::format = graphite::rsrc::file::format::classic);
+    std::tuple<uint64_t, uint64_t> shared_data() const;
     
 private:
     std::string m_path;
+    std::vector<std::tuple<std::string, kdk::output_format>> m_outputs;
+    std::shared_ptr<kdk::assembler_pool> m_assemblers;
+    std::size_t m_jobs { 1 };
+    bool m_compresses { false };
+    uint64_t m_memory_limit { 0 };
+    std::shared_ptr<kdk::assembly_cache> m_cache;
     std::vector<kdk::resource> m_resources;
+    std::vector<std::string> m_dependencies;
+    std::set<std::string> m_dependency_set;
+    
+    std::shared_ptr<kdk::resource_writer> m_writer;
+    std::shared_ptr<kdk::worker_pool> m_pool;
+    std::thread m_pipeline;
+    std::mutex m_queue_lock;
+    std::condition_variable m_queue_changed;
+    std::deque<std::tuple<std::vector<kdk::resource>, uint64_t>> m_queue;
+    uint64_t m_queued_bytes { 0 };
+    bool m_closing { false };
+    std::exception_ptr m_pipeline_error;
+    bool m_importing { false };
+    
+    /**
+     * Open the writer for the outputs of the target.
+     */
+    std::shared_ptr<kdk::resource_writer> open_writer(kdk::output_format format) const;
+    
+    /**
+     * The number of bytes of assembled data that may be held in memory at once.
+     */
+    uint64_t batch_limit() const;
+    
+    /**
+     * Begin the use of the image cache by the build. The images that the build imports
+     * are held until `end_importing()`, which is called once the build ends or fails.
+     */
+    void begin_importing();
+    
+    /**
+     * End the use of the image cache by the build, if it has begun.
+     */
+    void end_importing();
+    
+    /**
+     * Assemble the specified resources and hand them to the writer, in order.
+     */
+    void write_resources(const std::vector<kdk::resource>& resources);
+    
+    /**
+     * The main loop of the pipeline thread.
+     */
+    void pipeline_main();
 };
 
 };
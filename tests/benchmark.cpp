@@ -0,0 +1,758 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "image/image.hpp"
+#include "image/pict.hpp"
+#include "image/rled.hpp"
+#include "kestrel/compression.hpp"
+#include "lsp/json.hpp"
+#include "lsp/language_server.hpp"
+
+// Measures the assembler on generated inputs. Each benchmark writes its inputs to a work
+// directory, then either runs the `kas` binary that was built beside this one or calls
+// into the library directly, and prints its timings.
+//
+//   kas-benchmark <work-directory> [benchmark ...]
+//
+// runs the named benchmarks, or all of them:
+//
+// - scaling:     a 120,000 resource build with -j 1 to 16, checking that every output is
+//                identical to the serial one.
+// - server:      a two resource build as a new process and through a warm compile
+//                server, and the 120,000 resource build through the server.
+// - watch:       a 400 file, 2,000 resource build in watch mode, and the time from an
+//                edit to one field until the output has been rewritten.
+// - lsp:         keystrokes, newlines, completions and definition edits in a 120,000
+//                line document open in the language server.
+// - compression: 20,000 text resources built with and without --compress, and the speed
+//                of decompression.
+// - rled:        encoding the frames of 48x48 sprites.
+// - pict:        encoding interface sized images as pictures.
+//
+// Use a release build. The image encoders use their scalar loops rather than SSE2 when
+// configured with -DCMAKE_CXX_FLAGS=-U__SSE2__.
+
+// MARK: - Timing
+
+typedef std::chrono::steady_clock benchmark_clock;
+
+static inline double milliseconds_since(benchmark_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(benchmark_clock::now() - start).count();
+}
+
+/**
+ * Run the body repeatedly for at least the specified time, and return the mean time
+ * taken by each run in milliseconds.
+ */
+static inline double mean_time(double minimum, const std::function<void()>& body)
+{
+    std::size_t runs = 0;
+    auto start = benchmark_clock::now();
+    do {
+        body();
+        ++runs;
+    } while (milliseconds_since(start) < minimum);
+    return milliseconds_since(start) / runs;
+}
+
+// MARK: - Files
+
+static inline void write_file(const std::string& path, const std::string& contents)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << contents;
+}
+
+static inline std::string read_file(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static inline uint64_t file_size(const std::string& path)
+{
+    struct stat info;
+    return ::stat(path.c_str(), &info) == 0 ? static_cast<uint64_t>(info.st_size) : 0;
+}
+
+// MARK: - Generated Input
+
+/**
+ * A simple generator keeps every input reproducible.
+ */
+static uint32_t random_state = 0x2545F491;
+
+static inline uint32_t next_random()
+{
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static const char outfit_definition[] =
+    "@define {\n"
+    "    name = \"Outfit\";\n"
+    "    code = \"oütf\";\n"
+    "    field(\"cargo\") {\n"
+    "        value(type = bitmask, size = word, offset = 0, default = none) {\n"
+    "            none = 0; food = 1; industrial = 2; medical = 4; luxury = 8; metal = 16;\n"
+    "        };\n"
+    "    };\n"
+    "    field(\"mass\") {\n"
+    "        value(type = integer, size = word, offset = 2, default = 0);\n"
+    "    };\n"
+    "    field(\"title\") {\n"
+    "        value(type = c_string, size = 64, offset = 4);\n"
+    "    };\n"
+    "}\n";
+
+static const char description_definition[] =
+    "@define {\n"
+    "    name = \"Description\";\n"
+    "    code = \"dësc\";\n"
+    "    field(\"flags\") {\n"
+    "        value(type = integer, size = dword, offset = 0);\n"
+    "    };\n"
+    "    field(\"text\") {\n"
+    "        value(type = c_string, size = 2048, offset = 4);\n"
+    "    };\n"
+    "}\n";
+
+static inline std::string outfit(int64_t id, uint32_t mass)
+{
+    static const char *cargo[] = { "food", "industrial metal", "medical luxury", "food metal" };
+    auto number = std::to_string(id);
+    return "    new (id = #" + number + ", name = \"Outfit " + number + "\") { cargo = " + cargo[id % 4]
+         + "; mass = " + std::to_string(mass) + "; title = \"Outfit number " + number + "\"; }\n";
+}
+
+/**
+ * Returns a source file that declares the specified number of outfits, one per line.
+ */
+static inline std::string outfit_source(int64_t count)
+{
+    std::string source { outfit_definition };
+    source += "declare Outfit {\n";
+    for (int64_t id = 0; id < count; ++id) {
+        source += outfit(id, id % 1000);
+    }
+    source += "}\n";
+    return source;
+}
+
+static inline std::string description_text()
+{
+    static const char *words[] = {
+        "the", "asteroid", "field", "is", "rich", "in", "metal", "and", "a", "pilot", "may",
+        "find", "rare", "minerals", "here", "although", "pirates", "often", "wait", "for",
+        "freighters", "that", "stray", "from", "patrolled", "lanes", "of", "federation", "space"
+    };
+    std::string text;
+    while (true) {
+        std::string word { words[next_random() % (sizeof(words) / sizeof(words[0]))] };
+        if (text.size() + word.size() + 2 >= 2000) {
+            break;
+        }
+        text += (text.empty() ? "" : " ") + word;
+    }
+    return text + ".";
+}
+
+// MARK: - Processes
+
+/**
+ * The path of the `kas` binary, which is built beside this one.
+ */
+static std::string kas_path;
+
+/**
+ * Start `kas` with the specified arguments, sending everything it prints to the log.
+ */
+static inline pid_t spawn(const std::vector<std::string>& arguments, const std::string& log)
+{
+    std::vector<char *> argv { const_cast<char *>(kas_path.c_str()) };
+    for (const auto& argument : arguments) {
+        argv.push_back(const_cast<char *>(argument.c_str()));
+    }
+    argv.push_back(nullptr);
+    
+    auto pid = ::fork();
+    if (pid == 0) {
+        auto fd = ::open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        ::dup2(fd, STDOUT_FILENO);
+        ::dup2(fd, STDERR_FILENO);
+        ::execv(argv[0], argv.data());
+        ::_exit(127);
+    }
+    return pid;
+}
+
+static inline void stop(pid_t pid)
+{
+    ::kill(pid, SIGTERM);
+    ::waitpid(pid, nullptr, 0);
+}
+
+/**
+ * Run `kas` to completion, returning false if it fails. The time that it took, in
+ * milliseconds, is added to `elapsed`.
+ */
+static inline bool run_kas(const std::vector<std::string>& arguments, double& elapsed, const std::string& log = "/dev/null")
+{
+    auto start = benchmark_clock::now();
+    auto pid = spawn(arguments, log);
+    int status = 0;
+    if (pid < 0 || ::waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::fprintf(stderr, "kas failed: %s\n", log.c_str());
+        return false;
+    }
+    elapsed += milliseconds_since(start);
+    return true;
+}
+
+/**
+ * Wait until the log holds the specified number of lines that contain the marker, or
+ * until the timeout in milliseconds passes.
+ */
+static inline bool wait_for_log(const std::string& log, const std::string& marker, std::size_t count, double timeout)
+{
+    auto start = benchmark_clock::now();
+    while (milliseconds_since(start) < timeout) {
+        auto contents = read_file(log);
+        std::size_t found = 0;
+        for (auto n = contents.find(marker); n != std::string::npos; n = contents.find(marker, n + 1)) {
+            ++found;
+        }
+        if (found >= count) {
+            return true;
+        }
+        ::usleep(500);
+    }
+    std::fprintf(stderr, "Timed out waiting for %s\n", log.c_str());
+    return false;
+}
+
+// MARK: - Benchmarks
+
+static inline bool scaling(const std::string& directory)
+{
+    auto input = directory + "/outfits.kdl";
+    write_file(input, outfit_source(120000));
+    std::printf("scaling: 120000 resources, best of 3 runs\n");
+    
+    std::string serial_output;
+    double serial_time = 0;
+    for (auto jobs : { 1, 2, 4, 8, 16 }) {
+        auto output = directory + "/scaling-" + std::to_string(jobs) + ".kdat";
+        auto best = 0.0;
+        for (auto run = 0; run < 3; ++run) {
+            double elapsed = 0;
+            if (!run_kas({ "-j", std::to_string(jobs), "--format", "kestrel", "-o", output, input }, elapsed)) {
+                return false;
+            }
+            best = run == 0 ? elapsed : std::min(best, elapsed);
+        }
+        
+        auto contents = read_file(output);
+        if (jobs == 1) {
+            serial_output = contents;
+            serial_time = best;
+        }
+        else if (contents != serial_output) {
+            std::fprintf(stderr, "scaling: the output of -j %d differs from -j 1\n", jobs);
+            return false;
+        }
+        std::printf("  -j %-2d %10.1f ms %8.2fx\n", jobs, best, serial_time / best);
+    }
+    return true;
+}
+
+static inline bool server(const std::string& directory)
+{
+    auto small = directory + "/two-outfits.kdl";
+    auto large = directory + "/outfits.kdl";
+    auto output = directory + "/server.kdat";
+    auto socket = directory + "/kas.sock";
+    write_file(small, outfit_source(2));
+    write_file(large, outfit_source(120000));
+    ::unlink(socket.c_str());
+    std::printf("server: mean of 20 two resource builds, and of 3 warm 120000 resource builds\n");
+    
+    double cold = 0;
+    for (auto run = 0; run < 20; ++run) {
+        if (!run_kas({ "--format", "kestrel", "-o", output, small }, cold)) {
+            return false;
+        }
+    }
+    std::printf("  new process    %10.2f ms\n", cold / 20);
+    
+    auto pid = spawn({ "--serve", socket }, directory + "/server.log");
+    auto start = benchmark_clock::now();
+    struct stat info;
+    while (::stat(socket.c_str(), &info) != 0 && milliseconds_since(start) < 5000) {
+        ::usleep(1000);
+    }
+    
+    // The first request to the server compiles the definitions, and is not counted.
+    double first = 0;
+    double warm = 0;
+    auto passed = run_kas({ "--connect", socket, "--format", "kestrel", "-o", output, small }, first);
+    for (auto run = 0; passed && run < 20; ++run) {
+        passed = run_kas({ "--connect", socket, "--format", "kestrel", "-o", output, small }, warm);
+    }
+    if (passed) {
+        std::printf("  warm server    %10.2f ms\n", warm / 20);
+    }
+    
+    first = 0;
+    warm = 0;
+    passed = passed && run_kas({ "--connect", socket, "--format", "kestrel", "-o", output, large }, first);
+    for (auto run = 0; passed && run < 3; ++run) {
+        passed = run_kas({ "--connect", socket, "--format", "kestrel", "-o", output, large }, warm);
+    }
+    if (passed) {
+        std::printf("  large, first   %10.1f ms\n", first);
+        std::printf("  large, warm    %10.1f ms\n", warm / 3);
+    }
+    
+    stop(pid);
+    ::unlink(socket.c_str());
+    return passed;
+}
+
+static inline bool watch(const std::string& directory)
+{
+    auto sources = directory + "/watch";
+    ::mkdir(sources.c_str(), 0755);
+    auto definitions = sources + "/definitions.kdl";
+    write_file(definitions, outfit_definition);
+    
+    // Each of the 400 files declares 5 outfits. One field of one of them is edited.
+    std::vector<std::string> arguments { "--watch", "--scenario", definitions, "--format", "kestrel", "-o", directory + "/watch.kdat" };
+    auto edited_source = [&] (int file, uint32_t mass) {
+        std::string source { "declare Outfit {\n" };
+        for (auto n = 0; n < 5; ++n) {
+            source += outfit(file * 5 + n, n == 0 ? mass : n);
+        }
+        return source + "}\n";
+    };
+    for (auto file = 0; file < 400; ++file) {
+        auto path = sources + "/outfits-" + std::to_string(file) + ".kdl";
+        write_file(path, edited_source(file, 0));
+        arguments.push_back(path);
+    }
+    std::printf("watch: 400 files declaring 2000 resources, mean of 5 edits\n");
+    
+    auto log = directory + "/watch.log";
+    const std::string finished { "kas: build finished" };
+    auto start = benchmark_clock::now();
+    auto pid = spawn(arguments, log);
+    if (!wait_for_log(log, finished, 1, 60000)) {
+        stop(pid);
+        return false;
+    }
+    std::printf("  first build    %10.1f ms\n", milliseconds_since(start));
+    
+    // The file watcher starts watching just after reporting a build, so each edit waits
+    // for it to settle.
+    double latency = 0;
+    for (auto edit = 1; edit <= 5; ++edit) {
+        ::usleep(200000);
+        start = benchmark_clock::now();
+        write_file(sources + "/outfits-200.kdl", edited_source(200, 1000 + edit));
+        if (!wait_for_log(log, finished, edit + 1, 60000)) {
+            stop(pid);
+            return false;
+        }
+        latency += milliseconds_since(start);
+    }
+    stop(pid);
+    std::printf("  edit to output %10.1f ms\n", latency / 5);
+    
+    // The driver reports the assembly cache after every build.
+    auto contents = read_file(log);
+    auto cache = contents.rfind("kas: assembly cache: ");
+    if (cache != std::string::npos) {
+        std::printf("  %s\n", contents.substr(cache, contents.find('\n', cache) - cache).c_str());
+    }
+    return true;
+}
+
+static inline void append_message(std::string& stream, const kdk::json& message)
+{
+    auto content = message.dump();
+    stream += "Content-Length: " + std::to_string(content.size()) + "\r\n\r\n" + content;
+}
+
+static inline kdk::json edit_message(const std::string& uri, int line, int column, int end_column, const std::string& text)
+{
+    kdk::json change;
+    change["range"]["start"]["line"] = line;
+    change["range"]["start"]["character"] = column;
+    change["range"]["end"]["line"] = line;
+    change["range"]["end"]["character"] = end_column;
+    change["text"] = text;
+    
+    kdk::json message;
+    message["jsonrpc"] = "2.0";
+    message["method"] = "textDocument/didChange";
+    message["params"]["textDocument"]["uri"] = uri;
+    message["params"]["contentChanges"] = kdk::json::make_array();
+    message["params"]["contentChanges"].push_back(change);
+    return message;
+}
+
+static inline bool lsp(const std::string& directory)
+{
+    auto uri = "file://" + directory + "/document.kdl";
+    auto text = outfit_source(120000);
+    int definition_lines = static_cast<int>(std::count(outfit_definition, outfit_definition + sizeof(outfit_definition) - 1, '\n'));
+    std::printf("lsp: a %zu line document, mean of 20 edits or requests\n", static_cast<std::size_t>(std::count(text.begin(), text.end(), '\n')));
+    
+    // Every message is queued up front, and the server reports the time that it took to
+    // handle each one.
+    std::string input;
+    std::vector<std::string> labels;
+    kdk::json message;
+    message["jsonrpc"] = "2.0";
+    message["id"] = 1;
+    message["method"] = "initialize";
+    message["params"]["capabilities"] = kdk::json::make_object();
+    append_message(input, message);
+    labels.push_back("");
+    
+    message = kdk::json();
+    message["jsonrpc"] = "2.0";
+    message["method"] = "textDocument/didOpen";
+    message["params"]["textDocument"]["uri"] = uri;
+    message["params"]["textDocument"]["version"] = 1;
+    message["params"]["textDocument"]["text"] = text;
+    append_message(input, message);
+    labels.push_back("open");
+    
+    // Keystrokes type into the mass of an outfit half way through the document, and
+    // newlines are added after it. The definition edits change the default mass.
+    auto line = definition_lines + 1 + 60000;
+    auto column = static_cast<int>(outfit(60000, 0).find("mass = ") + 7);
+    for (auto n = 0; n < 20; ++n) {
+        append_message(input, edit_message(uri, line, column, column + 1, std::to_string(n % 9 + 1)));
+        labels.push_back("keystroke");
+    }
+    for (auto n = 0; n < 20; ++n) {
+        append_message(input, edit_message(uri, line + 100 + n * 2, 0, 0, "\n"));
+        labels.push_back("newline");
+    }
+    for (auto n = 0; n < 20; ++n) {
+        message = kdk::json();
+        message["jsonrpc"] = "2.0";
+        message["id"] = 2 + n;
+        message["method"] = "textDocument/completion";
+        message["params"]["textDocument"]["uri"] = uri;
+        message["params"]["position"]["line"] = line + 1;
+        message["params"]["position"]["character"] = column;
+        append_message(input, message);
+        labels.push_back("completion");
+    }
+    std::string mass_default { "default = 0" };
+    std::string definition { outfit_definition };
+    auto default_offset = definition.find(mass_default) + mass_default.size() - 1;
+    auto default_line = static_cast<int>(std::count(definition.begin(), definition.begin() + default_offset, '\n'));
+    auto default_column = static_cast<int>(default_offset - definition.rfind('\n', default_offset) - 1);
+    for (auto n = 0; n < 3; ++n) {
+        append_message(input, edit_message(uri, default_line, default_column, default_column + 1, std::to_string(n + 1)));
+        labels.push_back("definition");
+    }
+    
+    message = kdk::json();
+    message["jsonrpc"] = "2.0";
+    message["id"] = 100;
+    message["method"] = "shutdown";
+    append_message(input, message);
+    labels.push_back("");
+    message = kdk::json();
+    message["jsonrpc"] = "2.0";
+    message["method"] = "exit";
+    append_message(input, message);
+    
+    std::istringstream in { input };
+    std::ostringstream out;
+    std::ostringstream trace;
+    auto standard_error = std::cerr.rdbuf(trace.rdbuf());
+    kdk::language_server language_server { in, out };
+    language_server.set_trace(true);
+    auto status = language_server.run();
+    std::cerr.rdbuf(standard_error);
+    if (status != 0) {
+        std::fprintf(stderr, "lsp: the language server failed\n");
+        return false;
+    }
+    
+    std::vector<std::pair<std::string, std::vector<double>>> times {
+        { "open", {} }, { "keystroke", {} }, { "newline", {} }, { "completion", {} }, { "definition", {} }
+    };
+    std::istringstream lines { trace.str() };
+    std::string report;
+    for (std::size_t n = 0; n < labels.size() && std::getline(lines, report); ++n) {
+        auto handled = report.find(" handled in ");
+        for (auto& time : times) {
+            if (handled != std::string::npos && time.first == labels[n]) {
+                time.second.push_back(std::strtod(report.c_str() + handled + 12, nullptr));
+            }
+        }
+    }
+    for (const auto& time : times) {
+        if (time.second.empty()) {
+            std::fprintf(stderr, "lsp: no time was reported for %s\n", time.first.c_str());
+            return false;
+        }
+        auto total = 0.0;
+        for (auto elapsed : time.second) {
+            total += elapsed;
+        }
+        std::printf("  %-14s %10.2f ms\n", time.first.c_str(), total / time.second.size());
+    }
+    return true;
+}
+
+static inline bool compression(const std::string& directory)
+{
+    auto input = directory + "/descriptions.kdl";
+    std::vector<std::string> texts;
+    std::string source { description_definition };
+    source += "declare Description {\n";
+    for (auto id = 0; id < 20000; ++id) {
+        texts.push_back(description_text());
+        source += "    new (id = #" + std::to_string(id) + ") { flags = " + std::to_string(id % 7) + "; text = \"" + texts.back() + "\"; }\n";
+    }
+    source += "}\n";
+    write_file(input, source);
+    std::printf("compression: 20000 text resources of 2052 bytes, best of 3 runs\n");
+    
+    for (auto compress : { false, true }) {
+        auto output = directory + (compress ? "/compressed.kdat" : "/uncompressed.kdat");
+        std::vector<std::string> arguments { "--format", "kestrel", "-o", output, input };
+        if (compress) {
+            arguments.push_back("--compress");
+        }
+        auto best = 0.0;
+        for (auto run = 0; run < 3; ++run) {
+            double elapsed = 0;
+            if (!run_kas(arguments, elapsed)) {
+                return false;
+            }
+            best = run == 0 ? elapsed : std::min(best, elapsed);
+        }
+        std::printf("  %-12s %10.1f ms %12llu bytes\n", compress ? "compressed" : "uncompressed", best, static_cast<unsigned long long>(file_size(output)));
+    }
+    
+    // Decompression is compared with copying the same data.
+    std::vector<std::vector<char>> resources;
+    std::vector<std::vector<char>> blocks;
+    for (const auto& text : texts) {
+        std::vector<char> data(2052, 0);
+        std::copy(text.begin(), text.end(), data.begin() + 4);
+        std::vector<char> block;
+        if (kdk::kestrel::compress(data.data(), data.size(), block, data.size())) {
+            resources.push_back(data);
+            blocks.push_back(block);
+        }
+    }
+    if (blocks.empty()) {
+        std::fprintf(stderr, "compression: no resource was compressed\n");
+        return false;
+    }
+    
+    std::vector<char> destination(2052);
+    auto passed = true;
+    auto decompress_time = mean_time(500, [&] {
+        for (const auto& block : blocks) {
+            passed = kdk::kestrel::decompress(block.data(), block.size(), destination.data(), destination.size()) && passed;
+        }
+    });
+    auto copy_time = mean_time(500, [&] {
+        for (const auto& data : resources) {
+            std::memcpy(destination.data(), data.data(), data.size());
+        }
+    });
+    if (!passed) {
+        std::fprintf(stderr, "compression: a block did not decompress\n");
+        return false;
+    }
+    auto megabytes = resources.size() * 2052 / 1e6;
+    std::printf("  decompress   %10.1f MB/s\n", megabytes / decompress_time * 1000);
+    std::printf("  copy         %10.1f MB/s\n", megabytes / copy_time * 1000);
+    return true;
+}
+
+static inline const char *encoder_paths()
+{
+#if defined(__SSE2__)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+static inline bool rled(const std::string& directory)
+{
+    // A sheet of 36 frames, each an ellipse that turns from frame to frame, with
+    // transparent corners.
+    kdk::image sheet;
+    sheet.width = 48 * 6;
+    sheet.height = 48 * 6;
+    sheet.pixels.resize(sheet.width * sheet.height * 4);
+    for (uint32_t y = 0; y < sheet.height; ++y) {
+        for (uint32_t x = 0; x < sheet.width; ++x) {
+            auto frame = (y / 48) * 6 + x / 48;
+            auto dx = static_cast<int>(x % 48) - 24;
+            auto dy = static_cast<int>(y % 48) - 24;
+            auto skew = static_cast<int>(frame % 12) - 6;
+            auto inside = (dx + skew * dy / 12) * (dx + skew * dy / 12) * 2 + dy * dy * 3 < 22 * 22 * 3;
+            auto pixel = &sheet.pixels[(y * sheet.width + x) * 4];
+            pixel[0] = static_cast<uint8_t>(96 + dx * 3);
+            pixel[1] = static_cast<uint8_t>(96 + dy * 3);
+            pixel[2] = static_cast<uint8_t>(next_random() % 16 + 64);
+            pixel[3] = inside ? 255 : 0;
+        }
+    }
+    
+    std::size_t count = 0;
+    std::string error;
+    if (!kdk::rled::frame_count(sheet, 48, 48, count, error)) {
+        std::fprintf(stderr, "rled: %s\n", error.c_str());
+        return false;
+    }
+    
+    std::vector<char> data;
+    auto elapsed = mean_time(1000, [&] {
+        for (std::size_t frame = 0; frame < count; ++frame) {
+            kdk::rled::encode_frame(sheet, 48, 48, frame, data);
+        }
+    });
+    std::printf("rled: %zu frames of 48x48, %s\n", count, encoder_paths());
+    std::printf("  encode       %10.1f k frames/s\n", count / elapsed);
+    return true;
+}
+
+static inline bool pict(const std::string& directory)
+{
+    std::printf("pict: interface images, %s\n", encoder_paths());
+    const uint32_t sizes[][2] = { { 640, 480 }, { 1024, 768 }, { 1920, 1080 } };
+    for (const auto& size : sizes) {
+        // A vertical gradient behind flat panels, which hold lines of noisy text.
+        kdk::image image;
+        image.width = size[0];
+        image.height = size[1];
+        image.pixels.resize(image.width * image.height * 4);
+        for (uint32_t y = 0; y < image.height; ++y) {
+            for (uint32_t x = 0; x < image.width; ++x) {
+                auto pixel = &image.pixels[(y * image.width + x) * 4];
+                auto panel = (x % 320) > 16 && (y % 240) > 16;
+                auto text = panel && (x % 320) > 32 && (x % 320) < 288 && (y % 16) < 9 && (y % 240) > 32;
+                auto shade = static_cast<uint8_t>(y * 255 / image.height);
+                pixel[0] = text ? static_cast<uint8_t>(next_random() & 0xFF) : panel ? 48 : shade;
+                pixel[1] = text ? pixel[0] : panel ? 56 : shade / 2;
+                pixel[2] = text ? pixel[0] : panel ? 72 : 96;
+                pixel[3] = 255;
+            }
+        }
+        
+        std::string error;
+        if (!kdk::pict::validate(image, error)) {
+            std::fprintf(stderr, "pict: %s\n", error.c_str());
+            return false;
+        }
+        std::vector<char> data;
+        auto elapsed = mean_time(1000, [&] {
+            kdk::pict::encode_rows(image, 0, image.height, data);
+        });
+        auto megabytes = image.width * image.height * 4 / 1e6;
+        std::printf("  %4ux%-4u    %10.2f ms %8.1f MB/s\n", image.width, image.height, elapsed, megabytes / elapsed * 1000);
+    }
+    return true;
+}
+
+// MARK: - Main
+
+int main(int argc, const char **argv)
+{
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s <work-directory> [scaling|server|watch|lsp|compression|rled|pict ...]\n", argv[0]);
+        return 1;
+    }
+    
+    // Paths are made absolute, since the server and the language server are given them
+    // from elsewhere.
+    ::mkdir(argv[1], 0755);
+    char path[PATH_MAX];
+    if (!::realpath(argv[1], path)) {
+        std::fprintf(stderr, "The work directory %s could not be created.\n", argv[1]);
+        return 1;
+    }
+    std::string directory { path };
+    std::string program { argv[0] };
+    auto separator = program.find_last_of('/');
+    kas_path = (separator == std::string::npos ? std::string(".") : program.substr(0, separator)) + "/kas";
+    
+    const std::vector<std::pair<std::string, std::function<bool(const std::string&)>>> benchmarks {
+        { "scaling", scaling }, { "server", server }, { "watch", watch }, { "lsp", lsp },
+        { "compression", compression }, { "rled", rled }, { "pict", pict }
+    };
+    std::vector<std::string> selected(argv + 2, argv + argc);
+    for (const auto& name : selected) {
+        if (std::none_of(benchmarks.begin(), benchmarks.end(), [&] (const std::pair<std::string, std::function<bool(const std::string&)>>& benchmark) {
+            return benchmark.first == name;
+        })) {
+            std::fprintf(stderr, "There is no benchmark named %s.\n", name.c_str());
+            return 1;
+        }
+    }
+    
+    auto passed = true;
+    for (const auto& benchmark : benchmarks) {
+        if (selected.empty() || std::find(selected.begin(), selected.end(), benchmark.first) != selected.end()) {
+            passed = benchmark.second(directory) && passed;
+            std::fflush(stdout);
+        }
+    }
+    return passed ? 0 : 1;
+}
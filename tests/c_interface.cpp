@@ -0,0 +1,127 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include "api/kdl.h"
+
+// Checks that the names of types handed out by the C interface stay valid until the
+// types of the context change, and that bad arguments are reported as errors rather than
+// escaping as C++ exceptions.
+
+// MARK: - Source
+
+static const char definitions[] =
+    "@define {\n"
+    "    name = \"Outfit\";\n"
+    "    code = \"oütf\";\n"
+    "    field(\"mass\") {\n"
+    "        value(type = integer, size = word, offset = 0);\n"
+    "    };\n"
+    "}\n"
+    "@define {\n"
+    "    name = \"Weapon\";\n"
+    "    code = \"wëap\";\n"
+    "    field(\"damage\") {\n"
+    "        value(type = integer, size = word, offset = 0);\n"
+    "    };\n"
+    "}\n";
+
+static const char more_definitions[] =
+    "@define {\n"
+    "    name = \"Ship\";\n"
+    "    code = \"shïp\";\n"
+    "    field(\"speed\") {\n"
+    "        value(type = integer, size = word, offset = 0);\n"
+    "    };\n"
+    "}\n";
+
+// MARK: - Checks
+
+static inline bool check(bool condition, const char *description)
+{
+    if (!condition) {
+        std::fprintf(stderr, "Failed: %s\n", description);
+    }
+    return condition;
+}
+
+static inline bool check_type_names(kdl_context *context)
+{
+    bool passed = check(kdl_context_type_count(context) == 2, "the scenario defines two types");
+    auto first = kdl_context_type_name(context, 0);
+    auto second = kdl_context_type_name(context, 1);
+    passed = check(first && std::strcmp(first, "Outfit") == 0, "the first type is Outfit") && passed;
+    passed = check(second && std::strcmp(second, "Weapon") == 0, "the second type is Weapon") && passed;
+    passed = check(kdl_context_type_name(context, 2) == nullptr, "there is no third type") && passed;
+    
+    // Asking for the names again, from the first, must not free the names already given.
+    passed = check(kdl_context_type_name(context, 0) == first && kdl_context_type_name(context, 1) == second, "names are not refreshed while the types are unchanged") && passed;
+    passed = check(first && std::strcmp(first, "Outfit") == 0 && std::strcmp(second, "Weapon") == 0, "names stay valid") && passed;
+    
+    // A child sees the types of its parent along with its own.
+    auto child = kdl_context_create(context);
+    if (kdl_context_add_source(child, "more.kdl", more_definitions, sizeof(more_definitions) - 1) != KDL_OK) {
+        std::fprintf(stderr, "%s\n", kdl_context_last_error(child));
+        kdl_context_destroy(child);
+        return false;
+    }
+    auto third = kdl_context_type_name(child, 2);
+    passed = check(kdl_context_type_count(child) == 3 && third && std::strcmp(third, "Ship") == 0, "the child sees three types") && passed;
+    kdl_context_destroy(child);
+    return passed;
+}
+
+static inline bool check_bad_arguments(kdl_context *context)
+{
+    bool passed = check(kdl_context_add_file(context, nullptr) == KDL_ERROR, "a missing path is an error");
+    passed = check(std::strlen(kdl_context_last_error(context)) > 0, "a missing path has a message") && passed;
+    passed = check(kdl_context_add_source(context, "none.kdl", nullptr, 16) == KDL_ERROR, "missing source is an error") && passed;
+    passed = check(kdl_context_add_source(context, nullptr, definitions, sizeof(definitions) - 1) == KDL_ERROR, "a missing name is an error") && passed;
+    passed = check(kdl_context_write(context, nullptr, KDL_FORMAT_KESTREL) == KDL_ERROR, "a missing output path is an error") && passed;
+    passed = check(kdl_context_add_source(context, "empty.kdl", "", 0) == KDL_OK, "an empty source is accepted") && passed;
+    passed = check(std::strlen(kdl_context_last_error(context)) == 0, "success clears the error") && passed;
+    return passed;
+}
+
+// MARK: - Main
+
+int main(int argc, const char **argv)
+{
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <output-path>\n", argv[0]);
+        return 1;
+    }
+    
+    auto context = kdl_context_create(nullptr);
+    if (kdl_context_add_source(context, "definitions.kdl", definitions, sizeof(definitions) - 1) != KDL_OK) {
+        std::fprintf(stderr, "%s\n", kdl_context_last_error(context));
+        kdl_context_destroy(context);
+        return 1;
+    }
+    
+    bool passed = check_type_names(context);
+    passed = check_bad_arguments(context) && passed;
+    passed = check(kdl_context_write(context, argv[1], KDL_FORMAT_KESTREL) == KDL_OK, "the context can still be written") && passed;
+    kdl_context_destroy(context);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "api/kdl.h"
+#include "kestrel/reader.hpp"
+
+// Compiles a type whose fields carry default values, writes a resource that omits them
+// and checks that the defaults were encoded into its data.
+
+// MARK: - Source
+
+static const char source[] =
+    "@define {\n"
+    "    name = \"Outfit\";\n"
+    "    code = \"oütf\";\n"
+    "    field(\"cargo\") {\n"
+    "        value(type = bitmask, size = word, offset = 0, default = medical) {\n"
+    "            none = 0; food = 1; industrial = 2; medical = 4; luxury = 8;\n"
+    "        };\n"
+    "    };\n"
+    "    field(\"mass\") {\n"
+    "        value(type = integer, size = word, offset = 2, default = 300);\n"
+    "    };\n"
+    "}\n"
+    "declare Outfit {\n"
+    "    new (id = #128) { cargo = food luxury; mass = 5; }\n"
+    "    new (id = #129) { }\n"
+    "}\n";
+
+// MARK: - Checks
+
+static void report(void *user_data, int is_error, const char *file, int line, const char *message)
+{
+    std::fprintf(stderr, "%s:%d: %s: %s\n", file, line, is_error ? "error" : "warning", message);
+}
+
+static inline bool check(const kdk::kestrel_reader& reader, int64_t id, const std::vector<unsigned char>& expected)
+{
+    auto resource = reader.find("oütf", id);
+    if (!resource) {
+        std::fprintf(stderr, "Resource #%lld is missing.\n", static_cast<long long>(id));
+        return false;
+    }
+    
+    std::vector<char> data(reader.size(*resource));
+    if (!reader.read(*resource, data.data()) || data.size() < expected.size() || std::memcmp(data.data(), expected.data(), expected.size()) != 0) {
+        std::fprintf(stderr, "Resource #%lld has the wrong data.\n", static_cast<long long>(id));
+        return false;
+    }
+    return true;
+}
+
+// MARK: - Main
+
+int main(int argc, const char **argv)
+{
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <output-path>\n", argv[0]);
+        return 1;
+    }
+    
+    auto context = kdl_context_create(nullptr);
+    kdl_context_set_diagnostic_callback(context, report, nullptr);
+    if (kdl_context_add_source(context, "defaults.kdl", source, sizeof(source) - 1) != KDL_OK ||
+        kdl_context_write(context, argv[1], KDL_FORMAT_KESTREL) != KDL_OK) {
+        std::fprintf(stderr, "%s\n", kdl_context_last_error(context));
+        kdl_context_destroy(context);
+        return 1;
+    }
+    kdl_context_destroy(context);
+    
+    kdk::kestrel_reader reader(argv[1]);
+    bool passed = check(reader, 128, { 0x00, 0x09, 0x00, 0x05 });
+    passed = check(reader, 129, { 0x00, 0x04, 0x01, 0x2C }) && passed;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,224 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "output/kestrel_writer.hpp"
+#include "kestrel/reader.hpp"
+#include "diagnostic/log.hpp"
+
+// Writes resources with the Kestrel writer, reads them back with the Kestrel reader and
+// checks that every resource is found by id and by name with its original data, both
+// with and without compression. Truncated and damaged files must be rejected.
+
+// MARK: - Resources
+
+/**
+ * A resource that is written, and then expected to be read back.
+ */
+struct expected_resource
+{
+    std::string code;
+    int64_t id;
+    std::string name;
+    std::vector<char> data;
+};
+
+static inline std::vector<expected_resource> make_resources()
+{
+    // A simple generator keeps the data reproducible. Some data is repetitive, so that it
+    // is compressed, and some is shared between resources.
+    uint32_t state = 0x2545F491;
+    auto random_bytes = [&] (std::size_t size) {
+        std::vector<char> bytes(size);
+        for (auto& byte : bytes) {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            byte = static_cast<char>(state);
+        }
+        return bytes;
+    };
+    
+    std::vector<expected_resource> resources;
+    const char *codes[] = { "röid", "wëap", "PICT" };
+    for (auto code : codes) {
+        for (int64_t n = 0; n < 200; ++n) {
+            auto id = (n % 2 ? -1 : 1) * (n * 37 + 128);
+            auto name = n % 3 ? std::string(code) + " " + std::to_string(n) : std::string();
+            std::vector<char> data;
+            switch (n % 4) {
+                case 0: data = random_bytes(static_cast<std::size_t>(n * 13)); break;
+                case 1: data = std::vector<char>(static_cast<std::size_t>(n * 61), static_cast<char>(n)); break;
+                case 2: data = std::vector<char>(code, code + std::strlen(code)); break;
+                default: break;
+            }
+            resources.push_back({ code, id, name, data });
+        }
+    }
+    resources.push_back({ "röid", INT64_MAX, "Largest", random_bytes(4096) });
+    resources.push_back({ "röid", INT64_MIN, "Smallest", {} });
+    return resources;
+}
+
+static inline void write_resources(const std::string& path, const std::vector<expected_resource>& resources, bool compresses)
+{
+    kdk::worker_pool pool(4);
+    kdk::kestrel_writer writer(path, compresses);
+    
+    // The first resource is added on its own, and the remainder in batches.
+    std::vector<kdk::resource_writer::assembled_resource> batch;
+    for (auto n = 0; n < resources.size(); ++n) {
+        const auto& resource = resources[n];
+        auto bytes = std::make_shared<std::vector<char>>(resource.data);
+        auto data = std::make_shared<graphite::data::data>(bytes, bytes->size(), 0);
+        if (n == 0) {
+            writer.add_resource(resource.code, resource.id, resource.name, data);
+            continue;
+        }
+        batch.emplace_back(resource.code, resource.id, resource.name, data);
+        if (batch.size() == 64) {
+            writer.add_resources(batch, pool);
+            batch.clear();
+        }
+    }
+    writer.add_resources(batch, pool);
+    writer.finish();
+}
+
+// MARK: - Checks
+
+static inline bool check_entry(const kdk::kestrel_reader& reader, const kdk::kestrel::resource_entry *entry, const expected_resource& resource, const char *lookup)
+{
+    if (!entry) {
+        std::fprintf(stderr, "'%s' #%lld was not found by %s.\n", resource.code.c_str(), static_cast<long long>(resource.id), lookup);
+        return false;
+    }
+    
+    std::vector<char> data(reader.size(*entry));
+    auto name = reader.name(*entry);
+    if (entry->id != resource.id || reader.type(*entry) != resource.code || !name || resource.name != name ||
+        !reader.read(*entry, data.data()) || data != resource.data) {
+        std::fprintf(stderr, "'%s' #%lld found by %s does not match.\n", resource.code.c_str(), static_cast<long long>(resource.id), lookup);
+        return false;
+    }
+    return true;
+}
+
+static inline bool check_round_trip(const std::string& path, bool compresses)
+{
+    auto resources = make_resources();
+    write_resources(path, resources, compresses);
+    
+    kdk::kestrel_reader reader(path);
+    bool passed = true;
+    if (reader.resource_count() != resources.size()) {
+        std::fprintf(stderr, "%s holds %zu resources rather than %zu.\n", path.c_str(), reader.resource_count(), resources.size());
+        passed = false;
+    }
+    
+    bool any_compressed = false;
+    for (const auto& resource : resources) {
+        auto entry = reader.find(resource.code, resource.id);
+        passed = check_entry(reader, entry, resource, "id") && passed;
+        any_compressed = any_compressed || (entry && reader.compressed(*entry));
+        if (!resource.name.empty()) {
+            passed = check_entry(reader, reader.find(resource.code, resource.name), resource, "name") && passed;
+        }
+    }
+    
+    if (any_compressed != compresses) {
+        std::fprintf(stderr, "%s %s compressed resources.\n", path.c_str(), compresses ? "has no" : "unexpectedly has");
+        passed = false;
+    }
+    
+    if (reader.find("röid", 129) || reader.find("röid", "missing") || reader.find("none", 128) || reader.find("toolong", 128)) {
+        std::fprintf(stderr, "%s found a resource that does not exist.\n", path.c_str());
+        passed = false;
+    }
+    return passed;
+}
+
+static inline bool rejects(const std::string& path, const std::vector<char>& bytes, const char *damage)
+{
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(bytes.data(), bytes.size());
+    }
+    
+    log::scope scope(nullptr);
+    try {
+        kdk::kestrel_reader reader(path);
+    }
+    catch (const log::fatal_error&) {
+        return true;
+    }
+    std::fprintf(stderr, "A file that was %s was not rejected.\n", damage);
+    return false;
+}
+
+static inline bool check_rejection(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> bytes { std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+    auto damaged_path = path + ".damaged";
+    
+    bool passed = true;
+    for (auto size : { bytes.size() - 1, bytes.size() / 2, sizeof(kdk::kestrel::header), std::size_t(8), std::size_t(0) }) {
+        passed = rejects(damaged_path, std::vector<char>(bytes.begin(), bytes.begin() + size), "truncated") && passed;
+    }
+    
+    // A truncated file whose header claims the truncated size still has tables that lie
+    // beyond the end of the file.
+    std::vector<char> truncated(bytes.begin(), bytes.end() - 64);
+    uint64_t size = truncated.size();
+    std::memcpy(truncated.data() + offsetof(kdk::kestrel::header, file_size), &size, sizeof(size));
+    passed = rejects(damaged_path, truncated, "truncated and patched") && passed;
+    
+    auto bad_magic = bytes;
+    bad_magic[0] = 'X';
+    passed = rejects(damaged_path, bad_magic, "not a Kestrel file") && passed;
+    
+    std::remove(damaged_path.c_str());
+    return passed;
+}
+
+// MARK: - Main
+
+int main(int argc, const char **argv)
+{
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <output-path>\n", argv[0]);
+        return 1;
+    }
+    
+    std::string path { argv[1] };
+    bool passed = check_round_trip(path, false);
+    passed = check_rejection(path) && passed;
+    passed = check_round_trip(path + ".compressed", true) && passed;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,336 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "kestrel/compression.hpp"
+#include "output/classic_writer.hpp"
+#include "output/extended_writer.hpp"
+#include "output/macroman.hpp"
+
+// Writes resources with the classic and extended writers, reads the files back by
+// walking their resource maps, and checks that every resource is present with its
+// original name and data, decompressing it where the extended writer compressed it.
+// The layouts read here are those of the classic Resource
+// Manager and of `documentation/extended-format.md`.
+
+// MARK: - Resources
+
+/**
+ * A resource that is written, and then expected to be read back.
+ */
+struct expected_resource
+{
+    std::string code;
+    int64_t id;
+    std::string name;
+    std::vector<char> data;
+};
+
+typedef std::map<std::tuple<std::string, int64_t>, std::tuple<std::string, std::vector<char>>> resource_table;
+
+static inline std::vector<expected_resource> make_resources(bool extended)
+{
+    // Some data is shared between resources, and some is empty.
+    std::vector<expected_resource> resources;
+    const char *codes[] = { "röid", "wëap", "PICT" };
+    for (auto code : codes) {
+        for (int64_t n = 0; n < 300; ++n) {
+            auto id = (n % 2 ? -1 : 1) * (n * 37 + 128);
+            auto name = n % 3 ? std::string(code) + " " + std::to_string(n) : std::string();
+            std::vector<char> data;
+            switch (n % 3) {
+                case 0: data = std::vector<char>(static_cast<std::size_t>(n * 7 + 1), static_cast<char>(n)); break;
+                case 1: data = std::vector<char>(code, code + std::strlen(code)); break;
+                default: break;
+            }
+            resources.push_back({ code, id, name, data });
+        }
+    }
+    if (extended) {
+        resources.push_back({ "röid", INT64_MAX, "Largest", std::vector<char>(70000, 'x') });
+        resources.push_back({ "röid", INT64_MIN, std::string(255, 'n'), {} });
+    }
+    return resources;
+}
+
+static inline void write_resources(kdk::resource_writer& writer, const std::vector<expected_resource>& resources)
+{
+    kdk::worker_pool pool(4);
+    
+    // The first resource is added on its own, and the remainder in batches.
+    std::vector<kdk::resource_writer::assembled_resource> batch;
+    for (auto n = 0; n < resources.size(); ++n) {
+        const auto& resource = resources[n];
+        auto bytes = std::make_shared<std::vector<char>>(resource.data);
+        auto data = std::make_shared<graphite::data::data>(bytes, bytes->size(), 0);
+        if (n == 0) {
+            writer.add_resource(resource.code, resource.id, resource.name, data);
+            continue;
+        }
+        batch.emplace_back(resource.code, resource.id, resource.name, data);
+        if (batch.size() == 64) {
+            writer.add_resources(batch, pool);
+            batch.clear();
+        }
+    }
+    writer.add_resources(batch, pool);
+    writer.finish();
+}
+
+// MARK: - Reading
+
+/**
+ * Reads big-endian values from a file, failing if they lie beyond its end.
+ */
+class file_reader
+{
+public:
+    file_reader(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        m_bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    
+    uint64_t size() const
+    {
+        return m_bytes.size();
+    }
+    
+    uint64_t read(uint64_t offset, uint64_t width)
+    {
+        uint64_t value = 0;
+        for (auto n = 0; n < width; ++n) {
+            value = (value << 8) | static_cast<uint8_t>(at(offset + n));
+        }
+        return value;
+    }
+    
+    std::string bytes(uint64_t offset, uint64_t length)
+    {
+        if (length > 0) {
+            at(offset + length - 1);
+        }
+        return std::string(m_bytes.data() + offset, length);
+    }
+    
+    bool failed() const
+    {
+        return m_failed;
+    }
+    
+private:
+    std::vector<char> m_bytes;
+    bool m_failed { false };
+    
+    char at(uint64_t offset)
+    {
+        if (offset >= m_bytes.size()) {
+            m_failed = true;
+            return 0;
+        }
+        return m_bytes[offset];
+    }
+};
+
+static inline bool check_preamble(file_reader& file, const std::string& path, uint64_t preamble, uint64_t width, uint64_t& data_offset, uint64_t& map_offset)
+{
+    // The preamble locates the data area and the map, and is repeated at the start of
+    // the map.
+    data_offset = file.read(preamble, width);
+    map_offset = file.read(preamble + width, width);
+    auto data_length = file.read(preamble + 2 * width, width);
+    auto map_length = file.read(preamble + 3 * width, width);
+    if (data_offset + data_length != map_offset || map_offset + map_length != file.size() ||
+        file.bytes(preamble, 4 * width) != file.bytes(map_offset, 4 * width)) {
+        std::fprintf(stderr, "%s has an inconsistent preamble.\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+static inline bool read_classic(const std::string& path, resource_table& table)
+{
+    file_reader file(path);
+    uint64_t data_offset;
+    uint64_t map_offset;
+    if (!check_preamble(file, path, 0, 4, data_offset, map_offset)) {
+        return false;
+    }
+    
+    auto type_list = map_offset + file.read(map_offset + 24, 2);
+    auto name_list = map_offset + file.read(map_offset + 26, 2);
+    auto type_count = file.read(type_list, 2) + 1;
+    for (auto t = 0; t < type_count; ++t) {
+        auto entry = type_list + 2 + 8 * t;
+        auto code = kdk::macroman::to_utf8(file.bytes(entry, 4));
+        auto count = file.read(entry + 4, 2) + 1;
+        auto references = type_list + file.read(entry + 6, 2);
+        
+        for (auto r = 0; r < count; ++r) {
+            auto reference = references + 12 * r;
+            auto id = static_cast<int16_t>(file.read(reference, 2));
+            auto name_offset = file.read(reference + 2, 2);
+            auto data = data_offset + file.read(reference + 5, 3);
+            
+            std::string name;
+            if (name_offset != 0xFFFF) {
+                name = kdk::macroman::to_utf8(file.bytes(name_list + name_offset + 1, file.read(name_list + name_offset, 1)));
+            }
+            auto bytes = file.bytes(data + 4, file.read(data, 4));
+            table[std::make_tuple(code, id)] = std::make_tuple(name, std::vector<char>(bytes.begin(), bytes.end()));
+        }
+    }
+    
+    if (file.failed()) {
+        std::fprintf(stderr, "%s refers to data beyond its end.\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+static inline bool read_extended(const std::string& path, bool compresses, resource_table& table)
+{
+    uint64_t compressed_count = 0;
+    file_reader file(path);
+    uint64_t data_offset;
+    uint64_t map_offset;
+    if (file.read(0, 8) != 1 || !check_preamble(file, path, 8, 8, data_offset, map_offset)) {
+        return false;
+    }
+    
+    auto type_list = map_offset + file.read(map_offset + 46, 8);
+    auto name_list = map_offset + file.read(map_offset + 54, 8);
+    auto attribute_list = map_offset + file.read(map_offset + 62, 8);
+    auto type_count = file.read(type_list, 8) + 1;
+    for (auto t = 0; t < type_count; ++t) {
+        auto entry = type_list + 8 + 36 * t;
+        auto code = kdk::macroman::to_utf8(file.bytes(entry, 4));
+        auto count = file.read(entry + 4, 8) + 1;
+        auto references = type_list + file.read(entry + 12, 8);
+        if (file.read(entry + 20, 8) != 0) {
+            std::fprintf(stderr, "%s gives '%s' attributes.\n", path.c_str(), code.c_str());
+            return false;
+        }
+        
+        for (auto r = 0; r < count; ++r) {
+            auto reference = references + 29 * r;
+            auto id = static_cast<int64_t>(file.read(reference, 8));
+            auto name_offset = file.read(reference + 8, 8);
+            auto attributes = file.read(reference + 16, 1);
+            auto data = data_offset + file.read(reference + 17, 8);
+            
+            std::string name;
+            if (name_offset != UINT64_MAX) {
+                name = kdk::macroman::to_utf8(file.bytes(name_list + name_offset + 1, file.read(name_list + name_offset, 1)));
+            }
+            auto bytes = file.bytes(data + 8, file.read(data, 8));
+            std::vector<char> contents(bytes.begin(), bytes.end());
+            
+            // Compressed data is its decompressed length followed by an LZ4 block.
+            if (attributes & 0x01) {
+                ++compressed_count;
+                auto size = file.read(data + 8, 8);
+                contents.assign(static_cast<std::size_t>(size), 0);
+                if (bytes.size() < 8 || !kdk::kestrel::decompress(bytes.data() + 8, bytes.size() - 8, contents.data(), contents.size())) {
+                    std::fprintf(stderr, "%s: '%s' #%lld does not decompress.\n", path.c_str(), code.c_str(), static_cast<long long>(id));
+                    return false;
+                }
+            }
+            else if (attributes != 0) {
+                std::fprintf(stderr, "%s: '%s' #%lld has unknown attributes.\n", path.c_str(), code.c_str(), static_cast<long long>(id));
+                return false;
+            }
+            table[std::make_tuple(code, id)] = std::make_tuple(name, contents);
+        }
+    }
+    
+    if (file.failed()) {
+        std::fprintf(stderr, "%s refers to data beyond its end.\n", path.c_str());
+        return false;
+    }
+    if (attribute_list != file.size()) {
+        std::fprintf(stderr, "%s does not end with an empty attribute list.\n", path.c_str());
+        return false;
+    }
+    if (compresses != (compressed_count > 0)) {
+        std::fprintf(stderr, "%s holds %llu compressed resources.\n", path.c_str(), static_cast<unsigned long long>(compressed_count));
+        return false;
+    }
+    return true;
+}
+
+// MARK: - Checks
+
+static inline bool check_round_trip(const std::string& path, bool extended, bool compresses = false)
+{
+    auto resources = make_resources(extended);
+    if (extended) {
+        kdk::extended_writer writer(path, compresses);
+        write_resources(writer, resources);
+    }
+    else {
+        kdk::classic_writer writer(path);
+        write_resources(writer, resources);
+    }
+    
+    resource_table table;
+    if (!(extended ? read_extended(path, compresses, table) : read_classic(path, table))) {
+        return false;
+    }
+    
+    bool passed = true;
+    if (table.size() != resources.size()) {
+        std::fprintf(stderr, "%s holds %zu resources rather than %zu.\n", path.c_str(), table.size(), resources.size());
+        passed = false;
+    }
+    for (const auto& resource : resources) {
+        auto it = table.find(std::make_tuple(resource.code, resource.id));
+        if (it == table.end() || std::get<0>(it->second) != resource.name || std::get<1>(it->second) != resource.data) {
+            std::fprintf(stderr, "%s: '%s' #%lld does not match.\n", path.c_str(), resource.code.c_str(), static_cast<long long>(resource.id));
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+// MARK: - Main
+
+int main(int argc, const char **argv)
+{
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <output-path>\n", argv[0]);
+        return 1;
+    }
+    
+    std::string path { argv[1] };
+    bool passed = check_round_trip(path + ".rsrc", false);
+    passed = check_round_trip(path + ".extended", true) && passed;
+    passed = check_round_trip(path + ".compressed", true, true) && passed;
+    return passed ? 0 : 1;
+}
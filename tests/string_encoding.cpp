@@ -0,0 +1,112 @@
+/*
+* Copyright (c) 2019 Tom Hancocks
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "api/kdl.h"
+#include "kestrel/reader.hpp"
+
+// Compiles types with string fields, writes resources with strings of several lengths and
+// checks that each string is encoded in its own format and stays within its own value.
+
+// MARK: - Source
+
+static const char source[] =
+    "@define {\n"
+    "    name = \"Label\";\n"
+    "    code = \"labl\";\n"
+    "    field(\"label\") {\n"
+    "        value(type = p_string, size = 16, offset = 0, default = \"Asteroid Field\");\n"
+    "    };\n"
+    "    field(\"tag\") {\n"
+    "        value(type = c_string, size = 8, offset = 16);\n"
+    "    };\n"
+    "}\n"
+    "@define {\n"
+    "    name = \"Note\";\n"
+    "    code = \"note\";\n"
+    "    field(\"text\") {\n"
+    "        value(type = string, length = 8, offset = 0);\n"
+    "    };\n"
+    "}\n"
+    "declare Note {\n"
+    "    new (id = #128) { text = \"Note\"; }\n"
+    "}\n"
+    "declare Label {\n"
+    "    new (id = #128) { label = \"This label is far longer than sixteen\"; tag = \"abc\"; }\n"
+    "    new (id = #129) { label = \"Rock\"; tag = \"A tag that is too long\"; }\n"
+    "    new (id = #130) { tag = \"xyz\"; }\n"
+    "}\n";
+
+// MARK: - Checks
+
+static void report(void *user_data, int is_error, const char *file, int line, const char *message)
+{
+    std::fprintf(stderr, "%s:%d: %s: %s\n", file, line, is_error ? "error" : "warning", message);
+}
+
+static inline bool check(const kdk::kestrel_reader& reader, const std::string& code, int64_t id, const std::string& expected)
+{
+    auto resource = reader.find(code, id);
+    if (!resource) {
+        std::fprintf(stderr, "'%s' #%lld is missing.\n", code.c_str(), static_cast<long long>(id));
+        return false;
+    }
+    
+    std::string data(reader.size(*resource), '\0');
+    if (!reader.read(*resource, &data[0]) || data != expected) {
+        std::fprintf(stderr, "'%s' #%lld has the wrong data.\n", code.c_str(), static_cast<long long>(id));
+        return false;
+    }
+    return true;
+}
+
+// MARK: - Main
+
+int main(int argc, const char **argv)
+{
+    if (argc != 2) {
+        std::fprintf(stderr, "Usage: %s <output-path>\n", argv[0]);
+        return 1;
+    }
+    
+    auto context = kdl_context_create(nullptr);
+    kdl_context_set_diagnostic_callback(context, report, nullptr);
+    if (kdl_context_add_source(context, "strings.kdl", source, sizeof(source) - 1) != KDL_OK ||
+        kdl_context_write(context, argv[1], KDL_FORMAT_KESTREL) != KDL_OK) {
+        std::fprintf(stderr, "%s\n", kdl_context_last_error(context));
+        kdl_context_destroy(context);
+        return 1;
+    }
+    kdl_context_destroy(context);
+    
+    // Strings are truncated to the width of their value. A Pascal String keeps one byte
+    // of it for its length, and a C String for its terminator. A string that replaces a
+    // longer default leaves none of the default behind. A plain string is a C String.
+    kdk::kestrel_reader reader(argv[1]);
+    bool passed = check(reader, "labl", 128, std::string("\x0F") + "This label is f" + std::string("abc\0\0\0\0\0", 8));
+    passed = check(reader, "labl", 129, std::string("\x04") + "Rock" + std::string(11, '\0') + std::string("A tag t\0", 8)) && passed;
+    passed = check(reader, "labl", 130, std::string("\x0E") + "Asteroid Field" + std::string("\0xyz\0\0\0\0\0", 9)) && passed;
+    passed = check(reader, "note", 128, std::string("Note\0\0\0\0", 8)) && passed;
+    return passed ? 0 : 1;
+}